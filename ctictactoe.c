@@ -26,16 +26,25 @@
 
 // Necessário para usar alguns recursos definidos pelo padrão POSIX,
 // seguido por sistemas Unix-like como Linux, macOS, etc.
+// (a parte "X/Open" traz coisas como o `SA_RESTART`).
 #if defined (__unix__) || defined (__APPLE__)
-# define _POSIX_C_SOURCE 199309L
+# define _XOPEN_SOURCE 600
+#endif
+// O macOS esconde o `SIGWINCH` quando pedimos só o padrão.
+#if defined (__APPLE__)
+# define _DARWIN_C_SOURCE
 #endif
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
 #include <time.h>
 #include <math.h>
+#include <signal.h>
+#include <stdarg.h>
 
 /**
  * Cabeçalhos específicos de cada sistema, isso
@@ -48,8 +57,32 @@
 # include <windows.h>
 #elif defined (__unix__) || defined (__APPLE__)
 # include <unistd.h>
+# include <fcntl.h>
+# include <poll.h>
 # include <termios.h>
 # include <sys/ioctl.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <sys/resource.h>
+# include <sys/wait.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <pthread.h>
+#endif
+#if defined (__linux__)
+# include <sys/epoll.h>
+#endif
+
+/**
+ * Instruções SIMD (várias contas de uma vez só)
+ * para a rede neural, quando o compilador pode
+ * usar elas. O AVX2 precisa de `-mavx2` ou
+ * `-march=native`, o SSE2 todo x86-64 tem.
+ */
+#if defined (__AVX2__)
+# include <immintrin.h>
+#elif defined (__SSE2__)
+# include <emmintrin.h>
 #endif
 
 /**
@@ -74,1872 +107,14137 @@
 #define ESC "\x1b"
 
 /**
- * Interrompe a execução do
- * programa por `ms` milissegundos.
+ * Opções passadas pela linha de comando.
  */
-void block_delay(uint32_t ms)
+struct ProgramOptions
+{
+    /**
+     * Desliga todas as esperas (`block_delay`),
+     * deixando animações e IAs instantâneas.
+     */
+    bool no_delay;
+    /**
+     * Ninguém está na frente do terminal,
+     * então o jogo não espera confirmações.
+     */
+    bool unattended;
+    /**
+     * Semente fixa para o `rand`,
+     * só vale se `has_seed` for `true`.
+     */
+    unsigned int seed;
+    bool has_seed;
+    /**
+     * Caminho de um roteiro de jogadas,
+     * veja `ScriptInputSource`.
+     */
+    const char *script_path;
+    /**
+     * Quantas partidas jogar sem
+     * interface (`0` para nenhuma).
+     */
+    unsigned long selfplay_games;
+    /**
+     * Os cortexes de cada lado
+     * nas partidas sem interface.
+     */
+    const char *x_ai;
+    const char *o_ai;
+    /**
+     * Arquivo onde gravar as partidas.
+     */
+    const char *record_path;
+    /**
+     * Partidas por bloco do arquivo
+     * (`0` para o padrão).
+     */
+    unsigned long record_block_games;
+    /**
+     * Arquivo de partidas para ler.
+     */
+    const char *read_records_path;
+    /**
+     * Arquivo de partidas para rever
+     * (a partida é escolhida por `game_number`).
+     */
+    const char *replay_path;
+    /**
+     * Partida específica para mostrar
+     * (só vale se `has_game_number` for `true`).
+     */
+    unsigned long game_number;
+    bool has_game_number;
+    /**
+     * Começa com o painel de
+     * estatísticas ligado.
+     */
+    bool stats;
+    /**
+     * Executa os benchmarks.
+     */
+    bool bench;
+    /**
+     * Executa o benchmark de desenho.
+     */
+    bool bench_render;
+    /**
+     * Onde gravar os resultados dos
+     * benchmarks em JSON (opcional).
+     */
+    const char *bench_json_path;
+    /**
+     * Onde gravar a linha do tempo
+     * dos eventos ao sair (opcional).
+     */
+    const char *trace_path;
+    /**
+     * Socket onde hospedar partidas em rede.
+     */
+    const char *server_path;
+    /**
+     * Socket do servidor para jogar em rede.
+     */
+    const char *client_path;
+    /**
+     * Socket do servidor para o gerador de carga,
+     * com quantas conexões e quantas partidas.
+     */
+    const char *loadgen_path;
+    unsigned long loadgen_connections;
+    unsigned long loadgen_matches;
+    /**
+     * Tempo por jogada dos motores
+     * externos, em milissegundos.
+     */
+    unsigned long move_ms;
+    /**
+     * Limite de tempo de cada jogada
+     * das IAs, em milissegundos (`0` para
+     * nenhum), veja `AIBrain`.
+     */
+    unsigned long think_ms;
+    /**
+     * Cortex usado quando o programa
+     * vira um motor externo (`--engine`).
+     */
+    const char *engine_cortex;
+    /**
+     * Profundidade do perft (`0` para nenhum),
+     * a variante e a posição de onde começar.
+     */
+    unsigned long perft_depth;
+    const char *perft_variant;
+    const char *perft_position;
+    /**
+     * Quantas threads usar (`0` para
+     * uma por processador).
+     */
+    unsigned long threads;
+    /**
+     * Arquivo de pesos da rede neural
+     * do cortex `nnue` (opcional).
+     */
+    const char *nnue_path;
+    /**
+     * Onde gravar os pesos treinados (`--train`),
+     * o arquivo de posições, quantas posições
+     * gerar, quantas épocas e o tabuleiro (`m,n,k`).
+     */
+    const char *train_path;
+    const char *dataset_path;
+    unsigned long train_positions;
+    unsigned long epochs;
+    const char *board;
+    /**
+     * Onde gravar a tabela do cortex `rl`
+     * (`--rl-train`), quantas partidas jogar
+     * e a tabela que o cortex usa (`--rl-table`).
+     */
+    const char *rl_train_path;
+    unsigned long rl_games;
+    const char *rl_table_path;
+    /**
+     * O cortex candidato do SPRT (`--sprt`), o
+     * cortex de comparação, as hipóteses (em Elo),
+     * as chances de erro e o limite de partidas.
+     */
+    const char *sprt_candidate;
+    const char *sprt_baseline;
+    double sprt_elo0;
+    double sprt_elo1;
+    double sprt_alpha;
+    double sprt_beta;
+    unsigned long sprt_max_games;
+    /**
+     * Partidas por par do torneio (`--tournament`),
+     * os jogadores (cortexes separados por vírgula)
+     * e o arquivo de partidas para classificar.
+     */
+    unsigned long tournament_games;
+    const char *players;
+    const char *ratings_path;
+    /**
+     * Partidas jogadas ao mesmo tempo
+     * em uma thread (`--crowd`).
+     */
+    unsigned long crowd_games;
+    /**
+     * Cortex da IA que o servidor coloca
+     * contra quem entra (`--server-ai`).
+     */
+    const char *server_ai;
+};
+
+/**
+ * As opções do programa.
+ */
+struct ProgramOptions program_options =
+{
+    .sprt_elo1 = 10,
+    .sprt_alpha = 0.05,
+    .sprt_beta = 0.05,
+};
+
+/**
+ * Um relógio em nanosegundos que
+ * só anda para frente, bom para
+ * medir quanto tempo algo demorou.
+ */
+uint64_t monotonic_ns()
 {
 #if defined (_WIN32)
-    Sleep(ms);
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+    uint64_t rest = counter.QuadPart % frequency.QuadPart;
+    return (seconds * 1000000000ull) + ((rest * 1000000000ull) / frequency.QuadPart);
 #elif defined (__unix__) || defined (__APPLE__)
     struct timespec t = {0};
-    if (ms >= 1000)
-    {
-        t.tv_sec = ms / 1000;
-        t.tv_nsec = (ms % 1000) * 1000000;
-    }
-    else
-        t.tv_nsec = ms * 1000000;
-    nanosleep(&t, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000000ull) + t.tv_nsec;
 #endif
 }
 
 /**
- * Vetor 2D.
+ * Variável "local de thread": cada thread
+ * enxerga a sua própria cópia dela.
  */
-struct Vec2
+#if defined (_MSC_VER)
+# define THREAD_LOCAL __declspec(thread)
+#else
+# define THREAD_LOCAL __thread
+#endif
+
+/**
+ * Operações atômicas: feitas "de uma vez só",
+ * sem que outra thread veja o meio do caminho.
+ *
+ * O C99 não tem `<stdatomic.h>`, então usamos
+ * as do compilador (GCC/Clang) ou do Win32.
+ */
+static inline uint32_t atomic_fetch_add_u32(volatile uint32_t *target, uint32_t value)
 {
-    int32_t x;
-    int32_t y;
-};
+#if defined (_MSC_VER)
+    return (uint32_t)InterlockedExchangeAdd((volatile LONG *)target, (LONG)value);
+#else
+    return __atomic_fetch_add(target, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static inline uint32_t atomic_load_u32(const volatile uint32_t *target)
+{
+#if defined (_MSC_VER)
+    return (uint32_t)InterlockedCompareExchange((volatile LONG *)target, 0, 0);
+#else
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
 
 /**
- * Macro ajudante para vetores inline.
+ * Troca `*target` por `desired` só se ele ainda
+ * for `expected`, e diz se trocou.
  */
-#define vec2(x, y) ((struct Vec2){x, y})
+static inline bool atomic_compare_exchange_u32(volatile uint32_t *target, uint32_t expected, uint32_t desired)
+{
+#if defined (_MSC_VER)
+    return (uint32_t)InterlockedCompareExchange((volatile LONG *)target, (LONG)desired, (LONG)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(target, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline uint64_t atomic_load_u64(const volatile uint64_t *target)
+{
+#if defined (_MSC_VER)
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)target, 0, 0);
+#else
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void atomic_store_u64(volatile uint64_t *target, uint64_t value)
+{
+#if defined (_MSC_VER)
+    InterlockedExchange64((volatile LONG64 *)target, (LONG64)value);
+#else
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline void *atomic_load_ptr(void *const volatile *target)
+{
+#if defined (_MSC_VER)
+    return InterlockedCompareExchangePointer((PVOID volatile *)target, NULL, NULL);
+#else
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void atomic_store_ptr(void *volatile *target, void *value)
+{
+#if defined (_MSC_VER)
+    InterlockedExchangePointer((PVOID volatile *)target, value);
+#else
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+#endif
+}
 
 /**
- * Cor RGB.
+ * Uma thread de trabalho: roda `main(args)`
+ * em paralelo até alguém esperar por ela
+ * com `join_worker_thread`.
+ *
+ * A struct precisa continuar viva (e no mesmo
+ * lugar) até o `join_worker_thread`.
  */
-struct Color
+struct WorkerThread
 {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
+#if defined (_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    void (*main)(void *args);
+    void *args;
 };
 
 /**
- * Macro ajudante para cores inline.
+ * Adapta a `WorkerThread` para o tipo
+ * de função que cada sistema espera.
  */
-#define rgb(r, g, b) ((struct Color){r, g, b})
+#if defined (_WIN32)
+DWORD WINAPI worker_thread_entry(LPVOID a)
+{
+    struct WorkerThread *thread = a;
+    thread->main(thread->args);
+    return 0;
+}
+#else
+void *worker_thread_entry(void *a)
+{
+    struct WorkerThread *thread = a;
+    thread->main(thread->args);
+    return NULL;
+}
+#endif
 
 /**
- * Pega o tamanho do terminal.
+ * Começa a rodar `main(args)` numa thread nova.
+ *
+ * Retorna `false` se o sistema não deixar.
  */
-struct Vec2 display_size()
+bool start_worker_thread(struct WorkerThread *thread, void (*main)(void *args), void *args)
 {
+    thread->main = main;
+    thread->args = args;
 #if defined (_WIN32)
-    CONSOLE_SCREEN_BUFFER_INFO ws = {0};
-    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ws);
-    return vec2(
-        (ws.srWindow.Right - ws.srWindow.Left) + 1,
-        (ws.srWindow.Bottom - ws.srWindow.Top) + 1
-    );
-#elif defined (__unix__) || defined (__APPLE__)
-    struct winsize ws = {0};
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws);
-    return vec2(ws.ws_col, ws.ws_row);
+    thread->handle = CreateThread(NULL, 0, worker_thread_entry, thread, 0, NULL);
+    return thread->handle != NULL;
+#else
+    return pthread_create(&thread->handle, NULL, worker_thread_entry, thread) == 0;
 #endif
 }
 
 /**
- * Reseta todas as formatações.
+ * Espera a thread terminar.
  */
-void reset_formatting()
+void join_worker_thread(struct WorkerThread *thread)
 {
-    printf(ESC"[0m");
+#if defined (_WIN32)
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
 }
 
 /**
- * Entra no modo de escrita em negrito.
+ * Quantos processadores a máquina
+ * tem (pelo menos 1).
  */
-void set_bold()
+unsigned int cpu_count()
 {
-    printf(ESC"[1m");
+#if defined (_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (unsigned int)count : 1;
+#endif
 }
 
 /**
- * Entra no modo de escrita esvaecida.
+ * Um evento da linha do tempo.
+ *
+ * `name` e `arg_name` precisam ser textos
+ * fixos (literais), só o ponteiro é guardado.
  */
-void set_dim()
+struct TraceEvent
 {
-    printf(ESC"[2m");
-}
+    const char *name;
+    const char *arg_name;
+    int64_t arg;
+    /**
+     * Momento do evento (ns desde `trace_origin_ns`).
+     */
+    uint64_t ts_ns;
+    /**
+     * Duração, para eventos `'X'`.
+     */
+    uint64_t dur_ns;
+    /**
+     * Tipo do evento no formato do Chrome:
+     * `'X'` (intervalo) ou `'i'` (instante).
+     */
+    char phase;
+};
 
 /**
- * Entra no modo de escrita em itálico.
+ * Eventos por thread, potência de 2.
+ * Quando enche, os mais velhos são perdidos.
  */
-void set_italic()
-{
-    printf(ESC"[3m");
-}
+#define TRACE_RING_EVENTS 65536
 
 /**
- * Muda a cor de escrita do terminal.
+ * Máximo de threads que podem gravar eventos.
  */
-void set_foreground_color(struct Color color)
-{
-    printf(ESC"[38;2;%u;%u;%um", color.r, color.g, color.b);
-}
+#define TRACE_MAX_THREADS 64
 
 /**
- * Muda a cor de fundo do terminal.
+ * O "anel" de eventos de uma thread.
+ *
+ * Só a própria thread escreve nele (um produtor)
+ * e `head` é publicado depois de cada evento,
+ * então quem lê nunca precisa de trava.
  */
-void set_background_color(struct Color color)
+struct TraceRing
 {
-    printf(ESC"[48;2;%u;%u;%um", color.r, color.g, color.b);
-}
+    volatile uint64_t head;
+    uint32_t thread_id;
+    const char *thread_name;
+    struct TraceEvent events[TRACE_RING_EVENTS];
+};
 
 /**
- * Move o cursor relativamente à
- * sua posição atual.
+ * Liga a gravação de eventos (`--trace`).
+ * Desligada, custa só um `if`.
  */
-void move_cursor(struct Vec2 pos)
+bool trace_enabled = false;
+
+/**
+ * O momento em que a gravação começou.
+ */
+uint64_t trace_origin_ns = 0;
+
+/**
+ * Registro dos anéis de todas as threads.
+ *
+ * `trace_ring_count` é só incrementado, cada
+ * thread pega um lugar próprio e o preenche.
+ */
+struct TraceRing *volatile trace_rings[TRACE_MAX_THREADS] = {0};
+volatile uint32_t trace_ring_count = 0;
+
+/**
+ * O anel da thread atual (criado no primeiro evento).
+ */
+THREAD_LOCAL struct TraceRing *trace_thread_ring = NULL;
+
+/**
+ * Não conseguiu um anel, não tenta de novo.
+ */
+THREAD_LOCAL bool trace_thread_dropped = false;
+
+/**
+ * O anel da thread atual, registrando
+ * um novo se for o primeiro evento dela.
+ */
+struct TraceRing *trace_current_ring()
 {
-    if (pos.x != 0)
-    {
-        if (pos.x < 0)
-            printf(ESC"[%dD", pos.x * -1);
-        else
-            printf(ESC"[%dC", pos.x);
-    }
+    if (trace_thread_ring != NULL || trace_thread_dropped)
+        return trace_thread_ring;
 
-    if (pos.y != 0)
+    uint32_t slot = atomic_fetch_add_u32(&trace_ring_count, 1);
+    struct TraceRing *ring = NULL;
+    if (slot < TRACE_MAX_THREADS)
+        ring = calloc(1, sizeof(struct TraceRing));
+
+    if (ring == NULL)
     {
-        if (pos.y < 0)
-            printf(ESC"[%dA", pos.y * -1);
-        else
-            printf(ESC"[%dB", pos.y);
+        trace_thread_dropped = true;
+        return NULL;
     }
+
+    ring->thread_id = slot + 1;
+    atomic_store_ptr((void *volatile *)&trace_rings[slot], ring);
+    trace_thread_ring = ring;
+    return ring;
 }
 
 /**
- * Define a posição exata do cursor.
- *
- * NOTA: Valores negativos NÃO funcionam.
+ * Dá um nome para a thread atual
+ * na linha do tempo (texto fixo).
  */
-void set_cursor_position(struct Vec2 pos)
+void trace_name_thread(const char *name)
 {
-    printf(ESC"[%d;%dH", pos.y, pos.x);
+    if (!trace_enabled)
+        return;
+
+    struct TraceRing *ring = trace_current_ring();
+    if (ring != NULL)
+        ring->thread_name = name;
 }
 
 /**
- * Põe o cursor no começo do terminal.
+ * Grava um evento no anel da thread atual.
  */
-void rewind_cursor()
+void trace_push(char phase, const char *name, uint64_t start_ns, uint64_t end_ns, const char *arg_name, int64_t arg)
 {
-    set_cursor_position(vec2(0, 0));
+    struct TraceRing *ring = trace_current_ring();
+    if (ring == NULL)
+        return;
+
+    uint64_t head = ring->head;
+    struct TraceEvent *event = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+    event->name = name;
+    event->arg_name = arg_name;
+    event->arg = arg;
+    event->ts_ns = start_ns - trace_origin_ns;
+    event->dur_ns = end_ns - start_ns;
+    event->phase = phase;
+    atomic_store_u64(&ring->head, head + 1);
 }
 
 /**
- * Sempre põe o cursor no começo do terminal.
+ * Começa um intervalo da linha do tempo.
  *
- * Caso `force_clean` seja `true`, todo o terminal
- * é limpo, caso seja `false`, o terminal só
- * será limpo se o terminal mudou te tamanho.
+ * Retorna o momento de início,
+ * ou `0` se a gravação estiver desligada.
  */
-void new_screen_frame(bool force_clean)
+static inline uint64_t trace_span_start()
 {
-    // A função "lembra" do tamanho
-    // anterior do terminal.
-    static struct Vec2 prev_size = {0};
+    return trace_enabled ? monotonic_ns() : 0;
+}
 
-    rewind_cursor();
+/**
+ * Termina um intervalo que começou em `start`.
+ */
+static inline void trace_span_stop(const char *name, uint64_t start, const char *arg_name, int64_t arg)
+{
+    if (start == 0 || !trace_enabled)
+        return;
 
-    struct Vec2 size = display_size();
+    trace_push('X', name, start, monotonic_ns(), arg_name, arg);
+}
 
-    bool size_changed = (prev_size.x != size.x) || (prev_size.y != size.y);
-    
-    if (force_clean || size_changed)
-        printf(ESC"[J");
+/**
+ * Marca um instante na linha do tempo.
+ */
+static inline void trace_instant(const char *name, const char *arg_name, int64_t arg)
+{
+    if (!trace_enabled)
+        return;
 
-    if (size_changed)
-        prev_size = size;
+    uint64_t now = monotonic_ns();
+    trace_push('i', name, now, now, arg_name, arg);
 }
 
 /**
- * Estrutura que guarda
- * configurações do terminal.
+ * Arquivo onde `write_trace_file` grava.
  */
-struct TerminalConfig
-{
-#if defined (_WIN32)
-    UINT __output_codepage;
-    UINT __codepage;
-    DWORD __output_cfg;
-    DWORD __input_cfg;
-#elif defined (__unix__) || defined (__APPLE__)
-    struct termios __input_cfg;
-#endif
-};
+const char *trace_path = NULL;
 
 /**
- * Informações originais do terminal.
- */
-struct TerminalConfig original_terminal_cfg = {0};
-
-/**
- * Restaura as configurações originais do terminal.
+ * Escreve um tempo em ns como
+ * microssegundos, a unidade do formato.
  */
-void restore_terminal(void)
+void write_trace_us(FILE *file, uint64_t ns)
 {
-    // Volta a mostrar o cursor.
-    printf(ESC"[?25h");
-    // Volta para o buffer principal.
-    printf(ESC"[?1049l");
-
-    // Aplicando as configurações originais do terminal.
-#if defined (_WIN32)
-    SetConsoleCP(original_terminal_cfg.__codepage);
-    SetConsoleOutputCP(original_terminal_cfg.__output_codepage);
-    SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), original_terminal_cfg.__input_cfg);
-    SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), original_terminal_cfg.__output_cfg);
-#elif defined (__unix__) || defined (__APPLE__)
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &original_terminal_cfg.__input_cfg);
-#endif
+    fprintf(file, "%llu.%03u", (unsigned long long)(ns / 1000), (unsigned int)(ns % 1000));
 }
 
 /**
- * Em ambos os sistemas:
- *  Configura a entrada do terminal
- *  para ficar no modo "cru", muda
- *  para o buffer alternativo do terminal
- *  e coloca o buffer da `stdout` como `_IONBF` (sem buffer)
+ * Grava todos os anéis em `trace_path` no formato
+ * "Trace Event" do Chrome, que abre no Perfetto
+ * (https://ui.perfetto.dev) e no `chrome://tracing`.
  *
- * Somente no Windows:
- *  Configura a saída para ficar em utf-8, além
- *  de configurar o terminal para aceitar
- *  codes (as sequências que começam com ESC).
+ * Feita para rodar no `atexit`, com as
+ * outras threads já encerradas.
  */
-void setup_terminal()
+void write_trace_file()
 {
-    // Aqui já precisamos fazer configurações
-    // específicas para cada sistema.
-#if defined (_WIN32)
-    original_terminal_cfg.__output_codepage = GetConsoleOutputCP();
-    original_terminal_cfg.__codepage = GetConsoleCP();
-
-    // Dizendo ao terminal para utilizar utf-8
-    // para não nos preocuparmos com caracteres especiais.
-    SetConsoleOutputCP(CP_UTF8);
-    SetConsoleCP(CP_UTF8);
-
-    HANDLE stdout_h = GetStdHandle(STD_OUTPUT_HANDLE);
-    HANDLE stdin_h = GetStdHandle(STD_INPUT_HANDLE);
+    if (!trace_enabled || trace_path == NULL)
+        return;
 
-    GetConsoleMode(stdout_h, &original_terminal_cfg.__output_cfg);
-    GetConsoleMode(stdin_h, &original_terminal_cfg.__input_cfg);
+    trace_enabled = false;
 
-    DWORD stdout_mode = original_terminal_cfg.__output_cfg;
-    DWORD stdin_mode = original_terminal_cfg.__input_cfg;
+    FILE *file = fopen(trace_path, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "não foi possível criar \"%s\"\n", trace_path);
+        return;
+    }
 
-    // Precisamos informar ao terminal que
-    // queremos ser capazes de utilizar as sequências ANSI
-    // (as que começam com ESC).
-    stdout_mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    // Assim como queremos receber sequências ANSI como entrata também.
-    stdin_mode |= ENABLE_VIRTUAL_TERMINAL_INPUT;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ctictactoe\"}}");
 
-    // Finalmente, colocamos a entrada no "modo cru".
-    stdin_mode &= ~(ENABLE_ECHO_INPUT | ENABLE_LINE_INPUT | ENABLE_PROCESSED_INPUT);
+    uint32_t count = trace_ring_count;
+    if (count > TRACE_MAX_THREADS)
+        count = TRACE_MAX_THREADS;
 
-    SetConsoleMode(stdout_h, stdout_mode);
-    SetConsoleMode(stdin_h, stdin_mode);
-#elif defined (__unix__) || defined (__APPLE__)
-    tcgetattr(STDIN_FILENO, &original_terminal_cfg.__input_cfg);
+    for (uint32_t t = 0; t < count; t++)
+    {
+        struct TraceRing *ring = atomic_load_ptr((void *const volatile *)&trace_rings[t]);
+        if (ring == NULL)
+            continue;
 
-    struct termios stdin_trms = original_terminal_cfg.__input_cfg;
-    // Colocando a entrada no "modo cru".
-    stdin_trms.c_lflag &= ~(ECHO | ICANON | ISIG);
+        if (ring->thread_name != NULL)
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                ring->thread_id, ring->thread_name);
 
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &stdin_trms);
-#endif    
-    // Tiramos a bufferização da saída
-    // para não precisarmos ter que usar `\n`
-    // e nem usar `fflush`.
-    // Não é bom para performance
-    // mas deixa as coisas mais simples.
-    setvbuf(stdout, NULL, _IONBF, 0);
+        uint64_t head = atomic_load_u64(&ring->head);
+        uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = first; i < head; i++)
+        {
+            struct TraceEvent *event = &ring->events[i & (TRACE_RING_EVENTS - 1)];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":",
+                event->name, event->phase, ring->thread_id);
+            write_trace_us(file, event->ts_ns);
+            if (event->phase == 'X')
+            {
+                fprintf(file, ",\"dur\":");
+                write_trace_us(file, event->dur_ns);
+            }
+            else
+                fprintf(file, ",\"s\":\"t\"");
+            if (event->arg_name != NULL)
+                fprintf(file, ",\"args\":{\"%s\":%lld}", event->arg_name, (long long)event->arg);
+            fputc('}', file);
+        }
 
-    // Muda para o buffer alternativo.
-    printf(ESC"[?1049h");
-    // Esconde o cursor.
-    printf(ESC"[?25l");
+        free(ring);
+        trace_rings[t] = NULL;
+    }
 
-    rewind_cursor();
+    fprintf(file, "\n]}\n");
+    fclose(file);
+}
 
-    // Quando o programa fechar
-    // `restore_terminal` vai ser chamado
-    // e fazer o terminal voltar ao
-    // normal.
-    atexit(restore_terminal);
+/**
+ * Liga a gravação de eventos, que
+ * será salva em `path` quando o programa sair.
+ */
+void start_tracing(const char *path)
+{
+    trace_path = path;
+    trace_origin_ns = monotonic_ns();
+    trace_enabled = true;
+    trace_name_thread("principal");
+    atexit(write_trace_file);
 }
 
 /**
- * Lê dados brutos direto da
- * entrada do terminal e escreve
- * em `seq` de tamanho `n`.
+ * Interrompe a execução do
+ * programa por `ms` milissegundos.
  *
- * Retorna a quantidade de bytes
- * que leu.
+ * Não faz nada se `program_options.no_delay`
+ * estiver ligado.
  */
-size_t raw_input(uint8_t *seq, size_t n)
+void block_delay(uint32_t ms)
 {
+    if (program_options.no_delay)
+        return;
+
+    uint64_t trace_start = trace_span_start();
+
 #if defined (_WIN32)
-    DWORD rd;
-    ReadFile(GetStdHandle(STD_INPUT_HANDLE), seq, n, &rd, NULL);
-    return rd;
+    Sleep(ms);
 #elif defined (__unix__) || defined (__APPLE__)
-    return read(STDIN_FILENO, seq, n);
+    struct timespec t = {0};
+    if (ms >= 1000)
+    {
+        t.tv_sec = ms / 1000;
+        t.tv_nsec = (ms % 1000) * 1000000;
+    }
+    else
+        t.tv_nsec = ms * 1000000;
+    nanosleep(&t, NULL);
 #endif
+
+    trace_span_stop("block_delay", trace_start, "ms", ms);
 }
 
 /**
- * Inputs processados do teclado.
+ * Liga (1) ou desliga (0) as medições
+ * de tempo das fases do jogo na compilação.
  *
- * NOTA: Não coloquei TODAS as teclas,
- * coloquei apenas o que é conveniente.
+ * Desligadas, elas nem existem no
+ * programa final: `-DPHASE_STATS=0`.
  */
-enum KeyboardInput
+#ifndef PHASE_STATS
+# define PHASE_STATS 1
+#endif
+
+/**
+ * As fases de cada iteração do jogo.
+ */
+enum GamePhase
 {
-    KEY_UNSUPPORTED,
-    KEY_1,
-    KEY_2,
-    KEY_3,
-    KEY_A,
-    KEY_D,
-    KEY_Q,
-    KEY_S,
-    KEY_W,
-    KEY_SPACE,
-    KEY_BACKSPACE,
-    KEY_ESCAPE,
-    KEY_ENTER,
-    KEY_ARROW_UP,
-    KEY_ARROW_DOWN,
-    KEY_ARROW_RIGHT,
-    KEY_ARROW_LEFT,
+    /**
+     * Esperando a entrada (do jogador
+     * ou da IA, incluindo as esperas dela).
+     */
+    INPUT_PHASE,
+    /**
+     * `process_game_state`.
+     */
+    STATE_PHASE,
+    /**
+     * `ai_think`.
+     */
+    AI_PHASE,
+    /**
+     * `render_game`.
+     */
+    RENDER_PHASE,
+    PHASE_COUNT,
 };
 
 /**
- * Função que bloqueia a execução,
- * espera uma entrada do usuário e
- * devolve a tecla representada em
- * `KeyboardInput`.
+ * Nomes das fases, para o painel
+ * e para a linha do tempo.
  */
-enum KeyboardInput keyboard_input()
-{
-    uint8_t seq[9] = {0};
-    size_t seq_n = raw_input(seq, 8);
+const char *phase_names[PHASE_COUNT] = {
+    [INPUT_PHASE] = "entrada",
+    [STATE_PHASE] = "estado",
+    [AI_PHASE] = "IA",
+    [RENDER_PHASE] = "desenho",
+};
 
-    if (seq_n == 1)
-        switch (seq[0])
-        {
-        case '1': return KEY_1;
-        case '2': return KEY_2;
-        case '3': return KEY_3;
-        case 'a': return KEY_A;
-        case 'd': return KEY_D;
-        case 'q': return KEY_Q;
-        case 's': return KEY_S;
-        case 'w': return KEY_W;
-        case ' ': return KEY_SPACE;
-        case 0x7f: return KEY_BACKSPACE;
-        case 0x1b: return KEY_ESCAPE;
-        case '\r': case '\n': return KEY_ENTER;
-        default: return KEY_UNSUPPORTED;
-        }
-    if (seq_n == 3 && seq[0] == 0x1b && seq[1] == '[' && ('A' <= seq[2] && seq[2] <= 'D'))
-        switch (seq[2])
-        {
-        case 'A': return KEY_ARROW_UP;
-        case 'B': return KEY_ARROW_DOWN;
-        case 'C': return KEY_ARROW_RIGHT;
-        case 'D': return KEY_ARROW_LEFT;
-        }
-    return KEY_UNSUPPORTED;
-}
+/**
+ * Quantidade de "baldes" do histograma,
+ * são 4 por potência de 2 de nanosegundos.
+ */
+#define PHASE_HISTOGRAM_BUCKETS 252
 
 /**
- * Define a jogada feita.
+ * Tempos de uma fase.
  */
-enum Move
+struct PhaseStats
 {
-    FREE_MOVE,
-    X_MOVE,
-    O_MOVE,
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t last_ns;
+    uint32_t histogram[PHASE_HISTOGRAM_BUCKETS];
 };
 
 /**
- * O tabuleiro do jogo.
+ * Tempos de todas as fases.
  */
-typedef enum Move GameBoard[3][3];
+struct PhaseStats phase_stats[PHASE_COUNT] = {0};
 
 /**
- * Muda uma jogada de uma célula do tabuleiro.
+ * Liga as medições enquanto o programa roda.
+ * Desligadas, custam só um `if`.
  */
-static inline void set_game_board_cell(GameBoard board, struct Vec2 pos, enum Move move)
-{
-    board[pos.y][pos.x] = move;
-}
+bool phase_stats_enabled = false;
 
 /**
- * Pega a jogada de uma célula do tabuleiro.
+ * Em qual balde do histograma `ns` cai.
+ *
+ * Os 4 primeiros são 0, 1, 2 e 3 ns, depois
+ * cada potência de 2 é dividida em 4 partes.
  */
-static inline enum Move game_board_cell(GameBoard board, struct Vec2 pos)
+static inline size_t phase_histogram_bucket(uint64_t ns)
 {
-    return board[pos.y][pos.x];
+    if (ns < 4)
+        return ns;
+
+    int msb = 63;
+    while (!((ns >> msb) & 1))
+        msb--;
+
+    return ((msb - 1) * 4) + ((ns >> (msb - 2)) & 3);
 }
 
 /**
- * É só um inteiro, ele funciona
- * como uma "matriz de booleanos"
- * para guardar as jogadas de um ator
- * e fazer comparações mais rápido.
- * 
- * NOTA: Apenas os 9 bits menos
- * significativos são realmente
- * importantes.
+ * O maior tempo (em ns) que cai no balde `bucket`.
  */
-typedef uint16_t MovePrint;
+uint64_t phase_histogram_bucket_limit(size_t bucket)
+{
+    if (bucket < 4)
+        return bucket;
+
+    int msb = (bucket / 4) + 1;
+    uint64_t mantissa = 4 + (bucket % 4);
+    return ((mantissa + 1) << (msb - 2)) - 1;
+}
 
 /**
- * Todas as combinações vencedoras.
+ * Começa a medir uma fase.
  *
- * 0-2 => horizontais;
- * 3-5 => verticais;
- * 6 7 => diagonais.
+ * Retorna o momento de início, ou `0` se
+ * as medições e a linha do tempo estiverem desligadas.
  */
-const MovePrint match_move_prints[] = {
-    // Os números estão em octal.
-    // Horizontais.
-    0007, 0070, 0700,
-    // Verticais.
-    0111, 0222, 0444,
-    // Diagnoais.
-    0421, 0124,
-};
+static inline uint64_t phase_timer_start()
+{
+#if PHASE_STATS
+    if (phase_stats_enabled)
+        return monotonic_ns();
+#endif
+    return trace_span_start();
+}
 
 /**
- * Troca um bit do `MovePrint`.
+ * Termina de medir uma fase
+ * que começou em `start`.
+ *
+ * A fase também vira um intervalo
+ * na linha do tempo (`--trace`).
  */
-static inline void edit_move_print(MovePrint *print, struct Vec2 pos, bool bit)
+static inline void phase_timer_stop(enum GamePhase phase, uint64_t start)
 {
-    uint16_t mask = (1 << ((pos.y * 3) + pos.x));
-    if (bit)
-        *print |= mask;
-    else
-        *print &= ~mask;
+    if (start == 0)
+        return;
+
+    uint64_t end = monotonic_ns();
+    if (trace_enabled)
+        trace_push('X', phase_names[phase], start, end, NULL, 0);
+
+#if PHASE_STATS
+    if (!phase_stats_enabled)
+        return;
+
+    uint64_t ns = end - start;
+    struct PhaseStats *stats = &phase_stats[phase];
+    stats->count++;
+    stats->total_ns += ns;
+    stats->last_ns = ns;
+    stats->histogram[phase_histogram_bucket(ns)]++;
+#endif
 }
 
 /**
- * Pega um bit do `MovePrint`.
+ * Estima o percentil `p` (0-100)
+ * de uma fase pelo histograma.
  */
-static inline bool move_print_inspec(MovePrint print, struct Vec2 pos)
+uint64_t phase_stats_percentile(const struct PhaseStats *stats, unsigned int p)
 {
-    return (print & (1 << ((pos.y * 3) + pos.x))) > 0;
+    uint64_t wanted = ((stats->count * p) + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < PHASE_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += stats->histogram[i];
+        if (seen >= wanted && seen > 0)
+            return phase_histogram_bucket_limit(i);
+    }
+    return 0;
 }
 
 /**
- * Estrutura que guarda jogadas
- * separadamente em 3 `MovePrint`s
- * para análise mais fácil.
+ * Tamanho padrão de cada bloco de uma `Arena`.
  */
-struct MovePrintTriplet
-{
-    MovePrint free;
-    MovePrint x;
-    MovePrint o;
-};
+#define ARENA_BLOCK_SIZE (64 * 1024)
 
 /**
- * Gera um `MovePrintTriplet` a
- * partir do tabuleiro do jogo.
+ * Alinhamento de tudo que sai de uma `Arena`,
+ * suficiente para qualquer tipo comum.
  */
-struct MovePrintTriplet get_move_print_triplet(GameBoard board)
+#define ARENA_ALIGNMENT 16
+
+/**
+ * Um bloco de memória de uma `Arena`,
+ * os dados vêm logo depois dele.
+ */
+struct ArenaBlock
 {
-    struct MovePrintTriplet triplet = {0};
-    for (int y = 0; y < 3; y++)
+    struct ArenaBlock *next;
+    size_t cap;
+    size_t used;
+    /**
+     * Só para os dados começarem alinhados.
+     */
+    uint8_t padding[ARENA_ALIGNMENT - (sizeof(size_t) * 3) % ARENA_ALIGNMENT];
+};
+
+/**
+ * Uma "arena" (ou região) de memória: pedir memória
+ * é só andar um ponteiro, e tudo é devolvido de uma
+ * vez, voltando o ponteiro (`arena_rewind`/`arena_reset`).
+ *
+ * Os blocos nunca são devolvidos ao sistema antes
+ * de `close_arena`, então depois que a arena
+ * "esquenta" ela não chama mais o `malloc`.
+ *
+ * Uma arena zerada (`{0}`) já pode ser usada.
+ */
+struct Arena
+{
+    struct ArenaBlock *first;
+    struct ArenaBlock *current;
+    /**
+     * Bytes em uso agora e o máximo já usado.
+     */
+    size_t used;
+    size_t peak;
+    /**
+     * Quantas vezes foi zerada e quantos
+     * blocos pediu ao sistema (`malloc`).
+     */
+    uint64_t resets;
+    uint64_t blocks;
+};
+
+/**
+ * Um ponto da arena para voltar depois.
+ */
+struct ArenaMark
+{
+    struct ArenaBlock *block;
+    size_t block_used;
+    size_t used;
+};
+
+/**
+ * Pede `size` bytes para a arena.
+ *
+ * Retorna `NULL` se faltar memória no sistema.
+ */
+void *arena_alloc(struct Arena *arena, size_t size)
+{
+    size = (size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    struct ArenaBlock *block = arena->current;
+    if (block == NULL || block->cap - block->used < size)
     {
-        for (int x = 0; x < 3; x++)
+        // O próximo bloco já existe e está livre,
+        // basta reaproveitar se couber.
+        struct ArenaBlock *next = (block != NULL) ? block->next : arena->first;
+        if (next != NULL && next->cap >= size)
+            next->used = 0;
+        else
         {
-            MovePrint *print = NULL;
-            enum Move move = game_board_cell(board, vec2(x, y));
-            switch (move)
-            {
-            case FREE_MOVE: print = &triplet.free; break;
-            case X_MOVE: print = &triplet.x; break;
-            case O_MOVE: print = &triplet.o; break;
-            }
-            edit_move_print(print, vec2(x, y), true);
+            size_t cap = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+            struct ArenaBlock *fresh = malloc(sizeof(struct ArenaBlock) + cap);
+            if (fresh == NULL)
+                return NULL;
+
+            *fresh = (struct ArenaBlock){ .next = next, .cap = cap };
+            if (block != NULL)
+                block->next = fresh;
+            else
+                arena->first = fresh;
+            arena->blocks++;
+            next = fresh;
         }
+        arena->current = block = next;
     }
-    return triplet;
+
+    void *memory = (uint8_t *)(block + 1) + block->used;
+    block->used += size;
+    arena->used += size;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    return memory;
 }
 
 /**
- * Retorna a quantidade de
- * jogadas em um `MovePrint`.
+ * Marca onde a arena está agora.
  */
-static inline uint8_t move_print_count(MovePrint print)
+struct ArenaMark arena_mark(struct Arena *arena)
 {
-    uint8_t count = 0;
-    for (int i = 0; i < 9; i++)
-        count += (print >> i) & 1;
-    return count;
+    return (struct ArenaMark)
+    {
+        .block = arena->current,
+        .block_used = (arena->current != NULL) ? arena->current->used : 0,
+        .used = arena->used,
+    };
 }
 
 /**
- * Escreve as coordenadas de cada bit
- * em `print` dentro de `coords`.
- *
- * Use `move_print_count` para saber
- * o atamanho do array.
+ * Devolve tudo que foi pedido depois de `mark`.
  */
-void move_print_coords(MovePrint print, struct Vec2 coords[])
+void arena_rewind(struct Arena *arena, struct ArenaMark mark)
 {
-    int coord_i = 0;
-    for (int i = 0; i < 9; i++)
-        if ((print >> i) & 1)
-        {
-            coords[coord_i] = vec2(i % 3, i / 3);
-            coord_i++;
-        }
+    arena->current = mark.block;
+    if (mark.block != NULL)
+        mark.block->used = mark.block_used;
+    arena->used = mark.used;
 }
 
 /**
- * Compara 2 `MovePrint`s, retornando
- * `true` se a linha estiver pura e
- * e `false` se ela não estiver pura.
- *
- * A pureza da linha é em relação
- * ao `testing`, se houver uma jogada
- * do `opponent` na linha, ela é considerada
- * impura, se só houver jogadas do `testing`
- * ela é pura.
+ * Devolve tudo de uma vez (mas guarda os blocos).
  */
-static inline bool test_move_print_purity(MovePrint testing, MovePrint opponent)
+void arena_reset(struct Arena *arena)
 {
-    return (testing | opponent) == testing;
+    arena_rewind(arena, (struct ArenaMark){0});
+    arena->resets++;
 }
 
 /**
- * Testa se há uma combinação
- * vencedora em uma linha e retorna
- * o `MovePrint`.
+ * Devolve os blocos ao sistema.
  */
-static inline MovePrint test_move_print_winner_line(MovePrint testing, size_t match_index)
+void close_arena(struct Arena *arena)
 {
-    if ((testing & match_move_prints[match_index]) == match_move_prints[match_index])
-        return match_move_prints[match_index];
-    return 0;
+    struct ArenaBlock *block = arena->first;
+    while (block != NULL)
+    {
+        struct ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    *arena = (struct Arena){0};
 }
 
 /**
- * Pega todas as jogadas consideradas
- * vencedoras e as retorna como `MovePrint`.
+ * Vetor 2D.
  */
-MovePrint test_move_print_winner(MovePrint testing)
+struct Vec2
 {
-    MovePrint result = 0;
-    for (int i = 0; i < 8; i++)
-        result |= test_move_print_winner_line(testing, i);
-    return result;
-}
+    int32_t x;
+    int32_t y;
+};
 
 /**
- * Representa o símbolo que vai jogar.
+ * Macro ajudante para vetores inline.
  */
-enum Actor
+#define vec2(x, y) ((struct Vec2){x, y})
+
+/**
+ * Cor RGB.
+ */
+struct Color
 {
-    NULL_ACTOR,
-    X_ACTOR,
-    O_ACTOR,
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
 };
 
 /**
- * Converte de `Actor` para `Move`.
+ * Macro ajudante para cores inline.
  */
-#define actor_to_move(a) ((enum Move)a)
+#define rgb(r, g, b) ((struct Color){r, g, b})
 
 /**
- * Retorna o `Actor` oponente.
+ * Indica que o terminal mudou de tamanho
+ * e que o tamanho guardado está velho.
+ *
+ * Começa como `true` para que a primeira
+ * chamada de `display_size` pergunte o
+ * tamanho ao sistema.
  */
-#define opponent_actor(a) ((a == NULL_ACTOR) ? NULL_ACTOR : ((a == X_ACTOR) ? O_ACTOR : X_ACTOR))
+volatile sig_atomic_t display_resized = true;
 
 /**
- * A cor que não representa
- * nenhum jogador :^)
+ * Quando `x` for maior que zero, é usado
+ * no lugar do tamanho real do terminal.
  */
-#define NULL_ACTOR_COLOR rgb(178, 82, 218);
+struct Vec2 display_size_override = {0};
 
+#if defined (__unix__) || defined (__APPLE__)
 /**
- * Pega a cor que representa o símbolo.
+ * Marca `fd` para ser fechado sozinho
+ * quando o programa chamar `exec`, para
+ * que processos filhos (os motores
+ * externos) não herdem os nossos
+ * arquivos, canos e sockets.
  */
-struct Color actor_color(enum Actor actor)
+void close_on_exec(int fd)
 {
-    switch (actor)
-    {
-    case X_ACTOR:
-        return rgb(255, 51, 136);
-    case O_ACTOR:
-        return rgb(64, 204, 255);
-    case NULL_ACTOR:
-        return NULL_ACTOR_COLOR;
-    }
+    if (fd >= 0)
+        fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
 }
 
 /**
- * Representa a continuidade
- * ou final do jogo.
+ * Um "cano" (pipe) que o tratador do
+ * sinal `SIGWINCH` usa para acordar
+ * quem estiver esperando uma tecla.
+ *
+ * `[0]` é o lado de leitura e
+ * `[1]` é o lado de escrita.
  */
-enum EndGame
+int display_resize_pipe[2] = {-1, -1};
+
+/**
+ * Tratador do sinal `SIGWINCH`, que
+ * o sistema envia quando o terminal
+ * muda de tamanho.
+ *
+ * Dentro de um tratador de sinal só
+ * podemos fazer coisas bem simples,
+ * então só marcamos a mudança e
+ * escrevemos um byte no "cano".
+ */
+void on_display_resize(int signal_number)
 {
-    RUNNING,
-    GAME_DRAW,
-    X_VICTORY,
-    O_VICTORY,
-};
+    (void)signal_number;
+    display_resized = true;
+    if (display_resize_pipe[1] >= 0)
+        (void)!write(display_resize_pipe[1], "", 1);
+}
+#endif
 
 /**
- * Pega a cor do emapte (velha).
+ * Pega o tamanho do terminal.
+ *
+ * No Unix o tamanho fica guardado e
+ * só é perguntado de novo ao sistema
+ * (o que custa uma chamada `ioctl`)
+ * depois de um `SIGWINCH`.
+ *
+ * O Windows não tem `SIGWINCH`, então
+ * lá continuamos perguntando sempre.
  */
-struct Color game_draw_color()
+struct Vec2 display_size()
 {
-    return NULL_ACTOR_COLOR;
+    // Os benchmarks fixam o tamanho para
+    // não depender do terminal.
+    if (display_size_override.x > 0)
+        return display_size_override;
+
+#if defined (_WIN32)
+    CONSOLE_SCREEN_BUFFER_INFO ws = {0};
+    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ws);
+    return vec2(
+        (ws.srWindow.Right - ws.srWindow.Left) + 1,
+        (ws.srWindow.Bottom - ws.srWindow.Top) + 1
+    );
+#elif defined (__unix__) || defined (__APPLE__)
+    static struct Vec2 size = {0};
+
+    if (display_resized)
+    {
+        // Desmarcamos antes de perguntar, assim
+        // um sinal que chegar no meio do caminho
+        // não é perdido.
+        display_resized = false;
+
+        struct winsize ws = {0};
+        ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws);
+        size = vec2(ws.ws_col, ws.ws_row);
+    }
+
+    return size;
+#endif
 }
 
 /**
- * Representa todo o estado do jogo.
+ * Para onde vai tudo que é desenhado
+ * no terminal.
+ *
+ * Normalmente é a `stdout`, que está sem
+ * buffer, então cada escrita vira uma
+ * chamada ao sistema (`write`). Os benchmarks
+ * trocam o destino para medir a interface
+ * sem depender de um terminal de verdade.
  */
-struct GameState
+struct TerminalSink
 {
     /**
-     * A grade 3x3 do jogo.
-     */
-    GameBoard board;
-    /**
-     * A seleção atual do jogador (ou IA).
+     * Onde escrever (`NULL` é a `stdout`).
      */
-    struct Vec2 selection;
+    FILE *file;
     /**
-     * Quem vai jogar.
+     * Só conta, não escreve em lugar nenhum.
      */
-    enum Actor turn;
+    bool discard;
     /**
-     * Quantidade de jogadas.
+     * Total de bytes escritos.
      */
-    uint8_t moves;
+    uint64_t bytes;
     /**
-     * Continuidade do jogo.
+     * Total de escritas, com um arquivo
+     * sem buffer cada uma é uma chamada ao sistema.
      */
-    enum EndGame endgame;
+    uint64_t writes;
 };
 
 /**
- * Desenha o símbolo representando o ator
- * usando a sua cor respectiva.
+ * O destino atual da saída do terminal.
  */
-void draw_game_actor(enum Actor actor)
-{
-    if (actor != NULL_ACTOR)
-        set_foreground_color(actor_color(actor));
+struct TerminalSink terminal_sink = {0};
 
-    switch (actor)
-    {
-    case O_ACTOR:
-        putchar('O');
-        break;
-    case X_ACTOR:
-        putchar('X');
-        break;
-    case NULL_ACTOR:
-        putchar(' ');
-        break;
-    }
-    if (actor != NULL_ACTOR)
-        reset_formatting();
+/**
+ * Escreve `n` bytes no terminal.
+ */
+void terminal_write(const void *data, size_t n)
+{
+    terminal_sink.bytes += n;
+    terminal_sink.writes++;
+    if (!terminal_sink.discard)
+        fwrite(data, 1, n, (terminal_sink.file != NULL) ? terminal_sink.file : stdout);
 }
 
 /**
- * Desenha o quadro em volta das células do tabuleiro.
+ * Igual ao `printf`, mas escreve
+ * no destino do terminal.
+ *
+ * NOTA: Textos maiores que 255 bytes
+ * são cortados, use `terminal_write`.
  */
-void render_game_frame(enum EndGame endgame)
+void terminal_printf(const char *format, ...)
 {
-    set_bold();
-
-    if (endgame == GAME_DRAW)
-        set_foreground_color(game_draw_color());
-    else if (endgame == X_VICTORY)
-        set_foreground_color(actor_color(X_ACTOR));
-    else if (endgame == O_VICTORY)
-        set_foreground_color(actor_color(O_ACTOR));
+    char buffer[256];
 
-    printf("╭─ C Tic Tac Toe ─╮");
-    move_cursor(vec2(-19, 1));
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
 
-    for (int i = 0 ; i < 9; i++)
-    {
-        printf("│");
-        move_cursor(vec2(17, 0));
-        printf("│");
-        move_cursor(vec2(-19, 1));
-    }
+    if (n < 0)
+        return;
+    if ((size_t)n >= sizeof(buffer))
+        n = sizeof(buffer) - 1;
+    terminal_write(buffer, n);
+}
 
-    printf("╰─────────────────╯");
-    reset_formatting();
+/**
+ * Igual ao `putchar`, mas escreve
+ * no destino do terminal.
+ */
+void terminal_putchar(char c)
+{
+    terminal_write(&c, 1);
 }
 
 /**
- * Desenha a continuidade do jogo.
+ * Reseta todas as formatações.
  */
-void render_endgame(enum EndGame endgame, enum Actor turn, int moves)
+void reset_formatting()
 {
-    switch (endgame)
-    {
-    case GAME_DRAW:
-        set_background_color(game_draw_color());
-        printf("    Deu velha!     ");
-        break;
-    case O_VICTORY:
-        set_background_color(actor_color(O_ACTOR));
-        printf("  O é o vencedor!  ");
-        break;
-    case X_VICTORY:
-        set_background_color(actor_color(X_ACTOR));
-        printf("  X é o vencedor!  ");
-        break;
-    case RUNNING:
-        printf("     Turno: ");
-        draw_game_actor(turn);
-        move_cursor(vec2(-13, 1));
-        reset_formatting();
-        return;
-    }
-    reset_formatting();
-    move_cursor(vec2(-19, 1));
+    terminal_printf(ESC"[0m");
 }
 
 /**
- * Desenha a jogada.
+ * Entra no modo de escrita em negrito.
  */
-void draw_game_move(enum Move move)
+void set_bold()
 {
-    switch (move)
-    {
-    case FREE_MOVE:
+    terminal_printf(ESC"[1m");
+}
+
+/**
+ * Entra no modo de escrita esvaecida.
+ */
+void set_dim()
+{
+    terminal_printf(ESC"[2m");
+}
+
+/**
+ * Entra no modo de escrita em itálico.
+ */
+void set_italic()
+{
+    terminal_printf(ESC"[3m");
+}
+
+/**
+ * Muda a cor de escrita do terminal.
+ */
+void set_foreground_color(struct Color color)
+{
+    terminal_printf(ESC"[38;2;%u;%u;%um", color.r, color.g, color.b);
+}
+
+/**
+ * Muda a cor de fundo do terminal.
+ */
+void set_background_color(struct Color color)
+{
+    terminal_printf(ESC"[48;2;%u;%u;%um", color.r, color.g, color.b);
+}
+
+/**
+ * Move o cursor relativamente à
+ * sua posição atual.
+ */
+void move_cursor(struct Vec2 pos)
+{
+    if (pos.x != 0)
+    {
+        if (pos.x < 0)
+            terminal_printf(ESC"[%dD", pos.x * -1);
+        else
+            terminal_printf(ESC"[%dC", pos.x);
+    }
+
+    if (pos.y != 0)
+    {
+        if (pos.y < 0)
+            terminal_printf(ESC"[%dA", pos.y * -1);
+        else
+            terminal_printf(ESC"[%dB", pos.y);
+    }
+}
+
+/**
+ * Define a posição exata do cursor.
+ *
+ * NOTA: Valores negativos NÃO funcionam.
+ */
+void set_cursor_position(struct Vec2 pos)
+{
+    terminal_printf(ESC"[%d;%dH", pos.y, pos.x);
+}
+
+/**
+ * Põe o cursor no começo do terminal.
+ */
+void rewind_cursor()
+{
+    set_cursor_position(vec2(0, 0));
+}
+
+/**
+ * Sempre põe o cursor no começo do terminal.
+ *
+ * Caso `force_clean` seja `true`, todo o terminal
+ * é limpo, caso seja `false`, o terminal só
+ * será limpo se o terminal mudou te tamanho.
+ */
+void new_screen_frame(bool force_clean)
+{
+    // A função "lembra" do tamanho
+    // anterior do terminal.
+    static struct Vec2 prev_size = {0};
+
+    rewind_cursor();
+
+    struct Vec2 size = display_size();
+
+    bool size_changed = (prev_size.x != size.x) || (prev_size.y != size.y);
+    
+    if (force_clean || size_changed)
+        terminal_printf(ESC"[J");
+
+    if (size_changed)
+        prev_size = size;
+}
+
+/**
+ * Estrutura que guarda
+ * configurações do terminal.
+ */
+struct TerminalConfig
+{
+#if defined (_WIN32)
+    UINT __output_codepage;
+    UINT __codepage;
+    DWORD __output_cfg;
+    DWORD __input_cfg;
+#elif defined (__unix__) || defined (__APPLE__)
+    struct termios __input_cfg;
+#endif
+};
+
+/**
+ * Informações originais do terminal.
+ */
+struct TerminalConfig original_terminal_cfg = {0};
+
+/**
+ * Restaura as configurações originais do terminal.
+ */
+void restore_terminal(void)
+{
+    // Volta a mostrar o cursor.
+    terminal_printf(ESC"[?25h");
+    // Volta para o buffer principal.
+    terminal_printf(ESC"[?1049l");
+
+    // Aplicando as configurações originais do terminal.
+#if defined (_WIN32)
+    SetConsoleCP(original_terminal_cfg.__codepage);
+    SetConsoleOutputCP(original_terminal_cfg.__output_codepage);
+    SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), original_terminal_cfg.__input_cfg);
+    SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), original_terminal_cfg.__output_cfg);
+#elif defined (__unix__) || defined (__APPLE__)
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &original_terminal_cfg.__input_cfg);
+#endif
+}
+
+/**
+ * Em ambos os sistemas:
+ *  Configura a entrada do terminal
+ *  para ficar no modo "cru", muda
+ *  para o buffer alternativo do terminal
+ *  e coloca o buffer da `stdout` como `_IONBF` (sem buffer)
+ *
+ * Somente no Windows:
+ *  Configura a saída para ficar em utf-8, além
+ *  de configurar o terminal para aceitar
+ *  codes (as sequências que começam com ESC).
+ */
+void setup_terminal()
+{
+    // Aqui já precisamos fazer configurações
+    // específicas para cada sistema.
+#if defined (_WIN32)
+    original_terminal_cfg.__output_codepage = GetConsoleOutputCP();
+    original_terminal_cfg.__codepage = GetConsoleCP();
+
+    // Dizendo ao terminal para utilizar utf-8
+    // para não nos preocuparmos com caracteres especiais.
+    SetConsoleOutputCP(CP_UTF8);
+    SetConsoleCP(CP_UTF8);
+
+    HANDLE stdout_h = GetStdHandle(STD_OUTPUT_HANDLE);
+    HANDLE stdin_h = GetStdHandle(STD_INPUT_HANDLE);
+
+    GetConsoleMode(stdout_h, &original_terminal_cfg.__output_cfg);
+    GetConsoleMode(stdin_h, &original_terminal_cfg.__input_cfg);
+
+    DWORD stdout_mode = original_terminal_cfg.__output_cfg;
+    DWORD stdin_mode = original_terminal_cfg.__input_cfg;
+
+    // Precisamos informar ao terminal que
+    // queremos ser capazes de utilizar as sequências ANSI
+    // (as que começam com ESC).
+    stdout_mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    // Assim como queremos receber sequências ANSI como entrata também.
+    stdin_mode |= ENABLE_VIRTUAL_TERMINAL_INPUT;
+
+    // Finalmente, colocamos a entrada no "modo cru".
+    stdin_mode &= ~(ENABLE_ECHO_INPUT | ENABLE_LINE_INPUT | ENABLE_PROCESSED_INPUT);
+
+    SetConsoleMode(stdout_h, stdout_mode);
+    SetConsoleMode(stdin_h, stdin_mode);
+#elif defined (__unix__) || defined (__APPLE__)
+    tcgetattr(STDIN_FILENO, &original_terminal_cfg.__input_cfg);
+
+    struct termios stdin_trms = original_terminal_cfg.__input_cfg;
+    // Colocando a entrada no "modo cru".
+    stdin_trms.c_lflag &= ~(ECHO | ICANON | ISIG);
+
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &stdin_trms);
+
+    // Preparando o "cano" e o tratador do `SIGWINCH`
+    // para sabermos na hora quando o terminal
+    // mudar de tamanho.
+    if (pipe(display_resize_pipe) == 0)
+    {
+        fcntl(display_resize_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(display_resize_pipe[1], F_SETFL, O_NONBLOCK);
+        close_on_exec(display_resize_pipe[0]);
+        close_on_exec(display_resize_pipe[1]);
+    }
+
+    struct sigaction resize_action = {0};
+    resize_action.sa_handler = on_display_resize;
+    resize_action.sa_flags = SA_RESTART;
+    sigemptyset(&resize_action.sa_mask);
+    sigaction(SIGWINCH, &resize_action, NULL);
+#endif    
+    // Tiramos a bufferização da saída
+    // para não precisarmos ter que usar `\n`
+    // e nem usar `fflush`.
+    // Não é bom para performance
+    // mas deixa as coisas mais simples.
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    // Muda para o buffer alternativo.
+    terminal_printf(ESC"[?1049h");
+    // Esconde o cursor.
+    terminal_printf(ESC"[?25l");
+
+    rewind_cursor();
+
+    // Quando o programa fechar
+    // `restore_terminal` vai ser chamado
+    // e fazer o terminal voltar ao
+    // normal.
+    atexit(restore_terminal);
+}
+
+/**
+ * Lê dados brutos direto da
+ * entrada do terminal e escreve
+ * em `seq` de tamanho `n`.
+ *
+ * Retorna a quantidade de bytes
+ * que leu.
+ */
+size_t raw_input(uint8_t *seq, size_t n)
+{
+#if defined (_WIN32)
+    DWORD rd;
+    ReadFile(GetStdHandle(STD_INPUT_HANDLE), seq, n, &rd, NULL);
+    return rd;
+#elif defined (__unix__) || defined (__APPLE__)
+    ssize_t rd = read(STDIN_FILENO, seq, n);
+    return (rd > 0) ? (size_t)rd : 0;
+#endif
+}
+
+/**
+ * Inputs processados do teclado.
+ *
+ * NOTA: Não coloquei TODAS as teclas,
+ * coloquei apenas o que é conveniente.
+ */
+enum KeyboardInput
+{
+    KEY_UNSUPPORTED,
+    KEY_0,
+    KEY_1,
+    KEY_2,
+    KEY_3,
+    KEY_4,
+    KEY_5,
+    KEY_6,
+    KEY_7,
+    KEY_8,
+    KEY_9,
+    KEY_A,
+    KEY_D,
+    KEY_Q,
+    KEY_R,
+    KEY_S,
+    KEY_T,
+    KEY_U,
+    KEY_W,
+    KEY_SPACE,
+    KEY_TAB,
+    KEY_BACKSPACE,
+    KEY_ESCAPE,
+    KEY_ENTER,
+    KEY_ARROW_UP,
+    KEY_ARROW_DOWN,
+    KEY_ARROW_RIGHT,
+    KEY_ARROW_LEFT,
+    /**
+     * Não é uma tecla, indica que
+     * o terminal mudou de tamanho e
+     * a tela precisa ser redesenhada.
+     */
+    KEY_RESIZE,
+};
+
+/**
+ * Resultados possíveis de `wait_raw_input`.
+ */
+enum RawInputWait
+{
+    RAW_INPUT_READY,
+    RAW_INPUT_TIMEOUT,
+    RAW_INPUT_RESIZED,
+};
+
+/**
+ * Bloqueia até que a entrada do
+ * terminal tenha algo para ler, ou
+ * até passarem `timeout_ms` milissegundos
+ * (um valor negativo espera para sempre).
+ *
+ * Retorna `RAW_INPUT_RESIZED` se o terminal
+ * mudar de tamanho antes disso.
+ */
+enum RawInputWait wait_raw_input(int timeout_ms)
+{
+#if defined (_WIN32)
+    DWORD wait = WaitForSingleObject(
+        GetStdHandle(STD_INPUT_HANDLE),
+        (timeout_ms < 0) ? INFINITE : (DWORD)timeout_ms
+    );
+    return (wait == WAIT_TIMEOUT) ? RAW_INPUT_TIMEOUT : RAW_INPUT_READY;
+#elif defined (__unix__) || defined (__APPLE__)
+    struct pollfd fds[] = {
+        { .fd = STDIN_FILENO, .events = POLLIN },
+        { .fd = display_resize_pipe[0], .events = POLLIN },
+    };
+
+    while (true)
+    {
+        int ready = poll(fds, 2, timeout_ms);
+        if (ready < 0)
+            continue;
+        if (ready == 0)
+            return RAW_INPUT_TIMEOUT;
+
+        if (fds[1].revents & POLLIN)
+        {
+            // Esvaziando o "cano", vários sinais
+            // seguidos valem como um só.
+            uint8_t drain[16];
+            while (read(display_resize_pipe[0], drain, sizeof(drain)) > 0);
+            return RAW_INPUT_RESIZED;
+        }
+
+        if (fds[0].revents)
+            return RAW_INPUT_READY;
+    }
+#endif
+}
+
+/**
+ * Quanto tempo (em milissegundos) esperamos
+ * pelo resto de uma sequência depois de
+ * um ESC, antes de decidir que a tecla
+ * ESC foi apertada sozinha.
+ */
+#define ESCAPE_TIMEOUT_MS 50
+
+/**
+ * Tamanho do buffer circular da entrada.
+ */
+#define INPUT_RING_SIZE 64
+
+/**
+ * Decodificador da entrada do teclado.
+ *
+ * Quando várias teclas chegam juntas
+ * (tecla segurada, digitação rápida, colar
+ * texto, SSH lento...) um único `read` traz
+ * várias teclas de uma vez, e uma sequência
+ * ANSI pode até chegar cortada entre dois
+ * `read`s. Por isso os bytes lidos ficam num
+ * buffer circular e são decodificados
+ * um por um, conforme forem pedidos.
+ */
+struct InputDecoder
+{
+    uint8_t ring[INPUT_RING_SIZE];
+    /**
+     * Onde começam os bytes ainda não decodificados.
+     */
+    size_t start;
+    /**
+     * Quantos bytes ainda não foram decodificados.
+     */
+    size_t len;
+};
+
+/**
+ * O decodificador da entrada do terminal.
+ */
+struct InputDecoder input_decoder = {0};
+
+/**
+ * Pega o byte `i` (contando a partir
+ * do início) do decodificador.
+ */
+static inline uint8_t input_decoder_peek(struct InputDecoder *dec, size_t i)
+{
+    return dec->ring[(dec->start + i) % INPUT_RING_SIZE];
+}
+
+/**
+ * Descarta `n` bytes do início do decodificador.
+ */
+static inline void input_decoder_consume(struct InputDecoder *dec, size_t n)
+{
+    dec->start = (dec->start + n) % INPUT_RING_SIZE;
+    dec->len -= n;
+}
+
+/**
+ * Lê o que tiver na entrada do terminal
+ * para dentro do espaço livre do decodificador.
+ */
+void input_decoder_fill(struct InputDecoder *dec)
+{
+    size_t end = (dec->start + dec->len) % INPUT_RING_SIZE;
+    size_t free_space = INPUT_RING_SIZE - dec->len;
+    // Só lemos a parte contínua, o resto
+    // vem na próxima leitura.
+    size_t contiguous = INPUT_RING_SIZE - end;
+    if (contiguous > free_space)
+        contiguous = free_space;
+
+    dec->len += raw_input(&dec->ring[end], contiguous);
+}
+
+/**
+ * Converte um único byte em uma tecla.
+ */
+enum KeyboardInput decode_single_key(uint8_t byte)
+{
+    switch (byte)
+    {
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        return KEY_0 + (byte - '0');
+    case 'a': return KEY_A;
+    case 'd': return KEY_D;
+    case 'q': return KEY_Q;
+    case 'r': return KEY_R;
+    case 't': return KEY_T;
+    case 'u': return KEY_U;
+    case 's': return KEY_S;
+    case 'w': return KEY_W;
+    case ' ': return KEY_SPACE;
+    case '\t': return KEY_TAB;
+    case 0x7f: return KEY_BACKSPACE;
+    case 0x1b: return KEY_ESCAPE;
+    case '\r': case '\n': return KEY_ENTER;
+    default: return KEY_UNSUPPORTED;
+    }
+}
+
+/**
+ * Converte o final de `ESC [ A` (ou `ESC O A`)
+ * em uma seta.
+ */
+enum KeyboardInput decode_arrow_key(uint8_t final)
+{
+    switch (final)
+    {
+    case 'A': return KEY_ARROW_UP;
+    case 'B': return KEY_ARROW_DOWN;
+    case 'C': return KEY_ARROW_RIGHT;
+    case 'D': return KEY_ARROW_LEFT;
+    default: return KEY_UNSUPPORTED;
+    }
+}
+
+/**
+ * Tenta decodificar uma tecla do início
+ * do decodificador e escreve ela em `key`.
+ *
+ * Retorna quantos bytes a tecla ocupa, ou
+ * `0` se os bytes ainda não formam uma
+ * tecla completa (precisa ler mais).
+ */
+size_t input_decoder_next(struct InputDecoder *dec, enum KeyboardInput *key)
+{
+    if (dec->len == 0)
+        return 0;
+
+    uint8_t first = input_decoder_peek(dec, 0);
+
+    if (first != 0x1b)
+    {
+        // Caracteres utf-8 de mais de um byte
+        // não são suportados, mas precisamos
+        // saber o tamanho deles para pulá-los inteiros.
+        size_t n = 1;
+        if ((first & 0xE0) == 0xC0) n = 2;
+        else if ((first & 0xF0) == 0xE0) n = 3;
+        else if ((first & 0xF8) == 0xF0) n = 4;
+
+        if (dec->len < n)
+            return 0;
+
+        *key = (n == 1) ? decode_single_key(first) : KEY_UNSUPPORTED;
+        return n;
+    }
+
+    if (dec->len < 2)
+        return 0;
+
+    uint8_t second = input_decoder_peek(dec, 1);
+
+    // `ESC O A`: setas no modo "aplicação" do terminal.
+    if (second == 'O')
+    {
+        if (dec->len < 3)
+            return 0;
+        *key = decode_arrow_key(input_decoder_peek(dec, 2));
+        return 3;
+    }
+
+    // Um ESC seguido de qualquer outra coisa
+    // é só a tecla ESC (ou Alt + tecla).
+    if (second != '[')
+    {
+        *key = KEY_ESCAPE;
+        return 1;
+    }
+
+    // `ESC [` inicia uma sequência "CSI", que tem
+    // parâmetros (0x20 até 0x3F) e termina em
+    // um byte final (0x40 até 0x7E).
+    for (size_t i = 2; i < dec->len; i++)
+    {
+        uint8_t byte = input_decoder_peek(dec, i);
+
+        if (0x40 <= byte && byte <= 0x7E)
+        {
+            *key = (i == 2) ? decode_arrow_key(byte) : KEY_UNSUPPORTED;
+            return i + 1;
+        }
+
+        // Sequência quebrada, descartamos
+        // o que veio até aqui.
+        if (byte < 0x20 || byte > 0x3F)
+        {
+            *key = KEY_UNSUPPORTED;
+            return i;
+        }
+    }
+
+    // Uma sequência que nunca termina e encheu
+    // o buffer todo é lixo.
+    if (dec->len == INPUT_RING_SIZE)
+    {
+        *key = KEY_UNSUPPORTED;
+        return dec->len;
+    }
+
+    return 0;
+}
+
+/**
+ * Função que bloqueia a execução,
+ * espera uma entrada do usuário e
+ * devolve a tecla representada em
+ * `KeyboardInput`.
+ *
+ * Devolve `KEY_RESIZE` se o terminal
+ * mudar de tamanho durante a espera.
+ */
+enum KeyboardInput keyboard_input()
+{
+    struct InputDecoder *dec = &input_decoder;
+
+    while (true)
+    {
+        enum KeyboardInput key = KEY_UNSUPPORTED;
+        size_t used = input_decoder_next(dec, &key);
+        if (used > 0)
+        {
+            input_decoder_consume(dec, used);
+            trace_instant("tecla", "codigo", key);
+            return key;
+        }
+
+        // Se já existe um pedaço de sequência,
+        // só esperamos um pouquinho pelo resto.
+        bool incomplete = dec->len > 0;
+        enum RawInputWait wait = wait_raw_input(incomplete ? ESCAPE_TIMEOUT_MS : -1);
+
+        if (wait == RAW_INPUT_RESIZED)
+        {
+            trace_instant("redimensionamento", NULL, 0);
+            return KEY_RESIZE;
+        }
+
+        if (wait == RAW_INPUT_TIMEOUT)
+        {
+            // O resto nunca chegou, então era
+            // um ESC sozinho (ou um pedaço de lixo).
+            key = (input_decoder_peek(dec, 0) == 0x1b) ? KEY_ESCAPE : KEY_UNSUPPORTED;
+            input_decoder_consume(dec, (key == KEY_ESCAPE) ? 1 : dec->len);
+            trace_instant("tecla", "codigo", key);
+            return key;
+        }
+
+        input_decoder_fill(dec);
+    }
+}
+
+/**
+ * Define a jogada feita.
+ */
+enum Move
+{
+    FREE_MOVE,
+    X_MOVE,
+    O_MOVE,
+};
+
+/**
+ * O tabuleiro do jogo.
+ */
+typedef enum Move GameBoard[3][3];
+
+/**
+ * Muda uma jogada de uma célula do tabuleiro.
+ */
+static inline void set_game_board_cell(GameBoard board, struct Vec2 pos, enum Move move)
+{
+    board[pos.y][pos.x] = move;
+}
+
+/**
+ * Pega a jogada de uma célula do tabuleiro.
+ */
+static inline enum Move game_board_cell(GameBoard board, struct Vec2 pos)
+{
+    return board[pos.y][pos.x];
+}
+
+/**
+ * É só um inteiro, ele funciona
+ * como uma "matriz de booleanos"
+ * para guardar as jogadas de um ator
+ * e fazer comparações mais rápido.
+ * 
+ * NOTA: Apenas os 9 bits menos
+ * significativos são realmente
+ * importantes.
+ */
+typedef uint16_t MovePrint;
+
+/**
+ * Todas as combinações vencedoras.
+ *
+ * 0-2 => horizontais;
+ * 3-5 => verticais;
+ * 6 7 => diagonais.
+ */
+const MovePrint match_move_prints[] = {
+    // Os números estão em octal.
+    // Horizontais.
+    0007, 0070, 0700,
+    // Verticais.
+    0111, 0222, 0444,
+    // Diagnoais.
+    0421, 0124,
+};
+
+/**
+ * Troca um bit do `MovePrint`.
+ */
+static inline void edit_move_print(MovePrint *print, struct Vec2 pos, bool bit)
+{
+    uint16_t mask = (1 << ((pos.y * 3) + pos.x));
+    if (bit)
+        *print |= mask;
+    else
+        *print &= ~mask;
+}
+
+/**
+ * Pega um bit do `MovePrint`.
+ */
+static inline bool move_print_inspec(MovePrint print, struct Vec2 pos)
+{
+    return (print & (1 << ((pos.y * 3) + pos.x))) > 0;
+}
+
+/**
+ * Estrutura que guarda jogadas
+ * separadamente em 3 `MovePrint`s
+ * para análise mais fácil.
+ */
+struct MovePrintTriplet
+{
+    MovePrint free;
+    MovePrint x;
+    MovePrint o;
+};
+
+/**
+ * Gera um `MovePrintTriplet` a
+ * partir do tabuleiro do jogo.
+ */
+struct MovePrintTriplet get_move_print_triplet(GameBoard board)
+{
+    struct MovePrintTriplet triplet = {0};
+    for (int y = 0; y < 3; y++)
+    {
+        for (int x = 0; x < 3; x++)
+        {
+            MovePrint *print = NULL;
+            enum Move move = game_board_cell(board, vec2(x, y));
+            switch (move)
+            {
+            case FREE_MOVE: print = &triplet.free; break;
+            case X_MOVE: print = &triplet.x; break;
+            case O_MOVE: print = &triplet.o; break;
+            }
+            edit_move_print(print, vec2(x, y), true);
+        }
+    }
+    return triplet;
+}
+
+/**
+ * Retorna a quantidade de
+ * jogadas em um `MovePrint`.
+ */
+static inline uint8_t move_print_count(MovePrint print)
+{
+    uint8_t count = 0;
+    for (int i = 0; i < 9; i++)
+        count += (print >> i) & 1;
+    return count;
+}
+
+/**
+ * Escreve as coordenadas de cada bit
+ * em `print` dentro de `coords`.
+ *
+ * Use `move_print_count` para saber
+ * o atamanho do array.
+ */
+void move_print_coords(MovePrint print, struct Vec2 coords[])
+{
+    int coord_i = 0;
+    for (int i = 0; i < 9; i++)
+        if ((print >> i) & 1)
+        {
+            coords[coord_i] = vec2(i % 3, i / 3);
+            coord_i++;
+        }
+}
+
+/**
+ * Compara 2 `MovePrint`s, retornando
+ * `true` se a linha estiver pura e
+ * e `false` se ela não estiver pura.
+ *
+ * A pureza da linha é em relação
+ * ao `testing`, se houver uma jogada
+ * do `opponent` na linha, ela é considerada
+ * impura, se só houver jogadas do `testing`
+ * ela é pura.
+ */
+static inline bool test_move_print_purity(MovePrint testing, MovePrint opponent)
+{
+    return (testing | opponent) == testing;
+}
+
+/**
+ * Testa se há uma combinação
+ * vencedora em uma linha e retorna
+ * o `MovePrint`.
+ */
+static inline MovePrint test_move_print_winner_line(MovePrint testing, size_t match_index)
+{
+    if ((testing & match_move_prints[match_index]) == match_move_prints[match_index])
+        return match_move_prints[match_index];
+    return 0;
+}
+
+/**
+ * Pega todas as jogadas consideradas
+ * vencedoras e as retorna como `MovePrint`.
+ */
+MovePrint test_move_print_winner(MovePrint testing)
+{
+    MovePrint result = 0;
+    for (int i = 0; i < 8; i++)
+        result |= test_move_print_winner_line(testing, i);
+    return result;
+}
+
+/**
+ * Pega as células livres (`free_cells`) que
+ * completariam uma linha do `testing`,
+ * ou seja, onde ele ganha com uma jogada.
+ */
+MovePrint move_print_winning_cells(MovePrint testing, MovePrint free_cells)
+{
+    MovePrint result = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        // `missing` tem um bit só quando `missing & (missing - 1)`
+        // (que apaga o bit mais baixo) dá zero.
+        MovePrint missing = match_move_prints[i] & ~testing;
+        if (missing != 0 && (missing & (missing - 1)) == 0)
+            result |= missing & free_cells;
+    }
+    return result;
+}
+
+/**
+ * As linhas de `match_move_prints` que
+ * passam por cada célula (`y * 3 + x`):
+ * 2 nas bordas, 3 nos cantos e 4 no meio.
+ */
+const uint8_t cell_lines[9][4] = {
+    {0, 3, 6}, {0, 4},       {0, 5, 7},
+    {1, 3},    {1, 4, 6, 7}, {1, 5},
+    {2, 3, 7}, {2, 4},       {2, 5, 6},
+};
+const uint8_t cell_lines_len[9] = {
+    3, 2, 3,
+    2, 4, 2,
+    3, 2, 3,
+};
+
+/**
+ * As jogadas de um lado com a contagem de
+ * cada linha, atualizada a cada jogada.
+ *
+ * Assim, perguntas como "alguém ganhou?"
+ * ou "onde ele ganha na próxima?" viram
+ * só leituras, em vez de olhar as 8 linhas
+ * contando bits toda vez.
+ *
+ * Uma `LineCounters` zerada é um tabuleiro vazio.
+ */
+struct LineCounters
+{
+    /**
+     * As jogadas desse lado.
+     */
+    MovePrint marks;
+    /**
+     * Quantas jogadas há em cada linha.
+     */
+    uint8_t counts[8];
+    /**
+     * `lines_with[k - 1]` tem as linhas
+     * (bit `i` = linha `i`) com exatamente
+     * `k` jogadas desse lado.
+     */
+    uint8_t lines_with[3];
+};
+
+/**
+ * Marca a célula `cell` (`y * 3 + x`),
+ * mexendo só nas linhas que passam por ela.
+ */
+static inline void line_counters_add(struct LineCounters *lines, uint8_t cell)
+{
+    lines->marks |= 1 << cell;
+    for (int i = 0; i < cell_lines_len[cell]; i++)
+    {
+        uint8_t line = cell_lines[cell][i];
+        uint8_t before = lines->counts[line]++;
+        if (before > 0)
+            lines->lines_with[before - 1] &= ~(1 << line);
+        lines->lines_with[before] |= 1 << line;
+    }
+}
+
+/**
+ * Desmarca a célula `cell`, o contrário
+ * de `line_counters_add`.
+ */
+static inline void line_counters_remove(struct LineCounters *lines, uint8_t cell)
+{
+    lines->marks &= ~(1 << cell);
+    for (int i = 0; i < cell_lines_len[cell]; i++)
+    {
+        uint8_t line = cell_lines[cell][i];
+        uint8_t after = --lines->counts[line];
+        lines->lines_with[after] &= ~(1 << line);
+        if (after > 0)
+            lines->lines_with[after - 1] |= 1 << line;
+    }
+}
+
+/**
+ * As linhas com pelo menos uma jogada.
+ */
+static inline uint8_t line_counters_used(const struct LineCounters *lines)
+{
+    return lines->lines_with[0] | lines->lines_with[1] | lines->lines_with[2];
+}
+
+/**
+ * As linhas sem nenhuma jogada do `opponent`
+ * e com pelo menos `min` jogadas do `lines`
+ * (`min` de 1 a 3), ou seja, as que ele
+ * ainda pode completar.
+ */
+static inline uint8_t line_counters_open(const struct LineCounters *lines, const struct LineCounters *opponent, uint8_t min)
+{
+    uint8_t result = 0;
+    for (int k = min; k <= 3; k++)
+        result |= lines->lines_with[k - 1];
+    return result & ~line_counters_used(opponent);
+}
+
+/**
+ * As linhas onde `lines` ganha com
+ * mais uma jogada (2 jogadas e nenhuma
+ * do oponente).
+ */
+static inline uint8_t line_counters_threats(const struct LineCounters *lines, const struct LineCounters *opponent)
+{
+    return lines->lines_with[1] & ~line_counters_used(opponent);
+}
+
+/**
+ * O índice do bit mais baixo ligado
+ * (`bits` não pode ser zero).
+ */
+static inline int lowest_bit_index(uint32_t bits)
+{
+    int i = 0;
+    while (!((bits >> i) & 1))
+        i++;
+    return i;
+}
+
+/**
+ * Chaves de Zobrist: um número aleatório
+ * de 64 bits para cada jogada possível
+ * (`[0]` para X e `[1]` para O, em cada célula).
+ *
+ * O "hash" de uma posição é o XOR das chaves
+ * das jogadas feitas, então fazer ou desfazer
+ * uma jogada é só um XOR com a chave dela.
+ *
+ * (Geradas uma vez com o splitmix64 e
+ * fixadas aqui, para o hash ser sempre o mesmo.)
+ */
+const uint64_t zobrist_cell_keys[2][9] = {
+    {
+        0x6e789e6aa1b965f4ull, 0x06c45d188009454full, 0xf88bb8a8724c81ecull,
+        0x1b39896a51a8749bull, 0x53cb9f0c747ea2eaull, 0x2c829abe1f4532e1ull,
+        0xc584133ac916ab3cull, 0x3ee5789041c98ac3ull, 0xf3b8488c368cb0a6ull,
+    },
+    {
+        0x657eecdd3cb13d09ull, 0xc2d326e0055bdef6ull, 0x8621a03fe0bbdb7bull,
+        0x8e1f7555983aa92full, 0xb54e0f1600cc4d19ull, 0x84bb3f97971d80abull,
+        0x7d29825c75521255ull, 0xc3cf17102b7f7f86ull, 0x3466e9a083914f64ull,
+    },
+};
+
+/**
+ * Chave misturada no hash quando é a vez do O.
+ */
+const uint64_t zobrist_o_turn_key = 0xd81a8d2b5a4485acull;
+
+/**
+ * Representa o símbolo que vai jogar.
+ */
+enum Actor
+{
+    NULL_ACTOR,
+    X_ACTOR,
+    O_ACTOR,
+};
+
+/**
+ * Converte de `Actor` para `Move`.
+ */
+#define actor_to_move(a) ((enum Move)a)
+
+/**
+ * Retorna o `Actor` oponente.
+ */
+#define opponent_actor(a) ((a == NULL_ACTOR) ? NULL_ACTOR : ((a == X_ACTOR) ? O_ACTOR : X_ACTOR))
+
+/**
+ * A cor que não representa
+ * nenhum jogador :^)
+ */
+#define NULL_ACTOR_COLOR rgb(178, 82, 218);
+
+/**
+ * Pega a cor que representa o símbolo.
+ */
+struct Color actor_color(enum Actor actor)
+{
+    switch (actor)
+    {
+    case X_ACTOR:
+        return rgb(255, 51, 136);
+    case O_ACTOR:
+        return rgb(64, 204, 255);
+    case NULL_ACTOR:
+        return NULL_ACTOR_COLOR;
+    }
+}
+
+/**
+ * Representa a continuidade
+ * ou final do jogo.
+ */
+enum EndGame
+{
+    RUNNING,
+    GAME_DRAW,
+    X_VICTORY,
+    O_VICTORY,
+};
+
+/**
+ * Pega a cor do emapte (velha).
+ */
+struct Color game_draw_color()
+{
+    return NULL_ACTOR_COLOR;
+}
+
+/**
+ * Registro de uma partida: quem
+ * começou, as células jogadas em ordem
+ * e como a partida terminou.
+ */
+struct GameRecord
+{
+    enum Actor starter;
+    enum EndGame result;
+    /**
+     * Quantidade de jogadas em `cells`.
+     */
+    uint8_t len;
+    /**
+     * As células jogadas (`y * 3 + x`),
+     * o mesmo índice dos bits do `MovePrint`.
+     */
+    uint8_t cells[9];
+    /**
+     * Quem jogou de X (`0`) e de O (`1`), como
+     * números de jogadores de um torneio. Só valem
+     * se `has_players` for `true`.
+     */
+    bool has_players;
+    uint16_t players[2];
+};
+
+/**
+ * "Foto" do tabuleiro, com as
+ * jogadas de cada ator.
+ */
+struct BoardSnapshot
+{
+    MovePrint x;
+    MovePrint o;
+};
+
+struct GameRecordWriter;
+
+/**
+ * O que é preciso para desfazer uma
+ * jogada: a célula, o que mudou fora
+ * do tabuleiro e o XOR do hash.
+ *
+ * Veja `make_game_move` e `unmake_game_move`.
+ */
+struct GameUndo
+{
+    uint64_t hash_delta;
+    struct Vec2 selection;
+    enum EndGame endgame;
+    uint8_t cell;
+};
+
+/**
+ * Representa todo o estado do jogo.
+ */
+struct GameState
+{
+    /**
+     * A grade 3x3 do jogo.
+     */
+    GameBoard board;
+    /**
+     * A seleção atual do jogador (ou IA).
+     */
+    struct Vec2 selection;
+    /**
+     * Quem vai jogar.
+     */
+    enum Actor turn;
+    /**
+     * Quantidade de jogadas.
+     */
+    uint8_t moves;
+    /**
+     * Continuidade do jogo.
+     */
+    enum EndGame endgame;
+    /**
+     * As contagens de cada linha para X e O,
+     * atualizadas por `play_game_move`.
+     */
+    struct LineCounters x_lines;
+    struct LineCounters o_lines;
+    /**
+     * O hash de Zobrist das jogadas feitas
+     * (sem a vez, veja `game_state_hash`).
+     */
+    uint64_t hash;
+    /**
+     * As jogadas que a interface pode desfazer
+     * (`history[0]` até `history_len`) e, depois
+     * de desfazer, as que podem ser refeitas
+     * (de `history_len` até `redo_len`).
+     */
+    struct GameUndo history[9];
+    uint8_t history_len;
+    uint8_t redo_len;
+    /**
+     * Se desfazer e refazer andam 2 jogadas
+     * de uma vez (contra a máquina, para
+     * voltar sempre para a vez do jogador).
+     */
+    bool undo_whole_turn;
+    /**
+     * As jogadas feitas até agora.
+     */
+    struct GameRecord record;
+    /**
+     * Uma "foto" do tabuleiro para cada
+     * jogada, `snapshots[i]` é o tabuleiro
+     * depois de `i` jogadas.
+     */
+    struct BoardSnapshot snapshots[10];
+    /**
+     * Onde gravar a partida quando ela
+     * terminar (`NULL` para não gravar).
+     */
+    struct GameRecordWriter *recorder;
+};
+
+/**
+ * Desenha o símbolo representando o ator
+ * usando a sua cor respectiva.
+ */
+void draw_game_actor(enum Actor actor)
+{
+    if (actor != NULL_ACTOR)
+        set_foreground_color(actor_color(actor));
+
+    switch (actor)
+    {
+    case O_ACTOR:
+        terminal_putchar('O');
+        break;
+    case X_ACTOR:
+        terminal_putchar('X');
+        break;
+    case NULL_ACTOR:
+        terminal_putchar(' ');
+        break;
+    }
+    if (actor != NULL_ACTOR)
+        reset_formatting();
+}
+
+/**
+ * Desenha o quadro em volta das células do tabuleiro.
+ */
+void render_game_frame(enum EndGame endgame)
+{
+    set_bold();
+
+    if (endgame == GAME_DRAW)
+        set_foreground_color(game_draw_color());
+    else if (endgame == X_VICTORY)
+        set_foreground_color(actor_color(X_ACTOR));
+    else if (endgame == O_VICTORY)
+        set_foreground_color(actor_color(O_ACTOR));
+
+    terminal_printf("╭─ C Tic Tac Toe ─╮");
+    move_cursor(vec2(-19, 1));
+
+    for (int i = 0 ; i < 9; i++)
+    {
+        terminal_printf("│");
+        move_cursor(vec2(17, 0));
+        terminal_printf("│");
+        move_cursor(vec2(-19, 1));
+    }
+
+    terminal_printf("╰─────────────────╯");
+    reset_formatting();
+}
+
+/**
+ * Desenha a continuidade do jogo.
+ */
+void render_endgame(enum EndGame endgame, enum Actor turn, int moves)
+{
+    switch (endgame)
+    {
+    case GAME_DRAW:
+        set_background_color(game_draw_color());
+        terminal_printf("    Deu velha!     ");
+        break;
+    case O_VICTORY:
+        set_background_color(actor_color(O_ACTOR));
+        terminal_printf("  O é o vencedor!  ");
+        break;
+    case X_VICTORY:
+        set_background_color(actor_color(X_ACTOR));
+        terminal_printf("  X é o vencedor!  ");
+        break;
+    case RUNNING:
+        terminal_printf("     Turno: ");
+        draw_game_actor(turn);
+        move_cursor(vec2(-13, 1));
+        reset_formatting();
+        return;
+    }
+    reset_formatting();
+    move_cursor(vec2(-19, 1));
+}
+
+/**
+ * Desenha a jogada.
+ */
+void draw_game_move(enum Move move)
+{
+    switch (move)
+    {
+    case FREE_MOVE:
         draw_game_actor(NULL_ACTOR);
         break;
-    case X_MOVE:
-        draw_game_actor(X_ACTOR);
+    case X_MOVE:
+        draw_game_actor(X_ACTOR);
+        break;
+    case O_MOVE:
+        draw_game_actor(O_ACTOR);
+        break;
+    }
+}
+
+/**
+ * Desenha o quadro da célula da grade.
+ */
+void draw_game_cell_frame(enum Actor actor, bool highlighted)
+{
+    if (highlighted)
+    {
+        set_bold();
+        set_foreground_color(actor_color(actor));
+    }
+    else
+        set_dim();
+
+    terminal_printf("╭───╮");
+    move_cursor(vec2(-5, 1));
+
+    terminal_printf("│");
+    move_cursor(vec2(3, 0));
+    terminal_printf("│");
+    move_cursor(vec2(-5, 1));
+
+    terminal_printf("╰───╯");
+    move_cursor(vec2(-5, -2));
+
+    reset_formatting();
+}
+
+/**
+ * Desenha uma célula individual
+ * da grade do jogo.
+ */
+void draw_game_cell(enum Actor actor, enum Move move, bool highlighted)
+{
+    draw_game_cell_frame(actor, highlighted);
+    move_cursor(vec2(2, 1));
+    draw_game_move(move);
+    move_cursor(vec2(-3, -1));
+}
+
+/**
+ * Desenha o tabuleiro do jogo,
+ * mais precisamente, as células.
+ *
+ * `highlight` escolhe a cor baseado
+ * no `actor`.
+ */
+void render_game_board(GameBoard board, enum Actor actor, MovePrint highlight)
+{
+    for (int y = 0; y < 3; y++)
+    {
+        int moved_x = 0;
+
+        for (int x = 0; x < 3; x++)
+        {
+            struct Vec2 pos = {x, y};
+
+            bool highlighted = move_print_inspec(highlight, pos);
+            enum Move move_in_cell = game_board_cell(board, pos);
+
+            draw_game_cell(actor, move_in_cell, highlighted);
+
+            moved_x += 5;
+            move_cursor(vec2(5, 0));
+        }
+
+        move_cursor(vec2(-moved_x, 3));
+    }
+}
+
+/**
+ * É como `render_game_board`, mas possui
+ * uma animação "pintando" as células.
+ */
+void animate_board_rendering(GameBoard board, enum Actor actor, MovePrint highlight)
+{
+    int highlighted_len = move_print_count(highlight);
+    struct Vec2 highlighted_coords[9] = {0};
+    move_print_coords(highlight, highlighted_coords);
+
+    block_delay(100);
+
+    MovePrint animated_highlight = 0;
+    for (int i = 0; i <= highlighted_len; i++)
+    {
+        uint64_t frame = trace_span_start();
+        render_game_board(board, actor, animated_highlight);
+        edit_move_print(&animated_highlight, highlighted_coords[i], true);
+
+        if (i < highlighted_len)
+        {
+            move_cursor(vec2(0, -9));
+            block_delay(50);
+        }
+        trace_span_stop("quadro de vitória", frame, "quadro", i);
+    }
+}
+
+/**
+ * Animação de preenchimento utilizada
+ * quando o jogo da em velha.
+ */
+void game_board_fill_animation(GameBoard board, enum Actor turn, MovePrint missing)
+{
+    int missing_len = move_print_count(missing);
+    struct Vec2 missing_coords[3] = {0};
+    move_print_coords(missing, missing_coords);
+
+    uint8_t animated = 0;
+
+    render_game_board(board, NULL_ACTOR, 0);
+    move_cursor(vec2(0, -9));
+
+    block_delay(300);
+
+    for (int i = 0; i < missing_len; i++)
+    {
+        uint64_t frame = trace_span_start();
+        int selection = 0; do
+            selection = rand() % missing_len;
+        while (animated & (1 << selection));
+
+        set_game_board_cell(board, missing_coords[selection], actor_to_move(turn));
+        turn = opponent_actor(turn);
+
+        MovePrint selection_highlight = 0;
+        edit_move_print(&selection_highlight, missing_coords[selection], true);
+
+        render_game_board(board, NULL_ACTOR, selection_highlight);
+
+        animated |= (1 << selection);
+        if (i < missing_len)
+            move_cursor(vec2(0, -9));
+        block_delay(250);
+        trace_span_stop("quadro de velha", frame, "quadro", i);
+    }
+}
+
+/**
+ * Escreve uma duração com uma
+ * unidade legível (ns, us, ms ou s).
+ */
+void format_duration(char *str, size_t n, uint64_t ns)
+{
+    if (ns < 1000)
+        snprintf(str, n, "%lluns", (unsigned long long)ns);
+    else if (ns < 1000000)
+        snprintf(str, n, "%.1fus", ns / 1e3);
+    else if (ns < 1000000000)
+        snprintf(str, n, "%.1fms", ns / 1e6);
+    else
+        snprintf(str, n, "%.2fs", ns / 1e9);
+}
+
+/**
+ * Bytes e escritas do último `render_game`.
+ */
+uint64_t last_frame_bytes = 0;
+uint64_t last_frame_writes = 0;
+
+/**
+ * Desenha no canto da tela os tempos de
+ * cada fase (último, média e p99) e quanto
+ * o último quadro escreveu no terminal.
+ */
+void render_phase_stats_overlay()
+{
+    set_cursor_position(vec2(1, 1));
+    set_dim();
+    // "último" e "média" têm letras de 2 bytes,
+    // então o cabeçalho vai alinhado na mão.
+    terminal_printf("fase        último     média       p99");
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        const struct PhaseStats *stats = &phase_stats[phase];
+        char last[16], avarage[16], p99[16];
+        format_duration(last, sizeof(last), stats->last_ns);
+        format_duration(avarage, sizeof(avarage), (stats->count > 0) ? stats->total_ns / stats->count : 0);
+        format_duration(p99, sizeof(p99), phase_stats_percentile(stats, 99));
+
+        set_cursor_position(vec2(1, phase + 2));
+        terminal_printf("%-8s %9s %9s %9s", phase_names[phase], last, avarage, p99);
+    }
+
+    // Cabe do lado do desenho, para o painel
+    // não passar por cima do jogo em telas pequenas.
+    terminal_printf("  %llu bytes, %llu escritas  ",
+        (unsigned long long)last_frame_bytes, (unsigned long long)last_frame_writes);
+    reset_formatting();
+}
+
+/**
+ * Desenha o jogo.
+ *
+ * Caso `animate` seja `false`, o final
+ * do jogo é desenhado direto, sem as
+ * animações (útil para redesenhar a tela).
+ */
+void render_game(struct GameState *state, bool animate)
+{
+    struct Vec2 screen_size = display_size();
+    struct Vec2 screen_offset = {(screen_size.x / 2) - 9, (screen_size.y / 2) - 6};
+    new_screen_frame(false);
+    set_cursor_position(screen_offset);
+
+    render_game_frame(state->endgame);
+    move_cursor(vec2(-19, 1));
+    render_endgame(state->endgame, state->turn, state->moves);
+    terminal_printf("    Jogadas: %d", state->moves);
+    move_cursor(vec2(-12, -11));
+
+    struct MovePrintTriplet separated_state = get_move_print_triplet(state->board);
+
+    MovePrint highlighting = 0;
+    switch (state->endgame)
+    {
+    case RUNNING:
+        edit_move_print(&highlighting, state->selection, true);
+        render_game_board(state->board, state->turn, highlighting);
+        break;
+    case GAME_DRAW:
+    {
+        highlighting = separated_state.x | separated_state.o;
+        if (!animate)
+        {
+            render_game_board(state->board, NULL_ACTOR, highlighting);
+            break;
+        }
+        // A animação preenche as células livres,
+        // então ela trabalha numa cópia do tabuleiro
+        // para não bagunçar o estado do jogo.
+        GameBoard filled_board;
+        memcpy(filled_board, state->board, sizeof(GameBoard));
+        game_board_fill_animation(filled_board, state->turn, separated_state.free);
+        animate_board_rendering(filled_board, NULL_ACTOR, highlighting);
+        break;
+    }
+    case X_VICTORY:
+        highlighting = test_move_print_winner(separated_state.x);
+        if (animate)
+            animate_board_rendering(state->board, X_ACTOR, highlighting);
+        else
+            render_game_board(state->board, X_ACTOR, highlighting);
+        break;
+    case O_VICTORY:
+        highlighting = test_move_print_winner(separated_state.o);
+        if (animate)
+            animate_board_rendering(state->board, O_ACTOR, highlighting);
+        else
+            render_game_board(state->board, O_ACTOR, highlighting);
+        break;
+    }
+}
+
+/**
+ * Escreve um inteiro de 16 bits em "little-endian".
+ */
+static inline void put_u16le(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = value & 0xFF;
+    bytes[1] = value >> 8;
+}
+
+/**
+ * Lê um inteiro de 16 bits em "little-endian".
+ */
+static inline uint16_t get_u16le(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+/**
+ * Escreve um inteiro de 32 bits
+ * em "little-endian" (byte menos
+ * significativo primeiro), não
+ * importa a arquitetura do computador.
+ */
+static inline void put_u32le(uint8_t *bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        bytes[i] = (value >> (i * 8)) & 0xFF;
+}
+
+/**
+ * Lê um inteiro de 32 bits em "little-endian".
+ */
+static inline uint32_t get_u32le(const uint8_t *bytes)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t)bytes[i] << (i * 8);
+    return value;
+}
+
+/**
+ * Escreve um inteiro de 64 bits em "little-endian".
+ */
+static inline void put_u64le(uint8_t *bytes, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (value >> (i * 8)) & 0xFF;
+}
+
+/**
+ * Lê um inteiro de 64 bits em "little-endian".
+ */
+static inline uint64_t get_u64le(const uint8_t *bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= (uint64_t)bytes[i] << (i * 8);
+    return value;
+}
+
+/**
+ * Arquivo de partidas gravadas.
+ *
+ * Cada partida vira um registro
+ * compacto de no máximo 6 bytes:
+ *
+ *  - 1 byte de cabeçalho:
+ *    - bits 0-3 => quantidade de jogadas (0-9);
+ *    - bits 4-5 => resultado (`EndGame`);
+ *    - bit 6 => quem começou (0 = X, 1 = O);
+ *    - bit 7 => reservado (sempre 0).
+ *  - As células jogadas (`y * 3 + x`),
+ *    4 bits cada, duas por byte, a primeira
+ *    jogada nos 4 bits menos significativos.
+ *
+ * O arquivo é dividido em blocos de até
+ * `games_per_block` partidas:
+ *
+ *  - Cabeçalho (16 bytes): "CTTR", versão,
+ *    3 bytes reservados, `games_per_block` (u32)
+ *    e 4 bytes reservados.
+ *  - Blocos: quantidade de partidas (u32),
+ *    tamanho dos registros em bytes (u32)
+ *    e os registros em si.
+ *  - Cada registro: um byte com a quantidade de
+ *    jogadas (4 bits), o resultado (2 bits), se O
+ *    começou (1 bit) e se tem jogadores (1 bit),
+ *    os jogadores de X e de O (u16 cada), se tiver,
+ *    e as células, duas por byte.
+ *  - Um bloco vazio (0, 0) marcando o fim.
+ *  - O índice: a posição (u64) de cada bloco.
+ *  - Rodapé (24 bytes): posição do índice (u64),
+ *    total de partidas (u64), quantidade de
+ *    blocos (u32) e "CTTI".
+ *
+ * Todos os inteiros são "little-endian".
+ *
+ * O índice permite pular direto para qualquer
+ * partida, e o bloco vazio permite ler o arquivo
+ * do começo ao fim mesmo sem poder pular (um "cano").
+ */
+#define GAME_RECORD_MAGIC "CTTR"
+#define GAME_RECORD_INDEX_MAGIC "CTTI"
+#define GAME_RECORD_VERSION 1
+#define GAME_RECORD_HEADER_SIZE 16
+#define GAME_RECORD_BLOCK_HEADER_SIZE 8
+#define GAME_RECORD_FOOTER_SIZE 24
+/// Tamanho máximo de um registro.
+#define GAME_RECORD_MAX_BYTES 10
+/// Limite de partidas por bloco.
+#define GAME_RECORD_MAX_BLOCK_GAMES 4096
+/// Partidas por bloco usado se ninguém escolher outro.
+#define GAME_RECORD_DEFAULT_BLOCK_GAMES 1024
+
+/**
+ * Codifica `record` em `bytes` (que deve ter
+ * pelo menos `GAME_RECORD_MAX_BYTES`).
+ *
+ * Retorna quantos bytes foram escritos.
+ */
+size_t encode_game_record(const struct GameRecord *record, uint8_t *bytes)
+{
+    bytes[0] = (record->len & 0x0F)
+        | ((record->result & 0x03) << 4)
+        | ((record->starter == O_ACTOR) << 6)
+        | (record->has_players << 7);
+
+    size_t n = 1;
+    if (record->has_players)
+    {
+        put_u16le(&bytes[1], record->players[0]);
+        put_u16le(&bytes[3], record->players[1]);
+        n += 4;
+    }
+    for (uint8_t i = 0; i < record->len; i += 2)
+    {
+        uint8_t pair = record->cells[i] & 0x0F;
+        if (i + 1 < record->len)
+            pair |= (record->cells[i + 1] & 0x0F) << 4;
+        bytes[n++] = pair;
+    }
+    return n;
+}
+
+/**
+ * Decodifica um registro de `bytes`
+ * (com `n` bytes disponíveis) em `record`.
+ *
+ * Retorna quantos bytes o registro ocupa,
+ * ou `0` se os bytes forem inválidos.
+ */
+size_t decode_game_record(const uint8_t *bytes, size_t n, struct GameRecord *record)
+{
+    if (n == 0)
+        return 0;
+
+    uint8_t head = bytes[0];
+    uint8_t len = head & 0x0F;
+    size_t cells_at = (head & 0x80) ? 5 : 1;
+    size_t size = cells_at + ((len + 1) / 2);
+    if (len > 9 || size > n)
+        return 0;
+
+    record->len = len;
+    record->result = (enum EndGame)((head >> 4) & 0x03);
+    record->starter = (head & 0x40) ? O_ACTOR : X_ACTOR;
+    record->has_players = (head & 0x80) != 0;
+    record->players[0] = record->has_players ? get_u16le(&bytes[1]) : 0;
+    record->players[1] = record->has_players ? get_u16le(&bytes[3]) : 0;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        uint8_t cell = (bytes[cells_at + (i / 2)] >> ((i % 2) * 4)) & 0x0F;
+        if (cell > 8)
+            return 0;
+        record->cells[i] = cell;
+    }
+    return size;
+}
+
+/**
+ * Escreve partidas em um arquivo
+ * de partidas gravadas, conforme
+ * elas vão terminando.
+ */
+struct GameRecordWriter
+{
+    FILE *file;
+    uint32_t games_per_block;
+    /**
+     * Registros do bloco que
+     * ainda não foi escrito.
+     */
+    uint8_t block[GAME_RECORD_MAX_BLOCK_GAMES * GAME_RECORD_MAX_BYTES];
+    size_t block_len;
+    uint32_t block_games;
+    /**
+     * Posição atual no arquivo. Depois do
+     * `close_game_record_writer`, é o
+     * tamanho final dele.
+     */
+    uint64_t offset;
+    uint64_t total_games;
+    /**
+     * Posição de cada bloco já escrito.
+     */
+    uint64_t *index;
+    uint32_t index_len;
+    uint32_t index_cap;
+    /**
+     * Faltou memória para o índice, o arquivo
+     * sai sem ele e o fechamento falha.
+     */
+    bool index_failed;
+};
+
+/**
+ * Cria o arquivo `path` e começa a escrever
+ * com blocos de `games_per_block` partidas.
+ *
+ * Retorna `false` se não der para criar o arquivo.
+ */
+bool open_game_record_writer(struct GameRecordWriter *writer, const char *path, uint32_t games_per_block)
+{
+    if (games_per_block == 0 || games_per_block > GAME_RECORD_MAX_BLOCK_GAMES)
+        games_per_block = GAME_RECORD_DEFAULT_BLOCK_GAMES;
+
+    writer->file = (strcmp(path, "-") == 0) ? stdout : fopen(path, "wb");
+    if (writer->file == NULL)
+        return false;
+#if defined (__unix__) || defined (__APPLE__)
+    if (writer->file != stdout)
+        close_on_exec(fileno(writer->file));
+#endif
+
+    writer->games_per_block = games_per_block;
+    writer->block_len = 0;
+    writer->block_games = 0;
+    writer->total_games = 0;
+    writer->index = NULL;
+    writer->index_len = 0;
+    writer->index_cap = 0;
+    writer->index_failed = false;
+
+    uint8_t header[GAME_RECORD_HEADER_SIZE] = GAME_RECORD_MAGIC;
+    header[4] = GAME_RECORD_VERSION;
+    put_u32le(&header[8], games_per_block);
+    fwrite(header, 1, sizeof(header), writer->file);
+    writer->offset = sizeof(header);
+
+    return true;
+}
+
+/**
+ * Escreve o bloco atual no arquivo.
+ */
+void flush_game_record_block(struct GameRecordWriter *writer)
+{
+    if (!writer->index_failed && writer->index_len == writer->index_cap)
+    {
+        uint32_t cap = (writer->index_cap == 0) ? 64 : writer->index_cap * 2;
+        uint64_t *index = realloc(writer->index, cap * sizeof(uint64_t));
+        if (index == NULL)
+            writer->index_failed = true;
+        else
+        {
+            writer->index = index;
+            writer->index_cap = cap;
+        }
+    }
+    if (!writer->index_failed)
+        writer->index[writer->index_len++] = writer->offset;
+
+    uint8_t header[GAME_RECORD_BLOCK_HEADER_SIZE];
+    put_u32le(&header[0], writer->block_games);
+    put_u32le(&header[4], writer->block_len);
+    fwrite(header, 1, sizeof(header), writer->file);
+    fwrite(writer->block, 1, writer->block_len, writer->file);
+
+    writer->offset += sizeof(header) + writer->block_len;
+    writer->block_len = 0;
+    writer->block_games = 0;
+}
+
+/**
+ * Adiciona uma partida ao arquivo.
+ */
+void push_game_record(struct GameRecordWriter *writer, const struct GameRecord *record)
+{
+    writer->block_len += encode_game_record(record, &writer->block[writer->block_len]);
+    writer->block_games++;
+    writer->total_games++;
+
+    if (writer->block_games == writer->games_per_block)
+        flush_game_record_block(writer);
+}
+
+/**
+ * Escreve o que faltar, o índice e o
+ * rodapé, e então fecha o arquivo,
+ * deixando o tamanho dele em `offset`.
+ *
+ * Retorna `false` se algo deu errado na escrita.
+ */
+bool close_game_record_writer(struct GameRecordWriter *writer)
+{
+    if (writer->block_games > 0)
+        flush_game_record_block(writer);
+
+    // O bloco vazio que marca o fim.
+    uint8_t end_block[GAME_RECORD_BLOCK_HEADER_SIZE] = {0};
+    fwrite(end_block, 1, sizeof(end_block), writer->file);
+    uint64_t index_offset = writer->offset + sizeof(end_block);
+    writer->offset = index_offset;
+
+    // Sem o índice inteiro, o arquivo termina
+    // no bloco vazio e só dá para lê-lo em ordem.
+    if (writer->index_failed)
+        goto CLOSE_FILE;
+
+    for (uint32_t i = 0; i < writer->index_len; i++)
+    {
+        uint8_t entry[8];
+        put_u64le(entry, writer->index[i]);
+        fwrite(entry, 1, sizeof(entry), writer->file);
+    }
+
+    uint8_t footer[GAME_RECORD_FOOTER_SIZE];
+    put_u64le(&footer[0], index_offset);
+    put_u64le(&footer[8], writer->total_games);
+    put_u32le(&footer[16], writer->index_len);
+    memcpy(&footer[20], GAME_RECORD_INDEX_MAGIC, 4);
+    fwrite(footer, 1, sizeof(footer), writer->file);
+    writer->offset = index_offset + (writer->index_len * 8) + sizeof(footer);
+
+CLOSE_FILE:;
+    bool ok = !writer->index_failed && !ferror(writer->file);
+    if (writer->file != stdout)
+        ok = (fclose(writer->file) == 0) && ok;
+    else
+        fflush(stdout);
+
+    free(writer->index);
+    writer->index = NULL;
+    writer->file = NULL;
+    return ok;
+}
+
+/**
+ * Lê partidas de um arquivo de
+ * partidas gravadas, uma por vez,
+ * sem alocar memória.
+ */
+struct GameRecordReader
+{
+    FILE *file;
+    uint32_t games_per_block;
+    /**
+     * Só valem se `seekable` for `true`
+     * (arquivo completo e que dá para pular).
+     */
+    bool seekable;
+    uint64_t total_games;
+    uint64_t index_offset;
+    uint32_t block_count;
+    /**
+     * O bloco atual.
+     */
+    uint8_t block[GAME_RECORD_MAX_BLOCK_GAMES * GAME_RECORD_MAX_BYTES];
+    size_t block_len;
+    size_t block_pos;
+    uint32_t block_games_left;
+    bool finished;
+};
+
+/**
+ * Abre o arquivo `path` (`-` é a entrada padrão).
+ *
+ * Retorna `false` se não der para abrir
+ * ou se não for um arquivo de partidas.
+ */
+bool open_game_record_reader(struct GameRecordReader *reader, const char *path)
+{
+    reader->file = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (reader->file == NULL)
+        return false;
+
+    reader->seekable = false;
+    reader->total_games = 0;
+    reader->block_len = 0;
+    reader->block_pos = 0;
+    reader->block_games_left = 0;
+    reader->finished = false;
+
+    uint8_t header[GAME_RECORD_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header)
+        || memcmp(header, GAME_RECORD_MAGIC, 4) != 0
+        || header[4] != GAME_RECORD_VERSION)
+        goto INVALID_FILE;
+
+    reader->games_per_block = get_u32le(&header[8]);
+    if (reader->games_per_block == 0 || reader->games_per_block > GAME_RECORD_MAX_BLOCK_GAMES)
+        goto INVALID_FILE;
+
+    // Se der para pular (um arquivo, mesmo que venha
+    // pela entrada padrão), lemos o rodapé e voltamos,
+    // se não (um "cano"), só dá para ler em sequência.
+    if (ftell(reader->file) == GAME_RECORD_HEADER_SIZE
+        && fseek(reader->file, -GAME_RECORD_FOOTER_SIZE, SEEK_END) == 0)
+    {
+        uint8_t footer[GAME_RECORD_FOOTER_SIZE];
+        if (fread(footer, 1, sizeof(footer), reader->file) == sizeof(footer)
+            && memcmp(&footer[20], GAME_RECORD_INDEX_MAGIC, 4) == 0)
+        {
+            reader->seekable = true;
+            reader->index_offset = get_u64le(&footer[0]);
+            reader->total_games = get_u64le(&footer[8]);
+            reader->block_count = get_u32le(&footer[16]);
+        }
+        if (fseek(reader->file, GAME_RECORD_HEADER_SIZE, SEEK_SET) != 0)
+            goto INVALID_FILE;
+    }
+
+    return true;
+
+    INVALID_FILE:
+    if (reader->file != stdin)
+        fclose(reader->file);
+    reader->file = NULL;
+    return false;
+}
+
+/**
+ * Fecha o arquivo.
+ */
+void close_game_record_reader(struct GameRecordReader *reader)
+{
+    if (reader->file != NULL && reader->file != stdin)
+        fclose(reader->file);
+    reader->file = NULL;
+}
+
+/**
+ * Carrega o próximo bloco.
+ *
+ * Retorna `false` no fim do arquivo.
+ */
+bool load_game_record_block(struct GameRecordReader *reader)
+{
+    uint8_t header[GAME_RECORD_BLOCK_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header))
+        return false;
+
+    uint32_t games = get_u32le(&header[0]);
+    uint32_t len = get_u32le(&header[4]);
+    if (games == 0 || len > sizeof(reader->block))
+        return false;
+
+    if (fread(reader->block, 1, len, reader->file) != len)
+        return false;
+
+    reader->block_len = len;
+    reader->block_pos = 0;
+    reader->block_games_left = games;
+    return true;
+}
+
+/**
+ * Lê a próxima partida para `record`.
+ *
+ * Retorna `false` quando as
+ * partidas acabarem (ou em um erro).
+ */
+bool read_game_record(struct GameRecordReader *reader, struct GameRecord *record)
+{
+    if (reader->finished)
+        return false;
+
+    while (reader->block_games_left == 0)
+        if (!load_game_record_block(reader))
+        {
+            reader->finished = true;
+            return false;
+        }
+
+    size_t used = decode_game_record(
+        &reader->block[reader->block_pos],
+        reader->block_len - reader->block_pos,
+        record
+    );
+    if (used == 0)
+    {
+        reader->finished = true;
+        return false;
+    }
+
+    reader->block_pos += used;
+    reader->block_games_left--;
+    return true;
+}
+
+/**
+ * Pula direto para a partida
+ * número `game` (começando do 0), usando
+ * o índice para achar o bloco certo.
+ *
+ * Retorna `false` se não der para
+ * pular ou se a partida não existir.
+ */
+bool seek_game_record(struct GameRecordReader *reader, uint64_t game)
+{
+    if (!reader->seekable || game >= reader->total_games)
+        return false;
+
+    uint64_t block = game / reader->games_per_block;
+    uint8_t entry[8];
+    if (fseek(reader->file, reader->index_offset + (block * 8), SEEK_SET) != 0
+        || fread(entry, 1, sizeof(entry), reader->file) != sizeof(entry)
+        || fseek(reader->file, get_u64le(entry), SEEK_SET) != 0)
+        return false;
+
+    reader->finished = false;
+    reader->block_games_left = 0;
+    if (!load_game_record_block(reader))
+        return false;
+
+    // Dentro do bloco, só pulamos os
+    // registros lendo os cabeçalhos.
+    struct GameRecord skipped;
+    for (uint64_t i = 0; i < game % reader->games_per_block; i++)
+        if (!read_game_record(reader, &skipped))
+            return false;
+
+    return true;
+}
+
+/**
+ * Representa a ação que o
+ * jogador (ou IA) deseja fazer.
+ */
+enum GameInput {
+    QUIT_INPUT,
+    UP_INPUT,
+    DOWN_INPUT,
+    LEFT_INPUT,
+    RIGHT_INPUT,
+    MOVE_INPUT,
+    /**
+     * Desfaz e refaz jogadas.
+     */
+    UNDO_INPUT,
+    REDO_INPUT,
+    /**
+     * Nenhuma ação, só pede
+     * para a tela ser redesenhada.
+     */
+    REDRAW_INPUT,
+    /**
+     * A entrada ainda não está pronta, a
+     * fonte pede para ser chamada de novo
+     * mais tarde (veja `GameInputSourceStep`).
+     */
+    WAIT_INPUT,
+};
+
+/**
+ * Tipo genérico para argumentos
+ * do GameInputSourceExecutor
+ */
+typedef void *GameInputSourceArgs;
+
+/**
+ * Tipo do formato da função que
+ * pega um input de algum lugar.
+ */
+typedef enum GameInput(*GameInputSourceExecutor)(GameInputSourceArgs);
+
+/**
+ * Tipo do formato da função que pega um input
+ * sem bloquear: ela faz só um "passo", e em vez
+ * de dormir retorna `WAIT_INPUT`, dizendo em
+ * `wake_at` quando quer ser chamada de novo
+ * (no relógio de `monotonic_ns`, assim como `now`).
+ *
+ * O que ela precisa lembrar entre os
+ * passos fica nos próprios `args`, então uma
+ * thread só pode levar milhares de fontes ao
+ * mesmo tempo (veja `InputScheduler`).
+ */
+typedef enum GameInput(*GameInputSourceStep)(GameInputSourceArgs, uint64_t now, uint64_t *wake_at);
+
+/**
+ * Estrutura para pegar a
+ * entrada de algo no jogo.
+ */
+struct GameInputSource
+{
+    GameInputSourceExecutor executor;
+    GameInputSourceArgs args;
+};
+
+/**
+ * Joga na célula `cell` se ela estiver livre
+ * e passa a vez para o oponente.
+ *
+ * Retorna `false` se a célula já estiver ocupada.
+ */
+bool play_game_move(struct GameState *state, struct Vec2 cell)
+{
+    enum Move move_in_cell = game_board_cell(state->board, cell);
+    if (move_in_cell != FREE_MOVE)
+        return false;
+
+    enum Move move = actor_to_move(state->turn);
+    set_game_board_cell(state->board, cell, move);
+    line_counters_add((move == X_MOVE) ? &state->x_lines : &state->o_lines, (cell.y * 3) + cell.x);
+    state->hash ^= zobrist_cell_keys[move == O_MOVE][(cell.y * 3) + cell.x];
+    state->turn = opponent_actor(state->turn);
+    state->moves++;
+
+    struct GameRecord *record = &state->record;
+    struct BoardSnapshot snapshot = state->snapshots[record->len];
+    edit_move_print((move == X_MOVE) ? &snapshot.x : &snapshot.o, cell, true);
+
+    record->cells[record->len++] = (cell.y * 3) + cell.x;
+    state->snapshots[record->len] = snapshot;
+    return true;
+}
+
+/**
+ * O hash de Zobrist da posição, contando
+ * de quem é a vez.
+ */
+static inline uint64_t game_state_hash(const struct GameState *state)
+{
+    return state->hash ^ ((state->turn == O_ACTOR) ? zobrist_o_turn_key : 0);
+}
+
+/**
+ * Joga em `cell` como `play_game_move`, guardando
+ * em `undo` o necessário para desfazer a jogada
+ * com `unmake_game_move`, sem pedir memória.
+ *
+ * Quem faz a busca chama `detect_game_endgame`
+ * depois, se quiser saber se o jogo acabou.
+ *
+ * Retorna `false` se a célula já estiver ocupada.
+ */
+bool make_game_move(struct GameState *state, struct Vec2 cell, struct GameUndo *undo)
+{
+    uint8_t index = (cell.y * 3) + cell.x;
+    *undo = (struct GameUndo)
+    {
+        .hash_delta = zobrist_cell_keys[state->turn == O_ACTOR][index],
+        .selection = state->selection,
+        .endgame = state->endgame,
+        .cell = index,
+    };
+
+    // A primeira jogada decide quem começou.
+    if (state->moves == 0)
+        state->record.starter = state->turn;
+
+    return play_game_move(state, cell);
+}
+
+/**
+ * Desfaz a última jogada feita
+ * com `make_game_move`.
+ */
+void unmake_game_move(struct GameState *state, const struct GameUndo *undo)
+{
+    struct Vec2 cell = {undo->cell % 3, undo->cell / 3};
+
+    state->turn = opponent_actor(state->turn);
+    state->moves--;
+    state->record.len--;
+
+    set_game_board_cell(state->board, cell, FREE_MOVE);
+    line_counters_remove((state->turn == X_ACTOR) ? &state->x_lines : &state->o_lines, undo->cell);
+    state->hash ^= undo->hash_delta;
+
+    state->selection = undo->selection;
+    state->endgame = undo->endgame;
+}
+
+/**
+ * Desfaz a última jogada (ou as 2 últimas, com
+ * `undo_whole_turn`) do histórico da interface.
+ *
+ * Retorna `false` se não houver o que desfazer.
+ */
+bool undo_game_moves(struct GameState *state)
+{
+    uint8_t count = state->undo_whole_turn ? 2 : 1;
+    if (state->history_len < count)
+        return false;
+
+    for (uint8_t i = 0; i < count; i++)
+        unmake_game_move(state, &state->history[--state->history_len]);
+    return true;
+}
+
+/**
+ * Refaz o que `undo_game_moves` desfez.
+ *
+ * Retorna `false` se não houver o que refazer
+ * (ou se uma jogada não puder ser refeita, aí
+ * o histórico para onde ela estava).
+ */
+bool redo_game_moves(struct GameState *state)
+{
+    uint8_t count = state->undo_whole_turn ? 2 : 1;
+    if (state->redo_len - state->history_len < count)
+        return false;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        struct GameUndo *undo = &state->history[state->history_len];
+        if (!make_game_move(state, vec2(undo->cell % 3, undo->cell / 3), undo))
+            return false;
+        state->history_len++;
+    }
+    return true;
+}
+
+/**
+ * Modifica o estado do jogo baseado
+ * no input `input`.
+ *
+ * Sempre retorna `false`, ao menos que
+ * o input seja `QUIT_INPUT`, aí retorna `true`.
+ */
+bool apply_game_input(struct GameState *state, enum GameInput input)
+{
+    switch (input)
+    {
+    case QUIT_INPUT:
+        return true;
+    case REDRAW_INPUT:
+    case WAIT_INPUT:
+        break;
+    case UP_INPUT:
+        state->selection.y = ((state->selection.y + 3) - 1) % 3;
+        break;
+    case DOWN_INPUT:
+        state->selection.y = (state->selection.y + 1) % 3;
+        break;
+    case LEFT_INPUT:
+        state->selection.x = ((state->selection.x + 3) - 1) % 3;
+        break;
+    case RIGHT_INPUT:
+        state->selection.x = (state->selection.x + 1) % 3;
+        break;
+    case MOVE_INPUT:
+    {
+        // Só uma jogada que deu certo entra no histórico
+        // (e apaga o que dava para refazer).
+        struct GameUndo undo;
+        if (make_game_move(state, state->selection, &undo))
+        {
+            state->history[state->history_len] = undo;
+            state->redo_len = ++state->history_len;
+        }
+        break;
+    }
+    case UNDO_INPUT:
+        undo_game_moves(state);
+        break;
+    case REDO_INPUT:
+        redo_game_moves(state);
+        break;
+    }
+
+    return false;
+}
+
+/**
+ * Modifica o estado do jogo baseado
+ * no input recebido pelo `game_input_source`.
+ *
+ * Sempre retorna `false`, ao menos que
+ * o input recebido seja `QUIT_INPUT`, aí retorna `true`.
+ */
+bool process_game_input(struct GameState *state, struct GameInputSource game_input_source)
+{
+    return apply_game_input(state, game_input_source.executor(game_input_source.args));
+}
+
+/**
+ * Calcula o número mínimo de
+ * jogadas necessárias para ganhar
+ * até o final do jogo, levando
+ * em consideração quem iniciou o
+ * jogo.
+ */
+uint8_t calc_min_moves(bool starter, uint8_t moves)
+{
+    uint8_t moves_left = 0;
+    if (starter)
+        moves_left = 5 - (moves - (moves / 2));
+    else
+        moves_left = 4 - (moves / 2);
+
+    uint8_t min_moves = 3 - moves_left;
+    return min_moves;
+}
+
+/**
+ * Detecta se houve algum
+ * vencedor ou empate, e
+ * então, atualiza o `endgame`.
+ */
+void detect_game_endgame(struct GameState *state)
+{
+    // Assim que o jogo começa, nós guardamos
+    // quem começou, será SUPER importante
+    // para o algoritmo de detectar velha.
+    if (state->moves == 0)
+    {
+        state->record.starter = state->turn;
+        return;
+    }
+
+    // Não é possível ganhar um jogo com
+    // 4 jogadas, então ¯\_(ツ)_/¯
+    if (state->moves < 5)
+        return;
+
+    // Uma linha com 3 jogadas é vitória.
+    if (state->x_lines.lines_with[2] || state->o_lines.lines_with[2])
+    {
+        if (state->x_lines.lines_with[2])
+            state->endgame = X_VICTORY;
+        else
+            state->endgame = O_VICTORY;
+        return;
+    }
+
+    // Não há como detectar empate
+    // com menos de 6 jogadas.
+    if (state->moves < 6)
+        return;
+
+    bool is_x_starter = state->record.starter == X_ACTOR;
+    bool is_o_starter = state->record.starter == O_ACTOR;
+
+    uint8_t x_min_moves = calc_min_moves(is_x_starter, state->moves);
+    uint8_t o_min_moves = calc_min_moves(is_o_starter, state->moves);
+
+    // É velha se nenhuma linha sem o oponente tem
+    // jogadas suficientes para ser completada
+    // com as jogadas que ainda restam.
+    bool can_x_win = line_counters_open(&state->x_lines, &state->o_lines, x_min_moves) != 0;
+    bool can_o_win = line_counters_open(&state->o_lines, &state->x_lines, o_min_moves) != 0;
+
+    if (!can_x_win && !can_o_win)
+        state->endgame = GAME_DRAW;
+}
+
+/**
+ * Detecta se houve algum
+ * vencedor ou empate, e
+ * então, atualiza o estado.
+ *
+ * Quando o jogo termina, a partida
+ * é gravada no `recorder` (se houver).
+ */
+void process_game_state(struct GameState *state)
+{
+    bool was_running = state->endgame == RUNNING;
+
+    detect_game_endgame(state);
+
+    if (was_running && state->endgame != RUNNING)
+    {
+        state->record.result = state->endgame;
+        if (state->recorder != NULL)
+            push_game_record(state->recorder, &state->record);
+    }
+}
+
+/**
+ * Possíveis respostas de `blocking_confirm`.
+ */
+enum Confirmation
+{
+    CANCELED,
+    CONFIRMED,
+    /**
+     * O terminal mudou de tamanho,
+     * quem perguntou deve redesenhar
+     * a tela e perguntar de novo.
+     */
+    NEEDS_REDRAW,
+};
+
+/**
+ * Fica bloqueando o programa
+ * até que o jogador digite alguma
+ * tecla de confirmação ou saída/cancelamento.
+ *
+ * Retorna `CONFIRMED` para real confirmação
+ * e retorna `CANCELED` para caso queira saír/cancelar.
+ */
+enum Confirmation blocking_confirm()
+{
+    while (true)
+    {
+        enum KeyboardInput key = keyboard_input();
+
+        switch (key)
+        {
+            case KEY_Q:
+            case KEY_BACKSPACE:
+            case KEY_ESCAPE:
+                return CANCELED;
+            case KEY_ENTER:
+            case KEY_SPACE:
+                return CONFIRMED;
+            case KEY_RESIZE:
+                return NEEDS_REDRAW;
+            default:
+                continue;
+        }
+    }
+}
+
+/**
+ * Executa uma iteração de evento
+ * no jogo, retorna `true` se deve
+ * continuar, e `false` se deve parar.
+ */
+bool game_event_loop(struct GameState *state, struct GameInputSource game_input_source)
+{
+    uint64_t timer = phase_timer_start();
+    process_game_state(state);
+    phase_timer_stop(STATE_PHASE, timer);
+
+    uint64_t bytes = terminal_sink.bytes;
+    uint64_t writes = terminal_sink.writes;
+    timer = phase_timer_start();
+    render_game(state, true);
+    phase_timer_stop(RENDER_PHASE, timer);
+    last_frame_bytes = terminal_sink.bytes - bytes;
+    last_frame_writes = terminal_sink.writes - writes;
+
+    if (phase_stats_enabled)
+        render_phase_stats_overlay();
+
+    if (state->endgame != RUNNING)
+        return false;
+
+    timer = phase_timer_start();
+    bool quit = process_game_input(state, game_input_source);
+    phase_timer_stop(INPUT_PHASE, timer);
+    return !quit;
+}
+
+/**
+ * Converte uma tecla do jogador em uma ação.
+ *
+ * Retorna `false` se a tecla não
+ * significar nada durante o jogo.
+ */
+bool player_key_input(enum KeyboardInput key, enum GameInput *input)
+{
+    switch (key)
+    {
+    case KEY_W: case KEY_ARROW_UP: *input = UP_INPUT; return true;
+    case KEY_A: case KEY_ARROW_LEFT: *input = LEFT_INPUT; return true;
+    case KEY_S: case KEY_ARROW_DOWN: *input = DOWN_INPUT; return true;
+    case KEY_D: case KEY_ARROW_RIGHT: *input = RIGHT_INPUT; return true;
+    case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE: *input = QUIT_INPUT; return true;
+    case KEY_ENTER: case KEY_SPACE: *input = MOVE_INPUT; return true;
+    case KEY_U: *input = UNDO_INPUT; return true;
+    case KEY_R: *input = REDO_INPUT; return true;
+    case KEY_RESIZE: *input = REDRAW_INPUT; return true;
+#if PHASE_STATS
+    case KEY_T:
+        // Limpa a tela para o painel
+        // sumir quando for desligado.
+        phase_stats_enabled = !phase_stats_enabled;
+        new_screen_frame(true);
+        *input = REDRAW_INPUT;
+        return true;
+#endif
+    default: return false;
+    }
+}
+
+/**
+ * Bloqueia a execução e espera
+ * uma entrada do jogador.
+ *
+ * Compatível com o tipo `GameInputSourceExecutor`.
+ */
+enum GameInput player_game_input(GameInputSourceArgs a)
+{
+    enum GameInput input = REDRAW_INPUT;
+    while (!player_key_input(keyboard_input(), &input));
+    return input;
+}
+
+struct AIBrain;
+
+/**
+ * Tipo da função responsável
+ * por ser o "cortex" da IA.
+ * Responsável pela análise "visual",
+ * análise "espacial" e tomada de decisão.
+ */
+typedef void (*AIBrainCortex)(struct AIBrain *brain);
+
+/**
+ * Macro que define o valor
+ * do `goal` que indica que a IA
+ * ainda não pensou em uma jogada.
+ */
+#define AI_THINKING_STATE vec2(-1, -1)
+
+/**
+ * Macro para detectar se a IA
+ * ainda precisa pensar em uma jogada.
+ *
+ * Veja: `AI_THINKING_STATE`
+ */
+#define is_ai_thinking(v) ((v.x < 0) || (v.y < 0))
+
+/**
+ * Em que passo a IA está enquanto "joga
+ * como uma pessoa" (veja `ai_game_input_step`).
+ */
+enum AIStep
+{
+    /**
+     * Pronta para começar uma jogada ou um passo.
+     */
+    AI_READY_STEP,
+    /**
+     * Fingindo que pensa, ao acordar
+     * executa o cortex.
+     */
+    AI_THINKING_STEP,
+    /**
+     * Ao acordar, anda uma célula.
+     */
+    AI_WALKING_STEP,
+    /**
+     * Ao acordar, marca a célula.
+     */
+    AI_MOVING_STEP,
+};
+
+/**
+ * A "cabeça" da IA.
+ */
+struct AIBrain
+{
+    /**
+     * Os "olhos" da IA,
+     * ela não pode modificar
+     * diretamente, apenas "ver".
+     */
+    struct GameState *view;
+    /**
+     * O "tomador de decisão" da IA.
+     */
+    AIBrainCortex cortex;
+    /**
+     * Dados próprios do cortex (como o
+     * processo de um motor externo),
+     * `NULL` para os cortexes internos.
+     */
+    void *cortex_data;
+    /**
+     * Memória de rascunho do cortex.
+     *
+     * O que ele pede durante uma jogada é devolvido
+     * no fim dela (`ai_think`), e quem joga várias
+     * partidas pode zerar tudo entre elas.
+     * Se for `NULL`, usa a arena da thread.
+     */
+    struct Arena *arena;
+    /**
+     * Quando os valores de goal
+     * forem negativos, significa
+     * que a IA ainda não pensou,
+     * enquanto valores positivos (0-2),
+     * indicam onde ela vai jogar.
+     *
+     * Veja: `AI_THINKING_STATE`
+     */
+    struct Vec2 goal;
+    /**
+     * Onde a IA parou entre as
+     * chamadas de `ai_game_input_step`.
+     */
+    enum AIStep step;
+    /**
+     * Limite de tempo de cada jogada, em
+     * milissegundos (`0` para nenhum), e o
+     * prazo da jogada atual, que o `ai_think`
+     * calcula (no relógio de `monotonic_ns`).
+     */
+    uint32_t time_limit_ms;
+    uint64_t deadline;
+    /**
+     * Pedido para parar de pensar (`NULL` para
+     * nenhum), quando o valor apontado não for `0`.
+     */
+    const volatile sig_atomic_t *cancel;
+    /**
+     * A melhor jogada achada até agora.
+     *
+     * O `ai_think` começa com uma célula livre
+     * qualquer e os cortexes que demoram vão
+     * melhorando, então ela sempre vale: se o
+     * cortex parar antes de escolher, a IA joga ela.
+     */
+    struct Vec2 best_move;
+};
+
+/**
+ * Construtor para `AIBrain`.
+ *
+ * O limite de tempo das jogadas
+ * vem de `--think-ms`.
+ */
+struct AIBrain create_ai_brain(struct GameState *state, AIBrainCortex cortex)
+{
+    return (struct AIBrain)
+    {
+        .view = state,
+        .cortex = cortex,
+        .goal = AI_THINKING_STATE,
+        .time_limit_ms = program_options.think_ms,
+    };
+}
+
+/**
+ * Arena usada pelos cérebros sem uma própria.
+ */
+THREAD_LOCAL struct Arena ai_thread_arena = {0};
+
+/**
+ * Gerador de números aleatórios das IAs,
+ * um por thread (um "xorshift").
+ *
+ * Enquanto uma thread não chama `seed_ai_random`,
+ * ela usa o `rand` de sempre, e as partidas
+ * com `--seed` continuam saindo iguais.
+ */
+THREAD_LOCAL uint32_t ai_random_state = 0;
+
+void seed_ai_random(uint32_t seed)
+{
+    // O xorshift nunca sai do 0.
+    ai_random_state = (seed != 0) ? seed : 0x9E3779B9u;
+}
+
+int ai_random()
+{
+    if (ai_random_state == 0)
+        return rand();
+
+    ai_random_state ^= ai_random_state << 13;
+    ai_random_state ^= ai_random_state >> 17;
+    ai_random_state ^= ai_random_state << 5;
+    return (int)(ai_random_state >> 1);
+}
+
+/**
+ * Executa o "cortex" da IA.
+ *
+ * Se ele parar antes de escolher (pelo
+ * prazo ou pelo `cancel`), a IA fica
+ * com a `best_move`.
+ */
+void ai_think(struct AIBrain *brain)
+{
+    if (brain->arena == NULL)
+        brain->arena = &ai_thread_arena;
+    struct ArenaMark mark = arena_mark(brain->arena);
+
+    brain->deadline = (brain->time_limit_ms > 0)
+        ? monotonic_ns() + ((uint64_t)brain->time_limit_ms * 1000000) : 0;
+    MovePrint taken = brain->view->x_lines.marks | brain->view->o_lines.marks;
+    int free_cell = 0;
+    while (free_cell < 8 && (taken & (1 << free_cell)))
+        free_cell++;
+    brain->best_move = vec2(free_cell % 3, free_cell / 3);
+
+    uint64_t timer = phase_timer_start();
+    brain->cortex(brain);
+    phase_timer_stop(AI_PHASE, timer);
+
+    if (is_ai_thinking(brain->goal))
+        brain->goal = brain->best_move;
+
+    arena_rewind(brain->arena, mark);
+}
+
+/**
+ * Escolhe o próximo passo para
+ * "andar" de `where_i_am` até
+ * `where_i_want` como um jogador.
+ */
+enum GameInput walk_towards(struct Vec2 where_i_am, struct Vec2 where_i_want)
+{
+    struct Vec2 direction =
+    {
+        where_i_want.x - where_i_am.x,
+        where_i_want.y - where_i_am.y,
+    };
+    struct Vec2 distance = {abs(direction.x), abs(direction.y)};
+
+    if (distance.x > distance.y)
+    {
+        if (direction.x < 0)
+            return LEFT_INPUT;
+        return RIGHT_INPUT;
+    }
+    if (direction.y < 0)
+        return UP_INPUT;
+    return DOWN_INPUT;
+}
+
+/**
+ * Algoritmo para fazer a IA
+ * "andar" pelo tabuleiro como
+ * um jogador.
+ */
+enum GameInput ai_walk(struct AIBrain *brain)
+{
+    return walk_towards(brain->view->selection, brain->goal);
+}
+
+/**
+ * Quando acordar uma fonte que quer
+ * esperar `ms` milissegundos a partir de `now`.
+ *
+ * Sem esperas (`program_options.no_delay`),
+ * é o próprio `now`.
+ */
+uint64_t input_wake_time(uint64_t now, uint32_t ms)
+{
+    return program_options.no_delay ? now : now + ((uint64_t)ms * 1000000);
+}
+
+/**
+ * Simula alguém pensando e jogando,
+ * enviando inputs gerados por software,
+ * um passo por vez.
+ *
+ * Cada input vem depois de uma espera (pensar,
+ * andar, marcar), que é devolvida como `WAIT_INPUT`
+ * e o passo seguinte fica em `brain->step`.
+ *
+ * Compatível com o tipo `GameInputSourceStep`.
+ */
+enum GameInput ai_game_input_step(GameInputSourceArgs a, uint64_t now, uint64_t *wake_at)
+{
+    struct AIBrain *brain = a;
+
+    switch (brain->step)
+    {
+    case AI_READY_STEP:
+        if (is_ai_thinking(brain->goal))
+        {
+            brain->step = AI_THINKING_STEP;
+            *wake_at = input_wake_time(now, (rand() % 300) + 300);
+            return WAIT_INPUT;
+        }
+        break;
+    case AI_THINKING_STEP:
+        ai_think(brain);
+        break;
+    case AI_WALKING_STEP:
+        brain->step = AI_READY_STEP;
+        return ai_walk(brain);
+    case AI_MOVING_STEP:
+        brain->step = AI_READY_STEP;
+        brain->goal = AI_THINKING_STATE;
+        return MOVE_INPUT;
+    }
+
+    bool am_i_where_i_want = (brain->goal.x == brain->view->selection.x)
+        && (brain->goal.y == brain->view->selection.y);
+    if (am_i_where_i_want)
+    {
+        brain->step = AI_MOVING_STEP;
+        *wake_at = input_wake_time(now, 225);
+    }
+    else
+    {
+        brain->step = AI_WALKING_STEP;
+        *wake_at = input_wake_time(now, (rand() % 50) + 100);
+    }
+    return WAIT_INPUT;
+}
+
+/**
+ * Executa uma fonte que não bloqueia
+ * (`GameInputSourceStep`) como uma que
+ * bloqueia, dormindo nas esperas dela.
+ */
+enum GameInput wait_game_input(GameInputSourceStep step, GameInputSourceArgs args)
+{
+    uint64_t wake_at = 0;
+    enum GameInput input;
+    while ((input = step(args, monotonic_ns(), &wake_at)) == WAIT_INPUT)
+    {
+        uint64_t now = monotonic_ns();
+        if (wake_at > now)
+            block_delay((wake_at - now + 999999) / 1000000);
+    }
+    return input;
+}
+
+/**
+ * Simula alguém pensando e jogando,
+ * enviando inputs gerados por software.
+ *
+ * Compatível com o tipo `GameInputSourceExecutor`.
+ */
+enum GameInput ai_game_input(GameInputSourceArgs a)
+{
+    return wait_game_input(ai_game_input_step, a);
+}
+
+/**
+ * Uma fonte esperando no `InputScheduler`:
+ * `task` diz qual é (um índice de quem usa) e
+ * `tag` serve para reconhecer esperas velhas
+ * (de uma partida que já acabou, por exemplo).
+ */
+struct ScheduledInput
+{
+    uint64_t wake_at;
+    uint32_t task;
+    uint32_t tag;
+};
+
+/**
+ * Agenda de fontes de entrada que não
+ * bloqueiam: uma "heap" com quem acorda
+ * primeiro no topo, para uma thread só
+ * levar milhares de partidas ao mesmo tempo.
+ */
+struct InputScheduler
+{
+    struct ScheduledInput *heap;
+    uint32_t len;
+    uint32_t cap;
+};
+
+/**
+ * Agenda a fonte `task` para `wake_at`.
+ */
+void schedule_input(struct InputScheduler *scheduler, uint32_t task, uint32_t tag, uint64_t wake_at)
+{
+    if (scheduler->len == scheduler->cap)
+    {
+        scheduler->cap = (scheduler->cap == 0) ? 64 : scheduler->cap * 2;
+        scheduler->heap = realloc(scheduler->heap, scheduler->cap * sizeof(struct ScheduledInput));
+    }
+
+    // Sobe até achar quem acorda antes.
+    uint32_t i = scheduler->len++;
+    while (i > 0 && scheduler->heap[(i - 1) / 2].wake_at > wake_at)
+    {
+        scheduler->heap[i] = scheduler->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    scheduler->heap[i] = (struct ScheduledInput){ .wake_at = wake_at, .task = task, .tag = tag };
+}
+
+/**
+ * Tira da agenda a fonte que acorda primeiro,
+ * se ela já deve acordar em `now`.
+ */
+bool take_due_input(struct InputScheduler *scheduler, uint64_t now, struct ScheduledInput *due)
+{
+    if (scheduler->len == 0 || scheduler->heap[0].wake_at > now)
+        return false;
+
+    *due = scheduler->heap[0];
+    struct ScheduledInput last = scheduler->heap[--scheduler->len];
+
+    // Desce o último até o lugar dele.
+    uint32_t i = 0;
+    while (true)
+    {
+        uint32_t child = (2 * i) + 1;
+        if (child >= scheduler->len)
+            break;
+        if (child + 1 < scheduler->len && scheduler->heap[child + 1].wake_at < scheduler->heap[child].wake_at)
+            child++;
+        if (scheduler->heap[child].wake_at >= last.wake_at)
+            break;
+        scheduler->heap[i] = scheduler->heap[child];
+        i = child;
+    }
+    if (scheduler->len > 0)
+        scheduler->heap[i] = last;
+    return true;
+}
+
+/**
+ * Quantos milissegundos faltam para a próxima
+ * fonte acordar, arredondado para cima, ou `-1`
+ * se a agenda estiver vazia (o formato do
+ * tempo de espera do `poll`).
+ */
+int input_scheduler_timeout(const struct InputScheduler *scheduler, uint64_t now)
+{
+    if (scheduler->len == 0)
+        return -1;
+    if (scheduler->heap[0].wake_at <= now)
+        return 0;
+    return (int)((scheduler->heap[0].wake_at - now + 999999) / 1000000);
+}
+
+/**
+ * Libera a agenda.
+ */
+void close_input_scheduler(struct InputScheduler *scheduler)
+{
+    free(scheduler->heap);
+    *scheduler = (struct InputScheduler){0};
+}
+
+/**
+ * Cortex ruim.
+ *
+ * Basicamente, uma burrice artificial.
+ * Apenas escolhe uma célula aleatória e joga.
+ */
+void dumb_ai_cortex(struct AIBrain *brain)
+{
+    struct Vec2 randomly_choosen_cell = {0};
+
+    do
+        randomly_choosen_cell = vec2(ai_random() % 3, ai_random() % 3);
+    while (game_board_cell(brain->view->board, randomly_choosen_cell) != FREE_MOVE);
+
+    brain->goal = randomly_choosen_cell;
+}
+
+/**
+ * Parte do cortex mediano/bom.
+ *
+ * Diz se a linha analisada é
+ * potencialmente ruim de jogar,
+ * pelas contagens de jogadas nela.
+ */
+static inline bool avarage_ai_is_line_potentially_useless(uint8_t my_count, uint8_t enemy_count)
+{
+    return my_count > 0 || enemy_count == 0;
+}
+
+/**
+ * Parte do cortex mediano/bom.
+ *
+ * Enxerga quais jogadas faltam em uma linha.
+ */
+MovePrint avarage_ai_see_missing_moves(MovePrint my_moves, int match_print_i)
+{
+    return my_moves ^ match_move_prints[match_print_i];
+}
+
+/**
+ * Parte do cortex mediano/bom.
+ *
+ * Uma memória temporária para
+ * armazenar possíveis jogadas.
+ */
+struct AvarageAIMoveOptions
+{
+    size_t len;
+    struct Vec2 moves[9];
+    MovePrint __stored_moves;
+};
+
+/**
+ * Parte do cortex mediano/bom.
+ *
+ * Adiciona mais uma jogada em um
+ * `AvarageAIMoveOptions` se ainda
+ * não houver a jogada `move`.
+ */
+void avarage_ai_move_options_push(struct AvarageAIMoveOptions *opts, struct Vec2 move)
+{
+    if (!move_print_inspec(opts->__stored_moves, move))
+    {
+        edit_move_print(&opts->__stored_moves, move, true);
+        opts->moves[opts->len] = move;
+        opts->len++;
+    }
+}
+
+/**
+ * Parte do cortex mediano/bom.
+ *
+ * Pega aleatoriamente uma
+ * jogada de um `AvarageAIMoveOptions`
+ */
+struct Vec2 avarage_ai_move_options_pick(struct AvarageAIMoveOptions *opts)
+{
+    if (opts->len == 0) return vec2(-1, -1);
+
+    if (opts->len == 1) return opts->moves[0];
+    return opts->moves[ai_random() % opts->len];
+}
+
+/**
+ * Cortex mediano/bom.
+ *
+ * Em resumo, o algoritmo consiste
+ * em sempre tentar bloquear o oponente,
+ * e ganhar assim que aparecer uma
+ * oportunidade, mas não é
+ * estratégico o suficiente
+ * para ser impossível.
+ */
+void avarage_ai_cortex(struct AIBrain *brain)
+{
+    bool should_i_start = brain->view->moves == 0;
+    if (should_i_start)
+    {
+        brain->goal = vec2(ai_random() % 3, ai_random() % 3);
+        return;
+    }
+
+    bool am_i_x = brain->view->turn == X_ACTOR;
+    const struct LineCounters *mine = am_i_x ? &brain->view->x_lines : &brain->view->o_lines;
+    const struct LineCounters *enemy = am_i_x ? &brain->view->o_lines : &brain->view->x_lines;
+
+    // Se dá para ganhar agora, ganha
+    // (na primeira linha possível).
+    uint8_t my_threats = line_counters_threats(mine, enemy);
+    if (my_threats != 0)
+    {
+        int i = lowest_bit_index(my_threats);
+        MovePrint missing_move = avarage_ai_see_missing_moves(mine->marks & match_move_prints[i], i);
+        move_print_coords(missing_move, &brain->goal);
+        return;
+    }
+
+    // As listas de jogadas ficam na arena
+    // e somem sozinhas no fim da jogada.
+    struct AvarageAIMoveOptions *lists = arena_alloc(brain->arena, 3 * sizeof(struct AvarageAIMoveOptions));
+    if (lists == NULL)
+    {
+        dumb_ai_cortex(brain);
+        return;
+    }
+    memset(lists, 0, 3 * sizeof(struct AvarageAIMoveOptions));
+    struct AvarageAIMoveOptions *danger_cells = &lists[0];
+    struct AvarageAIMoveOptions *avarage_moves = &lists[1];
+    struct AvarageAIMoveOptions *potentially_useless = &lists[2];
+
+    for (int i = 0; i < 8; i++)
+    {
+        MovePrint my_moves = mine->marks & match_move_prints[i];
+        MovePrint enemy_moves = enemy->marks & match_move_prints[i];
+        uint8_t my_count = mine->counts[i];
+        uint8_t enemy_count = enemy->counts[i];
+
+        if (avarage_ai_is_line_potentially_useless(my_count, enemy_count))
+        {
+            MovePrint moves = avarage_ai_see_missing_moves(my_moves, i);
+            uint8_t move_count = move_print_count(moves);
+            struct Vec2 move_coords[3] = {0};
+            move_print_coords(moves, move_coords);
+            for (int i = 0; i < move_count; i++)
+                avarage_ai_move_options_push(potentially_useless, move_coords[i]);
+            continue;
+        }
+
+        // Aqui a linha só tem jogadas do inimigo.
+        bool will_enemy_win = enemy_count == 2;
+        if (will_enemy_win)
+        {
+            MovePrint missing_move = avarage_ai_see_missing_moves(enemy_moves, i);
+            struct Vec2 danger_cell = {0};
+            move_print_coords(missing_move, &danger_cell);
+            avarage_ai_move_options_push(danger_cells, danger_cell);
+            continue;
+        }
+
+        MovePrint available_moves = avarage_ai_see_missing_moves(enemy_moves, i);
+        struct Vec2 available_moves_coords[2] = {0};
+        move_print_coords(available_moves, available_moves_coords);
+
+        avarage_ai_move_options_push(avarage_moves, available_moves_coords[0]);
+        avarage_ai_move_options_push(avarage_moves, available_moves_coords[1]);
+    }
+
+    bool am_i_in_danger = danger_cells->len > 0;
+    bool do_i_have_good_moves = avarage_moves->len > 0;
+
+    if (am_i_in_danger)
+        brain->goal = avarage_ai_move_options_pick(danger_cells);
+    else if (do_i_have_good_moves)
+        brain->goal = avarage_ai_move_options_pick(avarage_moves);
+    else
+        brain->goal = avarage_ai_move_options_pick(potentially_useless);
+}
+
+/**
+ * Jogos m,n,k: um tabuleiro de `m` colunas
+ * por `n` linhas onde ganha quem fizer `k`
+ * em linha (o jogo da velha é o 3,3,3 e o
+ * gomoku é o 15,15,5).
+ *
+ * Em tabuleiros grandes a busca não chega
+ * no fim do jogo e precisa de uma avaliação
+ * rápida das posições. A avaliação daqui
+ * olha todas as "janelas" de `k` células em
+ * linha e troca o desenho de cada janela
+ * (as minhas peças e as do oponente) por uma
+ * pontuação tirada de uma tabela pronta.
+ */
+
+/**
+ * Maior `k` suportado: o desenho de uma
+ * janela usa `2 * k` bits.
+ */
+#define MNK_MAX_K 6
+
+/**
+ * Maior quantidade de janelas de um tabuleiro
+ * (o 7x7 com `k` 4 tem 112).
+ */
+#define MNK_MAX_WINDOWS 256
+
+/**
+ * Cada célula está em no máximo `4 * k`
+ * janelas (`k` em cada uma das 4 direções).
+ */
+#define MNK_CELL_MAX_WINDOWS (4 * MNK_MAX_K)
+
+/**
+ * O tabuleiro é guardado num `uint64_t`, como
+ * o `MovePrint`, com uma coluna sobrando em
+ * cada linha: o bit `y * (m + 1) + x` é a
+ * célula `(x, y)`.
+ *
+ * A coluna a mais fica sempre vazia, assim
+ * ao deslocar o tabuleiro para o lado uma
+ * peça nunca "vaza" para a linha de baixo.
+ * Por isso `(m + 1) * n` não pode passar de 64.
+ */
+typedef uint64_t MnkPrint;
+
+/**
+ * Uma janela de `k` células em linha. A
+ * célula `i` da janela é `start + i * step`.
+ */
+struct MnkWindow
+{
+    uint8_t start;
+    uint8_t step;
+    MnkPrint mask;
+};
+
+/**
+ * Uma janela que passa por uma célula e
+ * em qual posição da janela a célula está.
+ */
+struct MnkCellWindow
+{
+    uint8_t window;
+    uint8_t slot;
+};
+
+/**
+ * Tudo o que depende só do tamanho do tabuleiro:
+ * as janelas, as janelas de cada célula, a ordem
+ * das jogadas na busca e a tabela de pontuações.
+ *
+ * É montada uma vez por `build_mnk_geometry`
+ * (antes de criar threads) e depois só é lida.
+ */
+struct MnkGeometry
+{
+    uint8_t m, n, k;
+    uint8_t stride;
+    uint8_t cells_len;
+    MnkPrint cells;
+
+    struct MnkWindow windows[MNK_MAX_WINDOWS];
+    uint16_t windows_len;
+    struct MnkCellWindow cell_windows[64][MNK_CELL_MAX_WINDOWS];
+    uint8_t cell_windows_len[64];
+    uint8_t move_order[64];
+
+    /**
+     * Para cada direção (→, ↓, ↘ e ↙), o passo
+     * entre as células e as células onde uma
+     * janela pode começar.
+     */
+    uint8_t steps[4];
+    MnkPrint start_masks[4];
+
+    /**
+     * A pontuação (para X) de cada desenho
+     * de janela: os bits `0..k-1` são as peças
+     * de X e os bits `k..2k-1` as de O.
+     */
+    int32_t pattern_scores[1 << (2 * MNK_MAX_K)];
+};
+
+/**
+ * Quanto vale uma janela com `count` peças
+ * de um lado só: cada peça a mais vale 8
+ * vezes mais, e se faltar só uma é uma ameaça.
+ */
+const int32_t mnk_count_weights[MNK_MAX_K + 1] = {0, 1, 8, 64, 512, 4096, 32768};
+
+/**
+ * A pontuação de uma janela só com as peças
+ * `bits` de um lado.
+ *
+ * Peças juntas valem o dobro das separadas:
+ * um "três aberto" (`.XXX.` com `k` 5) é mais
+ * perigoso que um `X.X.X`, porque qualquer
+ * ponta vira um "quatro".
+ */
+int32_t mnk_pattern_score(uint32_t bits, int k)
+{
+    int count = 0;
+    for (uint32_t b = bits; b != 0; b &= b - 1)
+        count++;
+    if (count == 0)
+        return 0;
+
+    int32_t score = mnk_count_weights[count];
+    uint32_t shifted = bits;
+    while ((shifted & 1) == 0)
+        shifted >>= 1;
+    if (count >= 2 && count < k && shifted == (1u << count) - 1)
+        score *= 2;
+    return score;
+}
+
+/**
+ * Monta a geometria de um tabuleiro `m` x `n`
+ * com `k` em linha.
+ *
+ * Retorna `false` se o tabuleiro não couber.
+ */
+bool build_mnk_geometry(struct MnkGeometry *geometry, int m, int n, int k)
+{
+    if (m < 1 || n < 1 || k < 2 || k > MNK_MAX_K || (k > m && k > n) || (m + 1) * n > 64)
+        return false;
+
+    memset(geometry, 0, sizeof(struct MnkGeometry));
+    geometry->m = m;
+    geometry->n = n;
+    geometry->k = k;
+    geometry->stride = m + 1;
+    geometry->cells_len = m * n;
+
+    for (int y = 0; y < n; y++)
+        for (int x = 0; x < m; x++)
+            geometry->cells |= (MnkPrint)1 << (y * geometry->stride + x);
+
+    const int dxs[4] = {1, 0, 1, -1};
+    const int dys[4] = {0, 1, 1, 1};
+    for (int d = 0; d < 4; d++)
+    {
+        geometry->steps[d] = (dys[d] * geometry->stride) + dxs[d];
+
+        for (int y = 0; y < n; y++)
+        for (int x = 0; x < m; x++)
+        {
+            int end_x = x + (dxs[d] * (k - 1)), end_y = y + (dys[d] * (k - 1));
+            if (end_x < 0 || end_x >= m || end_y >= n)
+                continue;
+            if (geometry->windows_len == MNK_MAX_WINDOWS)
+                return false;
+
+            int start = y * geometry->stride + x;
+            struct MnkWindow *window = &geometry->windows[geometry->windows_len];
+            window->start = start;
+            window->step = geometry->steps[d];
+            for (int i = 0; i < k; i++)
+            {
+                int cell = start + (i * window->step);
+                window->mask |= (MnkPrint)1 << cell;
+                geometry->cell_windows[cell][geometry->cell_windows_len[cell]++] =
+                    (struct MnkCellWindow){.window = geometry->windows_len, .slot = i};
+            }
+            geometry->start_masks[d] |= (MnkPrint)1 << start;
+            geometry->windows_len++;
+        }
+    }
+
+    // Das células em mais janelas para as em
+    // menos, como a `qubic_move_order`.
+    int len = 0;
+    for (int cell = 0; cell < 64; cell++)
+    {
+        if ((geometry->cells & ((MnkPrint)1 << cell)) == 0)
+            continue;
+        int j = len++;
+        while (j > 0 && geometry->cell_windows_len[geometry->move_order[j - 1]] < geometry->cell_windows_len[cell])
+        {
+            geometry->move_order[j] = geometry->move_order[j - 1];
+            j--;
+        }
+        geometry->move_order[j] = cell;
+    }
+
+    // Janelas com peças dos dois lados
+    // não servem para ninguém e ficam com 0.
+    uint32_t full = (1u << k) - 1;
+    for (uint32_t x_bits = 0; x_bits <= full; x_bits++)
+        for (uint32_t o_bits = 0; o_bits <= full; o_bits++)
+        {
+            int32_t score = 0;
+            if (o_bits == 0)
+                score = mnk_pattern_score(x_bits, k);
+            else if (x_bits == 0)
+                score = -mnk_pattern_score(o_bits, k);
+            geometry->pattern_scores[x_bits | (o_bits << k)] = score;
+        }
+
+    return true;
+}
+
+/**
+ * Uma posição de um jogo m,n,k.
+ */
+struct MnkBoard
+{
+    const struct MnkGeometry *geometry;
+    MnkPrint x;
+    MnkPrint o;
+    enum Actor turn;
+    uint8_t moves;
+    enum EndGame endgame;
+};
+
+/**
+ * Cria um tabuleiro vazio.
+ */
+struct MnkBoard create_mnk_board(const struct MnkGeometry *geometry, enum Actor starter)
+{
+    return (struct MnkBoard)
+    {
+        .geometry = geometry,
+        .turn = starter,
+        .endgame = RUNNING,
+    };
+}
+
+/**
+ * Joga em `cell` (que precisa estar livre
+ * com o jogo em andamento). Só as janelas
+ * que passam por `cell` podem ter virado
+ * vitória.
+ */
+void mnk_make(struct MnkBoard *board, uint8_t cell)
+{
+    const struct MnkGeometry *geometry = board->geometry;
+    MnkPrint *mine = (board->turn == X_ACTOR) ? &board->x : &board->o;
+    *mine |= (MnkPrint)1 << cell;
+    board->moves++;
+
+    for (int i = 0; i < geometry->cell_windows_len[cell]; i++)
+    {
+        MnkPrint mask = geometry->windows[geometry->cell_windows[cell][i].window].mask;
+        if ((*mine & mask) == mask)
+        {
+            board->endgame = (board->turn == X_ACTOR) ? X_VICTORY : O_VICTORY;
+            break;
+        }
+    }
+    if (board->endgame == RUNNING && board->moves == geometry->cells_len)
+        board->endgame = GAME_DRAW;
+
+    board->turn = (board->turn == X_ACTOR) ? O_ACTOR : X_ACTOR;
+}
+
+/**
+ * Desfaz a última jogada, que foi em `cell`.
+ *
+ * Só se joga com o jogo em andamento, então
+ * antes dela o jogo estava em andamento.
+ */
+void mnk_unmake(struct MnkBoard *board, uint8_t cell)
+{
+    board->turn = (board->turn == X_ACTOR) ? O_ACTOR : X_ACTOR;
+    MnkPrint *mine = (board->turn == X_ACTOR) ? &board->x : &board->o;
+    *mine &= ~((MnkPrint)1 << cell);
+    board->moves--;
+    board->endgame = RUNNING;
+}
+
+/**
+ * Escreve as células livres em `moves`, na
+ * ordem da busca, e retorna quantas são.
+ */
+size_t mnk_moves(const struct MnkBoard *board, uint8_t moves[64])
+{
+    const struct MnkGeometry *geometry = board->geometry;
+    MnkPrint used = board->x | board->o;
+    size_t len = 0;
+    for (int i = 0; i < geometry->cells_len; i++)
+    {
+        uint8_t cell = geometry->move_order[i];
+        if ((used & ((MnkPrint)1 << cell)) == 0)
+            moves[len++] = cell;
+    }
+    return len;
+}
+
+/**
+ * O índice do bit ligado mais baixo
+ * (`bits` não pode ser 0).
+ */
+static inline int mnk_lowest_bit(MnkPrint bits)
+{
+#if defined (__GNUC__) || defined (__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int i = 0;
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/**
+ * O desenho de uma janela (`x` nos bits
+ * baixos e `o` depois dos `k` primeiros).
+ */
+static inline uint32_t mnk_window_pattern(const struct MnkGeometry *geometry, MnkPrint x, MnkPrint o, int start, int step)
+{
+    uint32_t pattern = 0;
+    for (int i = 0; i < geometry->k; i++)
+    {
+        int cell = start + (i * step);
+        pattern |= (uint32_t)((x >> cell) & 1) << i;
+        pattern |= (uint32_t)((o >> cell) & 1) << (geometry->k + i);
+    }
+    return pattern;
+}
+
+/**
+ * Avalia o tabuleiro inteiro (para X) sem
+ * guardar nada entre uma chamada e outra.
+ *
+ * Deslocar o tabuleiro `i * step` bits leva
+ * a célula `i` de cada janela para o começo
+ * dela, então `k` deslocamentos por direção
+ * dizem, de uma vez para todas as janelas,
+ * quais têm alguma peça de X e quais têm
+ * alguma de O. Só as janelas com peças de
+ * um lado só valem pontos, e só o desenho
+ * delas é montado.
+ */
+int32_t mnk_evaluate_full(const struct MnkBoard *board)
+{
+    const struct MnkGeometry *geometry = board->geometry;
+    int32_t score = 0;
+
+    for (int d = 0; d < 4; d++)
+    {
+        int step = geometry->steps[d];
+        MnkPrint any_x = 0, any_o = 0;
+        for (int i = 0; i < geometry->k; i++)
+        {
+            any_x |= board->x >> (i * step);
+            any_o |= board->o >> (i * step);
+        }
+
+        MnkPrint pure = (any_x ^ any_o) & geometry->start_masks[d];
+        while (pure != 0)
+        {
+            int start = mnk_lowest_bit(pure);
+            pure &= pure - 1;
+            score += geometry->pattern_scores[mnk_window_pattern(geometry, board->x, board->o, start, step)];
+        }
+    }
+    return score;
+}
+
+/**
+ * A avaliação por desenhos de janela mantida
+ * jogada a jogada: guarda o desenho de cada
+ * janela e a soma das pontuações, e cada
+ * jogada só mexe nas janelas da célula jogada.
+ */
+struct PatternEvaluator
+{
+    const struct MnkGeometry *geometry;
+    uint16_t patterns[MNK_MAX_WINDOWS];
+    /**
+     * Pontuação do ponto de vista de X.
+     */
+    int32_t score;
+};
+
+/**
+ * Monta os desenhos de todas as janelas
+ * de `board` do zero.
+ */
+void pattern_evaluator_reset(struct PatternEvaluator *evaluator, const struct MnkBoard *board)
+{
+    const struct MnkGeometry *geometry = board->geometry;
+    evaluator->geometry = geometry;
+    evaluator->score = 0;
+    for (int w = 0; w < geometry->windows_len; w++)
+    {
+        const struct MnkWindow *window = &geometry->windows[w];
+        uint32_t pattern = mnk_window_pattern(geometry, board->x, board->o, window->start, window->step);
+        evaluator->patterns[w] = pattern;
+        evaluator->score += geometry->pattern_scores[pattern];
+    }
+}
+
+/**
+ * Liga (ou desliga, em `unmake`) a peça de
+ * `actor` em `cell` nos desenhos das janelas
+ * que passam por ela.
+ */
+static inline void pattern_evaluator_toggle(struct PatternEvaluator *evaluator, uint8_t cell, enum Actor actor)
+{
+    const struct MnkGeometry *geometry = evaluator->geometry;
+    int shift = (actor == X_ACTOR) ? 0 : geometry->k;
+    for (int i = 0; i < geometry->cell_windows_len[cell]; i++)
+    {
+        struct MnkCellWindow cw = geometry->cell_windows[cell][i];
+        uint16_t old_pattern = evaluator->patterns[cw.window];
+        uint16_t new_pattern = old_pattern ^ (1u << (cw.slot + shift));
+        evaluator->score += geometry->pattern_scores[new_pattern] - geometry->pattern_scores[old_pattern];
+        evaluator->patterns[cw.window] = new_pattern;
+    }
+}
+
+void pattern_evaluator_make(void *data, uint8_t cell, enum Actor actor)
+{
+    pattern_evaluator_toggle(data, cell, actor);
+}
+
+void pattern_evaluator_unmake(void *data, uint8_t cell, enum Actor actor)
+{
+    pattern_evaluator_toggle(data, cell, actor);
+}
+
+/**
+ * A pontuação do ponto de vista de `turn`.
+ */
+int pattern_evaluator_evaluate(void *data, enum Actor turn)
+{
+    const struct PatternEvaluator *evaluator = data;
+    return (turn == X_ACTOR) ? evaluator->score : -evaluator->score;
+}
+
+/**
+ * Uma avaliação que a busca usa sem saber
+ * como ela funciona por dentro: a busca avisa
+ * cada jogada feita e desfeita, e pede a
+ * pontuação nas folhas.
+ *
+ * A avaliação já precisa estar montada para
+ * a posição da raiz antes da busca.
+ */
+struct MnkEvaluator
+{
+    void *data;
+    void (*make)(void *data, uint8_t cell, enum Actor actor);
+    void (*unmake)(void *data, uint8_t cell, enum Actor actor);
+    int (*evaluate)(void *data, enum Actor turn);
+};
+
+/**
+ * Pontuação de uma vitória na busca m,n,k.
+ * Fica bem acima de qualquer avaliação.
+ */
+#define MNK_WIN_SCORE 100000000
+
+/**
+ * Quando uma busca deve parar antes do fim:
+ * um prazo (`0` para nenhum) e um pedido
+ * (`NULL` para nenhum), como os do `AIBrain`.
+ */
+struct SearchStop
+{
+    uint64_t deadline;
+    const volatile sig_atomic_t *cancel;
+    /**
+     * A busca parou no meio, e o
+     * resultado dela não vale.
+     */
+    bool stopped;
+};
+
+/**
+ * Confere se a busca deve parar (o relógio
+ * só a cada 256 nós, ele é mais caro).
+ */
+static inline bool search_should_stop(struct SearchStop *stop, uint64_t nodes)
+{
+    if (!stop->stopped)
+        stop->stopped = (stop->cancel != NULL && *stop->cancel != 0)
+            || (stop->deadline != 0 && (nodes % 256) == 0 && monotonic_ns() >= stop->deadline);
+    return stop->stopped;
+}
+
+/**
+ * Busca alfa-beta (negamax) num jogo m,n,k,
+ * fazendo e desfazendo as jogadas no mesmo
+ * tabuleiro, como a `qubic_search`.
+ *
+ * Com `stop`, a busca pode parar no meio (o
+ * tabuleiro volta como estava, mas a pontuação
+ * não vale).
+ */
+int mnk_search(struct MnkBoard *board, const struct MnkEvaluator *evaluator, int depth, int alpha, int beta, uint64_t *nodes, struct SearchStop *stop)
+{
+    (*nodes)++;
+    if (stop != NULL && search_should_stop(stop, *nodes))
+        return 0;
+
+    if (board->endgame == GAME_DRAW)
+        return 0;
+    if (board->endgame != RUNNING)
+        return -(MNK_WIN_SCORE - board->moves);
+    if (depth == 0)
+        return evaluator->evaluate(evaluator->data, board->turn);
+
+    uint8_t moves[64];
+    size_t len = mnk_moves(board, moves);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        enum Actor actor = board->turn;
+        mnk_make(board, moves[i]);
+        evaluator->make(evaluator->data, moves[i], actor);
+
+        int score = -mnk_search(board, evaluator, depth - 1, -beta, -alpha, nodes, stop);
+
+        evaluator->unmake(evaluator->data, moves[i], actor);
+        mnk_unmake(board, moves[i]);
+        if (stop != NULL && stop->stopped)
+            return 0;
+        if (score > alpha)
+        {
+            alpha = score;
+            if (alpha >= beta)
+                break;
+        }
+    }
+    return alpha;
+}
+
+/**
+ * Escolhe a melhor jogada com uma
+ * busca de `depth` jogadas (o jogo
+ * precisa estar em andamento).
+ *
+ * Se a busca parar no meio (`stop`),
+ * a jogada retornada não vale.
+ */
+uint8_t mnk_best_move(struct MnkBoard *board, const struct MnkEvaluator *evaluator, int depth, uint64_t *nodes, struct SearchStop *stop)
+{
+    uint8_t moves[64];
+    size_t len = mnk_moves(board, moves);
+
+    // Toda pontuação é maior que `alpha`, então
+    // a primeira jogada sempre vira a melhor.
+    uint8_t best = 0;
+    int alpha = -MNK_WIN_SCORE - 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        enum Actor actor = board->turn;
+        mnk_make(board, moves[i]);
+        evaluator->make(evaluator->data, moves[i], actor);
+
+        int score = -mnk_search(board, evaluator, depth - 1, -MNK_WIN_SCORE - 1, -alpha, nodes, stop);
+
+        evaluator->unmake(evaluator->data, moves[i], actor);
+        mnk_unmake(board, moves[i]);
+        if (stop != NULL && stop->stopped)
+            break;
+        if (score > alpha)
+        {
+            alpha = score;
+            best = moves[i];
+        }
+    }
+    return best;
+}
+
+/**
+ * A geometria do jogo da velha (3,3,3),
+ * usada pelo `pattern_ai_cortex`.
+ */
+struct MnkGeometry classic_mnk_geometry;
+bool classic_mnk_geometry_ready = false;
+
+/**
+ * Monta a `classic_mnk_geometry` (só na
+ * primeira vez). Quem for usar a máquina
+ * em várias threads chama antes de criá-las.
+ */
+const struct MnkGeometry *get_classic_mnk_geometry()
+{
+    if (!classic_mnk_geometry_ready)
+    {
+        build_mnk_geometry(&classic_mnk_geometry, 3, 3, 3);
+        classic_mnk_geometry_ready = true;
+    }
+    return &classic_mnk_geometry;
+}
+
+/**
+ * Copia um estado do jogo clássico
+ * para um tabuleiro m,n,k 3,3,3.
+ */
+struct MnkBoard classic_to_mnk_board(const struct GameState *state)
+{
+    const struct MnkGeometry *geometry = get_classic_mnk_geometry();
+    struct MnkBoard board = create_mnk_board(geometry, state->turn);
+    for (int i = 0; i < 9; i++)
+    {
+        MnkPrint bit = (MnkPrint)1 << ((i / 3) * geometry->stride + (i % 3));
+        if (state->x_lines.marks & (1 << i))
+            board.x |= bit;
+        if (state->o_lines.marks & (1 << i))
+            board.o |= bit;
+    }
+    board.moves = state->moves;
+    return board;
+}
+
+/**
+ * A busca das máquinas m,n,k no jogo da
+ * velha, com profundidade crescente (1, 2, ...
+ * `depth`): cada profundidade terminada vira
+ * a `brain->best_move`, então ela pode parar a
+ * qualquer hora (veja `search_should_stop`) e
+ * ficar com a última que terminou.
+ */
+void mnk_ai_search(struct AIBrain *brain, struct MnkBoard *board, const struct MnkEvaluator *evaluator, int depth)
+{
+    struct SearchStop stop =
+    {
+        .deadline = brain->deadline,
+        .cancel = brain->cancel,
+    };
+
+    uint64_t nodes = 0;
+    for (int d = 1; d <= depth && !search_should_stop(&stop, 0); d++)
+    {
+        uint8_t cell = mnk_best_move(board, evaluator, d, &nodes, &stop);
+        if (!stop.stopped)
+            brain->best_move = vec2(cell % board->geometry->stride, cell / board->geometry->stride);
+    }
+    brain->goal = brain->best_move;
+}
+
+/**
+ * Profundidade da busca do `pattern_ai_cortex`.
+ * Bem curta, para a avaliação fazer diferença.
+ */
+#define PATTERN_AI_DEPTH 4
+
+/**
+ * Uma máquina que busca algumas jogadas
+ * à frente e avalia as folhas pelos
+ * desenhos das janelas.
+ */
+void pattern_ai_cortex(struct AIBrain *brain)
+{
+    struct MnkBoard board = classic_to_mnk_board(brain->view);
+
+    struct PatternEvaluator patterns;
+    pattern_evaluator_reset(&patterns, &board);
+    struct MnkEvaluator evaluator =
+    {
+        .data = &patterns,
+        .make = pattern_evaluator_make,
+        .unmake = pattern_evaluator_unmake,
+        .evaluate = pattern_evaluator_evaluate,
+    };
+
+    mnk_ai_search(brain, &board, &evaluator, PATTERN_AI_DEPTH);
+}
+
+/**
+ * Uma rede neural pequena para avaliar posições
+ * m,n,k, no estilo "NNUE" dos motores de xadrez
+ * (rede neural atualizada de forma eficiente).
+ *
+ * A entrada são as células: para cada célula
+ * existe uma entrada "minha peça está aqui" e
+ * outra "a peça do oponente está aqui", valendo
+ * 0 ou 1. A primeira camada (o "acumulador")
+ * é só a soma das colunas de pesos das entradas
+ * ligadas, então uma jogada só soma uma coluna
+ * e desfazer só subtrai a mesma coluna.
+ *
+ * Existe um acumulador para cada lado (cada um
+ * acha que as peças dele são as "minhas"). Na
+ * hora de avaliar, o de quem vai jogar vem
+ * primeiro, e o resto da rede é pequeno:
+ *
+ *  acumuladores (2 x 32, int16)
+ *  -> limitados a 0..127 (uint8)
+ *  -> camada de 64 para 32 (pesos int8)
+ *  -> limitada a 0..127 (uint8)
+ *  -> camada de 32 para 1 (pesos int8).
+ *
+ * Os números são inteiros pequenos ("quantizados")
+ * para caber muitos de uma vez nas instruções
+ * SIMD: 127 no acumulador é 1.0 e 64 num peso
+ * int8 é 1.0, então a saída vale 127 * 64 por 1.0.
+ */
+
+/**
+ * Entradas: "minha peça" e "peça do oponente"
+ * para cada um dos 64 bits do `MnkPrint`.
+ */
+#define NNUE_FEATURES 128
+
+/**
+ * Tamanho de cada acumulador.
+ */
+#define NNUE_HIDDEN 32
+
+/**
+ * Saídas da camada do meio.
+ */
+#define NNUE_L1 32
+
+/**
+ * Quantos bits a soma de uma camada int8
+ * é deslocada para voltar à escala do 127.
+ */
+#define NNUE_WEIGHT_SHIFT 6
+
+/**
+ * Os pesos da rede e o tabuleiro (`m`, `n`, `k`)
+ * para o qual eles foram treinados.
+ */
+struct NnueWeights
+{
+    uint8_t m, n, k;
+    int16_t feature_weights[NNUE_FEATURES][NNUE_HIDDEN];
+    int16_t feature_bias[NNUE_HIDDEN];
+    int8_t l1_weights[NNUE_L1][2 * NNUE_HIDDEN];
+    int32_t l1_bias[NNUE_L1];
+    int8_t l2_weights[NNUE_L1];
+    int32_t l2_bias;
+};
+
+/**
+ * Arquivo de pesos: "CTTN", a versão, `m`, `n`
+ * e `k`, e depois todos os pesos na ordem da
+ * `NnueWeights`, em "little-endian".
+ */
+#define NNUE_FILE_MAGIC "CTTN"
+#define NNUE_FILE_VERSION 1
+#define NNUE_FILE_SIZE (8 + (NNUE_FEATURES * NNUE_HIDDEN * 2) + (NNUE_HIDDEN * 2) \
+    + (NNUE_L1 * 2 * NNUE_HIDDEN) + (NNUE_L1 * 4) + NNUE_L1 + 4)
+
+/**
+ * Lê os pesos do arquivo `path`.
+ *
+ * Retorna `false` se não der para abrir
+ * ou se não for um arquivo de pesos.
+ */
+bool load_nnue_weights(struct NnueWeights *weights, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    uint8_t *bytes = malloc(NNUE_FILE_SIZE + 1);
+    // Um byte a mais para saber se o arquivo é maior.
+    size_t len = (bytes != NULL) ? fread(bytes, 1, NNUE_FILE_SIZE + 1, file) : 0;
+    fclose(file);
+    if (len != NNUE_FILE_SIZE || memcmp(bytes, NNUE_FILE_MAGIC, 4) != 0 || bytes[4] != NNUE_FILE_VERSION)
+    {
+        free(bytes);
+        return false;
+    }
+
+    weights->m = bytes[5];
+    weights->n = bytes[6];
+    weights->k = bytes[7];
+    const uint8_t *p = &bytes[8];
+    for (int f = 0; f < NNUE_FEATURES; f++)
+        for (int j = 0; j < NNUE_HIDDEN; j++, p += 2)
+            weights->feature_weights[f][j] = (int16_t)get_u16le(p);
+    for (int j = 0; j < NNUE_HIDDEN; j++, p += 2)
+        weights->feature_bias[j] = (int16_t)get_u16le(p);
+    for (int o = 0; o < NNUE_L1; o++)
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++, p++)
+            weights->l1_weights[o][j] = (int8_t)*p;
+    for (int o = 0; o < NNUE_L1; o++, p += 4)
+        weights->l1_bias[o] = (int32_t)get_u32le(p);
+    for (int o = 0; o < NNUE_L1; o++, p++)
+        weights->l2_weights[o] = (int8_t)*p;
+    weights->l2_bias = (int32_t)get_u32le(p);
+
+    free(bytes);
+    return true;
+}
+
+/**
+ * Grava os pesos em `path`, no
+ * formato da `load_nnue_weights`.
+ */
+bool save_nnue_weights(const struct NnueWeights *weights, const char *path)
+{
+    uint8_t *bytes = malloc(NNUE_FILE_SIZE);
+    if (bytes == NULL)
+        return false;
+
+    memcpy(bytes, NNUE_FILE_MAGIC, 4);
+    bytes[4] = NNUE_FILE_VERSION;
+    bytes[5] = weights->m;
+    bytes[6] = weights->n;
+    bytes[7] = weights->k;
+    uint8_t *p = &bytes[8];
+    for (int f = 0; f < NNUE_FEATURES; f++)
+        for (int j = 0; j < NNUE_HIDDEN; j++, p += 2)
+            put_u16le(p, (uint16_t)weights->feature_weights[f][j]);
+    for (int j = 0; j < NNUE_HIDDEN; j++, p += 2)
+        put_u16le(p, (uint16_t)weights->feature_bias[j]);
+    for (int o = 0; o < NNUE_L1; o++)
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++, p++)
+            *p = (uint8_t)weights->l1_weights[o][j];
+    for (int o = 0; o < NNUE_L1; o++, p += 4)
+        put_u32le(p, (uint32_t)weights->l1_bias[o]);
+    for (int o = 0; o < NNUE_L1; o++, p++)
+        *p = (uint8_t)weights->l2_weights[o];
+    put_u32le(p, (uint32_t)weights->l2_bias);
+
+    FILE *file = fopen(path, "wb");
+    bool ok = file != NULL && fwrite(bytes, 1, NNUE_FILE_SIZE, file) == NNUE_FILE_SIZE;
+    if (file != NULL && fclose(file) != 0)
+        ok = false;
+    free(bytes);
+    return ok;
+}
+
+/**
+ * Um número de `-range` a `range` de um
+ * gerador simples (LCG), só para não mexer
+ * no `rand`.
+ */
+static inline int nnue_random(uint32_t *seed, int range)
+{
+    *seed = (*seed * 1103515245u) + 12345u;
+    return (int)((*seed >> 16) % (2 * range + 1)) - range;
+}
+
+/**
+ * Sorteia pesos pequenos (sempre os mesmos
+ * para a mesma `seed`), para medir a rede
+ * sem precisar de um arquivo.
+ */
+void randomize_nnue_weights(struct NnueWeights *weights, int m, int n, int k, uint32_t seed)
+{
+    weights->m = m;
+    weights->n = n;
+    weights->k = k;
+
+    for (int f = 0; f < NNUE_FEATURES; f++)
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+            weights->feature_weights[f][j] = nnue_random(&seed, 24);
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+        weights->feature_bias[j] = 32 + nnue_random(&seed, 16);
+    for (int o = 0; o < NNUE_L1; o++)
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++)
+            weights->l1_weights[o][j] = nnue_random(&seed, 32);
+    for (int o = 0; o < NNUE_L1; o++)
+        weights->l1_bias[o] = nnue_random(&seed, 1024);
+    for (int o = 0; o < NNUE_L1; o++)
+        weights->l2_weights[o] = nnue_random(&seed, 64);
+    weights->l2_bias = 0;
+}
+
+/**
+ * Qual conjunto de instruções a rede usa.
+ */
+#if defined (__AVX2__)
+# define NNUE_SIMD_NAME "AVX2"
+#elif defined (__SSE2__)
+# define NNUE_SIMD_NAME "SSE2"
+#else
+# define NNUE_SIMD_NAME "escalar"
+#endif
+
+/**
+ * Produto escalar de `len` entradas uint8
+ * (0..127) com `len` pesos int8, uma por vez.
+ */
+static inline int32_t nnue_dot_scalar(const uint8_t *input, const int8_t *weights, int len)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < len; i++)
+        sum += input[i] * weights[i];
+    return sum;
+}
+
+/**
+ * O mesmo produto escalar, de 32 em 32 (AVX2)
+ * ou de 16 em 16 (SSE2). `len` precisa ser
+ * múltiplo de 32.
+ *
+ * O `maddubs` multiplica uint8 por int8 e soma
+ * os pares em int16; como as entradas vão só
+ * até 127, a soma nunca passa do limite do int16.
+ */
+static inline int32_t nnue_dot(const uint8_t *input, const int8_t *weights, int len)
+{
+#if defined (__AVX2__)
+    __m256i sum = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int i = 0; i < len; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)&input[i]);
+        __m256i b = _mm256_loadu_si256((const __m256i *)&weights[i]);
+        __m256i pairs = _mm256_maddubs_epi16(a, b);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+#elif defined (__SSE2__)
+    // O SSE2 não tem o `maddubs`, então os
+    // bytes viram int16 antes de multiplicar.
+    __m128i sum = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < len; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)&input[i]);
+        __m128i b = _mm_loadu_si128((const __m128i *)&weights[i]);
+        __m128i b_sign = _mm_cmpgt_epi8(zero, b);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, b_sign)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, b_sign)));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    return nnue_dot_scalar(input, weights, len);
+#endif
+}
+
+/**
+ * Soma (`sign` 1) ou subtrai (`sign` -1) uma
+ * coluna de pesos do acumulador.
+ */
+static inline void nnue_accumulate(int16_t *accumulator, const int16_t *column, int sign)
+{
+#if defined (__AVX2__)
+    for (int j = 0; j < NNUE_HIDDEN; j += 16)
+    {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)&accumulator[j]);
+        __m256i col = _mm256_loadu_si256((const __m256i *)&column[j]);
+        acc = (sign > 0) ? _mm256_add_epi16(acc, col) : _mm256_sub_epi16(acc, col);
+        _mm256_storeu_si256((__m256i *)&accumulator[j], acc);
+    }
+#elif defined (__SSE2__)
+    for (int j = 0; j < NNUE_HIDDEN; j += 8)
+    {
+        __m128i acc = _mm_loadu_si128((const __m128i *)&accumulator[j]);
+        __m128i col = _mm_loadu_si128((const __m128i *)&column[j]);
+        acc = (sign > 0) ? _mm_add_epi16(acc, col) : _mm_sub_epi16(acc, col);
+        _mm_storeu_si128((__m128i *)&accumulator[j], acc);
+    }
+#else
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+        accumulator[j] += sign * column[j];
+#endif
+}
+
+/**
+ * Limita um valor a 0..127 (a "ReLU cortada").
+ */
+static inline uint8_t nnue_clip(int32_t value)
+{
+    return (value < 0) ? 0 : ((value > 127) ? 127 : value);
+}
+
+/**
+ * A avaliação pela rede, com os acumuladores
+ * mantidos jogada a jogada.
+ */
+struct NnueEvaluator
+{
+    const struct NnueWeights *weights;
+    /**
+     * `[0]` do ponto de vista de X, `[1]` de O.
+     */
+    int16_t accumulators[2][NNUE_HIDDEN];
+};
+
+/**
+ * A entrada ligada por uma peça de `piece` em
+ * `cell`, do ponto de vista de `perspective`.
+ */
+static inline int nnue_feature(enum Actor perspective, enum Actor piece, uint8_t cell)
+{
+    return ((piece == perspective) ? 0 : 64) + cell;
+}
+
+/**
+ * Monta os acumuladores de `board` do zero.
+ */
+void nnue_evaluator_reset(struct NnueEvaluator *evaluator, const struct NnueWeights *weights, const struct MnkBoard *board)
+{
+    evaluator->weights = weights;
+    for (int p = 0; p < 2; p++)
+    {
+        enum Actor perspective = (p == 0) ? X_ACTOR : O_ACTOR;
+        memcpy(evaluator->accumulators[p], weights->feature_bias, sizeof(weights->feature_bias));
+        for (int cell = 0; cell < 64; cell++)
+        {
+            MnkPrint bit = (MnkPrint)1 << cell;
+            if (board->x & bit)
+                nnue_accumulate(evaluator->accumulators[p], weights->feature_weights[nnue_feature(perspective, X_ACTOR, cell)], 1);
+            else if (board->o & bit)
+                nnue_accumulate(evaluator->accumulators[p], weights->feature_weights[nnue_feature(perspective, O_ACTOR, cell)], 1);
+        }
+    }
+}
+
+void nnue_evaluator_make(void *data, uint8_t cell, enum Actor actor)
+{
+    struct NnueEvaluator *evaluator = data;
+    nnue_accumulate(evaluator->accumulators[0], evaluator->weights->feature_weights[nnue_feature(X_ACTOR, actor, cell)], 1);
+    nnue_accumulate(evaluator->accumulators[1], evaluator->weights->feature_weights[nnue_feature(O_ACTOR, actor, cell)], 1);
+}
+
+void nnue_evaluator_unmake(void *data, uint8_t cell, enum Actor actor)
+{
+    struct NnueEvaluator *evaluator = data;
+    nnue_accumulate(evaluator->accumulators[0], evaluator->weights->feature_weights[nnue_feature(X_ACTOR, actor, cell)], -1);
+    nnue_accumulate(evaluator->accumulators[1], evaluator->weights->feature_weights[nnue_feature(O_ACTOR, actor, cell)], -1);
+}
+
+/**
+ * Passa os acumuladores pelo resto da rede.
+ * `scalar` força a versão sem SIMD, para conferir.
+ */
+static inline int nnue_forward(const struct NnueEvaluator *evaluator, enum Actor turn, bool scalar)
+{
+    const struct NnueWeights *weights = evaluator->weights;
+    const int16_t *mine = evaluator->accumulators[(turn == X_ACTOR) ? 0 : 1];
+    const int16_t *theirs = evaluator->accumulators[(turn == X_ACTOR) ? 1 : 0];
+
+    uint8_t input[2 * NNUE_HIDDEN];
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+    {
+        input[j] = nnue_clip(mine[j]);
+        input[NNUE_HIDDEN + j] = nnue_clip(theirs[j]);
+    }
+
+    uint8_t hidden[NNUE_L1];
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        int32_t sum = scalar
+            ? nnue_dot_scalar(input, weights->l1_weights[o], 2 * NNUE_HIDDEN)
+            : nnue_dot(input, weights->l1_weights[o], 2 * NNUE_HIDDEN);
+        hidden[o] = nnue_clip((sum + weights->l1_bias[o]) >> NNUE_WEIGHT_SHIFT);
+    }
+
+    int32_t output = scalar
+        ? nnue_dot_scalar(hidden, weights->l2_weights, NNUE_L1)
+        : nnue_dot(hidden, weights->l2_weights, NNUE_L1);
+    return output + weights->l2_bias;
+}
+
+/**
+ * A pontuação do ponto de vista de `turn`.
+ */
+int nnue_evaluator_evaluate(void *data, enum Actor turn)
+{
+    return nnue_forward(data, turn, false);
+}
+
+/**
+ * Os pesos do cortex `nnue`, lidos
+ * do arquivo passado em `--nnue`.
+ */
+struct NnueWeights nnue_weights;
+bool nnue_weights_ready = false;
+
+/**
+ * Profundidade da busca do `nnue_ai_cortex`.
+ */
+#define NNUE_AI_DEPTH 4
+
+/**
+ * Uma máquina igual ao `pattern_ai_cortex`,
+ * mas avaliando as folhas pela rede neural.
+ *
+ * Sem pesos para o jogo da velha (3,3,3),
+ * joga como o `pattern_ai_cortex`.
+ */
+void nnue_ai_cortex(struct AIBrain *brain)
+{
+    if (!nnue_weights_ready || nnue_weights.m != 3 || nnue_weights.n != 3 || nnue_weights.k != 3)
+    {
+        pattern_ai_cortex(brain);
+        return;
+    }
+
+    struct MnkBoard board = classic_to_mnk_board(brain->view);
+
+    struct NnueEvaluator network;
+    nnue_evaluator_reset(&network, &nnue_weights, &board);
+    struct MnkEvaluator evaluator =
+    {
+        .data = &network,
+        .make = nnue_evaluator_make,
+        .unmake = nnue_evaluator_unmake,
+        .evaluate = nnue_evaluator_evaluate,
+    };
+
+    mnk_ai_search(brain, &board, &evaluator, NNUE_AI_DEPTH);
+}
+
+/**
+ * Uma máquina que aprende jogando contra ela
+ * mesma, sem busca nenhuma (como a MENACE, a
+ * "máquina de caixas de fósforos" dos anos 60).
+ *
+ * Ela guarda uma tabela com o valor de cada
+ * posição logo depois de uma jogada (de 0, a
+ * derrota de quem jogou, a 1, a vitória) e
+ * sempre joga para a posição de maior valor.
+ *
+ * As 8 posições iguais por rotação ou espelho
+ * (as "simetrias" do tabuleiro) usam a mesma
+ * entrada da tabela, então ela tem só 2 * 3^9
+ * entradas e a maioria nem é alcançável.
+ */
+
+/**
+ * O valor 1.0 na tabela (os valores são
+ * inteiros para caber numa operação atômica).
+ */
+#define RL_VALUE_ONE (1u << 16)
+
+/**
+ * Uma entrada para cada tabuleiro na base 3
+ * (veja `rl_position_slot`) e cada lado.
+ */
+#define RL_TABLE_SIZE (19683 * 2)
+
+/**
+ * A tabela de valores, compartilhada por todas
+ * as threads do treino sem nenhuma trava: cada
+ * atualização é uma troca atômica (veja `rl_update`).
+ */
+struct RlTable
+{
+    volatile uint32_t values[RL_TABLE_SIZE];
+};
+
+/**
+ * Para onde cada célula (`y * 3 + x`) vai em cada
+ * simetria: as 4 rotações, os 2 espelhos e as
+ * 2 diagonais.
+ */
+const uint8_t rl_symmetries[8][9] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8},
+    {2, 5, 8, 1, 4, 7, 0, 3, 6},
+    {8, 7, 6, 5, 4, 3, 2, 1, 0},
+    {6, 3, 0, 7, 4, 1, 8, 5, 2},
+    {2, 1, 0, 5, 4, 3, 8, 7, 6},
+    {6, 7, 8, 3, 4, 5, 0, 1, 2},
+    {0, 3, 6, 1, 4, 7, 2, 5, 8},
+    {8, 5, 2, 7, 4, 1, 6, 3, 0},
+};
+
+/**
+ * 3 elevado a cada posição, para montar
+ * o número na base 3 de um tabuleiro.
+ */
+const uint16_t rl_powers_of_3[9] = {1, 3, 9, 27, 81, 243, 729, 2187, 6561};
+
+/**
+ * A entrada da tabela de uma posição 3,3,3
+ * (`x` e `o` no formato do `MnkPrint`, com
+ * `stride` 4) e de quem acabou de jogar.
+ *
+ * O tabuleiro vira um número na base 3 (0
+ * vazia, 1 X, 2 O) em cada uma das 8 simetrias,
+ * e o menor número representa todas elas.
+ */
+uint32_t rl_position_slot(MnkPrint x, MnkPrint o, enum Actor mover)
+{
+    uint8_t digits[9];
+    for (int i = 0; i < 9; i++)
+    {
+        MnkPrint bit = (MnkPrint)1 << (((i / 3) * 4) + (i % 3));
+        digits[i] = (x & bit) ? 1 : ((o & bit) ? 2 : 0);
+    }
+
+    uint32_t best = UINT32_MAX;
+    for (int s = 0; s < 8; s++)
+    {
+        uint32_t index = 0;
+        for (int i = 0; i < 9; i++)
+            index += digits[i] * rl_powers_of_3[rl_symmetries[s][i]];
+        if (index < best)
+            best = index;
+    }
+    return (best * 2) + (mover == O_ACTOR);
+}
+
+/**
+ * Aproxima o valor de uma entrada de `target`
+ * em `1 / 2^RL_LEARNING_SHIFT` da diferença.
+ *
+ * Se outra thread mudar a entrada no meio do
+ * caminho, a troca atômica falha e a conta é
+ * refeita com o valor novo: ninguém espera
+ * ninguém e nenhuma atualização se perde.
+ */
+#define RL_LEARNING_SHIFT 2
+
+void rl_update(struct RlTable *table, uint32_t slot, uint32_t target)
+{
+    uint32_t old_value, new_value;
+    do
+    {
+        old_value = atomic_load_u32(&table->values[slot]);
+        new_value = old_value + (((int32_t)target - (int32_t)old_value) / (1 << RL_LEARNING_SHIFT));
+    }
+    while (!atomic_compare_exchange_u32(&table->values[slot], old_value, new_value));
+}
+
+/**
+ * A jogada de maior valor para quem vai
+ * jogar em `board`, com o valor em `value`
+ * (o jogo precisa estar em andamento).
+ */
+uint8_t rl_best_move(const struct RlTable *table, struct MnkBoard *board, uint32_t *value)
+{
+    uint8_t moves[64];
+    size_t len = mnk_moves(board, moves);
+    enum Actor mover = board->turn;
+
+    // A primeira jogada sempre vira a melhor.
+    uint8_t best = 0;
+    *value = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        mnk_make(board, moves[i]);
+        uint32_t move_value = atomic_load_u32(&table->values[rl_position_slot(board->x, board->o, mover)]);
+        mnk_unmake(board, moves[i]);
+        if (i == 0 || move_value > *value)
+        {
+            best = moves[i];
+            *value = move_value;
+        }
+    }
+    return best;
+}
+
+/**
+ * Uma tabela sem aprendizado nenhum:
+ * tudo vale 0.5 (nem ganha nem perde).
+ */
+void reset_rl_table(struct RlTable *table)
+{
+    for (int i = 0; i < RL_TABLE_SIZE; i++)
+        table->values[i] = RL_VALUE_ONE / 2;
+}
+
+/**
+ * Arquivo da tabela: "CTTQ", a versão e
+ * os valores (4 bytes em "little-endian").
+ */
+#define RL_FILE_MAGIC "CTTQ"
+#define RL_FILE_VERSION 1
+#define RL_FILE_SIZE (8 + (RL_TABLE_SIZE * 4))
+
+/**
+ * Grava a tabela em `path`.
+ */
+bool save_rl_table(const struct RlTable *table, const char *path)
+{
+    uint8_t *bytes = malloc(RL_FILE_SIZE);
+    if (bytes == NULL)
+        return false;
+
+    memcpy(bytes, RL_FILE_MAGIC, 4);
+    put_u32le(&bytes[4], RL_FILE_VERSION);
+    for (int i = 0; i < RL_TABLE_SIZE; i++)
+        put_u32le(&bytes[8 + (i * 4)], atomic_load_u32(&table->values[i]));
+
+    FILE *file = fopen(path, "wb");
+    bool ok = file != NULL && fwrite(bytes, 1, RL_FILE_SIZE, file) == RL_FILE_SIZE;
+    if (file != NULL && fclose(file) != 0)
+        ok = false;
+    free(bytes);
+    return ok;
+}
+
+/**
+ * Lê a tabela de `path`.
+ *
+ * Retorna `false` se não der para abrir
+ * ou se não for um arquivo de tabela.
+ */
+bool load_rl_table(struct RlTable *table, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    uint8_t *bytes = malloc(RL_FILE_SIZE + 1);
+    size_t len = (bytes != NULL) ? fread(bytes, 1, RL_FILE_SIZE + 1, file) : 0;
+    fclose(file);
+    bool ok = len == RL_FILE_SIZE && memcmp(bytes, RL_FILE_MAGIC, 4) == 0
+        && get_u32le(&bytes[4]) == RL_FILE_VERSION;
+    for (int i = 0; ok && i < RL_TABLE_SIZE; i++)
+        table->values[i] = get_u32le(&bytes[8 + (i * 4)]);
+    free(bytes);
+    return ok;
+}
+
+/**
+ * A tabela do cortex `rl`, lida do
+ * arquivo passado em `--rl-table`.
+ */
+struct RlTable *rl_table = NULL;
+
+/**
+ * Joga sempre para a posição de maior
+ * valor na tabela aprendida.
+ *
+ * Sem tabela, joga como o `pattern_ai_cortex`.
+ */
+void rl_ai_cortex(struct AIBrain *brain)
+{
+    if (rl_table == NULL)
+    {
+        pattern_ai_cortex(brain);
+        return;
+    }
+
+    struct MnkBoard board = classic_to_mnk_board(brain->view);
+    uint32_t value;
+    uint8_t cell = rl_best_move(rl_table, &board, &value);
+    brain->goal = vec2(cell % board.geometry->stride, cell / board.geometry->stride);
+}
+
+/**
+ * Um cortex e o nome dele na
+ * linha de comando.
+ */
+struct AICortexEntry
+{
+    const char *name;
+    AIBrainCortex cortex;
+};
+
+/**
+ * Todos os cortexes disponíveis.
+ */
+const struct AICortexEntry ai_cortexes[] = {
+    {"dumb", dumb_ai_cortex},
+    {"avarage", avarage_ai_cortex},
+    {"pattern", pattern_ai_cortex},
+    {"nnue", nnue_ai_cortex},
+    {"rl", rl_ai_cortex},
+};
+
+/**
+ * Procura um cortex pelo nome.
+ *
+ * Retorna `NULL` se não existir.
+ */
+AIBrainCortex find_ai_cortex(const char *name)
+{
+    for (size_t i = 0; i < sizeof(ai_cortexes)/sizeof(struct AICortexEntry); i++)
+        if (!strcmp(ai_cortexes[i].name, name))
+            return ai_cortexes[i].cortex;
+    return NULL;
+}
+
+/**
+ * Motores externos: programas de outras
+ * pessoas que jogam pelo protocolo abaixo,
+ * falando por "canos" (pipes) com a
+ * entrada e a saída padrão deles.
+ *
+ * Parecido com o UCI do xadrez, em linhas de texto:
+ *  - `ctt` => o motor responde `id name NOME` (opcional) e `cttok`;
+ *  - `newgame` => uma nova partida vai começar;
+ *  - `position S moves C...` => quem começou (`x` ou `o`)
+ *    e as células jogadas até agora (0-8, `y * 3 + x`);
+ *  - `go movetime MS` => o motor responde `bestmove C`
+ *    em até `MS` milissegundos;
+ *  - `quit` => o motor deve encerrar.
+ *
+ * O processo é mantido vivo entre partidas.
+ * Se ele demorar, travar, morrer ou jogar
+ * errado, é reiniciado (se preciso) e a
+ * jogada vem do `dumb_ai_cortex`.
+ */
+#if defined (__unix__) || defined (__APPLE__)
+
+/**
+ * Tamanho máximo de uma linha do motor.
+ */
+#define ENGINE_LINE_MAX 256
+
+/**
+ * Quanto esperamos o motor se
+ * apresentar (`ctt` => `cttok`).
+ */
+#define ENGINE_HANDSHAKE_MS 5000
+
+/**
+ * Folga além do `movetime` antes
+ * de considerar que o motor travou.
+ */
+#define ENGINE_GRACE_MS 100
+
+/**
+ * Um motor externo rodando.
+ */
+struct ExternalEngine
+{
+    /**
+     * Comando para iniciar o motor
+     * (executado pelo `/bin/sh`).
+     */
+    const char *command;
+    char name[64];
+    pid_t pid;
+    int to_engine;
+    int from_engine;
+    char input[ENGINE_LINE_MAX];
+    size_t input_len;
+    /**
+     * Tempo por jogada, em milissegundos.
+     */
+    uint32_t move_ms;
+    /**
+     * Desistimos de reiniciar o motor,
+     * todas as jogadas vêm do reserva.
+     */
+    bool dead;
+    /**
+     * Quantas jogadas o motor já viu da
+     * partida atual, para saber quando
+     * começa uma nova.
+     */
+    uint8_t seen_len;
+    uint64_t moves;
+    uint64_t timeouts;
+    uint64_t crashes;
+    uint64_t invalid;
+    uint64_t restarts;
+};
+
+/**
+ * Manda uma linha formatada para o motor.
+ *
+ * Retorna `false` se o motor não está lá.
+ */
+bool engine_send(struct ExternalEngine *engine, const char *fmt, ...)
+{
+    char line[ENGINE_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len < 0 || (size_t)len >= sizeof(line))
+        return false;
+
+    int sent = 0;
+    while (sent < len)
+    {
+        ssize_t n = write(engine->to_engine, line + sent, len - sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * Possíveis resultados de `engine_read_line`.
+ */
+enum EngineRead
+{
+    ENGINE_LINE,
+    ENGINE_TIMEOUT,
+    ENGINE_CLOSED,
+};
+
+/**
+ * Espera uma linha do motor até o
+ * momento `deadline` (de `monotonic_ns`).
+ */
+enum EngineRead engine_read_line(struct ExternalEngine *engine, char line[ENGINE_LINE_MAX], uint64_t deadline)
+{
+    while (true)
+    {
+        char *end = memchr(engine->input, '\n', engine->input_len);
+        if (end != NULL)
+        {
+            size_t len = end - engine->input;
+            memcpy(line, engine->input, len);
+            line[len] = 0;
+            // Motores feitos no Windows podem mandar "\r\n".
+            if (len > 0 && line[len - 1] == '\r')
+                line[len - 1] = 0;
+
+            engine->input_len -= len + 1;
+            memmove(engine->input, end + 1, engine->input_len);
+            return ENGINE_LINE;
+        }
+
+        // Uma linha grande demais é jogada fora.
+        if (engine->input_len == ENGINE_LINE_MAX)
+            engine->input_len = 0;
+
+        uint64_t now = monotonic_ns();
+        if (now >= deadline)
+            return ENGINE_TIMEOUT;
+
+        struct pollfd fds[] = {{ .fd = engine->from_engine, .events = POLLIN }};
+        int ready = poll(fds, 1, (int)(((deadline - now) + 999999) / 1000000));
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready == 0)
+            return ENGINE_TIMEOUT;
+
+        ssize_t n = read(engine->from_engine, engine->input + engine->input_len, ENGINE_LINE_MAX - engine->input_len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return ENGINE_CLOSED;
+        engine->input_len += n;
+    }
+}
+
+/**
+ * Joga fora o que o motor mandou e ninguém
+ * pediu (como um `bestmove` repetido), para
+ * a próxima resposta ser mesmo da próxima pergunta.
+ */
+void engine_discard_input(struct ExternalEngine *engine)
+{
+    engine->input_len = 0;
+
+    struct pollfd fds[] = {{ .fd = engine->from_engine, .events = POLLIN }};
+    while (poll(fds, 1, 0) > 0 && (fds[0].revents & POLLIN))
+        if (read(engine->from_engine, engine->input, ENGINE_LINE_MAX) <= 0)
+            break;
+}
+
+/**
+ * Encerra o processo do motor, pedindo
+ * com educação e depois à força.
+ */
+void stop_external_engine(struct ExternalEngine *engine)
+{
+    if (engine->pid <= 0)
+        return;
+
+    engine_send(engine, "quit\n");
+    close(engine->to_engine);
+    close(engine->from_engine);
+
+    // Damos um tempinho para ele sair sozinho.
+    for (int i = 0; i < 20; i++)
+    {
+        if (waitpid(engine->pid, NULL, WNOHANG) != 0)
+        {
+            engine->pid = -1;
+            return;
+        }
+        struct timespec t = { .tv_nsec = 5000000 };
+        nanosleep(&t, NULL);
+    }
+
+    kill(engine->pid, SIGKILL);
+    waitpid(engine->pid, NULL, 0);
+    engine->pid = -1;
+}
+
+/**
+ * Inicia o processo do motor e
+ * espera ele se apresentar.
+ */
+bool start_external_engine(struct ExternalEngine *engine)
+{
+    int to_engine[2], from_engine[2];
+    if (pipe(to_engine) != 0)
+        return false;
+    if (pipe(from_engine) != 0)
+    {
+        close(to_engine[0]);
+        close(to_engine[1]);
+        return false;
+    }
+    // O `dup2` no filho limpa a marca, então
+    // só as pontas que ele usa sobrevivem ao
+    // `exec`; os outros motores nunca as herdam.
+    close_on_exec(to_engine[0]);
+    close_on_exec(to_engine[1]);
+    close_on_exec(from_engine[0]);
+    close_on_exec(from_engine[1]);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // Aqui estamos no processo filho, ligamos os
+        // "canos" na entrada e na saída e viramos o motor.
+        dup2(to_engine[0], STDIN_FILENO);
+        dup2(from_engine[1], STDOUT_FILENO);
+        close(to_engine[0]);
+        close(to_engine[1]);
+        close(from_engine[0]);
+        close(from_engine[1]);
+
+        char command[ENGINE_LINE_MAX + 8];
+        snprintf(command, sizeof(command), "exec %s", engine->command);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        _exit(127);
+    }
+
+    close(to_engine[0]);
+    close(from_engine[1]);
+    if (pid < 0)
+    {
+        close(to_engine[1]);
+        close(from_engine[0]);
+        return false;
+    }
+
+    engine->pid = pid;
+    engine->to_engine = to_engine[1];
+    engine->from_engine = from_engine[0];
+    engine->input_len = 0;
+    engine->seen_len = UINT8_MAX;
+
+    uint64_t deadline = monotonic_ns() + (ENGINE_HANDSHAKE_MS * 1000000ull);
+    char line[ENGINE_LINE_MAX];
+    if (engine_send(engine, "ctt\n"))
+    {
+        while (engine_read_line(engine, line, deadline) == ENGINE_LINE)
+        {
+            if (!strncmp(line, "id name ", 8))
+                snprintf(engine->name, sizeof(engine->name), "%.63s", line + 8);
+            else if (!strcmp(line, "cttok"))
+                return true;
+        }
+    }
+
+    stop_external_engine(engine);
+    return false;
+}
+
+/**
+ * Reinicia um motor que travou ou morreu.
+ */
+void restart_external_engine(struct ExternalEngine *engine)
+{
+    if (engine->pid > 0)
+    {
+        kill(engine->pid, SIGKILL);
+        stop_external_engine(engine);
+    }
+
+    engine->restarts++;
+    if (!start_external_engine(engine))
+    {
+        fprintf(stderr, "motor \"%s\" não reiniciou, usando o cortex reserva\n", engine->command);
+        engine->dead = true;
+    }
+}
+
+/**
+ * Pede uma jogada ao motor para a posição de `view`,
+ * dando no máximo até `deadline` (`0` para só
+ * o tempo do motor) para ele pensar.
+ *
+ * Retorna `false` se ele não
+ * respondeu direito a tempo.
+ */
+bool engine_request_move(struct ExternalEngine *engine, struct GameState *view, uint64_t deadline, struct Vec2 *move)
+{
+    struct GameRecord *record = &view->record;
+
+    engine_discard_input(engine);
+
+    // Quando o motor vê menos jogadas que
+    // antes, uma nova partida começou.
+    bool sent = true;
+    if (record->len < engine->seen_len || engine->seen_len == UINT8_MAX)
+        sent = engine_send(engine, "newgame\n");
+    engine->seen_len = record->len;
+
+    char position[ENGINE_LINE_MAX];
+    int len = snprintf(position, sizeof(position), "position %c moves", (record->starter == O_ACTOR) ? 'o' : 'x');
+    for (uint8_t i = 0; i < record->len; i++)
+        len += snprintf(position + len, sizeof(position) - len, " %u", record->cells[i]);
+
+    uint32_t move_ms = engine->move_ms;
+    uint64_t now = monotonic_ns();
+    if (deadline != 0)
+    {
+        uint64_t left_ms = (deadline > now) ? (deadline - now) / 1000000 : 0;
+        if (left_ms < move_ms)
+            move_ms = (left_ms > 0) ? (uint32_t)left_ms : 1;
+    }
+    sent = sent && engine_send(engine, "%s\ngo movetime %u\n", position, move_ms);
+
+    deadline = now + ((uint64_t)(move_ms + ENGINE_GRACE_MS) * 1000000ull);
+    char line[ENGINE_LINE_MAX];
+    enum EngineRead read = sent ? ENGINE_LINE : ENGINE_CLOSED;
+    while (read == ENGINE_LINE)
+    {
+        read = engine_read_line(engine, line, deadline);
+        unsigned int cell = 0;
+        if (read != ENGINE_LINE || sscanf(line, "bestmove %u", &cell) != 1)
+            continue;
+
+        engine->moves++;
+        *move = vec2(cell % 3, cell / 3);
+        if (cell < 9 && game_board_cell(view->board, *move) == FREE_MOVE)
+            return true;
+
+        engine->invalid++;
+        return false;
+    }
+
+    if (read == ENGINE_TIMEOUT)
+        engine->timeouts++;
+    else
+        engine->crashes++;
+    restart_external_engine(engine);
+    return false;
+}
+
+/**
+ * Cortex que pergunta a jogada para um
+ * motor externo (`brain->cortex_data`).
+ */
+void external_engine_cortex(struct AIBrain *brain)
+{
+    struct ExternalEngine *engine = brain->cortex_data;
+
+    struct Vec2 move;
+    if (!engine->dead && engine_request_move(engine, brain->view, brain->deadline, &move))
+        brain->goal = move;
+    else
+        dumb_ai_cortex(brain);
+}
+
+/**
+ * Cria e inicia um motor para `command`.
+ *
+ * Retorna `NULL` se ele não iniciar.
+ */
+struct ExternalEngine *open_external_engine(const char *command, uint32_t move_ms)
+{
+    struct ExternalEngine *engine = calloc(1, sizeof(struct ExternalEngine));
+    if (engine == NULL)
+        return NULL;
+
+    engine->command = command;
+    engine->move_ms = move_ms;
+    snprintf(engine->name, sizeof(engine->name), "%s", command);
+    if (!start_external_engine(engine))
+    {
+        free(engine);
+        return NULL;
+    }
+    return engine;
+}
+
+void close_external_engine(struct ExternalEngine *engine)
+{
+    stop_external_engine(engine);
+    free(engine);
+}
+
+/**
+ * Mostra o que aconteceu com o motor.
+ */
+void print_external_engine_stats(FILE *out, const struct ExternalEngine *engine)
+{
+    fprintf(out, "Motor \"%s\": %llu jogadas, %llu atrasos, %llu quedas, %llu inválidas, %llu reinícios\n",
+        engine->name,
+        (unsigned long long)engine->moves,
+        (unsigned long long)engine->timeouts,
+        (unsigned long long)engine->crashes,
+        (unsigned long long)engine->invalid,
+        (unsigned long long)engine->restarts);
+}
+
+#endif
+
+/**
+ * Prefixo dos cortexes que são motores externos.
+ */
+#define ENGINE_CORTEX_PREFIX "engine:"
+
+/**
+ * Prepara um cortex pelo nome: um dos
+ * internos (`ai_cortexes`) ou
+ * `engine:COMANDO` para um motor externo.
+ *
+ * Retorna `false` se não existir ou não iniciar.
+ */
+bool open_ai_cortex(const char *name, AIBrainCortex *cortex, void **data)
+{
+    *data = NULL;
+    if (strncmp(name, ENGINE_CORTEX_PREFIX, strlen(ENGINE_CORTEX_PREFIX)) != 0)
+    {
+        *cortex = find_ai_cortex(name);
+        return *cortex != NULL;
+    }
+
+#if defined (__unix__) || defined (__APPLE__)
+    // Um motor que morre não pode
+    // derrubar o programa ao escrevermos.
+    signal(SIGPIPE, SIG_IGN);
+
+    uint32_t move_ms = (program_options.move_ms > 0) ? program_options.move_ms : 1000;
+    *data = open_external_engine(name + strlen(ENGINE_CORTEX_PREFIX), move_ms);
+    *cortex = external_engine_cortex;
+    return *data != NULL;
+#else
+    fprintf(stderr, "Motores externos só existem em sistemas POSIX\n");
+    return false;
+#endif
+}
+
+/**
+ * Libera o que `open_ai_cortex` preparou.
+ */
+void close_ai_cortex(AIBrainCortex cortex, void *data)
+{
+#if defined (__unix__) || defined (__APPLE__)
+    if (cortex == external_engine_cortex && data != NULL)
+        close_external_engine(data);
+#endif
+}
+
+/**
+ * Joga uma partida inteira entre duas
+ * IAs, sem interface e sem esperas,
+ * direto no estado do jogo.
+ *
+ * Os cérebros podem ser reusados
+ * entre partidas (um motor externo
+ * continua rodando, por exemplo), e as
+ * arenas deles são zeradas a cada partida.
+ *
+ * Retorna como a partida terminou.
+ */
+enum EndGame play_headless_game(struct GameState *game, struct AIBrain *x_brain, struct AIBrain *o_brain)
+{
+    struct AIBrain *brains[] = {x_brain, o_brain};
+    for (int i = 0; i < 2; i++)
+    {
+        brains[i]->view = game;
+        brains[i]->goal = AI_THINKING_STATE;
+        if (brains[i]->arena != NULL)
+            arena_reset(brains[i]->arena);
+    }
+
+    while (true)
+    {
+        process_game_state(game);
+        if (game->endgame != RUNNING)
+            return game->endgame;
+
+        struct AIBrain *brain = (game->turn == X_ACTOR) ? x_brain : o_brain;
+        ai_think(brain);
+        // Se a IA escolher uma célula ocupada,
+        // ela só pensa de novo, igual na interface.
+        play_game_move(game, brain->goal);
+        brain->goal = AI_THINKING_STATE;
+    }
+}
+
+/**
+ * Fonte de entrada que lê as jogadas
+ * de um roteiro (arquivo ou "cano"),
+ * permitindo repetir partidas gravadas
+ * e rodar o jogo todo sem ninguém no teclado.
+ *
+ * Cada linha do roteiro é um comando:
+ *  - `w` `a` `s` `d` ou `up` `left` `down` `right` => mover;
+ *  - `move` (ou `space`, `enter`) => marcar;
+ *  - `undo` e `redo` => desfazer e refazer;
+ *  - `cell X Y` => andar até a célula (0-2) e marcar;
+ *  - `wait MS` => esperar `MS` milissegundos;
+ *  - `quit` => saír.
+ *
+ * A primeira linha ainda pode ser `starter x` ou
+ * `starter o` para fixar quem começa.
+ * Linhas vazias e começando com `#` são ignoradas.
+ */
+struct ScriptInputSource
+{
+    FILE *file;
+    /**
+     * Os "olhos" do roteiro, usados
+     * para andar até uma célula.
+     */
+    struct GameState *view;
+    /**
+     * Célula onde o comando `cell` quer
+     * jogar, ou `vec2(-1, -1)` se nenhuma.
+     */
+    struct Vec2 goal;
+    /**
+     * Linha atual e, se algo der errado,
+     * a linha do erro (`0` se nenhum).
+     */
+    unsigned int line;
+    unsigned int error_line;
+};
+
+/**
+ * Abre o roteiro em `path` (`-` é a entrada padrão).
+ *
+ * Se o roteiro começar com `starter`, o
+ * `turn` do `state` é ajustado.
+ *
+ * Retorna `false` se não der para abrir.
+ */
+bool open_script_input_source(struct ScriptInputSource *script, const char *path, struct GameState *state)
+{
+    *script = (struct ScriptInputSource)
+    {
+        .file = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r"),
+        .view = state,
+        .goal = vec2(-1, -1),
+    };
+
+    if (script->file == NULL)
+        return false;
+
+    // Procurando um `starter` antes do primeiro comando.
+    int c;
+    while ((c = fgetc(script->file)) == '#' || c == '\n' || c == '\r')
+    {
+        while (c != '\n' && c != EOF)
+            c = fgetc(script->file);
+        script->line++;
+    }
+    ungetc(c, script->file);
+
+    char actor = 0;
+    if (c == 's' && fscanf(script->file, "starter %c", &actor) == 1)
+    {
+        script->line++;
+        if (actor == 'x' || actor == 'X')
+            state->turn = X_ACTOR;
+        else if (actor == 'o' || actor == 'O')
+            state->turn = O_ACTOR;
+        else
+            script->error_line = script->line;
+        while ((c = fgetc(script->file)) != '\n' && c != EOF);
+    }
+
+    return true;
+}
+
+/**
+ * Fecha o roteiro.
+ */
+void close_script_input_source(struct ScriptInputSource *script)
+{
+    if (script->file != NULL && script->file != stdin)
+        fclose(script->file);
+    script->file = NULL;
+}
+
+/**
+ * Lê os comandos do roteiro.
+ *
+ * Quando o roteiro acaba (ou tem
+ * um erro), retorna `QUIT_INPUT`.
+ *
+ * Compatível com o tipo `GameInputSourceExecutor`.
+ */
+enum GameInput script_game_input(GameInputSourceArgs a)
+{
+    struct ScriptInputSource *script = a;
+
+    if (script->error_line != 0)
+        return QUIT_INPUT;
+
+    while (true)
+    {
+        if (script->goal.x >= 0)
+        {
+            struct Vec2 where_i_am = script->view->selection;
+            if (where_i_am.x == script->goal.x && where_i_am.y == script->goal.y)
+            {
+                script->goal = vec2(-1, -1);
+                return MOVE_INPUT;
+            }
+            return walk_towards(where_i_am, script->goal);
+        }
+
+        char line[128];
+        if (fgets(line, sizeof(line), script->file) == NULL)
+            return QUIT_INPUT;
+        script->line++;
+
+        char command[16] = {0};
+        int x = 0, y = 0;
+        int fields = sscanf(line, "%15s %d %d", command, &x, &y);
+
+        if (fields <= 0 || command[0] == '#')
+            continue;
+
+        if (!strcmp(command, "w") || !strcmp(command, "up")) return UP_INPUT;
+        if (!strcmp(command, "a") || !strcmp(command, "left")) return LEFT_INPUT;
+        if (!strcmp(command, "s") || !strcmp(command, "down")) return DOWN_INPUT;
+        if (!strcmp(command, "d") || !strcmp(command, "right")) return RIGHT_INPUT;
+        if (!strcmp(command, "move") || !strcmp(command, "space") || !strcmp(command, "enter"))
+            return MOVE_INPUT;
+        if (!strcmp(command, "quit"))
+            return QUIT_INPUT;
+        if (!strcmp(command, "undo"))
+            return UNDO_INPUT;
+        if (!strcmp(command, "redo"))
+            return REDO_INPUT;
+
+        if (!strcmp(command, "wait") && fields == 2 && x >= 0)
+        {
+            block_delay(x);
+            continue;
+        }
+
+        if (!strcmp(command, "cell") && fields == 3 && 0 <= x && x < 3 && 0 <= y && y < 3)
+        {
+            script->goal = vec2(x, y);
+            continue;
+        }
+
+        script->error_line = script->line;
+        return QUIT_INPUT;
+    }
+}
+
+/**
+ * Estrutura que guarda
+ * o tamanho em bytes (`blen`)
+ * e o tamanho visual/utf-8 (`ulen`)
+ */
+struct UStrLenRes
+{
+    size_t ulen;
+    size_t blen;
+};
+
+/**
+ * Versão utf-8 do `strlen`, que conta
+ * code points utf-8 além de contar os bytes.
+ */
+struct UStrLenRes ustrlen(const char *str)
+{
+    struct UStrLenRes ln = {0, 0};
+    for (char c = *str; c != 0; str++, c = *str)
+    {
+        // `(c & 0xC0) == 0x80` testa se
+        // o byte segue o padrão `10xxxxxx`,
+        // Se ele seguir, é só um byte de continuidade
+        // do utf-8 e não precisa ser contado.
+        ln.ulen += ((c & 0xC0) == 0x80) ? 0 : 1;
+        ln.blen++;
+    }
+    return ln;
+}
+
+/**
+ * Em vez de escrever texto
+ * a partir do cursor, usa o
+ * cursor como o centro do texto.
+ */
+void write_center(const char *str)
+{
+    struct UStrLenRes len = ustrlen(str);
+    size_t visual_half = len.ulen - (len.ulen / 2);
+    move_cursor(vec2(-visual_half, 0));
+    terminal_write(str, len.blen);
+}
+
+/// Flag para negrito.
+#define BOLD_FLAG ((uint8_t)(0x01))
+/// Flag para esvaecido.
+#define DIM_FLAG ((uint8_t)(0x02))
+/// Flag para itálico.
+#define ITALIC_FLAG ((uint8_t)(0x04))
+/// Flag para cor do texto.
+#define FOREGROUND_COLOR_FLAG ((uint8_t)0x08)
+/// Flag para cor do fundo.
+#define BACKGROUND_COLOR_FLAG ((uint8_t)0x10)
+
+/**
+ * Estrutura que guarda a
+ * representação visual de um
+ * texto para menus.
+ *
+ * `fmt_flags` pode conter:
+ * - `BOLD_FLAG`;
+ * - `DIM_FLAG`;
+ * - `ITALIC_FLAG`;
+ * - `FOREGROUND_COLOR_FLAG` (depende do campo `foreground_color`);
+ * - `BACKGROUND_COLOR_FLAG` (depende do campo `background_color`).
+ */
+struct TextStyle
+{
+    struct Color foreground_color;
+    struct Color background_color;
+    uint8_t fmt_flags;
+};
+
+/**
+ * Um nó de texto que
+ * guarda tanto um ponteiro
+ * parao o texto em si, quanto
+ * seu estilo atribuído.
+ */
+struct TextNode
+{
+    struct TextStyle style;
+    const char *str;
+};
+
+/**
+ * Escreve um nó de texto
+ * na tela, usando o cursor
+ * como centro do texto, e
+ * aplicando o estilo atribuído.
+ */
+void write_text_node(struct TextNode node)
+{
+    if (node.style.fmt_flags & BOLD_FLAG)
+        set_bold();
+    else if (node.style.fmt_flags & DIM_FLAG)
+        set_dim();
+
+    if (node.style.fmt_flags & ITALIC_FLAG)
+        set_italic();
+
+    if (node.style.fmt_flags & FOREGROUND_COLOR_FLAG)
+        set_foreground_color(node.style.foreground_color);
+    if (node.style.fmt_flags & BACKGROUND_COLOR_FLAG)
+        set_background_color(node.style.foreground_color);
+
+    write_center(node.str);
+
+    if (node.style.fmt_flags != 0)
+        reset_formatting();
+}
+
+/**
+ * Escreve vários nós verticalmente, usando
+ * o cursor como centro tanto horizontal
+ * quanto vertical.
+ */
+void write_text_node_row(struct Vec2 offset, size_t n, struct TextNode nodes[n])
+{
+    offset.y -= n - (n / 2);
+
+    set_cursor_position(offset);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        write_text_node(nodes[i]);
+        offset.y += 1;
+        set_cursor_position(offset);
+    }
+}
+
+/// Nenhum estilo (estilo plano).
+const struct TextStyle plain_style = {0};
+/// Estilo de título.
+const struct TextStyle title_style = { .fmt_flags = BOLD_FLAG, };
+/// Estilo de opção.
+const struct TextStyle option_style = { .fmt_flags = ITALIC_FLAG, };
+/// Estilo de informação/instrução.
+const struct TextStyle info_style = { .fmt_flags = DIM_FLAG | ITALIC_FLAG, };
+
+/**
+ * Monta as "fotos" de cada jogada
+ * de uma partida gravada.
+ *
+ * `snapshots` precisa ter espaço
+ * para `record->len + 1` fotos.
+ */
+void build_board_snapshots(const struct GameRecord *record, struct BoardSnapshot snapshots[])
+{
+    snapshots[0] = (struct BoardSnapshot){0};
+    enum Actor actor = record->starter;
+
+    for (uint8_t i = 0; i < record->len; i++)
+    {
+        struct BoardSnapshot snapshot = snapshots[i];
+        MovePrint cell = 1 << record->cells[i];
+        if (actor == X_ACTOR)
+            snapshot.x |= cell;
+        else
+            snapshot.o |= cell;
+        snapshots[i + 1] = snapshot;
+        actor = opponent_actor(actor);
+    }
+}
+
+/**
+ * Transforma uma "foto" de volta
+ * em um tabuleiro.
+ */
+void board_from_snapshot(struct BoardSnapshot snapshot, GameBoard board)
+{
+    for (int y = 0; y < 3; y++)
+        for (int x = 0; x < 3; x++)
+        {
+            struct Vec2 pos = {x, y};
+            enum Move move = FREE_MOVE;
+            if (move_print_inspec(snapshot.x, pos))
+                move = X_MOVE;
+            else if (move_print_inspec(snapshot.o, pos))
+                move = O_MOVE;
+            set_game_board_cell(board, pos, move);
+        }
+}
+
+/**
+ * Desenha a jogada `ply` de uma
+ * partida gravada, destacando a
+ * última jogada (ou o final do jogo).
+ */
+void render_replay(const struct GameRecord *record, const struct BoardSnapshot snapshots[], uint8_t ply)
+{
+    struct Vec2 screen_size = display_size();
+    struct Vec2 screen_offset = {(screen_size.x / 2) - 9, (screen_size.y / 2) - 6};
+    new_screen_frame(true);
+    set_cursor_position(screen_offset);
+
+    bool is_last = ply == record->len;
+    enum EndGame endgame = is_last ? record->result : RUNNING;
+    enum Actor turn = (ply % 2 == 0) ? record->starter : opponent_actor(record->starter);
+
+    render_game_frame(endgame);
+    move_cursor(vec2(-19, 1));
+    render_endgame(endgame, turn, ply);
+    terminal_printf("    Jogadas: %d", ply);
+    move_cursor(vec2(-12, -11));
+
+    struct BoardSnapshot snapshot = snapshots[ply];
+    GameBoard board;
+    board_from_snapshot(snapshot, board);
+
+    switch (endgame)
+    {
+    case RUNNING:
+    {
+        // Quem fez a última jogada foi o oponente
+        // de quem tem a vez agora.
+        MovePrint last_move = (ply > 0) ? (1 << record->cells[ply - 1]) : 0;
+        render_game_board(board, opponent_actor(turn), last_move);
+        break;
+    }
+    case GAME_DRAW:
+        render_game_board(board, NULL_ACTOR, snapshot.x | snapshot.o);
         break;
-    case O_MOVE:
-        draw_game_actor(O_ACTOR);
+    case X_VICTORY:
+        render_game_board(board, X_ACTOR, test_move_print_winner(snapshot.x));
+        break;
+    case O_VICTORY:
+        render_game_board(board, O_ACTOR, test_move_print_winner(snapshot.o));
         break;
     }
+
+    struct TextNode info[] = {
+        {info_style, "←→ => Passo | ↑↓ => Início/Fim | 0-9 => Ir para"},
+        {info_style, "Q Escape Backspace => Saír"},
+    };
+    struct Vec2 info_offset = {screen_size.x / 2, screen_offset.y + 16};
+    write_text_node_row(info_offset, sizeof(info)/sizeof(struct TextNode), info);
+}
+
+/**
+ * Mostra uma partida gravada, deixando
+ * andar jogada por jogada, para frente
+ * e para trás, ou pular direto para
+ * qualquer jogada.
+ *
+ * Cada jogada é desenhada direto da sua
+ * "foto", sem repetir a partida desde o começo.
+ */
+void replay_viewer(const struct GameRecord *record, const struct BoardSnapshot snapshots[])
+{
+    uint8_t ply = 0;
+
+    while (true)
+    {
+        render_replay(record, snapshots, ply);
+
+        enum KeyboardInput key = keyboard_input();
+        switch (key)
+        {
+        case KEY_A: case KEY_ARROW_LEFT:
+            if (ply > 0) ply--;
+            break;
+        case KEY_D: case KEY_ARROW_RIGHT:
+            if (ply < record->len) ply++;
+            break;
+        case KEY_W: case KEY_ARROW_UP:
+            ply = 0;
+            break;
+        case KEY_S: case KEY_ARROW_DOWN:
+            ply = record->len;
+            break;
+        case KEY_0: case KEY_1: case KEY_2: case KEY_3: case KEY_4:
+        case KEY_5: case KEY_6: case KEY_7: case KEY_8: case KEY_9:
+        {
+            uint8_t wanted = key - KEY_0;
+            ply = (wanted < record->len) ? wanted : record->len;
+            break;
+        }
+        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE:
+            return;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Tela depois do fim da partida, espera
+ * a confirmação para voltar ao menu e
+ * deixa rever a partida.
+ *
+ * Não faz nada se a partida não terminou
+ * (alguém saiu) ou se ninguém estiver olhando.
+ */
+void after_game_screen(struct GameState *state)
+{
+    if (state->endgame == RUNNING || program_options.unattended)
+        return;
+
+    struct TextNode info[] = {
+        {info_style, "Espaço Enter => Continuar | R => Rever a partida"},
+    };
+
+    while (true)
+    {
+        struct Vec2 screen_size = display_size();
+        struct Vec2 info_offset = {screen_size.x / 2, (screen_size.y / 2) - 6 + 16};
+        write_text_node_row(info_offset, sizeof(info)/sizeof(struct TextNode), info);
+
+        enum KeyboardInput key = keyboard_input();
+        switch (key)
+        {
+        case KEY_R:
+            replay_viewer(&state->record, state->snapshots);
+            new_screen_frame(true);
+            render_game(state, false);
+            break;
+        case KEY_RESIZE:
+            render_game(state, false);
+            break;
+        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE:
+        case KEY_ENTER: case KEY_SPACE:
+            return;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Possíveis opções de jogo.
+ */
+enum MainMenuOption
+{
+    QUIT_GAME,
+    PLAYER_VS_PLAYER,
+    PLAYER_VS_MACHINE,
+    MACHINE_VS_MACHINE,
+    ULTIMATE_GAME,
+    QUBIC_GAME,
+};
+
+/**
+ * Menu principal do jogo.
+ * Mostra opções de jogo e
+ * informa os controles.
+ */
+enum MainMenuOption main_menu()
+{
+    DRAW_MENU:;
+    new_screen_frame(true);
+
+    struct Vec2 dsize = display_size();
+    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+
+    struct TextNode menu[] = {
+        {title_style, "C Tic Tac Toe"},
+        {option_style, "1. Jogador vs. Jogador"},
+        {option_style, "2. Jogador vs. Máquina"},
+        {option_style, "3. Máquina vs. Máquina"},
+        {option_style, "4. Jogo da Velha Supremo (9x9)"},
+        {option_style, "5. Qubic (4x4x4)"},
+        {plain_style, ""},
+        {info_style, "Q Escape Backspace => Saír"},
+        {plain_style, ""},
+        {title_style, "Controles"},
+        {info_style, "WASD ↑←↓→ => Mover"},
+        {info_style, "Espaço Enter => Marcar"},
+        {info_style, "U R => Desfazer/Refazer"},
+#if PHASE_STATS
+        {info_style, "T => Estatísticas"},
+#endif
+    };
+
+    write_text_node_row(menu_offset, sizeof(menu)/sizeof(struct TextNode), menu);
+
+    while (true)
+    {
+        enum KeyboardInput key = keyboard_input();
+
+        switch (key)
+        {
+        case KEY_1: return PLAYER_VS_PLAYER;
+        case KEY_2: return PLAYER_VS_MACHINE;
+        case KEY_3: return MACHINE_VS_MACHINE;
+        case KEY_4: return ULTIMATE_GAME;
+        case KEY_5: return QUBIC_GAME;
+        case KEY_ESCAPE: case KEY_Q: case KEY_BACKSPACE: return QUIT_GAME;
+        case KEY_RESIZE: goto DRAW_MENU;
+        default: continue;
+        }
+    }
+}
+
+/**
+ * Um pequeno popup para
+ * instruír os jogadores a
+ * escolherem quem vai ser quem.
+ *
+ * Retorna `true` se os jogadores
+ * decidirem procesguir, mas retorna
+ * `false` se eles quiserem cancelar
+ * a partida.
+ */
+bool player_vs_player_popup()
+{
+    DRAW_POPUP:;
+    new_screen_frame(true);
+
+    struct Vec2 dsize = display_size();
+    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+
+    struct TextNode info[] = {
+        {title_style, "Decidam quem vai ser quem (X ou O)"},
+        {plain_style, "Quem começa (X ou O) é decidido aleatoriamente pelo jogo"},
+        {plain_style, ""},
+        {info_style, "Espaço Enter => Confirmar"},
+        {info_style, "Q Escape Backspace => Cancelar"},
+    };
+
+    write_text_node_row(menu_offset, sizeof(info)/sizeof(struct TextNode), info);
+
+    enum Confirmation confirmation = blocking_confirm();
+    if (confirmation == NEEDS_REDRAW)
+        goto DRAW_POPUP;
+    return confirmation == CONFIRMED;
+}
+
+/**
+ * Um menu que deixa o jogador
+ * decidir se ele quer usar X ou O.
+ *
+ * `NULL_ACTOR` significa cancelamento.
+ */
+enum Actor player_actor_selection_menu()
+{
+    DRAW_MENU:;
+    new_screen_frame(true);
+
+    struct Vec2 dsize = display_size();
+    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+
+    struct TextStyle x_option =
+    {
+        .fmt_flags = FOREGROUND_COLOR_FLAG | ITALIC_FLAG,
+        .foreground_color = actor_color(X_ACTOR),
+    };
+
+    struct TextStyle o_option =
+    {
+        .fmt_flags = FOREGROUND_COLOR_FLAG | ITALIC_FLAG,
+        .foreground_color = actor_color(O_ACTOR),
+    };
+
+    struct TextNode menu[] = {
+        {title_style, "Escolha Sua Peça"},
+        {x_option, "1. Usar Peça X"},
+        {o_option, "2. Usar Peça O"},
+        {plain_style, ""},
+        {info_style, "Escolher X ou O não garante que você vai começar"},
+        {info_style, "Q Escape Backspace => Cancelar"},
+    };
+
+    write_text_node_row(menu_offset, sizeof(menu)/sizeof(struct TextNode), menu);
+
+    while (true)
+    {
+        enum KeyboardInput key = keyboard_input();
+        switch (key)
+        {
+        case KEY_1: return X_ACTOR;
+        case KEY_2: return O_ACTOR;
+        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE: return NULL_ACTOR;
+        case KEY_RESIZE: goto DRAW_MENU;
+        default: continue;
+        }
+    }
+}
+
+/**
+ * Menu para o jogador escolher
+ * uma IA para jogar.
+ *
+ * `NULL` significa cancelamento.
+ */
+AIBrainCortex ai_cortex_selection_menu(const char *ctitle, struct TextStyle *ctitle_style)
+{
+    DRAW_MENU:;
+    new_screen_frame(true);
+
+    struct Vec2 dsize = display_size();
+    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+
+    struct TextNode menu[] = {
+        {
+            (ctitle_style == NULL) ? title_style : *ctitle_style,
+            (ctitle == NULL) ? "Escolha um Oponente" : ctitle,
+        },
+        {option_style, "1. Burrice Artificial (fácil)"},
+        {option_style, "2. Inteligência Bloqueante (médio)"},
+        {option_style, "3. Busca com Padrões (difícil)"},
+        {plain_style, ""},
+        {info_style, "Q Escape Backspace => Cancelar"},
+    };
+
+    write_text_node_row(menu_offset, sizeof(menu)/sizeof(struct TextNode), menu);
+
+    while (true)
+    {
+        enum KeyboardInput key = keyboard_input();
+        switch (key)
+        {
+        case KEY_1: return dumb_ai_cortex;
+        case KEY_2: return avarage_ai_cortex;
+        case KEY_3: return pattern_ai_cortex;
+        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE: return NULL;
+        case KEY_RESIZE: goto DRAW_MENU;
+        default: continue;
+        }
+    }
+}
+
+/**
+ * Mostra por mais ou menos 2 segundos um
+ * popup com um título e um ator (X ou O).
+ */
+void actor_popup(const char *title, enum Actor actor)
+{
+    new_screen_frame(true);
+    block_delay(200);
+
+    struct Vec2 dsize = display_size();
+    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+
+    struct TextStyle actor_titile_style =
+    {
+        .fmt_flags = FOREGROUND_COLOR_FLAG | BOLD_FLAG,
+        .foreground_color = actor_color(actor),
+    };
+
+    struct Vec2 title_offset = { menu_offset.x, menu_offset.y - 2 };
+    set_cursor_position(title_offset);
+    write_text_node((struct TextNode){actor_titile_style, title});
+
+    struct Vec2 actor_box_offset = { menu_offset.x - 3, menu_offset.y - 1 };
+    set_cursor_position(actor_box_offset);
+    draw_game_cell(actor, actor_to_move(actor), true);
+
+    block_delay(2E3 + 100);
+    new_screen_frame(true);
+    block_delay(200);
+}
+
+/**
+ * Mostra por mais ou menos 2 segundos um
+ * popup mostrando quem vai começar
+ * jogando (X ou O).
+ */
+void who_is_starting_popup(enum Actor starter)
+{
+    actor_popup("Quem Começa:", starter);
+}
+
+/**
+ * Jogo da Velha Supremo (Ultimate Tic-Tac-Toe):
+ * um tabuleiro 3x3 feito de tabuleiros 3x3.
+ *
+ * A célula onde alguém joga "manda" o oponente
+ * para o sub-tabuleiro da mesma posição. Quem
+ * ganha um sub-tabuleiro marca ele no meta-tabuleiro,
+ * e quem ganha o meta-tabuleiro ganha o jogo.
+ *
+ * Um sub-tabuleiro ganho ou cheio fica fechado, e
+ * quem for mandado para ele joga em qualquer aberto.
+ */
+struct UltimateState
+{
+    /**
+     * As jogadas de cada lado em
+     * cada sub-tabuleiro.
+     */
+    MovePrint x[9];
+    MovePrint o[9];
+    /**
+     * Os sub-tabuleiros ganhos por cada lado.
+     */
+    MovePrint x_meta;
+    MovePrint o_meta;
+    /**
+     * Os sub-tabuleiros ganhos ou cheios.
+     */
+    MovePrint closed;
+    /**
+     * Onde a próxima jogada deve ser
+     * (`-1` para qualquer sub-tabuleiro aberto).
+     */
+    int8_t forced;
+    enum Actor turn;
+    uint8_t moves;
+    enum EndGame endgame;
+};
+
+/**
+ * Uma jogada do Supremo: `sub-tabuleiro * 9 + célula`.
+ */
+typedef uint8_t UltimateMove;
+
+/**
+ * Máximo de jogadas possíveis numa posição.
+ */
+#define ULTIMATE_MAX_MOVES 81
+
+/**
+ * Construtor para `UltimateState`.
+ */
+struct UltimateState create_ultimate_state(enum Actor starter)
+{
+    return (struct UltimateState)
+    {
+        .forced = -1,
+        .turn = starter,
+    };
+}
+
+/**
+ * As células livres de um sub-tabuleiro.
+ */
+static inline MovePrint ultimate_free_cells(const struct UltimateState *state, int board)
+{
+    return ~(state->x[board] | state->o[board]) & 0x1FF;
+}
+
+/**
+ * Os sub-tabuleiros onde se pode jogar agora.
+ */
+static inline MovePrint ultimate_open_boards(const struct UltimateState *state)
+{
+    if (state->endgame != RUNNING)
+        return 0;
+    if (state->forced >= 0)
+        return 1 << state->forced;
+    return ~state->closed & 0x1FF;
+}
+
+/**
+ * Gera as jogadas possíveis em `moves`, sem
+ * pedir memória nenhuma, e retorna quantas são.
+ */
+size_t ultimate_moves(const struct UltimateState *state, UltimateMove moves[ULTIMATE_MAX_MOVES])
+{
+    size_t len = 0;
+    MovePrint boards = ultimate_open_boards(state);
+    for (int board = 0; board < 9; board++)
+    {
+        if (!((boards >> board) & 1))
+            continue;
+
+        MovePrint free_cells = ultimate_free_cells(state, board);
+        for (int cell = 0; cell < 9; cell++)
+            if ((free_cells >> cell) & 1)
+                moves[len++] = (board * 9) + cell;
+    }
+    return len;
+}
+
+/**
+ * Só conta as jogadas possíveis,
+ * sem gerar nenhuma.
+ */
+size_t ultimate_count_moves(const struct UltimateState *state)
+{
+    size_t count = 0;
+    MovePrint boards = ultimate_open_boards(state);
+    for (int board = 0; board < 9; board++)
+        if ((boards >> board) & 1)
+            count += move_print_count(ultimate_free_cells(state, board));
+    return count;
+}
+
+/**
+ * Diz se `move` pode ser jogada agora.
+ */
+bool ultimate_is_legal(const struct UltimateState *state, UltimateMove move)
+{
+    int board = move / 9;
+    int cell = move % 9;
+    return move < ULTIMATE_MAX_MOVES
+        && ((ultimate_open_boards(state) >> board) & 1)
+        && ((ultimate_free_cells(state, board) >> cell) & 1);
+}
+
+/**
+ * Faz uma jogada (que precisa ser possível)
+ * e passa a vez para o oponente.
+ */
+void ultimate_play(struct UltimateState *state, UltimateMove move)
+{
+    int board = move / 9;
+    int cell = move % 9;
+    bool is_x = state->turn == X_ACTOR;
+
+    MovePrint *mine = is_x ? &state->x[board] : &state->o[board];
+    *mine |= 1 << cell;
+    state->moves++;
+
+    // As mesmas regras do 3x3 valem para
+    // cada sub-tabuleiro e para o meta-tabuleiro.
+    if (test_move_print_winner(*mine))
+    {
+        MovePrint *meta = is_x ? &state->x_meta : &state->o_meta;
+        *meta |= 1 << board;
+        state->closed |= 1 << board;
+        if (test_move_print_winner(*meta))
+            state->endgame = is_x ? X_VICTORY : O_VICTORY;
+    }
+    else if (ultimate_free_cells(state, board) == 0)
+        state->closed |= 1 << board;
+
+    if (state->endgame == RUNNING && state->closed == 0x1FF)
+        state->endgame = GAME_DRAW;
+
+    state->forced = ((state->closed >> cell) & 1) ? -1 : cell;
+    state->turn = opponent_actor(state->turn);
+}
+
+/**
+ * O que o perft conta: as posições a
+ * exatamente `depth` jogadas e como
+ * terminaram as partidas no caminho
+ * (até `depth` jogadas).
+ */
+struct PerftCounts
+{
+    uint64_t nodes;
+    uint64_t x_wins;
+    uint64_t o_wins;
+    uint64_t draws;
+};
+
+/**
+ * Conta uma partida que terminou em `endgame`
+ * (e a posição, se for a última jogada).
+ */
+static inline void perft_count_endgame(struct PerftCounts *counts, enum EndGame endgame, int depth)
+{
+    if (depth == 0)
+        counts->nodes++;
+    if (endgame == X_VICTORY)
+        counts->x_wins++;
+    else if (endgame == O_VICTORY)
+        counts->o_wins++;
+    else
+        counts->draws++;
+}
+
+/**
+ * Diz se alguma jogada possível agora termina
+ * o jogo, fechando o último sub-tabuleiro
+ * ou completando uma linha do meta-tabuleiro.
+ */
+bool ultimate_can_end_now(const struct UltimateState *state)
+{
+    MovePrint boards = ultimate_open_boards(state);
+    MovePrint meta = (state->turn == X_ACTOR) ? state->x_meta : state->o_meta;
+    MovePrint still_open = ~state->closed & 0x1FF;
+
+    // Onde ganhar o sub-tabuleiro ganha o jogo, e o
+    // último sub-tabuleiro aberto (fechar ele acaba o jogo).
+    MovePrint deciding = move_print_winning_cells(meta, boards);
+    if ((still_open & (still_open - 1)) == 0)
+        deciding |= still_open & boards;
+
+    for (int board = 0; deciding != 0 && board < 9; board++)
+    {
+        if (!((deciding >> board) & 1))
+            continue;
+
+        MovePrint mine = (state->turn == X_ACTOR) ? state->x[board] : state->o[board];
+        MovePrint free_cells = ultimate_free_cells(state, board);
+        if (move_print_winning_cells(mine, free_cells) != 0)
+            return true;
+        if (still_open == (1 << board) && move_print_count(free_cells) == 1)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Conta as posições a exatamente `depth`
+ * jogadas de `state` ("perft") e os
+ * finais de jogo no caminho.
+ *
+ * No último nível, se nenhuma jogada
+ * termina o jogo, as jogadas só são contadas,
+ * sem serem feitas (contagem em massa).
+ */
+void ultimate_perft(const struct UltimateState *state, int depth, struct PerftCounts *counts)
+{
+    if (state->endgame != RUNNING)
+    {
+        perft_count_endgame(counts, state->endgame, depth);
+        return;
+    }
+    if (depth == 0)
+    {
+        counts->nodes++;
+        return;
+    }
+    if (depth == 1 && !ultimate_can_end_now(state))
+    {
+        counts->nodes += ultimate_count_moves(state);
+        return;
+    }
+
+    UltimateMove moves[ULTIMATE_MAX_MOVES];
+    size_t len = ultimate_moves(state, moves);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        struct UltimateState next = *state;
+        ultimate_play(&next, moves[i]);
+        ultimate_perft(&next, depth - 1, counts);
+    }
+}
+
+/**
+ * Diz se `actor` ganha o sub-tabuleiro
+ * `board` com uma jogada só.
+ */
+bool ultimate_can_win_board(const struct UltimateState *state, enum Actor actor, int board)
+{
+    MovePrint mine = (actor == X_ACTOR) ? state->x[board] : state->o[board];
+    return move_print_winning_cells(mine, ultimate_free_cells(state, board)) != 0;
+}
+
+/**
+ * A máquina do Supremo.
+ *
+ * Olha só uma jogada à frente: ganha o jogo
+ * ou um sub-tabuleiro se puder, e evita mandar
+ * o oponente para onde ele ganha um sub-tabuleiro
+ * ou pode jogar em qualquer lugar.
+ */
+UltimateMove ultimate_ai_move(const struct UltimateState *state)
+{
+    UltimateMove moves[ULTIMATE_MAX_MOVES];
+    size_t len = ultimate_moves(state, moves);
+
+    UltimateMove best[ULTIMATE_MAX_MOVES];
+    size_t best_len = 0;
+    int best_score = INT32_MIN;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        struct UltimateState next = *state;
+        ultimate_play(&next, moves[i]);
+
+        int score = 0;
+        if (next.endgame == X_VICTORY || next.endgame == O_VICTORY)
+            score += 1000;
+        if (next.closed != state->closed)
+            score += 10;
+        if (next.forced < 0)
+            score -= 5;
+        else if (ultimate_can_win_board(&next, next.turn, next.forced))
+            score -= 8;
+
+        if (score > best_score)
+        {
+            best_score = score;
+            best_len = 0;
+        }
+        if (score == best_score)
+            best[best_len++] = moves[i];
+    }
+    return best[rand() % best_len];
+}
+
+/**
+ * Converte uma posição na grade 9x9 em jogada.
+ */
+UltimateMove ultimate_move_at(struct Vec2 pos)
+{
+    int board = ((pos.y / 3) * 3) + (pos.x / 3);
+    int cell = ((pos.y % 3) * 3) + (pos.x % 3);
+    return (board * 9) + cell;
+}
+
+/**
+ * Converte uma jogada em posição na grade 9x9.
+ */
+struct Vec2 ultimate_move_position(UltimateMove move)
+{
+    int board = move / 9;
+    int cell = move % 9;
+    return vec2(((board % 3) * 3) + (cell % 3), ((board / 3) * 3) + (cell / 3));
+}
+
+/**
+ * Desenha uma linha horizontal da grade do Supremo.
+ */
+void render_ultimate_rule(const char *left, const char *middle, const char *right)
+{
+    terminal_printf("%s", left);
+    for (int i = 0; i < 3; i++)
+    {
+        terminal_printf("─────────");
+        terminal_printf("%s", (i < 2) ? middle : right);
+    }
+    move_cursor(vec2(-31, 1));
+}
+
+/**
+ * Desenha o Supremo: a grade 9x9 com os
+ * sub-tabuleiros separados, a seleção entre
+ * colchetes e pontos nas células jogáveis.
+ */
+void render_ultimate(const struct UltimateState *state, struct Vec2 selection)
+{
+    struct Vec2 screen_size = display_size();
+    struct Vec2 screen_offset = {(screen_size.x / 2) - 15, (screen_size.y / 2) - 8};
+    new_screen_frame(false);
+    set_cursor_position(screen_offset);
+
+    MovePrint open = ultimate_open_boards(state);
+
+    set_bold();
+    terminal_printf("    Jogo da Velha Supremo");
+    reset_formatting();
+    move_cursor(vec2(-25, 1));
+
+    struct Color frame_color = {0};
+    bool colored_frame = state->endgame != RUNNING;
+    if (state->endgame == GAME_DRAW)
+        frame_color = game_draw_color();
+    else if (state->endgame == X_VICTORY)
+        frame_color = actor_color(X_ACTOR);
+    else if (state->endgame == O_VICTORY)
+        frame_color = actor_color(O_ACTOR);
+
+    for (int y = 0; y < 9; y++)
+    {
+        set_bold();
+        if (colored_frame)
+            set_foreground_color(frame_color);
+        if (y == 0)
+            render_ultimate_rule("╭", "┬", "╮");
+        else if (y % 3 == 0)
+            render_ultimate_rule("├", "┼", "┤");
+        reset_formatting();
+
+        for (int x = 0; x < 9; x++)
+        {
+            if (x % 3 == 0)
+            {
+                set_bold();
+                if (colored_frame)
+                    set_foreground_color(frame_color);
+                terminal_printf("│");
+                reset_formatting();
+            }
+
+            int board = ((y / 3) * 3) + (x / 3);
+            int cell = ((y % 3) * 3) + (x % 3);
+            bool selected = state->endgame == RUNNING && x == selection.x && y == selection.y;
+
+            enum Actor owner = NULL_ACTOR;
+            if ((state->x_meta >> board) & 1)
+                owner = X_ACTOR;
+            else if ((state->o_meta >> board) & 1)
+                owner = O_ACTOR;
+
+            enum Actor actor = NULL_ACTOR;
+            if ((state->x[board] >> cell) & 1)
+                actor = X_ACTOR;
+            else if ((state->o[board] >> cell) & 1)
+                actor = O_ACTOR;
+
+            terminal_printf(selected ? "[" : " ");
+            if (owner != NULL_ACTOR)
+            {
+                // Um sub-tabuleiro ganho fica
+                // todo com a marca do dono.
+                set_dim();
+                draw_game_actor(owner);
+            }
+            else if (actor != NULL_ACTOR)
+            {
+                if ((state->closed >> board) & 1)
+                    set_dim();
+                draw_game_actor(actor);
+            }
+            else if ((open >> board) & 1)
+            {
+                set_dim();
+                terminal_printf("·");
+                reset_formatting();
+            }
+            else
+                terminal_putchar(' ');
+            terminal_printf(selected ? "]" : " ");
+        }
+
+        set_bold();
+        if (colored_frame)
+            set_foreground_color(frame_color);
+        terminal_printf("│");
+        reset_formatting();
+        move_cursor(vec2(-31, 1));
+    }
+
+    set_bold();
+    if (colored_frame)
+        set_foreground_color(frame_color);
+    render_ultimate_rule("╰", "┴", "╯");
+    reset_formatting();
+
+    move_cursor(vec2(6, 0));
+    render_endgame(state->endgame, state->turn, state->moves);
+    terminal_printf("    Jogadas: %d", state->moves);
+}
+
+/**
+ * Joga uma partida do Supremo no terminal.
+ *
+ * `machine` é o lado jogado pela
+ * máquina (`NULL_ACTOR` para nenhum).
+ */
+void ultimate_game(enum Actor machine)
+{
+    struct UltimateState state = create_ultimate_state((enum Actor)((rand() % 2) + 1));
+    struct Vec2 selection = {4, 4};
+
+    who_is_starting_popup(state.turn);
+
+    while (state.endgame == RUNNING)
+    {
+        // A seleção já começa no sub-tabuleiro
+        // obrigatório, na mesma célula de antes.
+        if (state.forced >= 0 && ultimate_move_at(selection) / 9 != state.forced)
+            selection = vec2(((state.forced % 3) * 3) + (selection.x % 3), ((state.forced / 3) * 3) + (selection.y % 3));
+
+        render_ultimate(&state, selection);
+
+        if (state.turn == machine)
+        {
+            UltimateMove move = ultimate_ai_move(&state);
+            block_delay((rand() % 300) + 300);
+            selection = ultimate_move_position(move);
+            render_ultimate(&state, selection);
+            block_delay(225);
+            ultimate_play(&state, move);
+            continue;
+        }
+
+        enum GameInput input = REDRAW_INPUT;
+        while (!player_key_input(keyboard_input(), &input));
+
+        switch (input)
+        {
+        case QUIT_INPUT:
+            return;
+        case UP_INPUT:
+            selection.y = (selection.y + 8) % 9;
+            break;
+        case DOWN_INPUT:
+            selection.y = (selection.y + 1) % 9;
+            break;
+        case LEFT_INPUT:
+            selection.x = (selection.x + 8) % 9;
+            break;
+        case RIGHT_INPUT:
+            selection.x = (selection.x + 1) % 9;
+            break;
+        case MOVE_INPUT:
+        {
+            UltimateMove move = ultimate_move_at(selection);
+            if (ultimate_is_legal(&state, move))
+                ultimate_play(&state, move);
+            break;
+        }
+        case UNDO_INPUT: case REDO_INPUT: case REDRAW_INPUT: case WAIT_INPUT:
+            break;
+        }
+    }
+
+    if (program_options.unattended)
+        return;
+
+    struct TextNode info[] = {
+        {info_style, "Espaço Enter => Continuar"},
+    };
+
+    do
+    {
+        render_ultimate(&state, selection);
+        struct Vec2 screen_size = display_size();
+        struct Vec2 info_offset = {screen_size.x / 2, (screen_size.y / 2) + 8};
+        write_text_node_row(info_offset, sizeof(info)/sizeof(struct TextNode), info);
+    }
+    while (blocking_confirm() == NEEDS_REDRAW);
+}
+
+/**
+ * Menu dos modos de uma variante do jogo,
+ * com o nome (`title`) e a regra principal.
+ *
+ * Retorna `PLAYER_VS_PLAYER`, `PLAYER_VS_MACHINE`
+ * ou `QUIT_GAME` para cancelamento.
+ */
+enum MainMenuOption game_mode_menu(const char *title, const char *rule)
+{
+    DRAW_MENU:;
+    new_screen_frame(true);
+
+    struct Vec2 dsize = display_size();
+    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+
+    struct TextNode menu[] = {
+        {title_style, title},
+        {plain_style, rule},
+        {plain_style, ""},
+        {option_style, "1. Jogador vs. Jogador"},
+        {option_style, "2. Jogador vs. Máquina"},
+        {plain_style, ""},
+        {info_style, "Q Escape Backspace => Cancelar"},
+    };
+
+    write_text_node_row(menu_offset, sizeof(menu)/sizeof(struct TextNode), menu);
+
+    while (true)
+    {
+        enum KeyboardInput key = keyboard_input();
+        switch (key)
+        {
+        case KEY_1: return PLAYER_VS_PLAYER;
+        case KEY_2: return PLAYER_VS_MACHINE;
+        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE: return QUIT_GAME;
+        case KEY_RESIZE: goto DRAW_MENU;
+        default: continue;
+        }
+    }
+}
+
+/**
+ * O Qubic é o Jogo da Velha em 3D: um cubo
+ * 4x4x4 onde ganha quem fizer 4 em linha,
+ * inclusive atravessando as camadas.
+ *
+ * As 64 células cabem certinho num `uint64_t`,
+ * o mesmo truque do `MovePrint`, só que maior:
+ * o bit `z * 16 + y * 4 + x` é a célula `(x, y)`
+ * da camada `z`.
+ */
+typedef uint64_t QubicPrint;
+
+/**
+ * Quantas linhas vencedoras o cubo tem:
+ * 48 retas nas direções dos eixos, 24
+ * diagonais nos planos e 4 diagonais do cubo.
+ */
+#define QUBIC_LINES 76
+
+/**
+ * Cada célula está em no máximo 7 linhas
+ * (os cantos e as 8 células do meio).
+ */
+#define QUBIC_CELL_MAX_LINES 7
+
+/**
+ * As linhas vencedoras e, para cada célula,
+ * as linhas que passam por ela, assim uma
+ * jogada só precisa testar até 7 linhas em
+ * vez das 76.
+ *
+ * `qubic_move_order` tem as células ordenadas
+ * das que estão em mais linhas para as que
+ * estão em menos, para a busca olhar as
+ * melhores jogadas primeiro.
+ *
+ * São montadas por `build_qubic_tables`.
+ */
+QubicPrint qubic_lines[QUBIC_LINES];
+uint8_t qubic_cell_lines[64][QUBIC_CELL_MAX_LINES];
+uint8_t qubic_cell_lines_len[64];
+uint8_t qubic_move_order[64];
+bool qubic_tables_ready = false;
+
+/**
+ * Monta as tabelas do Qubic (só na primeira vez).
+ *
+ * Uma linha é um começo e uma direção que
+ * andam 4 células sem saír do cubo. Das 26
+ * direções, só usamos as 13 "para frente"
+ * para não contar a mesma linha duas vezes.
+ */
+void build_qubic_tables()
+{
+    if (qubic_tables_ready)
+        return;
+
+    int len = 0;
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        // "Para frente" é quando a primeira
+        // coordenada diferente de 0 é positiva.
+        int first = (dz != 0) ? dz : ((dy != 0) ? dy : dx);
+        if (first <= 0)
+            continue;
+
+        for (int z = 0; z < 4; z++)
+        for (int y = 0; y < 4; y++)
+        for (int x = 0; x < 4; x++)
+        {
+            int end_x = x + (dx * 3), end_y = y + (dy * 3), end_z = z + (dz * 3);
+            if (end_x < 0 || end_x > 3 || end_y < 0 || end_y > 3 || end_z < 0 || end_z > 3)
+                continue;
+
+            QubicPrint line = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                int cell = ((z + (dz * i)) * 16) + ((y + (dy * i)) * 4) + (x + (dx * i));
+                line |= (QubicPrint)1 << cell;
+                qubic_cell_lines[cell][qubic_cell_lines_len[cell]++] = len;
+            }
+            qubic_lines[len++] = line;
+        }
+    }
+
+    // Uma ordenação por inserção basta para 64 células.
+    for (int i = 0; i < 64; i++)
+    {
+        int j = i;
+        while (j > 0 && qubic_cell_lines_len[qubic_move_order[j - 1]] < qubic_cell_lines_len[i])
+        {
+            qubic_move_order[j] = qubic_move_order[j - 1];
+            j--;
+        }
+        qubic_move_order[j] = i;
+    }
+
+    qubic_tables_ready = true;
+}
+
+/**
+ * Conta quantos bits estão ligados.
+ *
+ * `print &= print - 1` apaga o bit mais baixo,
+ * então o laço roda uma vez por bit ligado.
+ */
+static inline uint8_t qubic_print_count(QubicPrint print)
+{
+    uint8_t count = 0;
+    while (print != 0)
+    {
+        print &= print - 1;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Representa todo o estado de um Qubic.
+ */
+struct QubicState
+{
+    QubicPrint x;
+    QubicPrint o;
+    /**
+     * A linha que ganhou o jogo (`0` se nenhuma).
+     */
+    QubicPrint winner_line;
+    enum Actor turn;
+    uint8_t moves;
+    enum EndGame endgame;
+};
+
+/**
+ * Construtor para `QubicState`.
+ */
+struct QubicState create_qubic_state(enum Actor starter)
+{
+    build_qubic_tables();
+    return (struct QubicState){.turn = starter};
+}
+
+/**
+ * As células livres do cubo.
+ */
+static inline QubicPrint qubic_free_cells(const struct QubicState *state)
+{
+    return ~(state->x | state->o);
+}
+
+/**
+ * Diz se `cell` pode ser jogada agora.
+ */
+bool qubic_is_legal(const struct QubicState *state, uint8_t cell)
+{
+    return state->endgame == RUNNING
+        && cell < 64 && ((qubic_free_cells(state) >> cell) & 1);
+}
+
+/**
+ * Gera as jogadas possíveis em `moves`, na
+ * ordem de `qubic_move_order`, e retorna quantas são.
+ */
+size_t qubic_moves(const struct QubicState *state, uint8_t moves[64])
+{
+    if (state->endgame != RUNNING)
+        return 0;
+
+    size_t len = 0;
+    QubicPrint free_cells = qubic_free_cells(state);
+    for (int i = 0; i < 64; i++)
+        if ((free_cells >> qubic_move_order[i]) & 1)
+            moves[len++] = qubic_move_order[i];
+    return len;
+}
+
+/**
+ * Faz uma jogada (que precisa ser possível)
+ * e passa a vez para o oponente.
+ *
+ * Só as linhas que passam pela célula
+ * jogada podem ter sido completadas.
+ */
+void qubic_play(struct QubicState *state, uint8_t cell)
+{
+    QubicPrint *mine = (state->turn == X_ACTOR) ? &state->x : &state->o;
+    *mine |= (QubicPrint)1 << cell;
+    state->moves++;
+
+    for (int i = 0; i < qubic_cell_lines_len[cell]; i++)
+    {
+        QubicPrint line = qubic_lines[qubic_cell_lines[cell][i]];
+        if ((*mine & line) == line)
+        {
+            state->winner_line = line;
+            state->endgame = (state->turn == X_ACTOR) ? X_VICTORY : O_VICTORY;
+            break;
+        }
+    }
+
+    if (state->endgame == RUNNING && state->moves == 64)
+        state->endgame = GAME_DRAW;
+
+    state->turn = opponent_actor(state->turn);
+}
+
+/**
+ * Pega as células livres que completariam
+ * uma linha do `testing`.
+ */
+QubicPrint qubic_winning_cells(QubicPrint testing, QubicPrint free_cells)
+{
+    QubicPrint result = 0;
+    for (int i = 0; i < QUBIC_LINES; i++)
+    {
+        QubicPrint missing = qubic_lines[i] & ~testing;
+        if (missing != 0 && (missing & (missing - 1)) == 0)
+            result |= missing & free_cells;
+    }
+    return result;
+}
+
+/**
+ * O perft do Qubic, com a mesma contagem
+ * em massa no último nível do clássico.
+ */
+void qubic_perft(const struct QubicState *state, int depth, struct PerftCounts *counts)
+{
+    if (state->endgame != RUNNING)
+    {
+        perft_count_endgame(counts, state->endgame, depth);
+        return;
+    }
+    if (depth == 0)
+    {
+        counts->nodes++;
+        return;
+    }
+
+    QubicPrint free_cells = qubic_free_cells(state);
+
+    if (depth == 1)
+    {
+        QubicPrint mine = (state->turn == X_ACTOR) ? state->x : state->o;
+        uint8_t free_len = 64 - state->moves;
+        // Com menos de 3 peças não dá para ganhar.
+        uint8_t wins = (state->moves >= 5) ? qubic_print_count(qubic_winning_cells(mine, free_cells)) : 0;
+
+        counts->nodes += free_len;
+        if (state->turn == X_ACTOR)
+            counts->x_wins += wins;
+        else
+            counts->o_wins += wins;
+        if (free_len == 1 && wins == 0)
+            counts->draws++;
+        return;
+    }
+
+    for (uint8_t cell = 0; cell < 64; cell++)
+    {
+        if (!((free_cells >> cell) & 1))
+            continue;
+
+        struct QubicState next = *state;
+        qubic_play(&next, cell);
+        qubic_perft(&next, depth - 1, counts);
+    }
+}
+
+/**
+ * Pontuação de uma vitória na busca. Quanto
+ * antes a vitória, maior a pontuação.
+ */
+#define QUBIC_WIN_SCORE 100000
+
+/**
+ * Quanto vale uma linha com 1, 2 ou 3
+ * peças de um lado só.
+ */
+const int qubic_line_weights[4] = {0, 1, 8, 64};
+
+/**
+ * Avalia a posição do ponto de vista
+ * de quem vai jogar: cada linha que só
+ * tem peças de um lado vale pontos para
+ * esse lado, linhas com os dois não valem nada.
+ */
+int qubic_evaluate(const struct QubicState *state)
+{
+    QubicPrint mine = (state->turn == X_ACTOR) ? state->x : state->o;
+    QubicPrint theirs = (state->turn == X_ACTOR) ? state->o : state->x;
+
+    int score = 0;
+    for (int i = 0; i < QUBIC_LINES; i++)
+    {
+        QubicPrint my_part = mine & qubic_lines[i];
+        QubicPrint their_part = theirs & qubic_lines[i];
+        if (their_part == 0)
+            score += qubic_line_weights[qubic_print_count(my_part)];
+        else if (my_part == 0)
+            score -= qubic_line_weights[qubic_print_count(their_part)];
+    }
+    return score;
+}
+
+/**
+ * Busca alfa-beta (na forma "negamax") até
+ * `depth` jogadas, retornando a pontuação do
+ * ponto de vista de quem vai jogar.
+ *
+ * Só são consideradas pontuações entre `alpha`
+ * e `beta`: quando uma jogada já é boa demais
+ * (`beta`), o oponente nunca deixaria chegar
+ * nela, e o resto das jogadas é ignorado.
+ *
+ * `nodes` conta as posições visitadas.
+ */
+int qubic_search(const struct QubicState *state, int depth, int alpha, int beta, uint64_t *nodes)
+{
+    (*nodes)++;
+
+    if (state->endgame == GAME_DRAW)
+        return 0;
+    // Quem jogou por último ganhou, então quem
+    // vai jogar agora perdeu.
+    if (state->endgame != RUNNING)
+        return -(QUBIC_WIN_SCORE - state->moves);
+    if (depth == 0)
+        return qubic_evaluate(state);
+
+    uint8_t moves[64];
+    size_t len = qubic_moves(state, moves);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        struct QubicState next = *state;
+        qubic_play(&next, moves[i]);
+
+        int score = -qubic_search(&next, depth - 1, -beta, -alpha, nodes);
+        if (score > alpha)
+        {
+            alpha = score;
+            if (alpha >= beta)
+                break;
+        }
+    }
+    return alpha;
+}
+
+/**
+ * Escolhe a melhor jogada com uma
+ * busca de `depth` jogadas (o jogo
+ * precisa estar em andamento).
+ */
+uint8_t qubic_best_move(const struct QubicState *state, int depth, uint64_t *nodes)
+{
+    uint8_t moves[64];
+    size_t len = qubic_moves(state, moves);
+
+    // Toda pontuação é maior que `alpha`, então
+    // a primeira jogada sempre vira a melhor.
+    uint8_t best = 0;
+    int alpha = -QUBIC_WIN_SCORE - 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        struct QubicState next = *state;
+        qubic_play(&next, moves[i]);
+
+        int score = -qubic_search(&next, depth - 1, -QUBIC_WIN_SCORE - 1, -alpha, nodes);
+        if (score > alpha)
+        {
+            alpha = score;
+            best = moves[i];
+        }
+    }
+    return best;
+}
+
+/**
+ * Profundidade da busca da máquina do Qubic.
+ */
+#define QUBIC_AI_DEPTH 3
+
+/**
+ * A posição (`x`, `y`, camada `z`)
+ * de uma célula do cubo.
+ */
+static inline uint8_t qubic_cell_at(struct Vec2 pos, int layer)
+{
+    return (layer * 16) + (pos.y * 4) + pos.x;
+}
+
+/**
+ * Desenha o Qubic: as 4 camadas lado a lado,
+ * a camada selecionada em destaque e a seleção
+ * entre colchetes. No fim do jogo, só a linha
+ * vencedora continua acesa.
+ */
+void render_qubic(const struct QubicState *state, struct Vec2 selection, int layer)
+{
+    struct Vec2 screen_size = display_size();
+    struct Vec2 screen_offset = {(screen_size.x / 2) - 31, (screen_size.y / 2) - 5};
+    new_screen_frame(false);
+    set_cursor_position(screen_offset);
+
+    set_bold();
+    move_cursor(vec2(24, 0));
+    terminal_printf("Qubic (4x4x4)");
+    reset_formatting();
+
+    struct Color frame_color = {0};
+    bool colored_frame = state->endgame != RUNNING;
+    if (state->endgame == GAME_DRAW)
+        frame_color = game_draw_color();
+    else if (state->endgame == X_VICTORY)
+        frame_color = actor_color(X_ACTOR);
+    else if (state->endgame == O_VICTORY)
+        frame_color = actor_color(O_ACTOR);
+
+    for (int z = 0; z < 4; z++)
+    {
+        bool active = state->endgame == RUNNING && z == layer;
+        set_cursor_position(vec2(screen_offset.x + (z * 16), screen_offset.y + 2));
+
+        if (active)
+            set_bold();
+        else
+            set_dim();
+        terminal_printf("   Camada %d", z + 1);
+        reset_formatting();
+        move_cursor(vec2(-11, 1));
+
+        for (int y = -1; y <= 4; y++)
+        {
+            if (active || colored_frame)
+                set_bold();
+            if (colored_frame)
+                set_foreground_color(frame_color);
+            else if (active)
+                set_foreground_color(actor_color(state->turn));
+
+            if (y == -1 || y == 4)
+            {
+                terminal_printf((y == -1) ? "╭────────────╮" : "╰────────────╯");
+                reset_formatting();
+                move_cursor(vec2(-14, 1));
+                continue;
+            }
+
+            terminal_printf("│");
+            reset_formatting();
+
+            for (int x = 0; x < 4; x++)
+            {
+                uint8_t cell = qubic_cell_at(vec2(x, y), z);
+                QubicPrint bit = (QubicPrint)1 << cell;
+                bool selected = active && x == selection.x && y == selection.y;
+
+                terminal_printf(selected ? "[" : " ");
+                if ((state->x | state->o) & bit)
+                {
+                    if (state->endgame != RUNNING && !(state->winner_line & bit))
+                        set_dim();
+                    draw_game_actor((state->x & bit) ? X_ACTOR : O_ACTOR);
+                }
+                else
+                {
+                    set_dim();
+                    terminal_printf("·");
+                    reset_formatting();
+                }
+                terminal_printf(selected ? "]" : " ");
+            }
+
+            if (active || colored_frame)
+                set_bold();
+            if (colored_frame)
+                set_foreground_color(frame_color);
+            else if (active)
+                set_foreground_color(actor_color(state->turn));
+            terminal_printf("│");
+            reset_formatting();
+            move_cursor(vec2(-14, 1));
+        }
+    }
+
+    set_cursor_position(vec2(screen_offset.x + 16, screen_offset.y + 10));
+    render_endgame(state->endgame, state->turn, state->moves);
+    terminal_printf("    Jogadas: %d", state->moves);
+}
+
+/**
+ * Joga uma partida de Qubic no terminal.
+ *
+ * `machine` é o lado jogado pela
+ * máquina (`NULL_ACTOR` para nenhum).
+ */
+void qubic_game(enum Actor machine)
+{
+    struct QubicState state = create_qubic_state((enum Actor)((rand() % 2) + 1));
+    struct Vec2 selection = {1, 1};
+    int layer = 1;
+
+    struct TextNode info[] = {
+        {info_style, "Tab => Próxima camada"},
+    };
+
+    who_is_starting_popup(state.turn);
+
+    while (state.endgame == RUNNING)
+    {
+        render_qubic(&state, selection, layer);
+        struct Vec2 screen_size = display_size();
+        struct Vec2 info_offset = {screen_size.x / 2, (screen_size.y / 2) + 9};
+        write_text_node_row(info_offset, sizeof(info)/sizeof(struct TextNode), info);
+
+        if (state.turn == machine)
+        {
+            uint64_t nodes = 0;
+            uint8_t move = qubic_best_move(&state, QUBIC_AI_DEPTH, &nodes);
+            block_delay((rand() % 300) + 300);
+            selection = vec2(move % 4, (move / 4) % 4);
+            layer = move / 16;
+            render_qubic(&state, selection, layer);
+            block_delay(225);
+            qubic_play(&state, move);
+            continue;
+        }
+
+        enum KeyboardInput key = keyboard_input();
+        if (key == KEY_TAB)
+        {
+            layer = (layer + 1) % 4;
+            continue;
+        }
+
+        enum GameInput input = REDRAW_INPUT;
+        if (!player_key_input(key, &input))
+            continue;
+
+        switch (input)
+        {
+        case QUIT_INPUT:
+            return;
+        case UP_INPUT:
+            selection.y = (selection.y + 3) % 4;
+            break;
+        case DOWN_INPUT:
+            selection.y = (selection.y + 1) % 4;
+            break;
+        case LEFT_INPUT:
+            selection.x = (selection.x + 3) % 4;
+            break;
+        case RIGHT_INPUT:
+            selection.x = (selection.x + 1) % 4;
+            break;
+        case MOVE_INPUT:
+        {
+            uint8_t cell = qubic_cell_at(selection, layer);
+            if (qubic_is_legal(&state, cell))
+                qubic_play(&state, cell);
+            break;
+        }
+        case UNDO_INPUT: case REDO_INPUT: case REDRAW_INPUT: case WAIT_INPUT:
+            break;
+        }
+    }
+
+    if (program_options.unattended)
+        return;
+
+    info[0].str = "Espaço Enter => Continuar";
+
+    do
+    {
+        render_qubic(&state, selection, layer);
+        struct Vec2 screen_size = display_size();
+        struct Vec2 info_offset = {screen_size.x / 2, (screen_size.y / 2) + 9};
+        write_text_node_row(info_offset, sizeof(info)/sizeof(struct TextNode), info);
+    }
+    while (blocking_confirm() == NEEDS_REDRAW);
+}
+
+/**
+ * Contagens conhecidas do perft do Qubic,
+ * a partir do cubo vazio (profundidade 1 a 6).
+ *
+ * Ninguém ganha antes da 7ª jogada, então
+ * são só as combinações de células.
+ */
+const struct PerftCounts qubic_perft_expected[] =
+{
+    {.nodes = 64},
+    {.nodes = 4032},
+    {.nodes = 249984},
+    {.nodes = 15249024},
+    {.nodes = 914941440},
+    {.nodes = 53981544960},
+};
+
+/**
+ * Contagens conhecidas do perft do Supremo,
+ * a partir do tabuleiro vazio (profundidade 1 a 7).
+ */
+const struct PerftCounts ultimate_perft_expected[] =
+{
+    {.nodes = 81},
+    {.nodes = 720},
+    {.nodes = 6336},
+    {.nodes = 55080},
+    {.nodes = 473256},
+    {.nodes = 4020960},
+    {.nodes = 33782544},
+};
+
+/**
+ * O Jogo da Velha clássico só com
+ * `MovePrint`s, sem a interface e sem
+ * a detecção antecipada de velha, para
+ * medir o núcleo de bitboards puro.
+ */
+struct ClassicBoard
+{
+    MovePrint x;
+    MovePrint o;
+    enum Actor turn;
+    enum EndGame endgame;
+};
+
+/**
+ * As células livres do `ClassicBoard`.
+ */
+static inline MovePrint classic_free_cells(const struct ClassicBoard *board)
+{
+    return ~(board->x | board->o) & 0x1FF;
+}
+
+/**
+ * Joga na célula `cell` (que precisa estar livre)
+ * e passa a vez para o oponente.
+ */
+static inline void classic_play(struct ClassicBoard *board, uint8_t cell)
+{
+    MovePrint *mine = (board->turn == X_ACTOR) ? &board->x : &board->o;
+    *mine |= 1 << cell;
+
+    if (test_move_print_winner(*mine))
+        board->endgame = (board->turn == X_ACTOR) ? X_VICTORY : O_VICTORY;
+    else if (classic_free_cells(board) == 0)
+        board->endgame = GAME_DRAW;
+
+    board->turn = opponent_actor(board->turn);
+}
+
+/**
+ * O perft do clássico.
+ *
+ * No último nível nenhuma jogada é feita:
+ * as células livres são as posições, as
+ * que completam uma linha são vitórias e,
+ * se só sobrou uma célula que não ganha,
+ * é velha (contagem em massa).
+ */
+void classic_perft(const struct ClassicBoard *board, int depth, struct PerftCounts *counts)
+{
+    if (board->endgame != RUNNING)
+    {
+        perft_count_endgame(counts, board->endgame, depth);
+        return;
+    }
+    if (depth == 0)
+    {
+        counts->nodes++;
+        return;
+    }
+
+    MovePrint free_cells = classic_free_cells(board);
+
+    if (depth == 1)
+    {
+        MovePrint mine = (board->turn == X_ACTOR) ? board->x : board->o;
+        uint8_t free_len = move_print_count(free_cells);
+        uint8_t wins = move_print_count(move_print_winning_cells(mine, free_cells));
+
+        counts->nodes += free_len;
+        if (board->turn == X_ACTOR)
+            counts->x_wins += wins;
+        else
+            counts->o_wins += wins;
+        if (free_len == 1 && wins == 0)
+            counts->draws++;
+        return;
+    }
+
+    for (uint8_t cell = 0; cell < 9; cell++)
+    {
+        if (!((free_cells >> cell) & 1))
+            continue;
+
+        struct ClassicBoard next = *board;
+        classic_play(&next, cell);
+        classic_perft(&next, depth - 1, counts);
+    }
+}
+
+/**
+ * Contagens conhecidas do perft do clássico,
+ * com X começando no tabuleiro vazio
+ * (profundidade 1 a 9, são 255168 partidas).
+ */
+const struct PerftCounts classic_perft_expected[] =
+{
+    {.nodes = 9},
+    {.nodes = 72},
+    {.nodes = 504},
+    {.nodes = 3024},
+    {.nodes = 15120, .x_wins = 1440},
+    {.nodes = 54720, .x_wins = 1440, .o_wins = 5328},
+    {.nodes = 148176, .x_wins = 49392, .o_wins = 5328},
+    {.nodes = 200448, .x_wins = 49392, .o_wins = 77904},
+    {.nodes = 127872, .x_wins = 131184, .o_wins = 77904, .draws = 46080},
+};
+
+/**
+ * Máximo de jogadas numa posição
+ * de qualquer variante do perft.
+ */
+#define PERFT_MAX_MOVES 81
+
+/**
+ * Uma posição de qualquer variante do perft.
+ */
+union PerftPosition
+{
+    struct ClassicBoard classic;
+    struct UltimateState ultimate;
+    struct QubicState qubic;
+};
+
+/**
+ * Uma variante do jogo que o perft conhece.
+ *
+ * As jogadas são números pequenos
+ * (a célula no clássico, `UltimateMove`
+ * no Supremo), e o `perft` de cada variante
+ * é uma função própria, sem ponteiros de
+ * função no meio da recursão.
+ *
+ * Para uma variante nova, basta colocar
+ * a posição dela em `PerftPosition` e
+ * uma entrada em `perft_variants`.
+ */
+struct PerftVariant
+{
+    const char *name;
+    void (*create)(union PerftPosition *position, enum Actor starter);
+    bool (*is_legal)(const union PerftPosition *position, uint8_t move);
+    size_t (*moves)(const union PerftPosition *position, uint8_t moves[PERFT_MAX_MOVES]);
+    void (*play)(union PerftPosition *position, uint8_t move);
+    void (*perft)(const union PerftPosition *position, int depth, struct PerftCounts *counts);
+    /**
+     * Contagens conhecidas a partir da
+     * posição inicial com X começando.
+     */
+    const struct PerftCounts *expected;
+    int expected_len;
+};
+
+void classic_perft_create(union PerftPosition *position, enum Actor starter)
+{
+    position->classic = (struct ClassicBoard){.turn = starter};
+}
+
+bool classic_perft_is_legal(const union PerftPosition *position, uint8_t move)
+{
+    return position->classic.endgame == RUNNING
+        && move < 9 && ((classic_free_cells(&position->classic) >> move) & 1);
+}
+
+size_t classic_perft_moves(const union PerftPosition *position, uint8_t moves[PERFT_MAX_MOVES])
+{
+    if (position->classic.endgame != RUNNING)
+        return 0;
+
+    size_t len = 0;
+    MovePrint free_cells = classic_free_cells(&position->classic);
+    for (uint8_t cell = 0; cell < 9; cell++)
+        if ((free_cells >> cell) & 1)
+            moves[len++] = cell;
+    return len;
+}
+
+void classic_perft_play(union PerftPosition *position, uint8_t move)
+{
+    classic_play(&position->classic, move);
+}
+
+void classic_perft_run(const union PerftPosition *position, int depth, struct PerftCounts *counts)
+{
+    classic_perft(&position->classic, depth, counts);
+}
+
+void ultimate_perft_create(union PerftPosition *position, enum Actor starter)
+{
+    position->ultimate = create_ultimate_state(starter);
+}
+
+bool ultimate_perft_is_legal(const union PerftPosition *position, uint8_t move)
+{
+    return ultimate_is_legal(&position->ultimate, move);
+}
+
+size_t ultimate_perft_moves(const union PerftPosition *position, uint8_t moves[PERFT_MAX_MOVES])
+{
+    return ultimate_moves(&position->ultimate, moves);
+}
+
+void ultimate_perft_play(union PerftPosition *position, uint8_t move)
+{
+    ultimate_play(&position->ultimate, move);
+}
+
+void ultimate_perft_run(const union PerftPosition *position, int depth, struct PerftCounts *counts)
+{
+    ultimate_perft(&position->ultimate, depth, counts);
+}
+
+void qubic_perft_create(union PerftPosition *position, enum Actor starter)
+{
+    position->qubic = create_qubic_state(starter);
+}
+
+bool qubic_perft_is_legal(const union PerftPosition *position, uint8_t move)
+{
+    return qubic_is_legal(&position->qubic, move);
+}
+
+size_t qubic_perft_moves(const union PerftPosition *position, uint8_t moves[PERFT_MAX_MOVES])
+{
+    return qubic_moves(&position->qubic, moves);
+}
+
+void qubic_perft_play(union PerftPosition *position, uint8_t move)
+{
+    qubic_play(&position->qubic, move);
+}
+
+void qubic_perft_run(const union PerftPosition *position, int depth, struct PerftCounts *counts)
+{
+    qubic_perft(&position->qubic, depth, counts);
+}
+
+/**
+ * As variantes que o `--perft` conhece.
+ */
+const struct PerftVariant perft_variants[] =
+{
+    {
+        .name = "classico",
+        .create = classic_perft_create,
+        .is_legal = classic_perft_is_legal,
+        .moves = classic_perft_moves,
+        .play = classic_perft_play,
+        .perft = classic_perft_run,
+        .expected = classic_perft_expected,
+        .expected_len = sizeof(classic_perft_expected)/sizeof(struct PerftCounts),
+    },
+    {
+        .name = "supremo",
+        .create = ultimate_perft_create,
+        .is_legal = ultimate_perft_is_legal,
+        .moves = ultimate_perft_moves,
+        .play = ultimate_perft_play,
+        .perft = ultimate_perft_run,
+        .expected = ultimate_perft_expected,
+        .expected_len = sizeof(ultimate_perft_expected)/sizeof(struct PerftCounts),
+    },
+    {
+        .name = "qubic",
+        .create = qubic_perft_create,
+        .is_legal = qubic_perft_is_legal,
+        .moves = qubic_perft_moves,
+        .play = qubic_perft_play,
+        .perft = qubic_perft_run,
+        .expected = qubic_perft_expected,
+        .expected_len = sizeof(qubic_perft_expected)/sizeof(struct PerftCounts),
+    },
+};
+
+/**
+ * Procura uma variante pelo nome.
+ */
+const struct PerftVariant *find_perft_variant(const char *name)
+{
+    for (size_t i = 0; i < sizeof(perft_variants)/sizeof(struct PerftVariant); i++)
+        if (!strcmp(perft_variants[i].name, name))
+            return &perft_variants[i];
+    return NULL;
+}
+
+/**
+ * Monta a posição a partir de um texto
+ * como `o:4,0,8`: quem começa (opcional,
+ * X por padrão) e as jogadas feitas,
+ * separadas por vírgula ou espaço.
+ *
+ * Retorna `false` se alguma jogada não
+ * for possível.
+ */
+bool setup_perft_position(const struct PerftVariant *variant, union PerftPosition *position, const char *text)
+{
+    enum Actor starter = X_ACTOR;
+    if (text != NULL && (text[0] == 'x' || text[0] == 'o') && text[1] == ':')
+    {
+        starter = (text[0] == 'x') ? X_ACTOR : O_ACTOR;
+        text += 2;
+    }
+    variant->create(position, starter);
+
+    while (text != NULL && *text != 0)
+    {
+        if (*text == ',' || *text == ' ')
+        {
+            text++;
+            continue;
+        }
+
+        char *end = NULL;
+        unsigned long move = strtoul(text, &end, 10);
+        if (end == text || move >= PERFT_MAX_MOVES || !variant->is_legal(position, move))
+            return false;
+        variant->play(position, move);
+        text = end;
+    }
+    return true;
+}
+
+/**
+ * O trabalho de um perft dividido na raiz:
+ * cada jogada da raiz é uma tarefa, e as
+ * threads pegam a próxima tarefa livre
+ * com um contador atômico.
+ */
+struct PerftJob
+{
+    const struct PerftVariant *variant;
+    union PerftPosition root;
+    int depth;
+    uint8_t moves[PERFT_MAX_MOVES];
+    size_t len;
+    /**
+     * Contagens de cada jogada da raiz, cada
+     * uma escrita por uma thread só.
+     */
+    struct PerftCounts counts[PERFT_MAX_MOVES];
+    volatile uint32_t next;
+};
+
+/**
+ * O que cada thread do perft faz.
+ */
+void perft_worker(void *a)
+{
+    struct PerftJob *job = a;
+    uint32_t i;
+    while ((i = atomic_fetch_add_u32(&job->next, 1)) < job->len)
+    {
+        union PerftPosition next = job->root;
+        job->variant->play(&next, job->moves[i]);
+        job->variant->perft(&next, job->depth - 1, &job->counts[i]);
+    }
+}
+
+/**
+ * Roda o perft de `job->root` até `job->depth`
+ * com até `threads` threads e retorna a soma.
+ *
+ * Depois, `job->counts` tem as contagens de
+ * cada jogada da raiz (o "divide").
+ */
+struct PerftCounts run_perft_job(struct PerftJob *job, unsigned int threads)
+{
+    struct PerftCounts total = {0};
+
+    job->len = (job->depth > 0) ? job->variant->moves(&job->root, job->moves) : 0;
+    job->next = 0;
+    memset(job->counts, 0, sizeof(job->counts));
+
+    if (job->len == 0)
+    {
+        job->variant->perft(&job->root, job->depth, &total);
+        return total;
+    }
+
+    if (threads > job->len)
+        threads = job->len;
+
+    // A thread atual também trabalha.
+    struct WorkerThread *workers = calloc(threads, sizeof(struct WorkerThread));
+    unsigned int started = 0;
+    while (workers != NULL && started + 1 < threads && start_worker_thread(&workers[started], perft_worker, job))
+        started++;
+    perft_worker(job);
+    for (unsigned int i = 0; i < started; i++)
+        join_worker_thread(&workers[i]);
+    free(workers);
+
+    for (size_t i = 0; i < job->len; i++)
+    {
+        total.nodes += job->counts[i].nodes;
+        total.x_wins += job->counts[i].x_wins;
+        total.o_wins += job->counts[i].o_wins;
+        total.draws += job->counts[i].draws;
+    }
+    return total;
+}
+
+/**
+ * Conjunto de posições usadas
+ * nos benchmarks: todas as posições
+ * alcançáveis numa partida que X começa
+ * (o lado do O é simétrico).
+ */
+struct BenchCorpus
+{
+    struct GameState *positions;
+    size_t len;
+    /**
+     * As posições que ainda não
+     * terminaram (onde uma IA pode jogar).
+     */
+    struct GameState *running;
+    size_t running_len;
+};
+
+/**
+ * Visita todas as posições alcançáveis a
+ * partir de `state`, guardando cada uma
+ * uma única vez (`seen` é indexado por
+ * `x * 512 + o`).
+ */
+void collect_bench_positions(struct BenchCorpus *corpus, struct GameState *state, uint8_t *seen)
+{
+    struct BoardSnapshot snapshot = state->snapshots[state->record.len];
+    size_t key = ((size_t)snapshot.x << 9) | snapshot.o;
+    if (seen[key / 8] & (1 << (key % 8)))
+        return;
+    seen[key / 8] |= 1 << (key % 8);
+
+    corpus->positions[corpus->len++] = *state;
+
+    bool finished = test_move_print_winner(snapshot.x)
+        || test_move_print_winner(snapshot.o)
+        || state->moves == 9;
+    if (finished)
+        return;
+
+    corpus->running[corpus->running_len++] = *state;
+
+    for (int i = 0; i < 9; i++)
+    {
+        struct GameState next = *state;
+        if (play_game_move(&next, vec2(i % 3, i / 3)))
+            collect_bench_positions(corpus, &next, seen);
+    }
+}
+
+/**
+ * Monta o conjunto de posições.
+ * (Existem 5478 posições alcançáveis.)
+ */
+void build_bench_corpus(struct BenchCorpus *corpus)
+{
+    corpus->positions = malloc(6000 * sizeof(struct GameState));
+    corpus->running = malloc(6000 * sizeof(struct GameState));
+    corpus->len = 0;
+    corpus->running_len = 0;
+
+    uint8_t *seen = calloc((512 * 512) / 8, 1);
+    struct GameState start = { .turn = X_ACTOR, .record.starter = X_ACTOR };
+    collect_bench_positions(corpus, &start, seen);
+    free(seen);
+}
+
+/**
+ * Libera o conjunto de posições.
+ */
+void free_bench_corpus(struct BenchCorpus *corpus)
+{
+    free(corpus->positions);
+    free(corpus->running);
+    *corpus = (struct BenchCorpus){0};
+}
+
+/**
+ * Os resultados dos benchmarks vão
+ * parar aqui, para o compilador não
+ * jogar fora o trabalho "inútil".
+ */
+volatile uint64_t bench_sink = 0;
+
+/**
+ * Lê o contador de ciclos da CPU
+ * (o `rdtsc` dos processadores x86).
+ *
+ * Retorna sempre `0` nas outras arquiteturas.
+ *
+ * NOTA: o `rdtsc` conta ciclos numa frequência
+ * fixa, que pode não ser a frequência real
+ * do processador naquele momento.
+ */
+static inline uint64_t cpu_cycles()
+{
+#if defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86))
+    return __rdtsc();
+#elif (defined (__GNUC__) || defined (__clang__)) && (defined (__x86_64__) || defined (__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Benchmark de `get_move_print_triplet`.
+ */
+size_t bench_get_move_print_triplet(struct BenchCorpus *corpus)
+{
+    uint64_t sink = 0;
+    for (size_t i = 0; i < corpus->len; i++)
+    {
+        struct MovePrintTriplet triplet = get_move_print_triplet(corpus->positions[i].board);
+        sink += triplet.free ^ triplet.x ^ triplet.o;
+    }
+    bench_sink += sink;
+    return corpus->len;
+}
+
+/**
+ * Benchmark de `move_print_count`.
+ */
+size_t bench_move_print_count(struct BenchCorpus *corpus)
+{
+    uint64_t sink = 0;
+    for (size_t i = 0; i < corpus->len; i++)
+    {
+        struct BoardSnapshot snapshot = corpus->positions[i].snapshots[corpus->positions[i].record.len];
+        sink += move_print_count(snapshot.x) + move_print_count(snapshot.o);
+    }
+    bench_sink += sink;
+    return corpus->len * 2;
+}
+
+/**
+ * Benchmark de `move_print_coords`.
+ */
+size_t bench_move_print_coords(struct BenchCorpus *corpus)
+{
+    uint64_t sink = 0;
+    for (size_t i = 0; i < corpus->len; i++)
+    {
+        struct BoardSnapshot snapshot = corpus->positions[i].snapshots[corpus->positions[i].record.len];
+        struct Vec2 coords[9];
+        move_print_coords(snapshot.x | snapshot.o, coords);
+        sink += coords[0].x + coords[0].y;
+    }
+    bench_sink += sink;
+    return corpus->len;
+}
+
+/**
+ * Benchmark de `test_move_print_winner`.
+ */
+size_t bench_test_move_print_winner(struct BenchCorpus *corpus)
+{
+    uint64_t sink = 0;
+    for (size_t i = 0; i < corpus->len; i++)
+    {
+        struct BoardSnapshot snapshot = corpus->positions[i].snapshots[corpus->positions[i].record.len];
+        sink += test_move_print_winner(snapshot.x) + test_move_print_winner(snapshot.o);
+    }
+    bench_sink += sink;
+    return corpus->len * 2;
+}
+
+/**
+ * Benchmark de `process_game_state`.
+ */
+size_t bench_process_game_state(struct BenchCorpus *corpus)
+{
+    uint64_t sink = 0;
+    for (size_t i = 0; i < corpus->len; i++)
+    {
+        struct GameState *state = &corpus->positions[i];
+        state->endgame = RUNNING;
+        process_game_state(state);
+        sink += state->endgame;
+    }
+    bench_sink += sink;
+    return corpus->len;
+}
+
+/**
+ * Executa um cortex em todas as
+ * posições que ainda não terminaram.
+ */
+size_t bench_ai_cortex(struct BenchCorpus *corpus, AIBrainCortex cortex)
+{
+    uint64_t sink = 0;
+    for (size_t i = 0; i < corpus->running_len; i++)
+    {
+        struct AIBrain brain = create_ai_brain(&corpus->running[i], cortex);
+        ai_think(&brain);
+        sink += brain.goal.x + brain.goal.y;
+    }
+    bench_sink += sink;
+    return corpus->running_len;
+}
+
+/**
+ * Benchmark de `dumb_ai_cortex`.
+ */
+size_t bench_dumb_ai_cortex(struct BenchCorpus *corpus)
+{
+    return bench_ai_cortex(corpus, dumb_ai_cortex);
+}
+
+/**
+ * Benchmark de `avarage_ai_cortex`.
+ */
+size_t bench_avarage_ai_cortex(struct BenchCorpus *corpus)
+{
+    return bench_ai_cortex(corpus, avarage_ai_cortex);
+}
+
+/**
+ * Um benchmark: executa uma operação
+ * sobre o conjunto de posições e retorna
+ * quantas operações foram feitas.
+ */
+struct BenchCase
+{
+    const char *name;
+    size_t (*run)(struct BenchCorpus *corpus);
+};
+
+/**
+ * Todos os benchmarks.
+ */
+const struct BenchCase bench_cases[] = {
+    {"get_move_print_triplet", bench_get_move_print_triplet},
+    {"move_print_count", bench_move_print_count},
+    {"move_print_coords", bench_move_print_coords},
+    {"test_move_print_winner", bench_test_move_print_winner},
+    {"process_game_state", bench_process_game_state},
+    {"dumb_ai_cortex", bench_dumb_ai_cortex},
+    {"avarage_ai_cortex", bench_avarage_ai_cortex},
+};
+
+/// Quantas vezes cada benchmark é repetido.
+#define BENCH_REPETITIONS 101
+/// Tempo mínimo de cada repetição.
+#define BENCH_MIN_REPETITION_NS 200000
+
+/**
+ * Resultado de um benchmark.
+ */
+struct BenchResult
+{
+    const char *name;
+    size_t ops_per_repetition;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    double median_cycles;
+    double p99_cycles;
+};
+
+/**
+ * Comparação para o `qsort`.
+ */
+int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Executa um benchmark: aquece, descobre
+ * quantas passadas cabem em uma repetição,
+ * e então mede `BENCH_REPETITIONS` repetições.
+ */
+struct BenchResult run_bench_case(const struct BenchCase *bench, struct BenchCorpus *corpus)
+{
+    // Aquecimento, que também serve para
+    // descobrir quantas passadas fazer.
+    size_t passes = 0;
+    size_t ops = 0;
+    uint64_t start = monotonic_ns();
+    do
+    {
+        ops += bench->run(corpus);
+        passes++;
+    }
+    while (monotonic_ns() - start < BENCH_MIN_REPETITION_NS);
+
+    double ns_per_op[BENCH_REPETITIONS];
+    double cycles_per_op[BENCH_REPETITIONS];
+
+    for (int r = 0; r < BENCH_REPETITIONS; r++)
+    {
+        ops = 0;
+        uint64_t cycles = cpu_cycles();
+        uint64_t ns = monotonic_ns();
+        for (size_t p = 0; p < passes; p++)
+            ops += bench->run(corpus);
+        ns = monotonic_ns() - ns;
+        cycles = cpu_cycles() - cycles;
+
+        ns_per_op[r] = (double)ns / ops;
+        cycles_per_op[r] = (double)cycles / ops;
+    }
+
+    qsort(ns_per_op, BENCH_REPETITIONS, sizeof(double), compare_doubles);
+    qsort(cycles_per_op, BENCH_REPETITIONS, sizeof(double), compare_doubles);
+
+    size_t p99 = ((BENCH_REPETITIONS * 99) + 99) / 100 - 1;
+    return (struct BenchResult)
+    {
+        .name = bench->name,
+        .ops_per_repetition = ops,
+        .median_ns = ns_per_op[BENCH_REPETITIONS / 2],
+        .p99_ns = ns_per_op[p99],
+        .min_ns = ns_per_op[0],
+        .median_cycles = cycles_per_op[BENCH_REPETITIONS / 2],
+        .p99_cycles = cycles_per_op[p99],
+    };
+}
+
+/**
+ * Escreve os resultados em JSON, para
+ * comparar versões diferentes do programa.
+ */
+void write_bench_json(FILE *out, const struct BenchResult results[], size_t n, size_t corpus_len)
+{
+    fprintf(out, "{\n");
+#if defined (__VERSION__)
+    fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+    fprintf(out, "  \"corpus_positions\": %zu,\n", corpus_len);
+    fprintf(out, "  \"repetitions\": %d,\n", BENCH_REPETITIONS);
+    fprintf(out, "  \"has_cycles\": %s,\n", cpu_cycles() != 0 ? "true" : "false");
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < n; i++)
+    {
+        const struct BenchResult *r = &results[i];
+        fprintf(out,
+            "    {\"name\": \"%s\", \"ops_per_repetition\": %zu, "
+            "\"ns_per_op\": {\"median\": %.3f, \"p99\": %.3f, \"min\": %.3f}, "
+            "\"cycles_per_op\": {\"median\": %.1f, \"p99\": %.1f}}%s\n",
+            r->name, r->ops_per_repetition,
+            r->median_ns, r->p99_ns, r->min_ns,
+            r->median_cycles, r->p99_cycles,
+            (i + 1 < n) ? "," : ""
+        );
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+/**
+ * Busca completa (negamax) que copia o
+ * estado inteiro a cada jogada.
+ *
+ * Retorna 1 se quem joga ganha, 0 para
+ * velha e -1 se perde.
+ */
+int bench_search_copy(const struct GameState *state, uint64_t *nodes)
+{
+    (*nodes)++;
+    if (state->endgame != RUNNING)
+        return (state->endgame == GAME_DRAW) ? 0 : -1;
+
+    int best = -2;
+    for (int i = 0; i < 9; i++)
+    {
+        struct GameState next = *state;
+        if (!play_game_move(&next, vec2(i % 3, i / 3)))
+            continue;
+        detect_game_endgame(&next);
+
+        int score = -bench_search_copy(&next, nodes);
+        if (score > best)
+            best = score;
+    }
+    return best;
+}
+
+/**
+ * A mesma busca, mas fazendo e desfazendo
+ * as jogadas no mesmo estado.
+ */
+int bench_search_make(struct GameState *state, uint64_t *nodes)
+{
+    (*nodes)++;
+    if (state->endgame != RUNNING)
+        return (state->endgame == GAME_DRAW) ? 0 : -1;
+
+    int best = -2;
+    for (int i = 0; i < 9; i++)
+    {
+        struct GameUndo undo;
+        if (!make_game_move(state, vec2(i % 3, i / 3), &undo))
+            continue;
+        detect_game_endgame(state);
+
+        int score = -bench_search_make(state, nodes);
+        unmake_game_move(state, &undo);
+        if (score > best)
+            best = score;
+    }
+    return best;
+}
+
+/**
+ * Confere desfazer e refazer na interface com
+ * jogadas em células ocupadas no meio (o que
+ * já estragou o histórico): depois de cada
+ * ação, o estado precisa ser igual ao de fazer
+ * as jogadas do histórico do zero.
+ *
+ * Retorna `false` se algum estado não bater.
+ */
+bool bench_undo_redo()
+{
+    // O mesmo que o roteiro `cell 0 0`, `cell 1 1`,
+    // `undo`, `cell 0 0`, `redo`, `undo`, `undo`,
+    // `cell 2 2` (`-1` é desfazer e `-2` refazer).
+    const int actions[] = {0, 4, -1, 0, -2, -1, -1, 8, -2, 4, -1, -1, -2, -2, 4};
+    struct GameState state = { .turn = X_ACTOR };
+    process_game_state(&state);
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(actions)/sizeof(int) && ok; i++)
+    {
+        if (actions[i] == -1)
+            apply_game_input(&state, UNDO_INPUT);
+        else if (actions[i] == -2)
+            apply_game_input(&state, REDO_INPUT);
+        else
+        {
+            state.selection = vec2(actions[i] % 3, actions[i] / 3);
+            apply_game_input(&state, MOVE_INPUT);
+        }
+
+        struct GameState rebuilt = { .turn = X_ACTOR };
+        process_game_state(&rebuilt);
+        for (uint8_t j = 0; j < state.history_len; j++)
+            ok = ok && play_game_move(&rebuilt, vec2(state.history[j].cell % 3, state.history[j].cell / 3));
+
+        ok = ok && state.history_len <= state.redo_len
+            && state.moves == state.history_len
+            && state.record.len == state.history_len
+            && state.hash == rebuilt.hash
+            && memcmp(state.board, rebuilt.board, sizeof(GameBoard)) == 0
+            && memcmp(&state.x_lines, &rebuilt.x_lines, sizeof(struct LineCounters)) == 0
+            && memcmp(&state.o_lines, &rebuilt.o_lines, sizeof(struct LineCounters)) == 0;
+    }
+
+    printf("\n%-26s %s\n", "desfazer e refazer", ok ? "ok" : "ERRADO");
+    return ok;
+}
+
+/**
+ * Confere que `mnk_ai_search` para na hora com um
+ * pedido de parada ou um prazo já vencido, jogando
+ * a `best_move` e deixando o tabuleiro como estava.
+ *
+ * Retorna `false` se algo disso falhar.
+ */
+bool bench_ai_search_stop()
+{
+    struct GameState state = { .turn = X_ACTOR };
+    process_game_state(&state);
+    // X ganha em (2, 0), então uma busca que
+    // não parasse trocaria a `best_move`.
+    play_game_move(&state, vec2(0, 0));
+    play_game_move(&state, vec2(0, 1));
+    play_game_move(&state, vec2(1, 0));
+    play_game_move(&state, vec2(1, 1));
+
+    volatile sig_atomic_t cancel = 1;
+    struct AIBrain brains[2] =
+    {
+        create_ai_brain(&state, pattern_ai_cortex),
+        create_ai_brain(&state, pattern_ai_cortex),
+    };
+    brains[0].cancel = &cancel;
+    brains[1].deadline = 1;
+
+    bool ok = true;
+    for (int i = 0; i < 2; i++)
+    {
+        struct MnkBoard board = classic_to_mnk_board(&state);
+        struct PatternEvaluator patterns;
+        pattern_evaluator_reset(&patterns, &board);
+        struct MnkEvaluator evaluator =
+        {
+            .data = &patterns,
+            .make = pattern_evaluator_make,
+            .unmake = pattern_evaluator_unmake,
+            .evaluate = pattern_evaluator_evaluate,
+        };
+        struct MnkBoard before = board;
+        struct PatternEvaluator patterns_before = patterns;
+
+        brains[i].best_move = vec2(2, 2);
+        mnk_ai_search(&brains[i], &board, &evaluator, PATTERN_AI_DEPTH);
+
+        int cell = brains[i].goal.y * 3 + brains[i].goal.x;
+        ok = ok && brains[i].goal.x == 2 && brains[i].goal.y == 2
+            && !((state.x_lines.marks | state.o_lines.marks) & (1 << cell))
+            && board.x == before.x && board.o == before.o
+            && board.turn == before.turn && board.moves == before.moves
+            && board.endgame == before.endgame
+            && patterns.score == patterns_before.score
+            && memcmp(patterns.patterns, patterns_before.patterns, sizeof(patterns.patterns)) == 0;
+    }
+
+    printf("%-26s %s\n", "busca interrompida", ok ? "ok" : "ERRADO");
+    return ok;
+}
+
+/**
+ * Mede as avaliações por janelas e pela
+ * rede neural (com pesos sorteados) num 7x7
+ * com 4 em linha: do zero, jogada a jogada
+ * e numa busca alfa-beta.
+ *
+ * Retorna `false` se as duas não baterem.
+ */
+bool bench_mnk_evaluation()
+{
+    enum {MNK_BENCH_POSITIONS = 1024};
+    struct MnkGeometry *mnk = malloc(sizeof(struct MnkGeometry));
+    struct MnkBoard *boards = malloc(MNK_BENCH_POSITIONS * sizeof(struct MnkBoard));
+    struct PatternEvaluator *patterns = malloc(sizeof(struct PatternEvaluator));
+    struct NnueWeights *weights = malloc(sizeof(struct NnueWeights));
+    struct NnueEvaluator *network = malloc(sizeof(struct NnueEvaluator));
+    bool ok = mnk != NULL && boards != NULL && patterns != NULL && weights != NULL && network != NULL
+        && build_mnk_geometry(mnk, 7, 7, 4);
+    if (!ok)
+        goto FREE_ALL;
+
+    // Posições sorteadas (sempre as mesmas)
+    // com 8 a 31 jogadas, sem as já terminadas.
+    uint32_t seed = 43;
+    for (int i = 0; i < MNK_BENCH_POSITIONS; i++)
+    {
+        boards[i] = create_mnk_board(mnk, X_ACTOR);
+        int plies = 8 + (i % 24);
+        for (int p = 0; p < plies && boards[i].endgame == RUNNING; p++)
+        {
+            uint8_t moves[64];
+            size_t len = mnk_moves(&boards[i], moves);
+            seed = (seed * 1103515245u) + 12345u;
+            mnk_make(&boards[i], moves[(seed >> 16) % len]);
+        }
+        if (boards[i].endgame != RUNNING)
+            i--;
+    }
+    randomize_nnue_weights(weights, 7, 7, 4, 44);
+
+    struct MnkEvaluator evaluators[2] =
+    {
+        {
+            .data = patterns,
+            .make = pattern_evaluator_make,
+            .unmake = pattern_evaluator_unmake,
+            .evaluate = pattern_evaluator_evaluate,
+        },
+        {
+            .data = network,
+            .make = nnue_evaluator_make,
+            .unmake = nnue_evaluator_unmake,
+            .evaluate = nnue_evaluator_evaluate,
+        },
+    };
+    const char *names[2][3] =
+    {
+        {"padrões do zero", "padrões jogada a jogada", "padrões busca prof. 3"},
+        {"rede do zero", "rede jogada a jogada", "rede busca prof. 3"},
+    };
+
+    // "avaliação" e "avaliações" têm 2 letras
+    // de 2 bytes, por isso o 28 e os 14.
+    printf("\n%-28s %14s %12s %14s\n", "avaliação 7x7 (k 4)", "avaliações", "ns", "avaliações/s");
+
+    int64_t checksum = 0;
+    for (int e = 0; e < 2; e++)
+    {
+        const struct MnkEvaluator *evaluator = &evaluators[e];
+        uint64_t counts[3] = {0};
+        double seconds[3] = {0};
+
+        // Do zero: montar a avaliação e avaliar
+        // (os padrões usam os deslocamentos).
+        uint64_t start = monotonic_ns();
+        for (int r = 0; r < 64; r++)
+            for (int i = 0; i < MNK_BENCH_POSITIONS; i++, counts[0]++)
+            {
+                if (e == 0)
+                    checksum += mnk_evaluate_full(&boards[i]);
+                else
+                {
+                    nnue_evaluator_reset(network, weights, &boards[i]);
+                    checksum += nnue_evaluator_evaluate(network, boards[i].turn);
+                }
+            }
+        seconds[0] = (monotonic_ns() - start) / 1e9;
+
+        // Jogada a jogada: cada jogada possível de
+        // cada posição, feita, avaliada e desfeita.
+        start = monotonic_ns();
+        for (int i = 0; i < MNK_BENCH_POSITIONS; i++)
+        {
+            struct MnkBoard *board = &boards[i];
+            pattern_evaluator_reset(patterns, board);
+            nnue_evaluator_reset(network, weights, board);
+
+            uint8_t moves[64];
+            size_t len = mnk_moves(board, moves);
+            for (int r = 0; r < 4; r++)
+                for (size_t j = 0; j < len; j++, counts[1]++)
+                {
+                    enum Actor actor = board->turn;
+                    evaluator->make(evaluator->data, moves[j], actor);
+                    checksum += evaluator->evaluate(evaluator->data, X_ACTOR);
+                    evaluator->unmake(evaluator->data, moves[j], actor);
+                }
+        }
+        seconds[1] = (monotonic_ns() - start) / 1e9;
+
+        // A busca alfa-beta usando a avaliação.
+        start = monotonic_ns();
+        for (int i = 0; i < 16; i++)
+        {
+            pattern_evaluator_reset(patterns, &boards[i]);
+            nnue_evaluator_reset(network, weights, &boards[i]);
+            checksum += mnk_best_move(&boards[i], evaluator, 3, &counts[2], NULL);
+        }
+        seconds[2] = (monotonic_ns() - start) / 1e9;
+
+        for (int b = 0; b < 3; b++)
+        {
+            struct UStrLenRes len = ustrlen(names[e][b]);
+            printf("%-*s %12llu %12.2f %12.0f\n", (int)(26 + len.blen - len.ulen), names[e][b],
+                (unsigned long long)counts[b], seconds[b] * 1e9 / counts[b],
+                counts[b] / ((seconds[b] > 0) ? seconds[b] : 1e-9));
+        }
+    }
+
+    // A conferência fica fora da medição: jogada a
+    // jogada tem que dar o mesmo que do zero, e a
+    // rede com SIMD o mesmo que sem.
+    for (int i = 0; ok && i < MNK_BENCH_POSITIONS; i += 7)
+    {
+        struct MnkBoard *board = &boards[i];
+        pattern_evaluator_reset(patterns, board);
+        nnue_evaluator_reset(network, weights, board);
+        uint8_t moves[64];
+        size_t len = mnk_moves(board, moves);
+        for (size_t j = 0; ok && j < len; j++)
+        {
+            enum Actor actor = board->turn;
+            mnk_make(board, moves[j]);
+            pattern_evaluator_make(patterns, moves[j], actor);
+            nnue_evaluator_make(network, moves[j], actor);
+
+            struct NnueEvaluator fresh;
+            nnue_evaluator_reset(&fresh, weights, board);
+            ok = patterns->score == mnk_evaluate_full(board)
+                && !memcmp(fresh.accumulators, network->accumulators, sizeof(fresh.accumulators))
+                && nnue_forward(network, board->turn, false) == nnue_forward(network, board->turn, true);
+
+            nnue_evaluator_unmake(network, moves[j], actor);
+            pattern_evaluator_unmake(patterns, moves[j], actor);
+            mnk_unmake(board, moves[j]);
+        }
+    }
+    printf("rede neural com %s%s\n", NNUE_SIMD_NAME, ok ? "" : "  ERRADO");
+
+    // Só para o compilador não jogar as contas fora.
+    if (checksum == 42)
+        printf("\n");
+
+    FREE_ALL:;
+    free(mnk);
+    free(boards);
+    free(patterns);
+    free(weights);
+    free(network);
+    return ok;
+}
+
+/// Maior perft (em posições) rodado nos benchmarks.
+#define BENCH_PERFT_MAX_NODES 20000000ull
+
+/**
+ * Executa todos os benchmarks, mostra uma
+ * tabela e, se `--bench-json` for usado,
+ * grava os resultados em JSON.
+ */
+int bench_session()
+{
+    struct BenchCorpus corpus;
+    build_bench_corpus(&corpus);
+
+    const size_t n = sizeof(bench_cases)/sizeof(struct BenchCase);
+    struct BenchResult results[sizeof(bench_cases)/sizeof(struct BenchCase)];
+
+    printf("Posições: %zu (%zu em andamento)\n\n", corpus.len, corpus.running_len);
+    printf("%-26s %12s %12s %12s %12s\n", "benchmark", "mediana ns", "p99 ns", "menor ns", "ciclos");
+
+    for (size_t i = 0; i < n; i++)
+    {
+        results[i] = run_bench_case(&bench_cases[i], &corpus);
+        printf("%-26s %12.2f %12.2f %12.2f %12.1f\n",
+            results[i].name, results[i].median_ns, results[i].p99_ns,
+            results[i].min_ns, results[i].median_cycles);
+    }
+
+    int status = 0;
+
+    // Resolve todas as posições em andamento copiando o
+    // estado ou com make/unmake: as duas buscas precisam
+    // achar as mesmas pontuações e deixar o estado como estava.
+    printf("\n%-27s %14s %14s %14s\n", "busca no clássico", "posições", "ns/posição", "posições/s");
+    uint64_t search_nodes[2] = {0};
+    double search_seconds[2] = {0};
+    int64_t search_scores[2] = {0};
+    bool search_intact = true;
+    for (int method = 0; method < 2; method++)
+    {
+        uint64_t start = monotonic_ns();
+        for (size_t i = 0; i < corpus.running_len; i++)
+        {
+            struct GameState *state = &corpus.running[i];
+            if (method == 0)
+                search_scores[method] += bench_search_copy(state, &search_nodes[method]);
+            else
+            {
+                uint64_t hash = game_state_hash(state);
+                search_scores[method] += bench_search_make(state, &search_nodes[method]);
+                search_intact = search_intact && game_state_hash(state) == hash;
+            }
+        }
+        search_seconds[method] = (monotonic_ns() - start) / 1e9;
+    }
+    bool search_matches = search_intact && search_nodes[0] == search_nodes[1] && search_scores[0] == search_scores[1];
+    for (int method = 0; method < 2; method++)
+    {
+        // O `%-*s` conta bytes, então somamos os
+        // bytes a mais das letras acentuadas.
+        const char *name = (method == 0) ? "cópia do estado" : "make/unmake";
+        struct UStrLenRes len = ustrlen(name);
+        printf("%-*s %12llu %12.2f %12.0f%s\n", (int)(26 + len.blen - len.ulen), name,
+            (unsigned long long)search_nodes[method],
+            search_seconds[method] * 1e9 / search_nodes[method],
+            search_nodes[method] / ((search_seconds[method] > 0) ? search_seconds[method] : 1e-9),
+            (method == 1 && !search_matches) ? "  ERRADO" : "");
+    }
+    if (!search_matches)
+        status = 1;
+
+    // O perft de cada variante confere o gerador de
+    // jogadas e mede a vazão dele ao mesmo tempo,
+    // até as profundidades que passam de `BENCH_PERFT_MAX_NODES`.
+    // "posições" tem 2 letras de 2 bytes, por isso o 14.
+    for (size_t v = 0; v < sizeof(perft_variants)/sizeof(struct PerftVariant); v++)
+    {
+        const struct PerftVariant *variant = &perft_variants[v];
+        char title[32];
+        snprintf(title, sizeof(title), "perft %s", variant->name);
+        printf("\n%-26s %14s %12s %14s\n", title, "posições", "esperado", "posições/s");
+
+        union PerftPosition position;
+        variant->create(&position, X_ACTOR);
+        for (int depth = 1; depth <= variant->expected_len; depth++)
+        {
+            uint64_t expected = variant->expected[depth - 1].nodes;
+            if (expected > BENCH_PERFT_MAX_NODES)
+                break;
+
+            struct PerftCounts counts = {0};
+            uint64_t start = monotonic_ns();
+            variant->perft(&position, depth, &counts);
+            double seconds = (monotonic_ns() - start) / 1e9;
+
+            char name[32];
+            snprintf(name, sizeof(name), "profundidade %d", depth);
+            printf("%-26s %12llu %12llu %12.0f%s\n", name,
+                (unsigned long long)counts.nodes, (unsigned long long)expected,
+                counts.nodes / ((seconds > 0) ? seconds : 1e-9),
+                (counts.nodes == expected) ? "" : "  ERRADO");
+            if (counts.nodes != expected)
+                status = 1;
+        }
+    }
+
+    // A busca alfa-beta do Qubic a partir de
+    // algumas aberturas, medindo posições/s.
+    printf("\n%-26s %14s %12s %14s\n", "busca do qubic", "posições", "ms", "posições/s");
+    const uint8_t qubic_openings[][4] = {{0, 21, 63, 42}, {5, 6, 9, 10}, {21, 22, 37, 38}};
+    for (int depth = 3; depth <= 4; depth++)
+    {
+        uint64_t nodes = 0;
+        uint64_t start = monotonic_ns();
+        for (size_t i = 0; i < sizeof(qubic_openings)/sizeof(qubic_openings[0]); i++)
+        {
+            struct QubicState qubic = create_qubic_state(X_ACTOR);
+            for (int j = 0; j < 4; j++)
+                qubic_play(&qubic, qubic_openings[i][j]);
+            qubic_best_move(&qubic, depth, &nodes);
+        }
+        double seconds = (monotonic_ns() - start) / 1e9;
+
+        char name[32];
+        snprintf(name, sizeof(name), "profundidade %d", depth);
+        printf("%-26s %12llu %12.1f %12.0f\n", name, (unsigned long long)nodes,
+            seconds * 1000, nodes / ((seconds > 0) ? seconds : 1e-9));
+    }
+
+    if (!bench_undo_redo())
+        status = 1;
+    if (!bench_ai_search_stop())
+        status = 1;
+    if (!bench_mnk_evaluation())
+        status = 1;
+
+    if (program_options.bench_json_path != NULL)
+    {
+        FILE *json = fopen(program_options.bench_json_path, "w");
+        if (json != NULL)
+        {
+            write_bench_json(json, results, n, corpus.len);
+            fclose(json);
+        }
+        else
+        {
+            perror(program_options.bench_json_path);
+            status = 1;
+        }
+    }
+
+    free_bench_corpus(&corpus);
+    return status;
+}
+
+/**
+ * Um cenário do benchmark de desenho:
+ * um conjunto de estados que são
+ * desenhados um atrás do outro.
+ */
+struct RenderBenchScenario
+{
+    const char *name;
+    struct GameState *states;
+    size_t len;
+    /**
+     * Se os finais de jogo são animados.
+     */
+    bool animate;
+};
+
+/**
+ * Resultado de um cenário em um destino.
+ */
+struct RenderBenchResult
+{
+    const char *scenario;
+    const char *sink;
+    uint64_t frames;
+    double frames_per_second;
+    double bytes_per_frame;
+    double writes_per_frame;
+};
+
+/// Tempo mínimo medido em cada cenário.
+#define RENDER_BENCH_MIN_NS 300000000ull
+
+/**
+ * Desenha os estados do cenário até passar
+ * `RENDER_BENCH_MIN_NS`, contando bytes e
+ * escritas no destino atual do terminal.
+ */
+struct RenderBenchResult run_render_bench(const struct RenderBenchScenario *scenario, const char *sink_name)
+{
+    uint64_t frames = 0;
+    uint64_t bytes = terminal_sink.bytes;
+    uint64_t writes = terminal_sink.writes;
+    uint64_t start = monotonic_ns();
+    uint64_t elapsed = 0;
+
+    do
+    {
+        for (size_t i = 0; i < scenario->len; i++)
+        {
+            // O desenho não muda o estado, mas
+            // a cópia garante isso para a medição.
+            struct GameState state = scenario->states[i];
+            render_game(&state, scenario->animate);
+        }
+        frames += scenario->len;
+        elapsed = monotonic_ns() - start;
+    }
+    while (elapsed < RENDER_BENCH_MIN_NS);
+
+    return (struct RenderBenchResult)
+    {
+        .scenario = scenario->name,
+        .sink = sink_name,
+        .frames = frames,
+        .frames_per_second = frames / (elapsed / 1e9),
+        .bytes_per_frame = (double)(terminal_sink.bytes - bytes) / frames,
+        .writes_per_frame = (double)(terminal_sink.writes - writes) / frames,
+    };
+}
+
+/**
+ * Benchmark do desenho do jogo.
+ *
+ * Desenha milhares de quadros de estados
+ * representativos (jogo em andamento, animação
+ * de velha e de vitória, sem as esperas) em
+ * dois destinos: só na memória (o custo de montar
+ * o quadro) e no "/dev/null" sem buffer (somando
+ * o custo das chamadas ao sistema).
+ */
+int render_bench_session()
+{
+    struct BenchCorpus corpus;
+    build_bench_corpus(&corpus);
+
+    // Separando as posições pelo jeito que terminam.
+    struct GameState *draws = malloc(corpus.len * sizeof(struct GameState));
+    struct GameState *victories = malloc(corpus.len * sizeof(struct GameState));
+    size_t draws_len = 0;
+    size_t victories_len = 0;
+
+    for (size_t i = 0; i < corpus.len; i++)
+    {
+        struct GameState state = corpus.positions[i];
+        state.endgame = RUNNING;
+        process_game_state(&state);
+        if (state.endgame == GAME_DRAW)
+            draws[draws_len++] = state;
+        else if (state.endgame != RUNNING)
+            victories[victories_len++] = state;
+    }
+
+    // A seleção muda a cada quadro, como se alguém
+    // estivesse andando pelo tabuleiro.
+    for (size_t i = 0; i < corpus.running_len; i++)
+        corpus.running[i].selection = vec2(i % 3, (i / 3) % 3);
+
+    const struct RenderBenchScenario scenarios[] = {
+        {"em andamento", corpus.running, corpus.running_len, false},
+        {"velha (animada)", draws, draws_len, true},
+        {"vitória (animada)", victories, victories_len, true},
+        {"final (redesenho)", victories, victories_len, false},
+    };
+    const size_t n = sizeof(scenarios)/sizeof(struct RenderBenchScenario);
+
+    struct RenderBenchResult results[2 * sizeof(scenarios)/sizeof(struct RenderBenchScenario)];
+    size_t results_len = 0;
+
+#if defined (_WIN32)
+    FILE *null_device = fopen("NUL", "wb");
+#else
+    FILE *null_device = fopen("/dev/null", "wb");
+#endif
+    if (null_device != NULL)
+        setvbuf(null_device, NULL, _IONBF, 0);
+
+    // Sem esperas e com um tamanho de terminal
+    // fixo, para os números serem comparáveis.
+    bool no_delay = program_options.no_delay;
+    program_options.no_delay = true;
+    display_size_override = vec2(80, 24);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        terminal_sink = (struct TerminalSink){ .discard = true };
+        results[results_len++] = run_render_bench(&scenarios[i], "memória");
+
+        if (null_device != NULL)
+        {
+            terminal_sink = (struct TerminalSink){ .file = null_device };
+            results[results_len++] = run_render_bench(&scenarios[i], "null");
+        }
+    }
+
+    terminal_sink = (struct TerminalSink){0};
+    display_size_override = vec2(0, 0);
+    program_options.no_delay = no_delay;
+    if (null_device != NULL)
+        fclose(null_device);
+
+    printf("%s%*s %-8s %10s %12s %12s %12s\n",
+        "cenário", 13, "", "destino", "quadros", "quadros/s", "bytes/quadro", "escritas/q.");
+    for (size_t i = 0; i < results_len; i++)
+        // O `printf` conta bytes e não letras, então
+        // completamos o nome do cenário na mão.
+        printf("%s%*s %-8s %10llu %12.0f %12.1f %12.1f\n",
+            results[i].scenario, (int)(20 - ustrlen(results[i].scenario).ulen), "", results[i].sink,
+            (unsigned long long)results[i].frames, results[i].frames_per_second,
+            results[i].bytes_per_frame, results[i].writes_per_frame);
+
+    int status = 0;
+    if (program_options.bench_json_path != NULL)
+    {
+        FILE *json = fopen(program_options.bench_json_path, "w");
+        if (json != NULL)
+        {
+            fprintf(json, "{\n  \"render_benchmarks\": [\n");
+            for (size_t i = 0; i < results_len; i++)
+                fprintf(json,
+                    "    {\"scenario\": \"%s\", \"sink\": \"%s\", \"frames\": %llu, "
+                    "\"frames_per_second\": %.1f, \"bytes_per_frame\": %.2f, \"writes_per_frame\": %.2f}%s\n",
+                    results[i].scenario, results[i].sink, (unsigned long long)results[i].frames,
+                    results[i].frames_per_second, results[i].bytes_per_frame, results[i].writes_per_frame,
+                    (i + 1 < results_len) ? "," : "");
+            fprintf(json, "  ]\n}\n");
+            fclose(json);
+        }
+        else
+        {
+            perror(program_options.bench_json_path);
+            status = 1;
+        }
+    }
+
+    free(draws);
+    free(victories);
+    free_bench_corpus(&corpus);
+    return status;
+}
+
+/**
+ * Mostra como usar o programa.
+ */
+void print_usage(const char *program)
+{
+    fprintf(stderr,
+        "Uso: %s [opções]\n"
+        "\n"
+        "Opções:\n"
+        "  --seed N         Usa N como semente fixa do gerador aleatório\n"
+        "  --script ARQ     Joga uma partida seguindo o roteiro ARQ (`-` = entrada padrão)\n"
+        "  --no-delay       Desliga todas as esperas e animações lentas\n"
+        "  --stats          Começa com o painel de estatísticas ligado (tecla T)\n"
+        "  --selfplay N     Joga N partidas entre IAs, sem interface\n"
+        "  --x-ai NOME      Cortex do X nas partidas sem interface (dumb, avarage, pattern, nnue, rl, engine:COMANDO)\n"
+        "  --o-ai NOME      Cortex do O nas partidas sem interface (dumb, avarage, pattern, nnue, rl, engine:COMANDO)\n"
+        "  --move-ms N      Tempo por jogada dos motores externos (padrão 1000)\n"
+        "  --think-ms N     Limite de tempo por jogada das IAs (padrão: sem limite)\n"
+        "  --engine NOME    Vira um motor externo usando o cortex NOME\n"
+        "  --record ARQ     Grava as partidas sem interface em ARQ\n"
+        "  --block-games N  Partidas por bloco do arquivo gravado\n"
+        "  --read-records ARQ  Lê um arquivo de partidas e mostra um resumo\n"
+        "  --replay ARQ     Revê uma partida de um arquivo de partidas\n"
+        "  --game N         Com --read-records ou --replay, escolhe a partida N\n"
+        "  --bench          Executa os benchmarks\n"
+        "  --bench-render   Executa o benchmark de desenho da interface\n"
+        "  --bench-json ARQ Grava os resultados dos benchmarks em JSON\n"
+        "  --trace ARQ      Grava a linha do tempo dos eventos em ARQ ao sair (Perfetto)\n"
+        "  --server SOCK    Hospeda partidas em rede no socket Unix SOCK (aceita --record)\n"
+        "  --server-ai NOME Com --server, quem entra joga contra o cortex NOME\n"
+        "  --client SOCK    Joga uma partida em rede pelo servidor em SOCK\n"
+        "  --loadgen SOCK   Gera carga no servidor em SOCK e mede a vazão\n"
+        "  --connections N  Conexões do gerador de carga (padrão 1000)\n"
+        "  --matches N      Partidas jogadas pelo gerador de carga (padrão 100000)\n"
+        "  --perft N        Conta as posições e os finais de jogo a N jogadas\n"
+        "  --variant NOME   Variante do perft (classico, supremo, qubic)\n"
+        "  --position POS   Posição do perft, como `o:4,0,8` (quem começa e as jogadas)\n"
+        "  --threads N      Threads do perft e do treino (padrão: uma por processador)\n"
+        "  --nnue ARQ       Pesos da rede neural do cortex nnue\n"
+        "  --train ARQ      Treina os pesos da rede neural e grava em ARQ\n"
+        "  --dataset ARQ    Posições do treino (padrão: ARQ.data, gerado se não existir)\n"
+        "  --positions N    Posições geradas para o treino (padrão 200000)\n"
+        "  --epochs N       Épocas do treino (padrão 30)\n"
+        "  --board M,N,K    Tabuleiro do treino (padrão 3,3,3)\n"
+        "  --rl-train ARQ   Treina a tabela do cortex rl e grava em ARQ\n"
+        "  --rl-games N     Partidas do treino da tabela (padrão 200000)\n"
+        "  --rl-table ARQ   Tabela aprendida do cortex rl\n"
+        "  --sprt NOME      Testa (SPRT) se o cortex NOME é mais forte que o --baseline\n"
+        "  --baseline NOME  Cortex de comparação do SPRT (padrão avarage)\n"
+        "  --elo0 E --elo1 E  Hipóteses do SPRT em Elo (padrão 0 e 10)\n"
+        "  --alpha P --beta P  Chances de erro do SPRT (padrão 0.05)\n"
+        "  --max-games N    Limite de partidas do SPRT (padrão 100000)\n"
+        "  --tournament N   Torneio todos contra todos, N partidas por par (aceita --record)\n"
+        "  --players A,B,C  Cortexes do torneio (e nomes dos jogadores de --ratings)\n"
+        "  --ratings ARQ    Classifica (Elo) os jogadores de um arquivo de partidas\n"
+        "  --crowd N        Joga N partidas entre IAs ao mesmo tempo em uma thread\n",
+        program
+    );
+}
+
+/**
+ * Lê as opções da linha de comando
+ * para dentro de `program_options`.
+ *
+ * Retorna `false` se alguma opção for inválida.
+ */
+bool parse_program_options(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool has_value = (i + 1) < argc;
+
+        if (!strcmp(arg, "--no-delay"))
+            program_options.no_delay = true;
+        else if (!strcmp(arg, "--stats"))
+            program_options.stats = true;
+        else if (!strcmp(arg, "--seed") && has_value)
+        {
+            char *end = NULL;
+            program_options.seed = strtoul(argv[++i], &end, 10);
+            program_options.has_seed = *end == 0;
+            if (!program_options.has_seed)
+                return false;
+        }
+        else if (!strcmp(arg, "--script") && has_value)
+        {
+            program_options.script_path = argv[++i];
+            program_options.unattended = true;
+        }
+        else if (!strcmp(arg, "--selfplay") && has_value)
+        {
+            char *end = NULL;
+            program_options.selfplay_games = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--x-ai") && has_value)
+            program_options.x_ai = argv[++i];
+        else if (!strcmp(arg, "--o-ai") && has_value)
+            program_options.o_ai = argv[++i];
+        else if (!strcmp(arg, "--record") && has_value)
+            program_options.record_path = argv[++i];
+        else if (!strcmp(arg, "--block-games") && has_value)
+        {
+            char *end = NULL;
+            program_options.record_block_games = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--read-records") && has_value)
+            program_options.read_records_path = argv[++i];
+        else if (!strcmp(arg, "--replay") && has_value)
+            program_options.replay_path = argv[++i];
+        else if (!strcmp(arg, "--bench"))
+            program_options.bench = true;
+        else if (!strcmp(arg, "--bench-render"))
+            program_options.bench_render = true;
+        else if (!strcmp(arg, "--bench-json") && has_value)
+            program_options.bench_json_path = argv[++i];
+        else if (!strcmp(arg, "--trace") && has_value)
+            program_options.trace_path = argv[++i];
+        else if (!strcmp(arg, "--move-ms") && has_value)
+        {
+            char *end = NULL;
+            program_options.move_ms = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--think-ms") && has_value)
+        {
+            char *end = NULL;
+            program_options.think_ms = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--engine") && has_value)
+            program_options.engine_cortex = argv[++i];
+        else if (!strcmp(arg, "--server") && has_value)
+            program_options.server_path = argv[++i];
+        else if (!strcmp(arg, "--client") && has_value)
+            program_options.client_path = argv[++i];
+        else if (!strcmp(arg, "--loadgen") && has_value)
+            program_options.loadgen_path = argv[++i];
+        else if (!strcmp(arg, "--connections") && has_value)
+        {
+            char *end = NULL;
+            program_options.loadgen_connections = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--matches") && has_value)
+        {
+            char *end = NULL;
+            program_options.loadgen_matches = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--perft") && has_value)
+        {
+            char *end = NULL;
+            program_options.perft_depth = strtoul(argv[++i], &end, 10);
+            if (*end != 0 || program_options.perft_depth == 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--nnue") && has_value)
+            program_options.nnue_path = argv[++i];
+        else if (!strcmp(arg, "--train") && has_value)
+            program_options.train_path = argv[++i];
+        else if (!strcmp(arg, "--dataset") && has_value)
+            program_options.dataset_path = argv[++i];
+        else if (!strcmp(arg, "--positions") && has_value)
+        {
+            char *end = NULL;
+            program_options.train_positions = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--epochs") && has_value)
+        {
+            char *end = NULL;
+            program_options.epochs = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--board") && has_value)
+            program_options.board = argv[++i];
+        else if (!strcmp(arg, "--rl-train") && has_value)
+            program_options.rl_train_path = argv[++i];
+        else if (!strcmp(arg, "--rl-games") && has_value)
+        {
+            char *end = NULL;
+            program_options.rl_games = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--rl-table") && has_value)
+            program_options.rl_table_path = argv[++i];
+        else if (!strcmp(arg, "--sprt") && has_value)
+            program_options.sprt_candidate = argv[++i];
+        else if (!strcmp(arg, "--baseline") && has_value)
+            program_options.sprt_baseline = argv[++i];
+        else if ((!strcmp(arg, "--elo0") || !strcmp(arg, "--elo1") || !strcmp(arg, "--alpha") || !strcmp(arg, "--beta")) && has_value)
+        {
+            char *end = NULL;
+            double value = strtod(argv[++i], &end);
+            if (*end != 0)
+                return false;
+            if (!strcmp(arg, "--elo0"))
+                program_options.sprt_elo0 = value;
+            else if (!strcmp(arg, "--elo1"))
+                program_options.sprt_elo1 = value;
+            else if (!strcmp(arg, "--alpha"))
+                program_options.sprt_alpha = value;
+            else
+                program_options.sprt_beta = value;
+        }
+        else if (!strcmp(arg, "--tournament") && has_value)
+        {
+            char *end = NULL;
+            program_options.tournament_games = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--crowd") && has_value)
+        {
+            char *end = NULL;
+            program_options.crowd_games = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--server-ai") && has_value)
+            program_options.server_ai = argv[++i];
+        else if (!strcmp(arg, "--players") && has_value)
+            program_options.players = argv[++i];
+        else if (!strcmp(arg, "--ratings") && has_value)
+            program_options.ratings_path = argv[++i];
+        else if (!strcmp(arg, "--max-games") && has_value)
+        {
+            char *end = NULL;
+            program_options.sprt_max_games = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--variant") && has_value)
+            program_options.perft_variant = argv[++i];
+        else if (!strcmp(arg, "--position") && has_value)
+            program_options.perft_position = argv[++i];
+        else if (!strcmp(arg, "--threads") && has_value)
+        {
+            char *end = NULL;
+            program_options.threads = strtoul(argv[++i], &end, 10);
+            if (*end != 0)
+                return false;
+        }
+        else if (!strcmp(arg, "--game") && has_value)
+        {
+            char *end = NULL;
+            program_options.game_number = strtoul(argv[++i], &end, 10);
+            program_options.has_game_number = *end == 0;
+            if (!program_options.has_game_number)
+                return false;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Joga uma única partida seguindo o
+ * roteiro de `program_options.script_path`,
+ * passando por todo o código da interface,
+ * sem menus e sem esperar o teclado.
+ */
+int script_session()
+{
+    struct GameState game =
+    {
+        .turn = (enum Actor)((rand() % 2) + 1),
+    };
+
+    struct ScriptInputSource script = {0};
+    if (!open_script_input_source(&script, program_options.script_path, &game))
+    {
+        perror(program_options.script_path);
+        return 1;
+    }
+
+    struct GameInputSource script_input =
+    {
+        .executor = script_game_input,
+        .args = &script,
+    };
+
+    setup_terminal();
+
+    who_is_starting_popup(game.turn);
+    while (game_event_loop(&game, script_input));
+
+    close_script_input_source(&script);
+
+    if (script.error_line != 0)
+    {
+        restore_terminal();
+        fprintf(stderr, "%s:%u: comando inválido\n", program_options.script_path, script.error_line);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Joga `program_options.selfplay_games`
+ * partidas entre IAs sem interface,
+ * gravando elas se `--record` for usado.
+ */
+int selfplay_session()
+{
+    const char *x_name = (program_options.x_ai != NULL) ? program_options.x_ai : "avarage";
+    const char *o_name = (program_options.o_ai != NULL) ? program_options.o_ai : "avarage";
+
+    // Cada cérebro tem sua arena, zerada a cada partida.
+    struct Arena x_arena = {0};
+    struct Arena o_arena = {0};
+    struct AIBrain x_brain = create_ai_brain(NULL, NULL);
+    struct AIBrain o_brain = create_ai_brain(NULL, NULL);
+    x_brain.arena = &x_arena;
+    o_brain.arena = &o_arena;
+    if (!open_ai_cortex(x_name, &x_brain.cortex, &x_brain.cortex_data))
+    {
+        fprintf(stderr, "Cortex desconhecido ou que não iniciou: %s\n", x_name);
+        return 1;
+    }
+    if (!open_ai_cortex(o_name, &o_brain.cortex, &o_brain.cortex_data))
+    {
+        fprintf(stderr, "Cortex desconhecido ou que não iniciou: %s\n", o_name);
+        close_ai_cortex(x_brain.cortex, x_brain.cortex_data);
+        return 1;
+    }
+
+    // O escritor é grande demais para a pilha.
+    struct GameRecordWriter *recorder = NULL;
+    if (program_options.record_path != NULL)
+    {
+        recorder = malloc(sizeof(struct GameRecordWriter));
+        if (!open_game_record_writer(recorder, program_options.record_path, program_options.record_block_games))
+        {
+            perror(program_options.record_path);
+            free(recorder);
+            close_ai_cortex(x_brain.cortex, x_brain.cortex_data);
+            close_ai_cortex(o_brain.cortex, o_brain.cortex_data);
+            return 1;
+        }
+    }
+
+    unsigned long results[4] = {0};
+    uint64_t start = monotonic_ns();
+    // Blocos pedidos depois da primeira partida,
+    // quando as arenas já "esquentaram".
+    uint64_t warm_blocks = 0;
+
+    for (unsigned long i = 0; i < program_options.selfplay_games; i++)
+    {
+        if (i == 1)
+            warm_blocks = x_arena.blocks + o_arena.blocks;
+
+        struct GameState game =
+        {
+            .turn = (enum Actor)((rand() % 2) + 1),
+            .recorder = recorder,
+        };
+        results[play_headless_game(&game, &x_brain, &o_brain)]++;
+    }
+
+    double seconds = (monotonic_ns() - start) / 1e9;
+    // Quando gravamos na saída padrão,
+    // o resumo vai para a saída de erro.
+    FILE *report = (recorder != NULL && recorder->file == stdout) ? stderr : stdout;
+
+    fprintf(report, "Partidas: %lu (%s vs. %s)\n", program_options.selfplay_games, x_name, o_name);
+    fprintf(report, "X venceu: %lu | O venceu: %lu | Velha: %lu\n",
+        results[X_VICTORY], results[O_VICTORY], results[GAME_DRAW]);
+    fprintf(report, "Tempo: %.3f s (%.0f partidas/s)\n",
+        seconds, program_options.selfplay_games / ((seconds > 0) ? seconds : 1e-9));
+
+#if defined (__unix__) || defined (__APPLE__)
+    struct AIBrain *brains[] = {&x_brain, &o_brain};
+    for (int i = 0; i < 2; i++)
+        if (brains[i]->cortex == external_engine_cortex && (i == 0 || brains[1]->cortex_data != brains[0]->cortex_data))
+            print_external_engine_stats(report, brains[i]->cortex_data);
+#endif
+    close_ai_cortex(x_brain.cortex, x_brain.cortex_data);
+    close_ai_cortex(o_brain.cortex, o_brain.cortex_data);
+
+    fprintf(report, "Arenas: pico %zu + %zu bytes, %llu reinícios, %llu blocos (%llu depois da 1ª partida)\n",
+        x_arena.peak, o_arena.peak,
+        (unsigned long long)(x_arena.resets + o_arena.resets),
+        (unsigned long long)(x_arena.blocks + o_arena.blocks),
+        (unsigned long long)((program_options.selfplay_games > 1) ? x_arena.blocks + o_arena.blocks - warm_blocks : 0));
+    close_arena(&x_arena);
+    close_arena(&o_arena);
+
+    if (recorder != NULL)
+    {
+        bool ok = close_game_record_writer(recorder);
+        uint64_t bytes = recorder->offset;
+        free(recorder);
+        if (!ok)
+        {
+            perror(program_options.record_path);
+            return 1;
+        }
+        fprintf(report, "Gravado: %llu bytes de partidas (%.2f bytes/partida)\n",
+            (unsigned long long)bytes,
+            (double)bytes / ((program_options.selfplay_games > 0) ? program_options.selfplay_games : 1));
+    }
+    return 0;
+}
+
+/**
+ * Partidas para decidir se um cortex é melhor
+ * que outro (`--sprt`), parando assim que o
+ * resultado for estatisticamente certo, pelo
+ * "teste sequencial da razão de probabilidades"
+ * (SPRT), o mesmo usado para testar motores
+ * de xadrez.
+ *
+ * O teste compara duas hipóteses: H0, "o
+ * candidato é `elo0` Elo mais forte" e H1,
+ * "é `elo1` Elo mais forte". A cada partida
+ * calculamos o LLR (o logaritmo de quanto H1
+ * explica os resultados melhor que H0): ele
+ * passar de `log((1 - beta) / alpha)` aceita H1,
+ * ficar abaixo de `log(beta / (1 - alpha))` aceita
+ * H0, e `alpha` e `beta` são as chances de
+ * aceitar a hipótese errada.
+ */
+
+/**
+ * De quantas em quantas partidas
+ * mostrar o andamento do teste.
+ */
+#define SPRT_REPORT_GAMES 1000
+
+/**
+ * Os limites e as contagens de um teste.
+ */
+struct SprtJob
+{
+    const char *candidate;
+    const char *baseline;
+    double lower_bound;
+    double upper_bound;
+    double score0;
+    double score1;
+    uint32_t max_games;
+    uint32_t seed;
+    /**
+     * Próxima partida a começar.
+     */
+    volatile uint32_t next_game;
+    /**
+     * Resultados do ponto de vista do candidato.
+     */
+    volatile uint32_t wins;
+    volatile uint32_t draws;
+    volatile uint32_t losses;
+    volatile uint32_t finished_games;
+    /**
+     * Vira 1 quando o teste termina.
+     */
+    volatile uint32_t stop;
+    /**
+     * Alguma thread não conseguiu abrir os cortexes.
+     */
+    volatile uint32_t failed;
+};
+
+/**
+ * A pontuação esperada (de 0 a 1) de
+ * quem é `elo` Elo mais forte.
+ */
+double elo_to_score(double elo)
+{
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+/**
+ * A diferença de Elo de uma pontuação.
+ */
+double score_to_elo(double score)
+{
+    // Sem derrotas (ou sem vitórias) o Elo é infinito.
+    if (score < 1e-6)
+        score = 1e-6;
+    if (score > 1.0 - 1e-6)
+        score = 1.0 - 1e-6;
+    return -400.0 * log10((1.0 / score) - 1.0);
+}
+
+/**
+ * O LLR do teste, aproximando a pontuação
+ * média por uma curva normal (com a variância
+ * medida das próprias partidas).
+ *
+ * Também diz o Elo estimado e a margem
+ * de erro (95%) em `elo` e `margin`.
+ */
+double sprt_llr(const struct SprtJob *job, uint32_t wins, uint32_t draws, uint32_t losses, double *elo, double *margin)
+{
+    double games = wins + draws + losses;
+    *elo = 0;
+    *margin = 0;
+    if (games == 0)
+        return 0;
+
+    double score = (wins + (draws * 0.5)) / games;
+    double variance = ((wins * (1 - score) * (1 - score)) + (draws * (0.5 - score) * (0.5 - score))
+        + (losses * score * score)) / games;
+    double score_variance = variance / games;
+
+    *elo = score_to_elo(score);
+    *margin = (score_to_elo(score + (1.96 * sqrt(score_variance))) - score_to_elo(score - (1.96 * sqrt(score_variance)))) / 2;
+
+    // Só velhas (ou só um resultado) não
+    // dizem nada sobre quem é melhor.
+    if (score_variance <= 0)
+        return 0;
+    return (job->score1 - job->score0) * ((2 * score) - job->score0 - job->score1) / (2 * score_variance);
+}
+
+/**
+ * O que cada thread do teste faz: abre os dois
+ * cortexes e joga até o teste acabar.
+ *
+ * A partida `i` tem o candidato de X nas pares
+ * e de O nas ímpares, e quem começa troca a cada
+ * par de partidas, então os dois jogam as mesmas
+ * situações. Cada partida tem sua própria semente,
+ * não importa em qual thread ela caia.
+ */
+void sprt_worker(void *a)
+{
+    struct SprtJob *job = a;
+
+    struct Arena arenas[2] = {0};
+    struct AIBrain brains[2] = {create_ai_brain(NULL, NULL), create_ai_brain(NULL, NULL)};
+    const char *names[2] = {job->candidate, job->baseline};
+    for (int i = 0; i < 2; i++)
+    {
+        brains[i].arena = &arenas[i];
+        if (!open_ai_cortex(names[i], &brains[i].cortex, &brains[i].cortex_data))
+        {
+            fprintf(stderr, "Cortex desconhecido ou que não iniciou: %s\n", names[i]);
+            if (i == 1)
+                close_ai_cortex(brains[0].cortex, brains[0].cortex_data);
+            atomic_fetch_add_u32(&job->failed, 1);
+            atomic_fetch_add_u32(&job->stop, 1);
+            return;
+        }
+    }
+
+    uint32_t i;
+    while (atomic_load_u32(&job->stop) == 0 && (i = atomic_fetch_add_u32(&job->next_game, 1)) < job->max_games)
+    {
+        seed_ai_random(job->seed ^ (i * 2654435761u));
+        bool candidate_is_x = (i % 2) == 0;
+        struct GameState game =
+        {
+            .turn = ((i / 2) % 2 == 0) ? X_ACTOR : O_ACTOR,
+        };
+        enum EndGame result = candidate_is_x
+            ? play_headless_game(&game, &brains[0], &brains[1])
+            : play_headless_game(&game, &brains[1], &brains[0]);
+
+        if (result == GAME_DRAW)
+            atomic_fetch_add_u32(&job->draws, 1);
+        else if ((result == X_VICTORY) == candidate_is_x)
+            atomic_fetch_add_u32(&job->wins, 1);
+        else
+            atomic_fetch_add_u32(&job->losses, 1);
+        uint32_t finished = atomic_fetch_add_u32(&job->finished_games, 1) + 1;
+
+        // Quem termina a partida confere se o
+        // teste já pode parar (e mostra o andamento).
+        uint32_t wins = atomic_load_u32(&job->wins);
+        uint32_t draws = atomic_load_u32(&job->draws);
+        uint32_t losses = atomic_load_u32(&job->losses);
+        double elo, margin;
+        double llr = sprt_llr(job, wins, draws, losses, &elo, &margin);
+        if (llr >= job->upper_bound || llr <= job->lower_bound)
+            atomic_fetch_add_u32(&job->stop, 1);
+        if (finished % SPRT_REPORT_GAMES == 0)
+            printf("%10u %9u %9u %9u %9.2f %+10.1f ± %.1f\n", finished, wins, draws, losses, llr, elo, margin);
+    }
+
+    for (int i = 0; i < 2; i++)
+        close_ai_cortex(brains[i].cortex, brains[i].cortex_data);
+    close_arena(&arenas[0]);
+    close_arena(&arenas[1]);
+}
+
+/**
+ * Roda o teste do cortex `program_options.sprt_candidate`
+ * contra `program_options.sprt_baseline` em
+ * todas as threads.
+ */
+int sprt_session()
+{
+    double alpha = program_options.sprt_alpha;
+    double beta = program_options.sprt_beta;
+    if (!(alpha > 0 && alpha < 1 && beta > 0 && beta < 1 && program_options.sprt_elo1 > program_options.sprt_elo0))
+    {
+        fprintf(stderr, "SPRT inválido: precisa de 0 < alpha, beta < 1 e elo0 < elo1\n");
+        return 1;
+    }
+
+    // O `pattern_ai_cortex` monta a geometria
+    // na primeira vez, antes das threads.
+    get_classic_mnk_geometry();
+
+    struct SprtJob job =
+    {
+        .candidate = program_options.sprt_candidate,
+        .baseline = (program_options.sprt_baseline != NULL) ? program_options.sprt_baseline : "avarage",
+        .lower_bound = log(beta / (1 - alpha)),
+        .upper_bound = log((1 - beta) / alpha),
+        .score0 = elo_to_score(program_options.sprt_elo0),
+        .score1 = elo_to_score(program_options.sprt_elo1),
+        .max_games = (program_options.sprt_max_games > 0) ? program_options.sprt_max_games : 100000,
+        .seed = program_options.has_seed ? program_options.seed : (uint32_t)time(NULL),
+    };
+    unsigned int threads = (program_options.threads > 0) ? program_options.threads : cpu_count();
+
+    printf("SPRT %s vs. %s: elo0 %.1f, elo1 %.1f, alpha %.3f, beta %.3f (LLR entre %.2f e %.2f), %u threads\n\n",
+        job.candidate, job.baseline, program_options.sprt_elo0, program_options.sprt_elo1,
+        alpha, beta, job.lower_bound, job.upper_bound, threads);
+    // "vitórias" e "derrotas" do ponto de vista do candidato.
+    printf("%10s %10s %9s %9s %9s %10s\n", "partidas", "vitórias", "velhas", "derrotas", "LLR", "Elo");
+
+    uint64_t start = monotonic_ns();
+    struct WorkerThread *workers = calloc(threads, sizeof(struct WorkerThread));
+    unsigned int started = 0;
+    while (workers != NULL && started + 1 < threads && start_worker_thread(&workers[started], sprt_worker, &job))
+        started++;
+    sprt_worker(&job);
+    for (unsigned int i = 0; i < started; i++)
+        join_worker_thread(&workers[i]);
+    free(workers);
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    if (job.failed > 0)
+        return 1;
+
+    double elo, margin;
+    double llr = sprt_llr(&job, job.wins, job.draws, job.losses, &elo, &margin);
+    printf("%10u %9u %9u %9u %9.2f %+10.1f ± %.1f\n\n",
+        job.finished_games, job.wins, job.draws, job.losses, llr, elo, margin);
+
+    if (llr >= job.upper_bound)
+        printf("H1 aceita: %s é pelo menos %.1f Elo mais forte que %s.\n", job.candidate, program_options.sprt_elo0, job.baseline);
+    else if (llr <= job.lower_bound)
+        printf("H0 aceita: %s não chega a %.1f Elo mais forte que %s.\n", job.candidate, program_options.sprt_elo1, job.baseline);
+    else
+        printf("Sem decisão depois de %u partidas.\n", job.finished_games);
+    printf("Tempo: %.3f s (%.0f partidas/s)\n", seconds, job.finished_games / ((seconds > 0) ? seconds : 1e-9));
+    return 0;
+}
+
+/**
+ * Vira um motor externo (veja `ExternalEngine`)
+ * usando o cortex `program_options.engine_cortex`,
+ * conversando pela entrada e saída padrão.
+ *
+ * Serve de exemplo do protocolo e para
+ * testar o adaptador: `--x-ai "engine:./ctictactoe --engine dumb"`.
+ */
+int engine_session()
+{
+    AIBrainCortex cortex = find_ai_cortex(program_options.engine_cortex);
+    if (cortex == NULL)
+    {
+        fprintf(stderr, "Cortex desconhecido: %s\n", program_options.engine_cortex);
+        return 1;
+    }
+
+    struct GameState game = {0};
+    struct AIBrain brain = create_ai_brain(&game, cortex);
+
+    char line[256];
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+
+        if (!strcmp(line, "ctt"))
+            printf("id name ctictactoe %s\ncttok\n", program_options.engine_cortex);
+        else if (!strcmp(line, "isready"))
+            printf("readyok\n");
+        else if (!strncmp(line, "position ", 9))
+        {
+            game = (struct GameState){ .turn = (line[9] == 'o') ? O_ACTOR : X_ACTOR };
+            process_game_state(&game);
+
+            const char *moves = strstr(line, "moves");
+            char *next = (char *)((moves != NULL) ? moves + 5 : "");
+            while (true)
+            {
+                char *end = NULL;
+                unsigned long cell = strtoul(next, &end, 10);
+                if (end == next || cell > 8)
+                    break;
+                play_game_move(&game, vec2(cell % 3, cell / 3));
+                process_game_state(&game);
+                next = end;
+            }
+        }
+        else if (!strncmp(line, "go", 2))
+        {
+            if (game.endgame != RUNNING)
+                continue;
+            // O `movetime` do motor vira o limite
+            // de tempo da IA (sem ele, o de `--think-ms`).
+            unsigned int movetime = 0;
+            brain.time_limit_ms = (sscanf(line, "go movetime %u", &movetime) == 1)
+                ? movetime : program_options.think_ms;
+            brain.goal = AI_THINKING_STATE;
+            ai_think(&brain);
+            printf("bestmove %d\n", (brain.goal.y * 3) + brain.goal.x);
+        }
+        else if (!strcmp(line, "quit"))
+            break;
+
+        fflush(stdout);
+    }
+    return 0;
+}
+
+/**
+ * Mostra uma partida gravada como texto.
+ */
+void print_game_record(FILE *out, uint64_t number, const struct GameRecord *record)
+{
+    const char *results[] = {"inacabada", "velha", "X venceu", "O venceu"};
+    fprintf(out, "#%llu começa %c:", (unsigned long long)number, (record->starter == O_ACTOR) ? 'O' : 'X');
+    for (uint8_t i = 0; i < record->len; i++)
+        fprintf(out, " %u,%u", record->cells[i] % 3, record->cells[i] / 3);
+    fprintf(out, " => %s", results[record->result]);
+    if (record->has_players)
+        fprintf(out, " (X: jogador %u, O: jogador %u)", record->players[0], record->players[1]);
+    fprintf(out, "\n");
+}
+
+/**
+ * Lê um arquivo de partidas e mostra
+ * um resumo, ou uma partida só se
+ * `--game` for usado.
+ */
+int read_records_session()
+{
+    const char *path = program_options.read_records_path;
+
+    // O leitor é grande demais para a pilha.
+    struct GameRecordReader *reader = malloc(sizeof(struct GameRecordReader));
+    if (!open_game_record_reader(reader, path))
+    {
+        fprintf(stderr, "%s: não é um arquivo de partidas válido\n", path);
+        free(reader);
+        return 1;
+    }
+
+    int status = 0;
+    struct GameRecord record;
+
+    if (program_options.has_game_number)
+    {
+        if (seek_game_record(reader, program_options.game_number) && read_game_record(reader, &record))
+            print_game_record(stdout, program_options.game_number, &record);
+        else
+        {
+            fprintf(stderr, "%s: partida %lu não encontrada\n", path, program_options.game_number);
+            status = 1;
+        }
+    }
+    else
+    {
+        unsigned long long games = 0;
+        unsigned long long moves = 0;
+        unsigned long long results[4] = {0};
+        uint64_t start = monotonic_ns();
+
+        while (read_game_record(reader, &record))
+        {
+            games++;
+            moves += record.len;
+            results[record.result]++;
+        }
+
+        double seconds = (monotonic_ns() - start) / 1e9;
+        printf("Partidas: %llu (%llu jogadas)\n", games, moves);
+        printf("X venceu: %llu | O venceu: %llu | Velha: %llu | Inacabadas: %llu\n",
+            results[X_VICTORY], results[O_VICTORY], results[GAME_DRAW], results[RUNNING]);
+        printf("Leitura: %.3f s (%.0f partidas/s)\n", seconds, games / ((seconds > 0) ? seconds : 1e-9));
+        if (reader->seekable && reader->total_games != games)
+        {
+            fprintf(stderr, "%s: o índice diz %llu partidas\n", path, (unsigned long long)reader->total_games);
+            status = 1;
+        }
+    }
+
+    close_game_record_reader(reader);
+    free(reader);
+    return status;
+}
+
+/**
+ * Abre o visualizador de partidas
+ * em uma partida de um arquivo.
+ */
+int replay_session()
+{
+    const char *path = program_options.replay_path;
+    uint64_t number = program_options.has_game_number ? program_options.game_number : 0;
+
+    struct GameRecordReader *reader = malloc(sizeof(struct GameRecordReader));
+    if (!open_game_record_reader(reader, path))
+    {
+        fprintf(stderr, "%s: não é um arquivo de partidas válido\n", path);
+        free(reader);
+        return 1;
+    }
+
+    struct GameRecord record;
+    bool found = seek_game_record(reader, number) && read_game_record(reader, &record);
+    close_game_record_reader(reader);
+    free(reader);
+
+    if (!found)
+    {
+        fprintf(stderr, "%s: partida %llu não encontrada\n", path, (unsigned long long)number);
+        return 1;
+    }
+
+    struct BoardSnapshot snapshots[10];
+    build_board_snapshots(&record, snapshots);
+
+    setup_terminal();
+    replay_viewer(&record, snapshots);
+    return 0;
+}
+
+/**
+ * Classificação (Elo) dos jogadores de um
+ * torneio, a partir das partidas gravadas.
+ *
+ * As partidas não ficam na memória: só contamos,
+ * para cada par (quem começou, o outro), quantas
+ * quem começou venceu, empatou e perdeu. Milhões
+ * de partidas viram uma tabela do tamanho do
+ * número de jogadores ao quadrado.
+ *
+ * Com as contagens, achamos os Elos mais prováveis
+ * no modelo do BayesElo: cada jogador tem uma
+ * força `g = 10^(Elo / 400)`, quem começa tem uma
+ * vantagem `eta` e `theta` diz o quanto as partidas
+ * empatam. Entre quem começa (`a = eta * g1`) e o
+ * outro (`b = g2`):
+ *
+ *  - quem começa vence com `a / (a + theta * b)`;
+ *  - o outro vence com `b / (theta * a + b)`;
+ *  - e o resto é velha.
+ *
+ * As forças são achadas pelo algoritmo MM
+ * (minorização e maximização, de Hunter): cada
+ * volta melhora a chance de todas as partidas
+ * terem dado o que deram, até não mudar mais.
+ */
+
+/// Limite de jogadores de uma classificação.
+#define RATING_MAX_PLAYERS 1024
+/**
+ * Empates "de mentira" de cada jogador contra
+ * um jogador médio, para quem só venceu (ou
+ * só perdeu) não ir para o infinito.
+ */
+#define RATING_PRIOR_DRAWS 2
+/// Para quando nenhuma força mudar mais que isso.
+#define RATING_TOLERANCE 1e-9
+#define RATING_MAX_ITERATIONS 100000
+
+/**
+ * Resultados de quem começou a partida.
+ */
+enum RatingResult
+{
+    RATING_WIN,
+    RATING_DRAW,
+    RATING_LOSS,
+};
+
+/**
+ * As contagens de um torneio.
+ */
+struct RatingCounts
+{
+    /**
+     * Os jogadores são numerados de `0`
+     * até `players - 1`.
+     */
+    uint32_t players;
+    uint32_t capacity;
+    /**
+     * `results[((starter * capacity) + other) * 3 + result]`.
+     */
+    uint64_t *results;
+    uint64_t games;
+};
+
+/**
+ * Libera as contagens.
+ */
+void close_rating_counts(struct RatingCounts *counts)
+{
+    free(counts->results);
+    *counts = (struct RatingCounts){0};
+}
+
+/**
+ * Conta uma partida entre `starter` (quem
+ * começou) e `other`.
+ *
+ * Retorna `false` se algum jogador
+ * passar de `RATING_MAX_PLAYERS`.
+ */
+bool add_rating_game(struct RatingCounts *counts, uint32_t starter, uint32_t other, enum RatingResult result)
+{
+    uint32_t needed = ((starter > other) ? starter : other) + 1;
+    if (needed > RATING_MAX_PLAYERS)
+        return false;
+
+    if (needed > counts->capacity)
+    {
+        // Dobramos a tabela, mudando as
+        // contagens antigas de lugar.
+        uint32_t capacity = (counts->capacity == 0) ? 16 : counts->capacity;
+        while (capacity < needed)
+            capacity *= 2;
+        uint64_t *results = calloc((size_t)capacity * capacity * 3, sizeof(uint64_t));
+        for (uint32_t s = 0; s < counts->players; s++)
+            memcpy(&results[(size_t)s * capacity * 3], &counts->results[(size_t)s * counts->capacity * 3],
+                counts->players * 3 * sizeof(uint64_t));
+        free(counts->results);
+        counts->results = results;
+        counts->capacity = capacity;
+    }
+    if (needed > counts->players)
+        counts->players = needed;
+
+    counts->results[(((size_t)starter * counts->capacity) + other) * 3 + result]++;
+    counts->games++;
+    return true;
+}
+
+/**
+ * Conta uma partida gravada.
+ *
+ * Partidas sem jogadores ou inacabadas são
+ * ignoradas. Retorna `false` se algum jogador
+ * passar de `RATING_MAX_PLAYERS`.
+ */
+bool add_rating_record(struct RatingCounts *counts, const struct GameRecord *record)
+{
+    if (!record->has_players || record->result == RUNNING)
+        return true;
+
+    int starter = (record->starter == O_ACTOR) ? 1 : 0;
+    enum EndGame starter_victory = (starter == 0) ? X_VICTORY : O_VICTORY;
+    enum RatingResult result = (record->result == GAME_DRAW) ? RATING_DRAW
+        : (record->result == starter_victory) ? RATING_WIN : RATING_LOSS;
+    return add_rating_game(counts, record->players[starter], record->players[1 - starter], result);
+}
+
+/**
+ * O resultado de `compute_ratings`.
+ */
+struct Ratings
+{
+    /**
+     * Elo de cada jogador (a média é `0`) e
+     * a margem de erro (95%).
+     */
+    double *elo;
+    double *margin;
+    /**
+     * A vantagem de começar e o
+     * "Elo dos empates", em Elo.
+     */
+    double advantage;
+    double draw_elo;
+    int iterations;
+};
+
+/**
+ * Libera a classificação.
+ */
+void close_ratings(struct Ratings *ratings)
+{
+    free(ratings->elo);
+    free(ratings->margin);
+    *ratings = (struct Ratings){0};
+}
+
+/**
+ * Acha os Elos mais prováveis de `counts`
+ * (veja o começo desta parte).
+ *
+ * O jogador médio dos empates de mentira fica
+ * na posição `players`, com força fixa `1`.
+ */
+struct Ratings compute_ratings(const struct RatingCounts *counts)
+{
+    uint32_t n = counts->players;
+    uint32_t cap = counts->capacity;
+    double *g = malloc((n + 1) * sizeof(double));
+    double *previous = malloc(n * sizeof(double));
+    // As vitórias mais os empates de cada jogador,
+    // o que não muda de uma volta para outra.
+    double *wins = malloc(n * sizeof(double));
+    double starter_wins = 0;
+    double draws = 0;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        g[i] = 1;
+        wins[i] = RATING_PRIOR_DRAWS;
+        for (uint32_t j = 0; j < n; j++)
+        {
+            const uint64_t *r = &counts->results[((size_t)i * cap + j) * 3];
+            const uint64_t *t = &counts->results[((size_t)j * cap + i) * 3];
+            wins[i] += r[RATING_WIN] + r[RATING_DRAW] + t[RATING_LOSS] + t[RATING_DRAW];
+            starter_wins += r[RATING_WIN] + r[RATING_DRAW];
+            draws += r[RATING_DRAW];
+        }
+    }
+    g[n] = 1;
+
+    double eta = 1;
+    double theta = 2;
+    int iterations = 0;
+    double change = 1;
+    while (change > RATING_TOLERANCE && iterations < RATING_MAX_ITERATIONS)
+    {
+        iterations++;
+        change = 0;
+        memcpy(previous, g, n * sizeof(double));
+
+        // Cada força, com as outras
+        // (e `eta` e `theta`) paradas.
+        for (uint32_t i = 0; i < n; i++)
+        {
+            double sum = 0;
+            for (uint32_t j = 0; j < n; j++)
+            {
+                const uint64_t *r = &counts->results[((size_t)i * cap + j) * 3];
+                const uint64_t *t = &counts->results[((size_t)j * cap + i) * 3];
+                double as_starter = eta * g[i];
+                double as_other = eta * g[j];
+                sum += (r[RATING_WIN] + r[RATING_DRAW]) * eta / (as_starter + (theta * g[j]))
+                    + (r[RATING_LOSS] + r[RATING_DRAW]) * theta * eta / ((theta * as_starter) + g[j])
+                    + (t[RATING_WIN] + t[RATING_DRAW]) * theta / (as_other + (theta * g[i]))
+                    + (t[RATING_LOSS] + t[RATING_DRAW]) / ((theta * as_other) + g[i]);
+            }
+            // Os empates de mentira, um começando
+            // e outro não, contra o jogador médio.
+            double half = RATING_PRIOR_DRAWS / 2.0;
+            sum += half * ((eta / ((eta * g[i]) + (theta * g[n]))) + (theta * eta / ((theta * eta * g[i]) + g[n])));
+            sum += half * ((theta / ((eta * g[n]) + (theta * g[i]))) + (1 / ((theta * eta * g[n]) + g[i])));
+
+            g[i] = wins[i] / sum;
+        }
+
+        // Os Elos só valem uns em relação aos outros:
+        // mantemos a média no `0`, e o jogador médio
+        // dos empates de mentira continua sendo o médio.
+        double log_mean = 0;
+        for (uint32_t i = 0; i < n; i++)
+            log_mean += log(g[i]);
+        double scale = exp(-log_mean / n);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            g[i] *= scale;
+            double delta = fabs(log(g[i] / previous[i]));
+            if (delta > change)
+                change = delta;
+        }
+
+        // A vantagem e os empates, só
+        // com as partidas de verdade.
+        double eta_sum = 0;
+        double theta_sum = 0;
+        for (uint32_t i = 0; i < n; i++)
+            for (uint32_t j = 0; j < n; j++)
+            {
+                const uint64_t *r = &counts->results[((size_t)i * cap + j) * 3];
+                double a = eta * g[i];
+                double first = (r[RATING_WIN] + r[RATING_DRAW]) / (a + (theta * g[j]));
+                double second = (r[RATING_LOSS] + r[RATING_DRAW]) / ((theta * a) + g[j]);
+                eta_sum += (first * g[i]) + (second * theta * g[i]);
+                theta_sum += (first * g[j]) + (second * a);
+            }
+        if (eta_sum > 0 && starter_wins > 0)
+        {
+            double updated = starter_wins / eta_sum;
+            double delta = fabs(log(updated / eta));
+            if (delta > change)
+                change = delta;
+            eta = updated;
+        }
+        // `theta` maximiza `draws * log(theta² - 1) - theta * theta_sum`.
+        if (theta_sum > 0)
+        {
+            double updated = (draws + sqrt((draws * draws) + (theta_sum * theta_sum))) / theta_sum;
+            // Sem empates `theta` iria para `1`,
+            // e o `log` acima para o infinito.
+            if (updated < 1.0 + 1e-9)
+                updated = 1.0 + 1e-9;
+            double delta = fabs(log(updated / theta));
+            if (delta > change)
+                change = delta;
+            theta = updated;
+        }
+    }
+
+    // A margem de erro vem da curvatura da
+    // chance em volta de cada força (a "informação
+    // de Fisher"), com as outras paradas.
+    struct Ratings ratings =
+    {
+        .elo = malloc(n * sizeof(double)),
+        .margin = malloc(n * sizeof(double)),
+        .advantage = 400 * log10(eta),
+        .draw_elo = 400 * log10(theta),
+        .iterations = iterations,
+    };
+    double mean = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        double information = 0;
+        for (uint32_t j = 0; j <= n; j++)
+        {
+            double half = RATING_PRIOR_DRAWS / 2.0;
+            const uint64_t *r = (j < n) ? &counts->results[((size_t)i * cap + j) * 3] : NULL;
+            const uint64_t *t = (j < n) ? &counts->results[((size_t)j * cap + i) * 3] : NULL;
+            double pairs[2][2] =
+            {
+                // Como quem começa e como o outro.
+                {
+                    (j < n) ? (double)(r[RATING_WIN] + r[RATING_DRAW]) : half,
+                    (j < n) ? (double)(r[RATING_LOSS] + r[RATING_DRAW]) : half,
+                },
+                {
+                    (j < n) ? (double)(t[RATING_WIN] + t[RATING_DRAW]) : half,
+                    (j < n) ? (double)(t[RATING_LOSS] + t[RATING_DRAW]) : half,
+                },
+            };
+            for (int side = 0; side < 2; side++)
+            {
+                double a = eta * ((side == 0) ? g[i] : g[j]);
+                double b = (side == 0) ? g[j] : g[i];
+                information += pairs[side][0] * (a * theta * b) / ((a + (theta * b)) * (a + (theta * b)));
+                information += pairs[side][1] * (theta * a * b) / (((theta * a) + b) * ((theta * a) + b));
+            }
+        }
+        ratings.elo[i] = 400 * log10(g[i]);
+        ratings.margin[i] = 1.96 * (400 / log(10)) / sqrt(information);
+        mean += ratings.elo[i];
+    }
+    for (uint32_t i = 0; i < n; i++)
+        ratings.elo[i] -= mean / ((n > 0) ? n : 1);
+
+    free(g);
+    free(previous);
+    free(wins);
+    return ratings;
+}
+
+/**
+ * Separa `list` ("a,b,c") em até `max` nomes.
+ *
+ * Os nomes apontam para `copy`, que deve ser
+ * liberado depois. Retorna quantos nomes foram lidos.
+ */
+uint32_t split_player_names(const char *list, char **copy, const char *names[], uint32_t max)
+{
+    *copy = malloc(strlen(list) + 1);
+    strcpy(*copy, list);
+
+    uint32_t n = 0;
+    for (char *name = strtok(*copy, ","); name != NULL && n < max; name = strtok(NULL, ","))
+        names[n++] = name;
+    return n;
+}
+
+/**
+ * Mostra a classificação, do melhor para o pior.
+ *
+ * `names` pode ter menos nomes que jogadores,
+ * os que faltarem aparecem pelo número.
+ */
+void print_ratings(const struct RatingCounts *counts, const struct Ratings *ratings, const char *names[], uint32_t names_len)
+{
+    uint32_t n = counts->players;
+    uint32_t cap = counts->capacity;
+    uint32_t *order = malloc(n * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++)
+        order[i] = i;
+    // Ordenação por inserção, são poucos jogadores.
+    for (uint32_t i = 1; i < n; i++)
+        for (uint32_t j = i; j > 0 && ratings->elo[order[j]] > ratings->elo[order[j - 1]]; j--)
+        {
+            uint32_t swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+
+    printf("%4s %-16s %8s %7s %12s %9s %7s\n", "#", "jogador", "Elo", "±", "partidas", "pontos", "velhas");
+    for (uint32_t k = 0; k < n; k++)
+    {
+        uint32_t i = order[k];
+        uint64_t games = 0, points = 0, draws = 0;
+        for (uint32_t j = 0; j < n; j++)
+        {
+            const uint64_t *r = &counts->results[((size_t)i * cap + j) * 3];
+            const uint64_t *t = &counts->results[((size_t)j * cap + i) * 3];
+            games += r[0] + r[1] + r[2] + t[0] + t[1] + t[2];
+            // Pontos contados em meios.
+            points += (2 * (r[RATING_WIN] + t[RATING_LOSS])) + r[RATING_DRAW] + t[RATING_DRAW];
+            draws += r[RATING_DRAW] + t[RATING_DRAW];
+        }
+        // Jogadores que não aparecem nas partidas
+        // (um número pulado) não são mostrados.
+        if (games == 0)
+            continue;
+
+        char number[16];
+        snprintf(number, sizeof(number), "jogador %u", i);
+        printf("%4u %-16s %+8.1f %6.1f %12llu %8.1f%% %6.1f%%\n",
+            k + 1, (i < names_len) ? names[i] : number, ratings->elo[i], ratings->margin[i],
+            (unsigned long long)games, 50.0 * points / games, 100.0 * draws / games);
+    }
+    printf("\nVantagem de começar: %+.1f Elo | Elo dos empates: %.1f | %d voltas do MM\n",
+        ratings->advantage, ratings->draw_elo, ratings->iterations);
+    free(order);
+}
+
+/**
+ * Lê um arquivo de partidas com jogadores
+ * (gravado por `--tournament`) e mostra
+ * a classificação deles.
+ *
+ * Os nomes vêm de `--players`, na
+ * mesma ordem do torneio.
+ */
+int ratings_session()
+{
+    const char *path = program_options.ratings_path;
+
+    struct GameRecordReader *reader = malloc(sizeof(struct GameRecordReader));
+    if (!open_game_record_reader(reader, path))
+    {
+        fprintf(stderr, "%s: não é um arquivo de partidas válido\n", path);
+        free(reader);
+        return 1;
+    }
+
+    int status = 0;
+    struct RatingCounts counts = {0};
+    struct GameRecord record;
+    uint64_t read = 0;
+    uint64_t start = monotonic_ns();
+    while (read_game_record(reader, &record))
+    {
+        read++;
+        if (!add_rating_record(&counts, &record))
+        {
+            fprintf(stderr, "%s: mais de %d jogadores\n", path, RATING_MAX_PLAYERS);
+            status = 1;
+            break;
+        }
+    }
+    double read_seconds = (monotonic_ns() - start) / 1e9;
+    close_game_record_reader(reader);
+    free(reader);
+
+    if (status == 0 && counts.games == 0)
+    {
+        fprintf(stderr, "%s: nenhuma partida com jogadores\n", path);
+        status = 1;
+    }
+    if (status != 0)
+    {
+        close_rating_counts(&counts);
+        return status;
+    }
+
+    start = monotonic_ns();
+    struct Ratings ratings = compute_ratings(&counts);
+    double solve_seconds = (monotonic_ns() - start) / 1e9;
+
+    char *names_copy = NULL;
+    const char *names[RATING_MAX_PLAYERS];
+    uint32_t names_len = (program_options.players != NULL)
+        ? split_player_names(program_options.players, &names_copy, names, RATING_MAX_PLAYERS) : 0;
+
+    print_ratings(&counts, &ratings, names, names_len);
+    printf("Partidas: %llu de %llu (leitura %.3f s, %.0f partidas/s; cálculo %.3f s)\n",
+        (unsigned long long)counts.games, (unsigned long long)read,
+        read_seconds, read / ((read_seconds > 0) ? read_seconds : 1e-9), solve_seconds);
+
+    free(names_copy);
+    close_ratings(&ratings);
+    close_rating_counts(&counts);
+    return 0;
+}
+
+/**
+ * Joga um torneio "todos contra todos" entre
+ * os cortexes de `--players`, com
+ * `program_options.tournament_games` partidas
+ * por par, e mostra a classificação.
+ *
+ * Como no SPRT, cada par troca de lado a
+ * cada partida e de quem começa a cada duas.
+ * Com `--record`, as partidas são gravadas com
+ * os jogadores (o número de cada um na lista),
+ * para `--ratings` ler depois.
+ */
+int tournament_session()
+{
+    char *names_copy = NULL;
+    const char *names[RATING_MAX_PLAYERS];
+    uint32_t players = (program_options.players != NULL)
+        ? split_player_names(program_options.players, &names_copy, names, RATING_MAX_PLAYERS) : 0;
+    if (players < 2)
+    {
+        fprintf(stderr, "O torneio precisa de pelo menos dois cortexes em --players\n");
+        free(names_copy);
+        return 1;
+    }
+
+    get_classic_mnk_geometry();
+
+    int status = 0;
+    struct Arena *arenas = calloc(players, sizeof(struct Arena));
+    struct AIBrain *brains = calloc(players, sizeof(struct AIBrain));
+    uint32_t opened = 0;
+    for (; opened < players; opened++)
+    {
+        brains[opened] = create_ai_brain(NULL, NULL);
+        brains[opened].arena = &arenas[opened];
+        if (!open_ai_cortex(names[opened], &brains[opened].cortex, &brains[opened].cortex_data))
+        {
+            fprintf(stderr, "Cortex desconhecido ou que não iniciou: %s\n", names[opened]);
+            status = 1;
+            goto CLEANUP;
+        }
+    }
+
+    struct GameRecordWriter *recorder = NULL;
+    if (program_options.record_path != NULL)
+    {
+        recorder = malloc(sizeof(struct GameRecordWriter));
+        if (!open_game_record_writer(recorder, program_options.record_path, program_options.record_block_games))
+        {
+            perror(program_options.record_path);
+            free(recorder);
+            status = 1;
+            goto CLEANUP;
+        }
+    }
+
+    uint32_t seed = program_options.has_seed ? program_options.seed : (uint32_t)time(NULL);
+    struct RatingCounts counts = {0};
+    uint64_t start = monotonic_ns();
+    uint64_t game_number = 0;
+    for (uint32_t a = 0; a < players; a++)
+        for (uint32_t b = a + 1; b < players; b++)
+            for (unsigned long i = 0; i < program_options.tournament_games; i++)
+            {
+                seed_ai_random(seed ^ (uint32_t)(game_number++ * 2654435761u));
+                uint32_t x = (i % 2 == 0) ? a : b;
+                uint32_t o = (i % 2 == 0) ? b : a;
+                struct GameState game =
+                {
+                    .turn = ((i / 2) % 2 == 0) ? X_ACTOR : O_ACTOR,
+                    .recorder = recorder,
+                    .record.has_players = true,
+                    .record.players = {x, o},
+                };
+                play_headless_game(&game, &brains[x], &brains[o]);
+                add_rating_record(&counts, &game.record);
+            }
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    struct Ratings ratings = compute_ratings(&counts);
+    print_ratings(&counts, &ratings, names, players);
+    printf("Partidas: %llu (%lu por par) | Tempo: %.3f s (%.0f partidas/s)\n",
+        (unsigned long long)counts.games, program_options.tournament_games,
+        seconds, counts.games / ((seconds > 0) ? seconds : 1e-9));
+    close_ratings(&ratings);
+    close_rating_counts(&counts);
+
+    if (recorder != NULL)
+    {
+        if (!close_game_record_writer(recorder))
+        {
+            perror(program_options.record_path);
+            status = 1;
+        }
+        free(recorder);
+    }
+
+    CLEANUP:
+    for (uint32_t i = 0; i < opened; i++)
+        close_ai_cortex(brains[i].cortex, brains[i].cortex_data);
+    for (uint32_t i = 0; i < players; i++)
+        close_arena(&arenas[i]);
+    free(arenas);
+    free(brains);
+    free(names_copy);
+    return status;
+}
+
+/**
+ * Uma partida da multidão (veja `crowd_session`).
+ */
+struct CrowdGame
+{
+    struct GameState state;
+    struct AIBrain brains[2];
+};
+
+/**
+ * Joga `program_options.crowd_games` partidas
+ * entre IAs ao mesmo tempo, todas em uma thread
+ * só, com as mesmas esperas da interface (pensar,
+ * andar e marcar), usando `ai_game_input_step`
+ * e um `InputScheduler`.
+ *
+ * Mostra a vazão e o quanto as IAs
+ * acordaram depois da hora pedida.
+ */
+int crowd_session()
+{
+    const char *names[2] =
+    {
+        (program_options.x_ai != NULL) ? program_options.x_ai : "avarage",
+        (program_options.o_ai != NULL) ? program_options.o_ai : "avarage",
+    };
+    AIBrainCortex cortexes[2] = {0};
+    void *cortex_data[2] = {0};
+    for (int i = 0; i < 2; i++)
+    {
+        // Os cortexes são divididos entre todas as
+        // partidas, então não podem guardar nada
+        // de uma partida (como um motor externo).
+        if (!open_ai_cortex(names[i], &cortexes[i], &cortex_data[i]) || cortex_data[i] != NULL)
+        {
+            fprintf(stderr, "Cortex desconhecido ou que não dá para dividir: %s\n", names[i]);
+            if (i == 1)
+                close_ai_cortex(cortexes[0], cortex_data[0]);
+            if (cortexes[i] != NULL)
+                close_ai_cortex(cortexes[i], cortex_data[i]);
+            return 1;
+        }
+    }
+
+    struct GameRecordWriter *recorder = NULL;
+    if (program_options.record_path != NULL)
+    {
+        recorder = malloc(sizeof(struct GameRecordWriter));
+        if (!open_game_record_writer(recorder, program_options.record_path, program_options.record_block_games))
+        {
+            perror(program_options.record_path);
+            free(recorder);
+            return 1;
+        }
+    }
+
+    uint32_t count = (uint32_t)program_options.crowd_games;
+    struct CrowdGame *games = malloc(count * sizeof(struct CrowdGame));
+    struct InputScheduler scheduler = {0};
+    uint64_t start = monotonic_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        games[i].state = (struct GameState)
+        {
+            .turn = (enum Actor)((rand() % 2) + 1),
+            .recorder = recorder,
+        };
+        for (int side = 0; side < 2; side++)
+        {
+            games[i].brains[side] = create_ai_brain(&games[i].state, cortexes[side]);
+            games[i].brains[side].cortex_data = cortex_data[side];
+        }
+        schedule_input(&scheduler, i, 0, start);
+    }
+
+    unsigned long results[4] = {0};
+    uint64_t steps = 0;
+    // O atraso de cada acordada.
+    struct PhaseStats lateness = {0};
+    uint64_t max_lateness = 0;
+
+    while (scheduler.len > 0)
+    {
+        uint64_t now = monotonic_ns();
+        struct ScheduledInput due;
+        if (!take_due_input(&scheduler, now, &due))
+        {
+            block_delay(input_scheduler_timeout(&scheduler, now));
+            continue;
+        }
+
+        uint64_t late = now - due.wake_at;
+        lateness.count++;
+        lateness.total_ns += late;
+        lateness.histogram[phase_histogram_bucket(late)]++;
+        if (late > max_lateness)
+            max_lateness = late;
+
+        // Roda a partida até a próxima espera.
+        struct CrowdGame *game = &games[due.task];
+        while (true)
+        {
+            process_game_state(&game->state);
+            if (game->state.endgame != RUNNING)
+            {
+                results[game->state.endgame]++;
+                break;
+            }
+
+            uint64_t wake_at = now;
+            struct AIBrain *brain = &game->brains[(game->state.turn == X_ACTOR) ? 0 : 1];
+            enum GameInput input = ai_game_input_step(brain, now, &wake_at);
+            steps++;
+            if (input == WAIT_INPUT)
+            {
+                schedule_input(&scheduler, due.task, 0, wake_at);
+                break;
+            }
+            apply_game_input(&game->state, input);
+        }
+    }
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    char p50[16], p99[16], avarage[16], worst[16];
+    format_duration(p50, sizeof(p50), phase_stats_percentile(&lateness, 50));
+    format_duration(p99, sizeof(p99), phase_stats_percentile(&lateness, 99));
+    format_duration(avarage, sizeof(avarage), (lateness.count > 0) ? lateness.total_ns / lateness.count : 0);
+    format_duration(worst, sizeof(worst), max_lateness);
+
+    FILE *report = (recorder != NULL && recorder->file == stdout) ? stderr : stdout;
+    fprintf(report, "Partidas: %u ao mesmo tempo em uma thread (%s vs. %s)\n", count, names[0], names[1]);
+    fprintf(report, "X venceu: %lu | O venceu: %lu | Velha: %lu\n",
+        results[X_VICTORY], results[O_VICTORY], results[GAME_DRAW]);
+    fprintf(report, "Tempo: %.3f s | Passos: %llu (%.0f/s)\n",
+        seconds, (unsigned long long)steps, steps / ((seconds > 0) ? seconds : 1e-9));
+    fprintf(report, "Atraso ao acordar: média %s, p50 %s, p99 %s, máximo %s\n", avarage, p50, p99, worst);
+
+    int status = 0;
+    if (recorder != NULL)
+    {
+        if (!close_game_record_writer(recorder))
+        {
+            perror(program_options.record_path);
+            status = 1;
+        }
+        free(recorder);
+    }
+    close_input_scheduler(&scheduler);
+    free(games);
+    close_ai_cortex(cortexes[0], cortex_data[0]);
+    close_ai_cortex(cortexes[1], cortex_data[1]);
+    return status;
+}
+
+/**
+ * Roda o perft pedido em `--perft`, mostra
+ * as contagens de cada jogada da raiz, o total
+ * e a vazão e, saindo da posição inicial,
+ * confere com as contagens conhecidas.
+ *
+ * Retorna `1` se algo não bater.
+ */
+int perft_session()
+{
+    const char *name = (program_options.perft_variant != NULL) ? program_options.perft_variant : "classico";
+    const struct PerftVariant *variant = find_perft_variant(name);
+    if (variant == NULL)
+    {
+        fprintf(stderr, "Variante desconhecida: %s\n", name);
+        return 1;
+    }
+
+    // O trabalho é grande demais para a pilha.
+    struct PerftJob *job = calloc(1, sizeof(struct PerftJob));
+    job->variant = variant;
+    job->depth = (program_options.perft_depth < PERFT_MAX_MOVES) ? (int)program_options.perft_depth : PERFT_MAX_MOVES;
+    if (!setup_perft_position(variant, &job->root, program_options.perft_position))
+    {
+        fprintf(stderr, "Posição inválida: %s\n", program_options.perft_position);
+        free(job);
+        return 1;
+    }
+
+    unsigned int threads = (program_options.threads > 0) ? program_options.threads : cpu_count();
+
+    uint64_t start = monotonic_ns();
+    struct PerftCounts total = run_perft_job(job, threads);
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    printf("perft %s, profundidade %d, %u threads\n\n", variant->name, job->depth, threads);
+
+    // "posições" e "vitórias" têm letras de 2 bytes.
+    printf("%-8s %16s %15s %15s %12s\n", "jogada", "posições", "vitórias X", "vitórias O", "velhas");
+    for (size_t i = 0; i < job->len; i++)
+    {
+        printf("%-8u %15llu %14llu %14llu %12llu\n", job->moves[i],
+            (unsigned long long)job->counts[i].nodes, (unsigned long long)job->counts[i].x_wins,
+            (unsigned long long)job->counts[i].o_wins, (unsigned long long)job->counts[i].draws);
+    }
+    printf("%-8s %15llu %14llu %14llu %12llu\n", "total",
+        (unsigned long long)total.nodes, (unsigned long long)total.x_wins,
+        (unsigned long long)total.o_wins, (unsigned long long)total.draws);
+
+    printf("\nPartidas terminadas: %llu\n",
+        (unsigned long long)(total.x_wins + total.o_wins + total.draws));
+    printf("Tempo: %.3f ms (%.0f posições/s)\n",
+        seconds * 1000, total.nodes / ((seconds > 0) ? seconds : 1e-9));
+
+    int status = 0;
+    bool from_start = program_options.perft_position == NULL || program_options.perft_position[0] == 0;
+    if (from_start && job->depth <= variant->expected_len)
+    {
+        struct PerftCounts expected = variant->expected[job->depth - 1];
+        bool matches = total.nodes == expected.nodes && total.x_wins == expected.x_wins
+            && total.o_wins == expected.o_wins && total.draws == expected.draws;
+
+        if (matches)
+            printf("Confere com as contagens conhecidas.\n");
+        else
+        {
+            printf("ERRADO, o esperado era %llu posições, %llu/%llu vitórias e %llu velhas.\n",
+                (unsigned long long)expected.nodes, (unsigned long long)expected.x_wins,
+                (unsigned long long)expected.o_wins, (unsigned long long)expected.draws);
+            status = 1;
+        }
+    }
+
+    free(job);
+    return status;
+}
+
+/**
+ * Treino dos pesos da rede neural (`--train`).
+ *
+ * 1. Partidas sem interface, em várias threads,
+ *    geram posições; cada posição recebe o
+ *    resultado certo (da tabela com todas as
+ *    posições resolvidas, em tabuleiros pequenos)
+ *    ou a pontuação de uma busca (nos grandes).
+ * 2. As posições vão para um arquivo, que
+ *    depois é mapeado na memória (`mmap`) e
+ *    lido direto de lá durante o treino.
+ * 3. Uma cópia da rede em `float` é ajustada
+ *    pelo Adam (um gradiente descendente com
+ *    "inércia"), com cada lote dividido entre
+ *    as threads.
+ * 4. De tempos em tempos, o estado do treino
+ *    vai para `ARQ.ckpt` (para continuar depois)
+ *    e os pesos quantizados para `ARQ`, que o
+ *    cortex `nnue` lê com `--nnue ARQ`.
+ */
+
+/**
+ * Arquivo de posições: um cabeçalho ("CTTD", a
+ * versão, `m`, `n`, `k` e quantas posições) e as
+ * posições em registros de tamanho fixo.
+ */
+#define TRAIN_DATA_MAGIC "CTTD"
+#define TRAIN_DATA_VERSION 1
+#define TRAIN_DATA_HEADER_SIZE 16
+
+/**
+ * Um registro: `x` e `o` (8 bytes cada), a
+ * pontuação da busca (4), quem joga (1), o
+ * resultado para quem joga (1) e 2 bytes vazios.
+ */
+#define TRAIN_RECORD_SIZE 24
+
+/**
+ * Resultados de um registro, do ponto de vista
+ * de quem vai jogar. `TRAIN_RESULT_SCORE` é
+ * quando só existe a pontuação da busca.
+ */
+enum TrainResult
+{
+    TRAIN_RESULT_LOSS = 0,
+    TRAIN_RESULT_DRAW = 1,
+    TRAIN_RESULT_WIN = 2,
+    TRAIN_RESULT_SCORE = 3,
+};
+
+/**
+ * Tabuleiros com até tantas células são
+ * resolvidos por completo numa tabela
+ * (`2 * 3^12` bytes no pior caso).
+ */
+#define SOLVED_TABLE_MAX_CELLS 12
+
+/**
+ * Resultado ainda não calculado na tabela.
+ */
+#define SOLVED_UNKNOWN -128
+
+/**
+ * O resultado (1 vitória, 0 velha, -1 derrota)
+ * de quem vai jogar, com jogo perfeito dos dois
+ * lados, para todas as posições alcançáveis.
+ *
+ * Uma posição vira um número na base 3 (cada
+ * célula é 0 vazia, 1 X ou 2 O), e cada
+ * número tem duas entradas: X ou O para jogar.
+ */
+struct SolvedTable
+{
+    const struct MnkGeometry *geometry;
+    int8_t *results;
+    uint32_t cell_weights[64];
+};
+
+/**
+ * Resolve `board` (e tudo o que vem depois
+ * dele) guardando os resultados na tabela.
+ */
+int solve_position(struct SolvedTable *table, struct MnkBoard *board, uint32_t index)
+{
+    uint32_t slot = (index * 2) + (board->turn == O_ACTOR);
+    if (table->results[slot] != SOLVED_UNKNOWN)
+        return table->results[slot];
+
+    int result = -1;
+    if (board->endgame == GAME_DRAW)
+        result = 0;
+    // Quem jogou por último ganhou.
+    else if (board->endgame == RUNNING)
+    {
+        uint8_t moves[64];
+        size_t len = mnk_moves(board, moves);
+        // Sem parar na primeira vitória: a tabela
+        // precisa ter todas as posições alcançáveis.
+        for (size_t i = 0; i < len; i++)
+        {
+            uint32_t digit = (board->turn == X_ACTOR) ? 1 : 2;
+            mnk_make(board, moves[i]);
+            int score = -solve_position(table, board, index + (digit * table->cell_weights[moves[i]]));
+            mnk_unmake(board, moves[i]);
+            if (score > result)
+                result = score;
+        }
+    }
+
+    table->results[slot] = result;
+    return result;
 }
 
 /**
- * Desenha o quadro da célula da grade.
+ * Monta a tabela de um tabuleiro pequeno,
+ * com X ou O começando.
+ *
+ * Retorna `false` se o tabuleiro for grande
+ * demais ou faltar memória.
  */
-void draw_game_cell_frame(enum Actor actor, bool highlighted)
+bool build_solved_table(struct SolvedTable *table, const struct MnkGeometry *geometry)
 {
-    if (highlighted)
+    if (geometry->cells_len > SOLVED_TABLE_MAX_CELLS)
+        return false;
+
+    uint32_t weight = 1;
+    for (int cell = 0; cell < 64; cell++)
     {
-        set_bold();
-        set_foreground_color(actor_color(actor));
+        table->cell_weights[cell] = 0;
+        if (geometry->cells & ((MnkPrint)1 << cell))
+        {
+            table->cell_weights[cell] = weight;
+            weight *= 3;
+        }
+    }
+
+    table->geometry = geometry;
+    table->results = malloc(weight * 2);
+    if (table->results == NULL)
+        return false;
+    memset(table->results, SOLVED_UNKNOWN, weight * 2);
+
+    for (int starter = X_ACTOR; starter <= O_ACTOR; starter++)
+    {
+        struct MnkBoard board = create_mnk_board(geometry, (enum Actor)starter);
+        solve_position(table, &board, 0);
+    }
+    return true;
+}
+
+/**
+ * O resultado de `board` na tabela.
+ */
+int solved_table_result(const struct SolvedTable *table, const struct MnkBoard *board)
+{
+    uint32_t index = 0;
+    for (int cell = 0; cell < 64; cell++)
+    {
+        if (board->x & ((MnkPrint)1 << cell))
+            index += table->cell_weights[cell];
+        else if (board->o & ((MnkPrint)1 << cell))
+            index += 2 * table->cell_weights[cell];
+    }
+    return table->results[(index * 2) + (board->turn == O_ACTOR)];
+}
+
+/**
+ * Profundidade da busca que dá a pontuação
+ * das posições dos tabuleiros grandes.
+ */
+#define TRAIN_LABEL_DEPTH 3
+
+/**
+ * Quanto de pontuação da busca vira uma
+ * chance de vitória de 73% (a sigmoide de 1).
+ */
+#define TRAIN_SCORE_SCALE 256.0f
+
+/**
+ * Posições geradas por vez por cada thread.
+ * Cada pedaço tem sua própria semente, então
+ * o arquivo sai igual com qualquer número
+ * de threads.
+ */
+#define TRAIN_GEN_CHUNK 256
+
+/**
+ * O trabalho de gerar as posições.
+ */
+struct TrainGenJob
+{
+    const struct MnkGeometry *geometry;
+    /**
+     * `NULL` nos tabuleiros grandes.
+     */
+    const struct SolvedTable *table;
+    uint8_t *records;
+    uint64_t len;
+    uint32_t seed;
+    volatile uint32_t next_chunk;
+};
+
+/**
+ * Um número de 0 a `n - 1` do mesmo gerador
+ * simples da rede (`nnue_random`).
+ */
+static inline uint32_t train_random(uint32_t *seed, uint32_t n)
+{
+    *seed = (*seed * 1103515245u) + 12345u;
+    return (*seed >> 16) % n;
+}
+
+/**
+ * Escreve a posição `board` com o seu
+ * resultado (ou pontuação) no registro.
+ */
+void label_train_position(const struct TrainGenJob *job, struct MnkBoard *board, uint8_t *record)
+{
+    int32_t score = 0;
+    enum TrainResult result = TRAIN_RESULT_SCORE;
+    if (job->table != NULL)
+        result = (enum TrainResult)(solved_table_result(job->table, board) + 1);
+    else
+    {
+        struct PatternEvaluator patterns;
+        pattern_evaluator_reset(&patterns, board);
+        struct MnkEvaluator evaluator =
+        {
+            .data = &patterns,
+            .make = pattern_evaluator_make,
+            .unmake = pattern_evaluator_unmake,
+            .evaluate = pattern_evaluator_evaluate,
+        };
+        uint64_t nodes = 0;
+        score = mnk_search(board, &evaluator, TRAIN_LABEL_DEPTH, -MNK_WIN_SCORE - 1, MNK_WIN_SCORE + 1, &nodes, NULL);
+        // Vitórias e derrotas achadas pela
+        // busca já são resultados certos.
+        if (score > MNK_WIN_SCORE / 2)
+            result = TRAIN_RESULT_WIN;
+        else if (score < -MNK_WIN_SCORE / 2)
+            result = TRAIN_RESULT_LOSS;
+    }
+
+    put_u64le(&record[0], board->x);
+    put_u64le(&record[8], board->o);
+    put_u32le(&record[16], (uint32_t)score);
+    record[20] = board->turn;
+    record[21] = result;
+    record[22] = 0;
+    record[23] = 0;
+}
+
+/**
+ * O que cada thread da geração faz: joga partidas
+ * (metade das jogadas sorteadas, metade a melhor
+ * pela avaliação por janelas) e guarda todas as
+ * posições em andamento.
+ */
+void train_gen_worker(void *a)
+{
+    struct TrainGenJob *job = a;
+    uint64_t chunks = (job->len + TRAIN_GEN_CHUNK - 1) / TRAIN_GEN_CHUNK;
+    uint32_t chunk;
+    while ((chunk = atomic_fetch_add_u32(&job->next_chunk, 1)) < chunks)
+    {
+        uint32_t seed = job->seed ^ (chunk * 2654435761u);
+        uint64_t begin = (uint64_t)chunk * TRAIN_GEN_CHUNK;
+        uint64_t end = (begin + TRAIN_GEN_CHUNK < job->len) ? begin + TRAIN_GEN_CHUNK : job->len;
+
+        uint64_t i = begin;
+        while (i < end)
+        {
+            struct MnkBoard board = create_mnk_board(job->geometry, (enum Actor)(train_random(&seed, 2) + 1));
+            while (i < end && board.endgame == RUNNING)
+            {
+                label_train_position(job, &board, &job->records[i++ * TRAIN_RECORD_SIZE]);
+
+                uint8_t moves[64];
+                size_t len = mnk_moves(&board, moves);
+                uint8_t cell = moves[train_random(&seed, len)];
+                if (train_random(&seed, 2) == 0)
+                {
+                    struct PatternEvaluator patterns;
+                    pattern_evaluator_reset(&patterns, &board);
+                    struct MnkEvaluator evaluator =
+                    {
+                        .data = &patterns,
+                        .make = pattern_evaluator_make,
+                        .unmake = pattern_evaluator_unmake,
+                        .evaluate = pattern_evaluator_evaluate,
+                    };
+                    uint64_t nodes = 0;
+                    cell = mnk_best_move(&board, &evaluator, 1, &nodes, NULL);
+                }
+                mnk_make(&board, cell);
+            }
+        }
+    }
+}
+
+/**
+ * Gera `len` posições em `path` com
+ * até `threads` threads.
+ *
+ * Retorna `false` se não der para gravar.
+ */
+bool generate_train_dataset(const char *path, const struct MnkGeometry *geometry, uint64_t len, uint32_t seed, unsigned int threads)
+{
+    struct SolvedTable table;
+    bool has_table = build_solved_table(&table, geometry);
+
+    struct TrainGenJob job =
+    {
+        .geometry = geometry,
+        .table = has_table ? &table : NULL,
+        .records = malloc(len * TRAIN_RECORD_SIZE),
+        .len = len,
+        .seed = seed,
+        .next_chunk = 0,
+    };
+    if (job.records == NULL)
+    {
+        if (has_table)
+            free(table.results);
+        return false;
+    }
+
+    // A thread atual também trabalha.
+    struct WorkerThread *workers = calloc(threads, sizeof(struct WorkerThread));
+    unsigned int started = 0;
+    while (workers != NULL && started + 1 < threads && start_worker_thread(&workers[started], train_gen_worker, &job))
+        started++;
+    train_gen_worker(&job);
+    for (unsigned int i = 0; i < started; i++)
+        join_worker_thread(&workers[i]);
+    free(workers);
+    if (has_table)
+        free(table.results);
+
+    uint8_t header[TRAIN_DATA_HEADER_SIZE] = TRAIN_DATA_MAGIC;
+    header[4] = TRAIN_DATA_VERSION;
+    header[5] = geometry->m;
+    header[6] = geometry->n;
+    header[7] = geometry->k;
+    put_u64le(&header[8], len);
+
+    FILE *file = fopen(path, "wb");
+    bool ok = file != NULL
+        && fwrite(header, 1, sizeof(header), file) == sizeof(header)
+        && fwrite(job.records, TRAIN_RECORD_SIZE, len, file) == len;
+    if (file != NULL && fclose(file) != 0)
+        ok = false;
+    free(job.records);
+    return ok;
+}
+
+/**
+ * Um arquivo mapeado na memória, só para leitura:
+ * o sistema traz as partes do arquivo conforme
+ * elas são lidas, sem copiar tudo antes.
+ */
+struct MappedFile
+{
+    const uint8_t *bytes;
+    size_t len;
+#if defined (_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+/**
+ * Mapeia o arquivo `path` inteiro.
+ *
+ * Retorna `false` se ele não existir,
+ * estiver vazio ou não puder ser mapeado.
+ */
+bool map_file(struct MappedFile *mapped, const char *path)
+{
+#if defined (_WIN32)
+    mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mapped->file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapped->file, &size) || size.QuadPart == 0)
+        goto FAIL;
+    mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapped->mapping == NULL)
+        goto FAIL;
+    mapped->bytes = MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mapped->bytes == NULL)
+    {
+        CloseHandle(mapped->mapping);
+        goto FAIL;
+    }
+    mapped->len = (size_t)size.QuadPart;
+    return true;
+
+    FAIL:;
+    CloseHandle(mapped->file);
+    return false;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *bytes = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // O mapeamento continua valendo sem o arquivo aberto.
+    close(fd);
+    if (bytes == MAP_FAILED)
+        return false;
+    mapped->bytes = bytes;
+    mapped->len = info.st_size;
+    return true;
+#endif
+}
+
+/**
+ * Desfaz o mapeamento.
+ */
+void unmap_file(struct MappedFile *mapped)
+{
+#if defined (_WIN32)
+    UnmapViewOfFile(mapped->bytes);
+    CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+#else
+    munmap((void *)mapped->bytes, mapped->len);
+#endif
+}
+
+/**
+ * A rede em `float`, com os mesmos tamanhos
+ * da `NnueWeights`, onde 1.0 vale 1.0 mesmo.
+ *
+ * Só tem `float`s, então também pode ser
+ * vista como um vetor de `NNUE_PARAM_COUNT`.
+ */
+struct NnueParams
+{
+    float feature_weights[NNUE_FEATURES][NNUE_HIDDEN];
+    float feature_bias[NNUE_HIDDEN];
+    float l1_weights[NNUE_L1][2 * NNUE_HIDDEN];
+    float l1_bias[NNUE_L1];
+    float l2_weights[NNUE_L1];
+    float l2_bias;
+};
+
+#define NNUE_PARAM_COUNT (sizeof(struct NnueParams) / sizeof(float))
+
+/**
+ * O maior peso int8, em `float`.
+ */
+#define NNUE_MAX_INT8_WEIGHT (127.0f / (1 << NNUE_WEIGHT_SHIFT))
+
+/**
+ * Arredonda e limita um valor.
+ */
+static inline int32_t nnue_quantize(float value, float scale, int32_t limit)
+{
+    float scaled = roundf(value * scale);
+    return (scaled > limit) ? limit : ((scaled < -limit) ? -limit : (int32_t)scaled);
+}
+
+/**
+ * Converte a rede em `float` para os
+ * inteiros que a `NnueEvaluator` usa.
+ */
+void quantize_nnue_params(const struct NnueParams *params, const struct MnkGeometry *geometry, struct NnueWeights *weights)
+{
+    const float l1_scale = 127.0f * (1 << NNUE_WEIGHT_SHIFT);
+
+    weights->m = geometry->m;
+    weights->n = geometry->n;
+    weights->k = geometry->k;
+    for (int f = 0; f < NNUE_FEATURES; f++)
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+            weights->feature_weights[f][j] = nnue_quantize(params->feature_weights[f][j], 127, INT16_MAX);
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+        weights->feature_bias[j] = nnue_quantize(params->feature_bias[j], 127, INT16_MAX);
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++)
+            weights->l1_weights[o][j] = nnue_quantize(params->l1_weights[o][j], 1 << NNUE_WEIGHT_SHIFT, INT8_MAX);
+        weights->l1_bias[o] = nnue_quantize(params->l1_bias[o], l1_scale, INT32_MAX / 2);
+        weights->l2_weights[o] = nnue_quantize(params->l2_weights[o], 1 << NNUE_WEIGHT_SHIFT, INT8_MAX);
+    }
+    weights->l2_bias = nnue_quantize(params->l2_bias, l1_scale, INT32_MAX / 2);
+}
+
+/**
+ * Sorteia os pesos iniciais do treino,
+ * menores nas camadas com mais entradas.
+ */
+void init_nnue_params(struct NnueParams *params, uint32_t seed)
+{
+    for (int f = 0; f < NNUE_FEATURES; f++)
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+            params->feature_weights[f][j] = nnue_random(&seed, 1000) * 0.0002f;
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+        params->feature_bias[j] = 0.5f;
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++)
+            params->l1_weights[o][j] = nnue_random(&seed, 1000) * 0.000125f;
+        params->l1_bias[o] = 0.5f;
+        params->l2_weights[o] = nnue_random(&seed, 1000) * 0.0002f;
+    }
+    params->l2_bias = 0;
+}
+
+/**
+ * Lê um registro do arquivo de posições e
+ * diz o valor esperado para a rede (de 0, a
+ * derrota, a 1, a vitória de quem vai jogar).
+ */
+float read_train_record(const uint8_t *record, MnkPrint *x, MnkPrint *o, enum Actor *turn)
+{
+    *x = get_u64le(&record[0]);
+    *o = get_u64le(&record[8]);
+    *turn = (record[20] == O_ACTOR) ? O_ACTOR : X_ACTOR;
+    if (record[21] == TRAIN_RESULT_SCORE)
+        return 1.0f / (1.0f + expf(-(float)(int32_t)get_u32le(&record[16]) / TRAIN_SCORE_SCALE));
+    return record[21] * 0.5f;
+}
+
+/**
+ * Roda a rede em `float` numa posição e soma
+ * em `grads` o gradiente do erro (a diferença
+ * ao quadrado entre a saída, passada pela
+ * sigmoide, e `target`). Retorna o erro.
+ */
+float train_nnue_sample(const struct NnueParams *params, struct NnueParams *grads, MnkPrint x, MnkPrint o, enum Actor turn, float target)
+{
+    MnkPrint pieces[2] = {(turn == X_ACTOR) ? x : o, (turn == X_ACTOR) ? o : x};
+
+    // As entradas ligadas de cada acumulador
+    // ([0] de quem joga, [1] do oponente).
+    uint8_t features[2][64];
+    int features_len[2] = {0};
+    for (int p = 0; p < 2; p++)
+        for (int side = 0; side < 2; side++)
+        {
+            MnkPrint bits = pieces[(p + side) % 2];
+            while (bits != 0)
+            {
+                features[p][features_len[p]++] = (side * 64) + mnk_lowest_bit(bits);
+                bits &= bits - 1;
+            }
+        }
+
+    float accumulators[2 * NNUE_HIDDEN];
+    float input[2 * NNUE_HIDDEN];
+    for (int p = 0; p < 2; p++)
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+        {
+            float sum = params->feature_bias[j];
+            for (int f = 0; f < features_len[p]; f++)
+                sum += params->feature_weights[features[p][f]][j];
+            accumulators[(p * NNUE_HIDDEN) + j] = sum;
+            input[(p * NNUE_HIDDEN) + j] = (sum < 0) ? 0 : ((sum > 1) ? 1 : sum);
+        }
+
+    float layer1[NNUE_L1];
+    float hidden[NNUE_L1];
+    float output = params->l2_bias;
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        float sum = params->l1_bias[o];
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++)
+            sum += params->l1_weights[o][j] * input[j];
+        layer1[o] = sum;
+        hidden[o] = (sum < 0) ? 0 : ((sum > 1) ? 1 : sum);
+        output += params->l2_weights[o] * hidden[o];
+    }
+
+    // E agora de trás para frente (a "retropropagação").
+    float predicted = 1.0f / (1.0f + expf(-output));
+    float error = predicted - target;
+    float d_output = 2 * error * predicted * (1 - predicted);
+
+    float d_input[2 * NNUE_HIDDEN] = {0};
+    grads->l2_bias += d_output;
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        grads->l2_weights[o] += d_output * hidden[o];
+        // Fora de 0..1 a saída não muda.
+        if (layer1[o] <= 0 || layer1[o] >= 1)
+            continue;
+        float d_layer1 = d_output * params->l2_weights[o];
+        grads->l1_bias[o] += d_layer1;
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++)
+        {
+            grads->l1_weights[o][j] += d_layer1 * input[j];
+            d_input[j] += d_layer1 * params->l1_weights[o][j];
+        }
+    }
+
+    for (int p = 0; p < 2; p++)
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+        {
+            float value = accumulators[(p * NNUE_HIDDEN) + j];
+            if (value <= 0 || value >= 1)
+                continue;
+            float d_accumulator = d_input[(p * NNUE_HIDDEN) + j];
+            grads->feature_bias[j] += d_accumulator;
+            for (int f = 0; f < features_len[p]; f++)
+                grads->feature_weights[features[p][f]][j] += d_accumulator;
+        }
+
+    return error * error;
+}
+
+/**
+ * Uma fatia de um lote, para uma thread.
+ */
+struct TrainSlice
+{
+    const struct NnueParams *params;
+    const uint8_t *records;
+    const uint32_t *order;
+    size_t begin;
+    size_t end;
+    struct NnueParams grads;
+    double loss;
+};
+
+/**
+ * O que cada thread do treino faz: soma os
+ * gradientes das posições da sua fatia.
+ */
+void train_slice_worker(void *a)
+{
+    struct TrainSlice *slice = a;
+    memset(&slice->grads, 0, sizeof(struct NnueParams));
+    slice->loss = 0;
+    for (size_t i = slice->begin; i < slice->end; i++)
+    {
+        MnkPrint x, o;
+        enum Actor turn;
+        float target = read_train_record(&slice->records[(size_t)slice->order[i] * TRAIN_RECORD_SIZE], &x, &o, &turn);
+        slice->loss += train_nnue_sample(slice->params, &slice->grads, x, o, turn, target);
+    }
+}
+
+/**
+ * O estado do Adam: a média dos gradientes
+ * (`moment`), a média dos quadrados (`velocity`)
+ * e quantos passos já foram dados.
+ */
+struct AdamState
+{
+    struct NnueParams moment;
+    struct NnueParams velocity;
+    uint32_t steps;
+};
+
+#define ADAM_LEARNING_RATE 0.002f
+#define ADAM_BETA1 0.9f
+#define ADAM_BETA2 0.999f
+#define ADAM_EPSILON 1e-8f
+
+/**
+ * Dá um passo do Adam com o gradiente médio
+ * `grads` e mantém os pesos das camadas int8
+ * dentro do que cabe num int8.
+ */
+void adam_step(struct NnueParams *params, struct AdamState *adam, const struct NnueParams *grads)
+{
+    adam->steps++;
+    float correction1 = 1 - powf(ADAM_BETA1, adam->steps);
+    float correction2 = 1 - powf(ADAM_BETA2, adam->steps);
+
+    float *values = (float *)params;
+    float *moment = (float *)&adam->moment;
+    float *velocity = (float *)&adam->velocity;
+    const float *gradient = (const float *)grads;
+    for (size_t i = 0; i < NNUE_PARAM_COUNT; i++)
+    {
+        moment[i] = (ADAM_BETA1 * moment[i]) + ((1 - ADAM_BETA1) * gradient[i]);
+        velocity[i] = (ADAM_BETA2 * velocity[i]) + ((1 - ADAM_BETA2) * gradient[i] * gradient[i]);
+        values[i] -= ADAM_LEARNING_RATE * (moment[i] / correction1) / (sqrtf(velocity[i] / correction2) + ADAM_EPSILON);
+    }
+
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++)
+            params->l1_weights[o][j] = fmaxf(-NNUE_MAX_INT8_WEIGHT, fminf(NNUE_MAX_INT8_WEIGHT, params->l1_weights[o][j]));
+        params->l2_weights[o] = fmaxf(-NNUE_MAX_INT8_WEIGHT, fminf(NNUE_MAX_INT8_WEIGHT, params->l2_weights[o]));
+    }
+}
+
+/**
+ * Arquivo de "checkpoint": "CTTK", a versão,
+ * `m`, `n`, `k`, a época e os passos, e depois os pesos e o
+ * estado do Adam (cada `float` como 4 bytes
+ * em "little-endian").
+ */
+#define TRAIN_CHECKPOINT_MAGIC "CTTK"
+#define TRAIN_CHECKPOINT_VERSION 1
+#define TRAIN_CHECKPOINT_SIZE (16 + (3 * NNUE_PARAM_COUNT * 4))
+
+/**
+ * Grava o estado do treino em `path`.
+ */
+bool save_train_checkpoint(const char *path, const struct MnkGeometry *geometry, const struct NnueParams *params, const struct AdamState *adam, uint32_t epoch)
+{
+    uint8_t *bytes = malloc(TRAIN_CHECKPOINT_SIZE);
+    if (bytes == NULL)
+        return false;
+
+    memcpy(bytes, TRAIN_CHECKPOINT_MAGIC, 4);
+    bytes[4] = TRAIN_CHECKPOINT_VERSION;
+    bytes[5] = geometry->m;
+    bytes[6] = geometry->n;
+    bytes[7] = geometry->k;
+    put_u32le(&bytes[8], epoch);
+    put_u32le(&bytes[12], adam->steps);
+
+    const float *parts[3] = {(const float *)params, (const float *)&adam->moment, (const float *)&adam->velocity};
+    uint8_t *p = &bytes[16];
+    for (int part = 0; part < 3; part++)
+        for (size_t i = 0; i < NNUE_PARAM_COUNT; i++, p += 4)
+        {
+            uint32_t bits;
+            memcpy(&bits, &parts[part][i], 4);
+            put_u32le(p, bits);
+        }
+
+    FILE *file = fopen(path, "wb");
+    bool ok = file != NULL && fwrite(bytes, 1, TRAIN_CHECKPOINT_SIZE, file) == TRAIN_CHECKPOINT_SIZE;
+    if (file != NULL && fclose(file) != 0)
+        ok = false;
+    free(bytes);
+    return ok;
+}
+
+/**
+ * Lê um estado de treino gravado.
+ *
+ * Retorna `false` se o arquivo não existir
+ * ou não for um checkpoint do mesmo tabuleiro.
+ */
+bool load_train_checkpoint(const char *path, const struct MnkGeometry *geometry, struct NnueParams *params, struct AdamState *adam, uint32_t *epoch)
+{
+    struct MappedFile mapped;
+    if (!map_file(&mapped, path))
+        return false;
+    const uint8_t *bytes = mapped.bytes;
+    if (mapped.len != TRAIN_CHECKPOINT_SIZE || memcmp(bytes, TRAIN_CHECKPOINT_MAGIC, 4) != 0
+        || bytes[4] != TRAIN_CHECKPOINT_VERSION
+        || bytes[5] != geometry->m || bytes[6] != geometry->n || bytes[7] != geometry->k)
+    {
+        unmap_file(&mapped);
+        return false;
+    }
+
+    *epoch = get_u32le(&bytes[8]);
+    adam->steps = get_u32le(&bytes[12]);
+    float *parts[3] = {(float *)params, (float *)&adam->moment, (float *)&adam->velocity};
+    const uint8_t *p = &bytes[16];
+    for (int part = 0; part < 3; part++)
+        for (size_t i = 0; i < NNUE_PARAM_COUNT; i++, p += 4)
+        {
+            uint32_t bits = get_u32le(p);
+            memcpy(&parts[part][i], &bits, 4);
+        }
+
+    unmap_file(&mapped);
+    return true;
+}
+
+/**
+ * Posições por passo do Adam (divididas
+ * entre as threads).
+ */
+#define TRAIN_BATCH 4096
+
+/**
+ * De quantas em quantas épocas gravar o
+ * checkpoint e os pesos.
+ */
+#define TRAIN_CHECKPOINT_EPOCHS 5
+
+/**
+ * Treina os pesos do cortex `nnue` (veja
+ * o começo desta parte) e grava em
+ * `program_options.train_path`.
+ */
+int train_session()
+{
+    const char *out_path = program_options.train_path;
+    char dataset_path[1024];
+    char checkpoint_path[1024];
+    if (program_options.dataset_path != NULL)
+        snprintf(dataset_path, sizeof(dataset_path), "%s", program_options.dataset_path);
+    else
+        snprintf(dataset_path, sizeof(dataset_path), "%s.data", out_path);
+    snprintf(checkpoint_path, sizeof(checkpoint_path), "%s.ckpt", out_path);
+
+    int m = 3, n = 3, k = 3;
+    if (program_options.board != NULL && sscanf(program_options.board, "%d,%d,%d", &m, &n, &k) != 3)
+        m = 0;
+    // A geometria é grande demais para a pilha.
+    struct MnkGeometry *geometry = malloc(sizeof(struct MnkGeometry));
+    if (geometry == NULL || !build_mnk_geometry(geometry, m, n, k))
+    {
+        fprintf(stderr, "Tabuleiro inválido: %s\n", program_options.board);
+        free(geometry);
+        return 1;
+    }
+
+    unsigned int threads = (program_options.threads > 0) ? program_options.threads : cpu_count();
+    uint32_t seed = program_options.has_seed ? program_options.seed : 45;
+
+    struct MappedFile dataset;
+    if (!map_file(&dataset, dataset_path))
+    {
+        uint64_t len = (program_options.train_positions > 0) ? program_options.train_positions : 200000;
+        printf("Gerando %llu posições em %s (%u threads)...\n", (unsigned long long)len, dataset_path, threads);
+        uint64_t start = monotonic_ns();
+        if (!generate_train_dataset(dataset_path, geometry, len, seed, threads) || !map_file(&dataset, dataset_path))
+        {
+            perror(dataset_path);
+            free(geometry);
+            return 1;
+        }
+        double seconds = (monotonic_ns() - start) / 1e9;
+        printf("Tempo: %.3f s (%.0f posições/s)\n\n", seconds, len / ((seconds > 0) ? seconds : 1e-9));
+    }
+
+    const uint8_t *header = dataset.bytes;
+    uint64_t len = (dataset.len >= TRAIN_DATA_HEADER_SIZE) ? get_u64le(&header[8]) : 0;
+    if (dataset.len < TRAIN_DATA_HEADER_SIZE || memcmp(header, TRAIN_DATA_MAGIC, 4) != 0
+        || header[4] != TRAIN_DATA_VERSION || len == 0 || len > UINT32_MAX
+        || dataset.len != TRAIN_DATA_HEADER_SIZE + (len * TRAIN_RECORD_SIZE)
+        || header[5] != geometry->m || header[6] != geometry->n || header[7] != geometry->k)
+    {
+        fprintf(stderr, "%s: não é um arquivo de posições válido para %d,%d,%d\n", dataset_path, m, n, k);
+        unmap_file(&dataset);
+        free(geometry);
+        return 1;
     }
+    const uint8_t *records = &dataset.bytes[TRAIN_DATA_HEADER_SIZE];
+
+    struct NnueParams *params = malloc(sizeof(struct NnueParams));
+    struct AdamState *adam = calloc(1, sizeof(struct AdamState));
+    struct TrainSlice *slices = malloc(threads * sizeof(struct TrainSlice));
+    struct WorkerThread *workers = calloc(threads, sizeof(struct WorkerThread));
+    uint32_t *order = malloc(len * sizeof(uint32_t));
+    struct NnueWeights *weights = malloc(sizeof(struct NnueWeights));
+    int status = 1;
+    if (params == NULL || adam == NULL || slices == NULL || workers == NULL || order == NULL || weights == NULL)
+        goto FREE_ALL;
+
+    uint32_t epoch = 0;
+    if (load_train_checkpoint(checkpoint_path, geometry, params, adam, &epoch))
+        printf("Continuando de %s (época %u)\n", checkpoint_path, epoch);
     else
-        set_dim();
+        init_nnue_params(params, seed);
 
-    printf("╭───╮");
-    move_cursor(vec2(-5, 1));
+    unsigned long epochs = (program_options.epochs > 0) ? program_options.epochs : 30;
+    printf("Treinando com %llu posições de %s, %u threads\n\n",
+        (unsigned long long)len, dataset_path, threads);
+    printf("%-8s %12s %14s\n", "época", "erro", "posições/s");
 
-    printf("│");
-    move_cursor(vec2(3, 0));
-    printf("│");
-    move_cursor(vec2(-5, 1));
+    for (; epoch < epochs; epoch++)
+    {
+        // Embaralha a ordem das posições a cada
+        // época, sempre a partir da ordem original,
+        // para a mesma época sair igual mesmo
+        // continuando de um `.ckpt`.
+        for (size_t i = 0; i < len; i++)
+            order[i] = i;
+        uint32_t shuffle_seed = seed + epoch;
+        for (size_t i = len - 1; i > 0; i--)
+        {
+            uint32_t j = ((uint64_t)train_random(&shuffle_seed, 65536) << 16 | train_random(&shuffle_seed, 65536)) % (i + 1);
+            uint32_t swap = order[i];
+            order[i] = order[j];
+            order[j] = swap;
+        }
 
-    printf("╰───╯");
-    move_cursor(vec2(-5, -2));
+        double loss = 0;
+        uint64_t start = monotonic_ns();
+        for (size_t begin = 0; begin < len; begin += TRAIN_BATCH)
+        {
+            size_t end = (begin + TRAIN_BATCH < len) ? begin + TRAIN_BATCH : len;
+            size_t per_thread = (end - begin + threads - 1) / threads;
+            for (unsigned int t = 0; t < threads; t++)
+            {
+                slices[t].params = params;
+                slices[t].records = records;
+                slices[t].order = order;
+                slices[t].begin = (begin + (t * per_thread) < end) ? begin + (t * per_thread) : end;
+                slices[t].end = (slices[t].begin + per_thread < end) ? slices[t].begin + per_thread : end;
+            }
 
-    reset_formatting();
+            // A thread atual fica com a última fatia.
+            unsigned int started = 0;
+            while (started + 1 < threads && start_worker_thread(&workers[started], train_slice_worker, &slices[started]))
+                started++;
+            for (unsigned int t = started; t < threads; t++)
+                train_slice_worker(&slices[t]);
+            for (unsigned int t = 0; t < started; t++)
+                join_worker_thread(&workers[t]);
+
+            // O gradiente do lote é a média dos de cada posição.
+            float *sum = (float *)&slices[0].grads;
+            for (unsigned int t = 1; t < threads; t++)
+            {
+                const float *part = (const float *)&slices[t].grads;
+                for (size_t i = 0; i < NNUE_PARAM_COUNT; i++)
+                    sum[i] += part[i];
+            }
+            for (size_t i = 0; i < NNUE_PARAM_COUNT; i++)
+                sum[i] /= (float)(end - begin);
+            for (unsigned int t = 0; t < threads; t++)
+                loss += slices[t].loss;
+
+            adam_step(params, adam, &slices[0].grads);
+        }
+        double seconds = (monotonic_ns() - start) / 1e9;
+        printf("%-7u %12.5f %12.0f\n", epoch + 1, loss / len, len / ((seconds > 0) ? seconds : 1e-9));
+
+        bool last = epoch + 1 == epochs;
+        if ((epoch + 1) % TRAIN_CHECKPOINT_EPOCHS == 0 || last)
+        {
+            quantize_nnue_params(params, geometry, weights);
+            if (!save_train_checkpoint(checkpoint_path, geometry, params, adam, epoch + 1)
+                || !save_nnue_weights(weights, out_path))
+            {
+                perror(out_path);
+                goto FREE_ALL;
+            }
+        }
+    }
+
+    // Quantas posições com vencedor certo a rede
+    // quantizada acerta só pelo sinal da saída.
+    quantize_nnue_params(params, geometry, weights);
+    uint64_t decided = 0, agreed = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        const uint8_t *record = &records[i * TRAIN_RECORD_SIZE];
+        if (record[21] != TRAIN_RESULT_WIN && record[21] != TRAIN_RESULT_LOSS)
+            continue;
+
+        struct MnkBoard board = create_mnk_board(geometry, X_ACTOR);
+        read_train_record(record, &board.x, &board.o, &board.turn);
+        struct NnueEvaluator network;
+        nnue_evaluator_reset(&network, weights, &board);
+        int score = nnue_evaluator_evaluate(&network, board.turn);
+        decided++;
+        agreed += (score > 0) == (record[21] == TRAIN_RESULT_WIN);
+    }
+    printf("\nAcertos (vitória ou derrota): %.1f%% de %llu posições\n",
+        100.0 * agreed / ((decided > 0) ? decided : 1), (unsigned long long)decided);
+    printf("Pesos gravados em %s (use --nnue %s)\n", out_path, out_path);
+    status = 0;
+
+    FREE_ALL:;
+    unmap_file(&dataset);
+    free(geometry);
+    free(params);
+    free(adam);
+    free(slices);
+    free(workers);
+    free(order);
+    free(weights);
+    return status;
 }
 
 /**
- * Desenha uma célula individual
- * da grade do jogo.
+ * Quantas partidas cada rodada do
+ * treino da tabela (`--rl-train`) tem.
  */
-void draw_game_cell(enum Actor actor, enum Move move, bool highlighted)
-{
-    draw_game_cell_frame(actor, highlighted);
-    move_cursor(vec2(2, 1));
-    draw_game_move(move);
-    move_cursor(vec2(-3, -1));
-}
+#define RL_ROUND_GAMES 20000
 
 /**
- * Desenha o tabuleiro do jogo,
- * mais precisamente, as células.
+ * Chance (em 1/N) de uma jogada do treino ser
+ * sorteada em vez da melhor, para a tabela
+ * conhecer posições que ela ainda acha ruins.
  *
- * `highlight` escolhe a cor baseado
- * no `actor`.
+ * Além disso, cada partida começa com 0 a 9
+ * jogadas sorteadas, senão as posições onde
+ * os dois lados erram várias vezes seguidas
+ * quase nunca aparecem.
  */
-void render_game_board(GameBoard board, enum Actor actor, MovePrint highlight)
+#define RL_EXPLORATION 4
+
+/**
+ * O trabalho de uma rodada do treino.
+ */
+struct RlTrainJob
 {
-    for (int y = 0; y < 3; y++)
+    struct RlTable *table;
+    const struct MnkGeometry *geometry;
+    uint32_t first_game;
+    uint32_t games;
+    uint32_t seed;
+    volatile uint32_t next_game;
+};
+
+/**
+ * O que cada thread do treino faz: joga
+ * partidas contra ela mesma e, a cada
+ * jogada, aproxima o valor da posição
+ * resultante do que ela realmente vale:
+ *  - se o jogo acabou, 1, 0.5 ou 0;
+ *  - se não, 1 menos o valor da melhor
+ *    resposta do oponente (o "Q-learning":
+ *    aprende o valor do jogo perfeito
+ *    mesmo jogando às vezes ao acaso).
+ */
+void rl_train_worker(void *a)
+{
+    struct RlTrainJob *job = a;
+    uint32_t game;
+    while ((game = atomic_fetch_add_u32(&job->next_game, 1)) < job->games)
     {
-        int moved_x = 0;
+        uint32_t seed = job->seed ^ ((job->first_game + game) * 2654435761u);
+        struct MnkBoard board = create_mnk_board(job->geometry, (enum Actor)(train_random(&seed, 2) + 1));
+        uint32_t random_moves = train_random(&seed, 10);
 
-        for (int x = 0; x < 3; x++)
+        while (board.endgame == RUNNING)
         {
-            struct Vec2 pos = {x, y};
-
-            bool highlighted = move_print_inspec(highlight, pos);
-            enum Move move_in_cell = game_board_cell(board, pos);
-
-            draw_game_cell(actor, move_in_cell, highlighted);
+            enum Actor mover = board.turn;
+            uint32_t value;
+            uint8_t cell = rl_best_move(job->table, &board, &value);
+            if (board.moves < random_moves || train_random(&seed, RL_EXPLORATION) == 0)
+            {
+                uint8_t moves[64];
+                size_t len = mnk_moves(&board, moves);
+                cell = moves[train_random(&seed, len)];
+            }
+            mnk_make(&board, cell);
 
-            moved_x += 5;
-            move_cursor(vec2(5, 0));
+            uint32_t target;
+            if (board.endgame == GAME_DRAW)
+                target = RL_VALUE_ONE / 2;
+            else if (board.endgame != RUNNING)
+                target = RL_VALUE_ONE;
+            else
+            {
+                uint32_t reply_value;
+                rl_best_move(job->table, &board, &reply_value);
+                target = RL_VALUE_ONE - reply_value;
+            }
+            rl_update(job->table, rl_position_slot(board.x, board.o, mover), target);
         }
-
-        move_cursor(vec2(-moved_x, 3));
     }
 }
 
 /**
- * É como `render_game_board`, mas possui
- * uma animação "pintando" as células.
+ * As posições usadas para ver se a tabela
+ * já aprendeu o jogo perfeito: todas as
+ * alcançáveis (uma de cada simetria), com o
+ * valor certo tirado da `SolvedTable`.
  */
-void animate_board_rendering(GameBoard board, enum Actor actor, MovePrint highlight)
+struct RlReference
 {
-    int highlighted_len = move_print_count(highlight);
-    struct Vec2 highlighted_coords[9] = {0};
-    move_print_coords(highlight, highlighted_coords);
+    /**
+     * Posições logo depois de uma jogada,
+     * com a entrada e o valor certo.
+     */
+    uint32_t *after_slots;
+    uint32_t *after_values;
+    size_t after_len;
+    /**
+     * Posições em andamento, para ver
+     * se a jogada escolhida é ótima.
+     */
+    struct MnkBoard *positions;
+    size_t positions_len;
+};
 
-    block_delay(100);
+/**
+ * Visita tudo o que é alcançável a
+ * partir de `board`, uma vez cada.
+ */
+void collect_rl_reference(struct RlReference *reference, const struct SolvedTable *solved, struct MnkBoard *board, bool *seen_after, bool *seen_positions)
+{
+    if (board->endgame != RUNNING)
+        return;
 
-    MovePrint animated_highlight = 0;
-    for (int i = 0; i <= highlighted_len; i++)
-    {
-        render_game_board(board, actor, animated_highlight);
-        edit_move_print(&animated_highlight, highlighted_coords[i], true);
+    // A mesma entrada serve para "quem vai jogar".
+    uint32_t slot = rl_position_slot(board->x, board->o, board->turn);
+    if (seen_positions[slot])
+        return;
+    seen_positions[slot] = true;
+    reference->positions[reference->positions_len++] = *board;
 
-        if (i < highlighted_len)
+    uint8_t moves[64];
+    size_t len = mnk_moves(board, moves);
+    for (size_t i = 0; i < len; i++)
+    {
+        enum Actor mover = board->turn;
+        mnk_make(board, moves[i]);
+        uint32_t after = rl_position_slot(board->x, board->o, mover);
+        if (!seen_after[after])
         {
-            move_cursor(vec2(0, -9));
-            block_delay(50);
+            seen_after[after] = true;
+            // O resultado da tabela é de quem vai jogar
+            // agora, o oposto de quem acabou de jogar.
+            int result = (board->endgame == RUNNING) ? -solved_table_result(solved, board)
+                : ((board->endgame == GAME_DRAW) ? 0 : 1);
+            reference->after_slots[reference->after_len] = after;
+            reference->after_values[reference->after_len++] = (uint32_t)(result + 1) * (RL_VALUE_ONE / 2);
         }
+        collect_rl_reference(reference, solved, board, seen_after, seen_positions);
+        mnk_unmake(board, moves[i]);
     }
 }
 
 /**
- * Animação de preenchimento utilizada
- * quando o jogo da em velha.
+ * Confere a tabela: quantos valores estão a menos
+ * de 1/4 do certo (`values_ok`) e quantas posições
+ * têm como melhor jogada uma jogada ótima (`moves_ok`).
  */
-void game_board_fill_animation(GameBoard board, enum Actor turn, MovePrint missing)
+void check_rl_table(const struct RlTable *table, const struct RlReference *reference, const struct SolvedTable *solved, size_t *values_ok, size_t *moves_ok)
 {
-    int missing_len = move_print_count(missing);
-    struct Vec2 missing_coords[3] = {0};
-    move_print_coords(missing, missing_coords);
+    *values_ok = 0;
+    for (size_t i = 0; i < reference->after_len; i++)
+    {
+        int32_t diff = (int32_t)atomic_load_u32(&table->values[reference->after_slots[i]]) - (int32_t)reference->after_values[i];
+        *values_ok += diff > -(int32_t)(RL_VALUE_ONE / 4) && diff < (int32_t)(RL_VALUE_ONE / 4);
+    }
 
-    uint8_t animated = 0;
+    *moves_ok = 0;
+    for (size_t i = 0; i < reference->positions_len; i++)
+    {
+        struct MnkBoard board = reference->positions[i];
+        int best = solved_table_result(solved, &board);
+        uint32_t value;
+        mnk_make(&board, rl_best_move(table, &board, &value));
+        int chosen = (board.endgame == RUNNING) ? -solved_table_result(solved, &board)
+            : ((board.endgame == GAME_DRAW) ? 0 : 1);
+        *moves_ok += chosen == best;
+    }
+}
 
-    render_game_board(board, NULL_ACTOR, 0);
-    move_cursor(vec2(0, -9));
+/**
+ * Treina a tabela do cortex `rl` com
+ * partidas em várias threads, mostrando
+ * a vazão e quanto ela já acerta, e grava
+ * em `program_options.rl_train_path`.
+ */
+int rl_train_session()
+{
+    const char *path = program_options.rl_train_path;
+    const struct MnkGeometry *geometry = get_classic_mnk_geometry();
+    unsigned int threads = (program_options.threads > 0) ? program_options.threads : cpu_count();
+    uint32_t seed = program_options.has_seed ? program_options.seed : 46;
+    unsigned long total_games = (program_options.rl_games > 0) ? program_options.rl_games : 200000;
+
+    struct RlTable *table = malloc(sizeof(struct RlTable));
+    struct SolvedTable solved;
+    struct RlReference reference =
+    {
+        .after_slots = malloc(RL_TABLE_SIZE * sizeof(uint32_t)),
+        .after_values = malloc(RL_TABLE_SIZE * sizeof(uint32_t)),
+        .positions = malloc(RL_TABLE_SIZE * sizeof(struct MnkBoard)),
+    };
+    bool *seen = calloc(2 * RL_TABLE_SIZE, sizeof(bool));
+    struct WorkerThread *workers = calloc(threads, sizeof(struct WorkerThread));
+    int status = 1;
+    bool has_solved = build_solved_table(&solved, geometry);
+    if (table == NULL || !has_solved || reference.after_slots == NULL || reference.after_values == NULL
+        || reference.positions == NULL || seen == NULL || workers == NULL)
+        goto FREE_ALL;
+
+    for (int starter = X_ACTOR; starter <= O_ACTOR; starter++)
+    {
+        struct MnkBoard board = create_mnk_board(geometry, (enum Actor)starter);
+        collect_rl_reference(&reference, &solved, &board, seen, &seen[RL_TABLE_SIZE]);
+    }
 
-    block_delay(300);
+    if (load_rl_table(table, path))
+        printf("Continuando de %s\n", path);
+    else
+        reset_rl_table(table);
 
-    for (int i = 0; i < missing_len; i++)
-    {
-        int selection = 0; do
-            selection = rand() % missing_len;
-        while (animated & (1 << selection));
+    printf("Treinando %lu partidas, %u threads (%zu posições depois de jogadas, %zu posições em andamento)\n\n",
+        total_games, threads, reference.after_len, reference.positions_len);
+    // "núcleo" e "ótimas" têm letras de 2 bytes.
+    printf("%-8s %12s %21s %14s %16s\n", "rodada", "partidas", "partidas/s/núcleo", "valores", "jogadas ótimas");
 
-        set_game_board_cell(board, missing_coords[selection], actor_to_move(turn));
-        turn = opponent_actor(turn);
+    unsigned long played = 0;
+    int converged_round = 0;
+    for (int round = 1; played < total_games; round++)
+    {
+        struct RlTrainJob job =
+        {
+            .table = table,
+            .geometry = geometry,
+            .first_game = played,
+            .games = (total_games - played < RL_ROUND_GAMES) ? total_games - played : RL_ROUND_GAMES,
+            .seed = seed,
+            .next_game = 0,
+        };
 
-        MovePrint selection_highlight = 0;
-        edit_move_print(&selection_highlight, missing_coords[selection], true);
+        uint64_t start = monotonic_ns();
+        unsigned int started = 0;
+        while (started + 1 < threads && start_worker_thread(&workers[started], rl_train_worker, &job))
+            started++;
+        rl_train_worker(&job);
+        for (unsigned int i = 0; i < started; i++)
+            join_worker_thread(&workers[i]);
+        double seconds = (monotonic_ns() - start) / 1e9;
+        played += job.games;
+
+        size_t values_ok, moves_ok;
+        check_rl_table(table, &reference, &solved, &values_ok, &moves_ok);
+        // Threads além dos processadores não são núcleos a mais.
+        unsigned int cores = (started + 1 < cpu_count()) ? started + 1 : cpu_count();
+        printf("%-8d %12lu %19.0f %11.1f%% %13.1f%%\n", round, played,
+            job.games / ((seconds > 0) ? seconds : 1e-9) / cores,
+            100.0 * values_ok / reference.after_len, 100.0 * moves_ok / reference.positions_len);
+
+        if (converged_round == 0 && values_ok == reference.after_len && moves_ok == reference.positions_len)
+            converged_round = round;
+    }
 
-        render_game_board(board, NULL_ACTOR, selection_highlight);
+    if (converged_round > 0)
+        printf("\nConvergiu para o jogo perfeito na rodada %d.\n", converged_round);
+    else
+        printf("\nAinda não convergiu para o jogo perfeito.\n");
 
-        animated |= (1 << selection);
-        if (i < missing_len)
-            move_cursor(vec2(0, -9));
-        block_delay(250);
+    if (!save_rl_table(table, path))
+    {
+        perror(path);
+        goto FREE_ALL;
     }
+    printf("Tabela gravada em %s (use --rl-table %s)\n", path, path);
+    status = 0;
+
+    FREE_ALL:;
+    if (has_solved)
+        free(solved.results);
+    free(table);
+    free(reference.after_slots);
+    free(reference.after_values);
+    free(reference.positions);
+    free(seen);
+    free(workers);
+    return status;
 }
 
 /**
- * Desenha o jogo.
+ * O modo em rede usa "sockets" de domínio Unix
+ * (arquivos especiais que ligam dois processos
+ * na mesma máquina) e só existe em sistemas POSIX.
+ *
+ * O protocolo é feito de linhas de texto curtas:
+ *
+ * Cliente → servidor:
+ *  - `JOIN`: entra na fila por um oponente;
+ *  - `MOVE C`: joga na célula `C` (0-8, `y * 3 + x`);
+ *  - `QUIT`: desiste da partida.
+ *
+ * Servidor → cliente:
+ *  - `WAIT`: ainda não há oponente;
+ *  - `START A S`: a partida começou, você é `A`
+ *    e `S` começa (ambos `x` ou `o`);
+ *  - `MOVE C`: o oponente jogou em `C`;
+ *  - `END R`: a partida terminou (`x`, `o` ou `draw`);
+ *  - `LEFT`: o oponente saiu;
+ *  - `ERR`: comando inválido.
  */
-void render_game(struct GameState *state)
-{
-    struct Vec2 screen_size = display_size();
-    struct Vec2 screen_offset = {(screen_size.x / 2) - 9, (screen_size.y / 2) - 6};
-    new_screen_frame(false);
-    set_cursor_position(screen_offset);
+#if defined (__unix__) || defined (__APPLE__)
 
-    render_game_frame(state->endgame);
-    move_cursor(vec2(-19, 1));
-    render_endgame(state->endgame, state->turn, state->moves);
-    printf("    Jogadas: %d", state->moves);
-    move_cursor(vec2(-12, -11));
+/**
+ * Tamanho máximo de uma linha do protocolo.
+ */
+#define NET_LINE_MAX 64
 
-    struct MovePrintTriplet separated_state = get_move_print_triplet(state->board);
+/**
+ * Quanto cada conexão pode acumular
+ * de respostas ainda não enviadas.
+ */
+#define NET_OUTPUT_MAX 512
 
-    MovePrint highlighting = 0;
-    switch (state->endgame)
-    {
-    case RUNNING:
-        edit_move_print(&highlighting, state->selection, true);
-        render_game_board(state->board, state->turn, highlighting);
-        break;
-    case GAME_DRAW:
-        game_board_fill_animation(state->board, state->turn, separated_state.free);
-        highlighting = separated_state.x | separated_state.o;
-        animate_board_rendering(state->board, NULL_ACTOR, highlighting);
-        break;
-    case X_VICTORY:
-        highlighting = test_move_print_winner(separated_state.x);
-        animate_board_rendering(state->board, X_ACTOR, highlighting);
-        break;
-    case O_VICTORY:
-        highlighting = test_move_print_winner(separated_state.o);
-        animate_board_rendering(state->board, O_ACTOR, highlighting);
-        break;
-    }
-}
+/**
+ * Quantos eventos pegamos de uma vez do `NetPoller`.
+ */
+#define NET_POLL_EVENTS 256
 
 /**
- * Representa a ação que o
- * jogador (ou IA) deseja fazer.
+ * Um aviso de que uma conexão
+ * pode ser lida ou escrita.
  */
-enum GameInput {
-    QUIT_INPUT,
-    UP_INPUT,
-    DOWN_INPUT,
-    LEFT_INPUT,
-    RIGHT_INPUT,
-    MOVE_INPUT,
+struct NetEvent
+{
+    int fd;
+    bool readable;
+    bool writable;
 };
 
 /**
- * Tipo genérico para argumentos
- * do GameInputSourceExecutor
+ * Espera por eventos em muitas conexões de uma vez.
+ *
+ * No Linux usa o `epoll`, que não precisa olhar
+ * todas as conexões a cada espera, nos outros
+ * sistemas usa o `poll` normal.
  */
-typedef void *GameInputSourceArgs;
+struct NetPoller
+{
+#if defined (__linux__)
+    int epoll_fd;
+    struct epoll_event events[NET_POLL_EVENTS];
+#else
+    struct pollfd *fds;
+    size_t len;
+    size_t cap;
+    /**
+     * Posição de cada conexão em `fds`
+     * (indexado pelo fd, `-1` para nenhuma).
+     */
+    int32_t *slots;
+    size_t slots_cap;
+    /**
+     * Onde a próxima busca começa, para
+     * nenhuma conexão ficar sempre por último.
+     */
+    size_t cursor;
+#endif
+};
+
+bool open_net_poller(struct NetPoller *poller)
+{
+#if defined (__linux__)
+    poller->epoll_fd = epoll_create1(0);
+    return poller->epoll_fd >= 0;
+#else
+    *poller = (struct NetPoller){0};
+    return true;
+#endif
+}
+
+void close_net_poller(struct NetPoller *poller)
+{
+#if defined (__linux__)
+    close(poller->epoll_fd);
+#else
+    free(poller->fds);
+    free(poller->slots);
+#endif
+}
 
 /**
- * Tipo do formato da função que
- * pega um input de algum lugar.
+ * Começa a esperar por leituras em `fd`.
  */
-typedef enum GameInput(*GameInputSourceExecutor)(GameInputSourceArgs);
+bool net_poller_add(struct NetPoller *poller, int fd)
+{
+#if defined (__linux__)
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = fd };
+    return epoll_ctl(poller->epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+#else
+    if ((size_t)fd >= poller->slots_cap)
+    {
+        size_t cap = ((size_t)fd + 1) * 2;
+        int32_t *slots = realloc(poller->slots, cap * sizeof(int32_t));
+        if (slots == NULL)
+            return false;
+        for (size_t i = poller->slots_cap; i < cap; i++)
+            slots[i] = -1;
+        poller->slots = slots;
+        poller->slots_cap = cap;
+    }
+
+    if (poller->len == poller->cap)
+    {
+        size_t cap = (poller->cap == 0) ? 64 : poller->cap * 2;
+        struct pollfd *fds = realloc(poller->fds, cap * sizeof(struct pollfd));
+        if (fds == NULL)
+            return false;
+        poller->fds = fds;
+        poller->cap = cap;
+    }
+
+    poller->slots[fd] = poller->len;
+    poller->fds[poller->len++] = (struct pollfd){ .fd = fd, .events = POLLIN };
+    return true;
+#endif
+}
 
 /**
- * Estrutura para pegar a
- * entrada de algo no jogo.
+ * Liga ou desliga a espera por
+ * espaço para escrever em `fd`.
  */
-struct GameInputSource
+void net_poller_watch_output(struct NetPoller *poller, int fd, bool watch)
 {
-    GameInputSourceExecutor executor;
-    GameInputSourceArgs args;
-};
+#if defined (__linux__)
+    struct epoll_event event = { .events = EPOLLIN | (watch ? EPOLLOUT : 0), .data.fd = fd };
+    epoll_ctl(poller->epoll_fd, EPOLL_CTL_MOD, fd, &event);
+#else
+    poller->fds[poller->slots[fd]].events = POLLIN | (watch ? POLLOUT : 0);
+#endif
+}
 
 /**
- * Modifica o estado do jogo baseado
- * no input recebido pelo `game_input_source`.
- *
- * Sempre retorna `false`, ao menos que
- * o input recebido seja `QUIT_INPUT`, aí retorna `true`.
+ * Para de esperar por `fd` (antes de fechar ele).
  */
-bool process_game_input(struct GameState *state, struct GameInputSource game_input_source)
+void net_poller_remove(struct NetPoller *poller, int fd)
 {
-    enum GameInput input = game_input_source.executor(game_input_source.args);
+#if defined (__linux__)
+    epoll_ctl(poller->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#else
+    int32_t slot = poller->slots[fd];
+    struct pollfd last = poller->fds[--poller->len];
+    poller->fds[slot] = last;
+    poller->slots[last.fd] = slot;
+    poller->slots[fd] = -1;
+#endif
+}
 
-    switch (input)
+/**
+ * Espera por até `timeout_ms` milissegundos
+ * (negativo para sempre) e preenche `events`
+ * (com espaço para `NET_POLL_EVENTS`).
+ *
+ * Retorna quantos eventos chegaram,
+ * ou `-1` se a espera foi interrompida.
+ */
+int net_poller_wait(struct NetPoller *poller, struct NetEvent *events, int timeout_ms)
+{
+#if defined (__linux__)
+    int ready = epoll_wait(poller->epoll_fd, poller->events, NET_POLL_EVENTS, timeout_ms);
+    for (int i = 0; i < ready; i++)
     {
-    case QUIT_INPUT:
-        return true;
-    case UP_INPUT:
-        state->selection.y = ((state->selection.y + 3) - 1) % 3;
-        break;
-    case DOWN_INPUT:
-        state->selection.y = (state->selection.y + 1) % 3;
-        break;
-    case LEFT_INPUT:
-        state->selection.x = ((state->selection.x + 3) - 1) % 3;
-        break;
-    case RIGHT_INPUT:
-        state->selection.x = (state->selection.x + 1) % 3;
-        break;
-    case MOVE_INPUT:
+        uint32_t flags = poller->events[i].events;
+        events[i] = (struct NetEvent)
+        {
+            .fd = poller->events[i].data.fd,
+            // Um erro ou desligamento também "acorda"
+            // a leitura, que é quem descobre o que houve.
+            .readable = flags & (EPOLLIN | EPOLLHUP | EPOLLERR),
+            .writable = flags & EPOLLOUT,
+        };
+    }
+    return ready;
+#else
+    int ready = poll(poller->fds, poller->len, timeout_ms);
+    if (ready <= 0)
+        return ready;
+
+    int count = 0;
+    for (size_t i = 0; i < poller->len && count < NET_POLL_EVENTS; i++)
     {
-        struct Vec2 selection = state->selection;
-        enum Move move_in_cell = game_board_cell(state->board, selection);
-        if (move_in_cell == FREE_MOVE)
+        struct pollfd *pfd = &poller->fds[(poller->cursor + i) % poller->len];
+        if (pfd->revents == 0)
+            continue;
+
+        events[count++] = (struct NetEvent)
         {
-            enum Move move = actor_to_move(state->turn);
-            set_game_board_cell(state->board, selection, move);
-            state->turn = opponent_actor(state->turn);
-            state->moves++;
-        }
-    }
+            .fd = pfd->fd,
+            .readable = pfd->revents & (POLLIN | POLLHUP | POLLERR),
+            .writable = pfd->revents & POLLOUT,
+        };
     }
-
-    return false;
+    poller->cursor++;
+    return count;
+#endif
 }
 
 /**
- * Calcula o número mínimo de
- * jogadas necessárias para ganhar
- * até o final do jogo, levando
- * em consideração quem iniciou o
- * jogo.
+ * Tenta aumentar o limite de arquivos
+ * abertos até o máximo permitido, cada
+ * conexão conta como um arquivo.
  */
-uint8_t calc_min_moves(bool starter, uint8_t moves)
+void raise_open_files_limit()
 {
-    uint8_t moves_left = 0;
-    if (starter)
-        moves_left = 5 - (moves - (moves / 2));
-    else
-        moves_left = 4 - (moves / 2);
-
-    uint8_t min_moves = 3 - moves_left;
-    return min_moves;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
 }
 
 /**
- * Detecta se houve algum
- * vencedor ou empate, e
- * então, atualiza o estado.
+ * Monta o endereço de um socket Unix em `path`.
  */
-void process_game_state(struct GameState *state)
+bool unix_socket_address(struct sockaddr_un *address, const char *path)
 {
-    // Assim que o jogo começa, nós guardamos
-    // quem começou, será SUPER importante
-    // para o algoritmo de detectar velha.
-    static enum Actor game_starter = NULL_ACTOR;
-    if (state->moves == 0)
+    *address = (struct sockaddr_un){ .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address->sun_path))
     {
-        game_starter = state->turn;
-        return;
+        errno = ENAMETOOLONG;
+        return false;
     }
+    strcpy(address->sun_path, path);
+    return true;
+}
 
-    // Não é possível ganhar um jogo com
-    // 4 jogadas, então ¯\_(ツ)_/¯
-    if (state->moves < 5)
-        return;
-
-    struct MovePrintTriplet separated_state = get_move_print_triplet(state->board);
-
-    MovePrint x_moves = separated_state.x;
-    MovePrint o_moves = separated_state.o;
-    MovePrint free_moves = separated_state.free;
-
-    MovePrint x_match = test_move_print_winner(x_moves);
-    MovePrint o_match = test_move_print_winner(o_moves);
-    if (x_match || o_match)
+/**
+ * Cria um socket Unix esperando conexões em `path`.
+ *
+ * Retorna `-1` em caso de erro (veja `errno`).
+ */
+int listen_unix_socket(const char *path)
+{
+    struct sockaddr_un address;
+    if (!unix_socket_address(&address, path))
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    close_on_exec(fd);
+
+    // Um arquivo velho de uma execução
+    // anterior impediria o `bind`.
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(fd, SOMAXCONN) != 0)
     {
-        if (x_match)
-            state->endgame = X_VICTORY;
-        else
-            state->endgame = O_VICTORY;
-        return;
+        close(fd);
+        return -1;
     }
 
-    // Não há como detectar empate
-    // com menos de 6 jogadas.
-    if (state->moves < 6)
-        return;
-
-    bool is_x_starter = game_starter == X_ACTOR;
-    bool is_o_starter = game_starter == O_ACTOR;
-
-    uint8_t x_min_moves = calc_min_moves(is_x_starter, state->moves);
-    uint8_t o_min_moves = calc_min_moves(is_o_starter, state->moves);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
 
-    size_t free_moves_len = move_print_count(free_moves);
-    struct Vec2 free_moves_coords[3] = {0};
-    move_print_coords(free_moves, free_moves_coords);
+/**
+ * Conecta ao socket Unix em `path`.
+ *
+ * Retorna `-1` em caso de erro (veja `errno`).
+ */
+int connect_unix_socket(const char *path)
+{
+    struct sockaddr_un address;
+    if (!unix_socket_address(&address, path))
+        return -1;
 
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    close_on_exec(fd);
 
-    for (int i = 0; i < free_moves_len; i++)
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
     {
-        struct Vec2 cell_pos = free_moves_coords[i];
-
-        MovePrint x_lines[] = {
-            x_moves & match_move_prints[cell_pos.y],
-            x_moves & match_move_prints[cell_pos.x + 3],
-            x_moves & match_move_prints[6],
-            x_moves & match_move_prints[7],
-        };
-
-        MovePrint o_lines[] = {
-            o_moves & match_move_prints[cell_pos.y],
-            o_moves & match_move_prints[cell_pos.x + 3],
-            o_moves & match_move_prints[6],
-            o_moves & match_move_prints[7],
-        };
-
-        for (int i = 0; i < 4; i++)
-        {
-            MovePrint x_line = x_lines[i];
-            MovePrint o_line = o_lines[i];
-
-            bool can_x_win = test_move_print_purity(x_line, o_line)
-                && (move_print_count(x_line) >= x_min_moves);
-
-            bool can_o_win = test_move_print_purity(o_line, x_line)
-                && (move_print_count(o_line) >= o_min_moves);
-
-            if (can_x_win || can_o_win)
-                goto KEEP_GAME_RUNNING;
-        }
+        close(fd);
+        return -1;
     }
-
-    state->endgame = GAME_DRAW;
-
-    KEEP_GAME_RUNNING:
-    return;
+    return fd;
 }
 
 /**
- * Fica bloqueando o programa
- * até que o jogador digite alguma
- * tecla de confirmação ou saída/cancelamento.
+ * Envia o que couber de `buffer` sem bloquear,
+ * deixando em `buffer` só o que ficou faltando.
  *
- * Retorna `true` para real confirmação
- * e retorna `false` para caso queira saír/cancelar.
+ * Retorna `false` se a conexão quebrou.
  */
-bool blocking_confirm()
+bool net_flush(int fd, char *buffer, size_t *len)
 {
-    while (true)
+    size_t sent = 0;
+    while (sent < *len)
     {
-        enum KeyboardInput key = keyboard_input();
-
-        switch (key)
+        ssize_t n = write(fd, buffer + sent, *len - sent);
+        if (n < 0)
         {
-            case KEY_Q:
-            case KEY_BACKSPACE:
-            case KEY_ESCAPE:
-                return false;
-            case KEY_ENTER:
-            case KEY_SPACE:
-                return true;
-            default:
+            if (errno == EINTR)
                 continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return false;
         }
+        sent += n;
     }
+
+    *len -= sent;
+    memmove(buffer, buffer + sent, *len);
+    return true;
 }
 
 /**
- * Executa uma iteração de evento
- * no jogo, retorna `true` se deve
- * continuar, e `false` se deve parar.
+ * Recebe o que já chegou em `fd` para o fim de `buffer`.
+ *
+ * Retorna `false` se a conexão acabou ou
+ * se uma linha não coube no `buffer`.
  */
-bool game_event_loop(struct GameState *state, struct GameInputSource game_input_source)
+bool net_receive(int fd, char *buffer, size_t *len, size_t cap)
 {
-    process_game_state(state);
+    if (*len == cap)
+        return false;
 
-    render_game(state);
+    ssize_t n;
+    do
+        n = read(fd, buffer + *len, cap - *len);
+    while (n < 0 && errno == EINTR);
 
-    if (state->endgame != RUNNING)
-    {
-        blocking_confirm();
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    if (n == 0)
         return false;
-    }
 
-    return !process_game_input(state, game_input_source);
+    *len += n;
+    return true;
 }
 
 /**
- * Bloqueia a execução e espera
- * uma entrada do jogador.
+ * Tira a primeira linha completa de `buffer`
+ * (sem o `\n`) e coloca em `line`.
  *
- * Compatível com o tipo `GameInputSourceExecutor`.
+ * Retorna `false` se ainda não há uma linha inteira.
  */
-enum GameInput player_game_input(GameInputSourceArgs a)
+bool net_take_line(char *buffer, size_t *len, char line[NET_LINE_MAX])
 {
-    while (true)
-    {
-        enum KeyboardInput key = keyboard_input();
+    char *end = memchr(buffer, '\n', *len);
+    if (end == NULL)
+        return false;
 
-        switch (key)
-        {
-        case KEY_W: case KEY_ARROW_UP: return UP_INPUT;
-        case KEY_A: case KEY_ARROW_LEFT: return LEFT_INPUT;
-        case KEY_S: case KEY_ARROW_DOWN: return DOWN_INPUT;
-        case KEY_D: case KEY_ARROW_RIGHT: return RIGHT_INPUT;
-        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE: return QUIT_INPUT;
-        case KEY_ENTER: case KEY_SPACE: return MOVE_INPUT;
-        default: continue;
-        }
-    }
+    size_t line_len = end - buffer;
+    memcpy(line, buffer, line_len);
+    line[line_len] = 0;
+
+    *len -= line_len + 1;
+    memmove(buffer, end + 1, *len);
+    return true;
 }
 
-struct AIBrain;
+/**
+ * Converte `x` ou `o` do protocolo para um ator.
+ */
+enum Actor net_actor(char c)
+{
+    switch (c)
+    {
+    case 'x': return X_ACTOR;
+    case 'o': return O_ACTOR;
+    default: return NULL_ACTOR;
+    }
+}
 
 /**
- * Tipo da função responsável
- * por ser o "cortex" da IA.
- * Responsável pela análise "visual",
- * análise "espacial" e tomada de decisão.
+ * Converte um ator para `x` ou `o` do protocolo.
  */
-typedef void (*AIBrainCortex)(struct AIBrain *brain);
+char net_actor_char(enum Actor actor)
+{
+    return (actor == X_ACTOR) ? 'x' : 'o';
+}
 
 /**
- * Macro que define o valor
- * do `goal` que indica que a IA
- * ainda não pensou em uma jogada.
+ * Uma conexão do servidor.
  */
-#define AI_THINKING_STATE vec2(-1, -1)
+struct ServerClient
+{
+    int fd;
+    char input[NET_LINE_MAX];
+    size_t input_len;
+    char output[NET_OUTPUT_MAX];
+    size_t output_len;
+    bool watching_output;
+    /**
+     * A conexão foi desligada por não dar conta
+     * das respostas, o fechamento chega pelo `NetPoller`.
+     */
+    bool broken;
+    /**
+     * Índice da partida atual (`-1` para nenhuma).
+     */
+    int32_t match;
+};
 
 /**
- * Macro para detectar se a IA
- * ainda precisa pensar em uma jogada.
- *
- * Veja: `AI_THINKING_STATE`
+ * Uma partida em andamento no servidor.
  */
-#define is_ai_thinking(v) ((v.x < 0) || (v.y < 0))
+struct ServerMatch
+{
+    struct GameState state;
+    /**
+     * As conexões do X e do O
+     * (`players[actor - 1]`), `-1` é a IA
+     * do servidor (veja `--server-ai`).
+     */
+    int players[2];
+    /**
+     * A IA do servidor, se ela jogar.
+     */
+    struct AIBrain brain;
+    /**
+     * Número da partida (`0` quando livre), para
+     * reconhecer esperas da IA de uma partida velha.
+     */
+    uint32_t tag;
+    /**
+     * Próxima partida da lista de
+     * livres (só vale quando livre).
+     */
+    int32_t next_free;
+};
 
 /**
- * A "cabeça" da IA.
+ * O servidor de partidas.
  */
-struct AIBrain
+struct GameServer
 {
+    int listen_fd;
+    struct NetPoller poller;
     /**
-     * Os "olhos" da IA,
-     * ela não pode modificar
-     * diretamente, apenas "ver".
+     * As conexões, indexadas pelo fd.
      */
-    struct GameState *view;
+    struct ServerClient **clients;
+    size_t clients_cap;
     /**
-     * O "tomador de decisão" da IA.
+     * As partidas, as livres formam uma
+     * lista que começa em `free_match`.
      */
-    AIBrainCortex cortex;
+    struct ServerMatch *matches;
+    size_t matches_len;
+    size_t matches_cap;
+    int32_t free_match;
     /**
-     * Quando os valores de goal
-     * forem negativos, significa
-     * que a IA ainda não pensou,
-     * enquanto valores positivos (0-2),
-     * indicam onde ela vai jogar.
-     *
-     * Veja: `AI_THINKING_STATE`
+     * Quem está esperando um oponente (`-1` para ninguém).
      */
-    struct Vec2 goal;
+    int waiting_fd;
+    /**
+     * Cortex da IA que joga contra quem entra
+     * (`NULL` para partidas só entre pessoas),
+     * e a agenda das esperas dela.
+     */
+    AIBrainCortex ai_cortex;
+    struct InputScheduler scheduler;
+    struct GameRecordWriter *recorder;
+    uint64_t connections;
+    uint64_t started;
+    uint64_t finished;
+    uint64_t moves;
 };
 
 /**
- * Construtor para `AIBrain`.
+ * Pedido para o servidor parar (`SIGINT`/`SIGTERM`).
  */
-struct AIBrain create_ai_brain(struct GameState *state, AIBrainCortex cortex)
+volatile sig_atomic_t server_stopping = false;
+
+void on_server_stop(int signal_number)
 {
-    return (struct AIBrain)
-    {
-        .view = state,
-        .cortex = cortex,
-        .goal = AI_THINKING_STATE,
-    };
+    (void)signal_number;
+    server_stopping = true;
 }
 
 /**
- * Executa o "cortex" da IA.
+ * Desliga uma conexão que não deu conta de receber
+ * as respostas, ela é fechada quando o `NetPoller`
+ * avisar do desligamento.
  */
-void ai_think(struct AIBrain *brain)
+void server_break_client(struct ServerClient *client)
 {
-    brain->cortex(brain);
+    client->broken = true;
+    client->output_len = 0;
+    shutdown(client->fd, SHUT_RDWR);
 }
 
 /**
- * Algoritmo para fazer a IA
- * "andar" pelo tabuleiro como
- * um jogador.
+ * Envia o que estiver pendente para uma conexão,
+ * esperando por espaço se não couber tudo agora.
  */
-enum GameInput ai_walk(struct AIBrain *brain)
+void server_flush(struct GameServer *server, struct ServerClient *client)
 {
-    struct Vec2 where_i_am = brain->view->selection;
-    struct Vec2 where_i_want = brain->goal;
-    struct Vec2 direction =
+    if (!net_flush(client->fd, client->output, &client->output_len))
     {
-        where_i_want.x - where_i_am.x,
-        where_i_want.y - where_i_am.y,
-    };
-    struct Vec2 distance = {abs(direction.x), abs(direction.y)};
+        server_break_client(client);
+        return;
+    }
 
-    if (distance.x > distance.y)
+    bool pending = client->output_len > 0;
+    if (pending != client->watching_output)
     {
-        if (direction.x < 0)
-            return LEFT_INPUT;
-        return RIGHT_INPUT;
+        net_poller_watch_output(&server->poller, client->fd, pending);
+        client->watching_output = pending;
     }
-    if (direction.y < 0)
-        return UP_INPUT;
-    return DOWN_INPUT;
 }
 
 /**
- * Simula alguém pensando e jogando,
- * enviando inputs gerados por software.
- *
- * Compatível com o tipo `GameInputSourceExecutor`.
+ * Manda uma linha formatada para uma conexão.
  */
-enum GameInput ai_game_input(GameInputSourceArgs a)
+void server_send(struct GameServer *server, struct ServerClient *client, const char *fmt, ...)
 {
-    struct AIBrain *brain = a;
-    
-    bool am_i_thinking = is_ai_thinking(brain->goal);
-    if (am_i_thinking)
-    {
-        block_delay((rand() % 300) + 300);
-        ai_think(brain);
-    }
+    if (client->broken)
+        return;
 
-    bool am_i_where_i_want = (brain->goal.x == brain->view->selection.x)
-        && (brain->goal.y == brain->view->selection.y);
-    if (am_i_where_i_want)
+    va_list args;
+    va_start(args, fmt);
+    size_t space = NET_OUTPUT_MAX - client->output_len;
+    int len = vsnprintf(client->output + client->output_len, space, fmt, args);
+    va_end(args);
+
+    if (len < 0 || (size_t)len >= space)
     {
-        block_delay(225);
-        brain->goal = AI_THINKING_STATE;
-        return MOVE_INPUT;
+        server_break_client(client);
+        return;
     }
-
-    block_delay((rand() % 50) + 100);
-    return ai_walk(brain);
+    client->output_len += len;
+    server_flush(server, client);
 }
 
 /**
- * Cortex ruim.
+ * Começa uma partida entre duas conexões,
+ * sorteando quem é X e quem começa.
  *
- * Basicamente, uma burrice artificial.
- * Apenas escolhe uma célula aleatória e joga.
+ * `b` pode ser `-1`, a IA do servidor.
+ * Se faltar memória, as duas conexões
+ * recebem `ERR` e são desligadas.
  */
-void dumb_ai_cortex(struct AIBrain *brain)
+void server_start_match(struct GameServer *server, int a, int b)
 {
-    struct Vec2 randomly_choosen_cell = {0};
+    int32_t index = server->free_match;
+    if (index >= 0)
+        server->free_match = server->matches[index].next_free;
+    else
+    {
+        if (server->matches_len == server->matches_cap)
+        {
+            size_t cap = (server->matches_cap == 0) ? 64 : server->matches_cap * 2;
+            struct ServerMatch *matches = realloc(server->matches, cap * sizeof(struct ServerMatch));
+            if (matches == NULL)
+            {
+                // Sem memória para a partida: avisamos os
+                // dois e desligamos, para ninguém ficar
+                // esperando um `START` que nunca vem.
+                int players[2] = {a, b};
+                for (int i = 0; i < 2; i++)
+                {
+                    if (players[i] < 0)
+                        continue;
+                    struct ServerClient *client = server->clients[players[i]];
+                    server_send(server, client, "ERR\n");
+                    server_break_client(client);
+                }
+                return;
+            }
+            server->matches = matches;
+            server->matches_cap = cap;
+        }
+        index = server->matches_len++;
+    }
 
-    do
-        randomly_choosen_cell = vec2(rand() % 3, rand() % 3);
-    while (game_board_cell(brain->view->board, randomly_choosen_cell) != FREE_MOVE);
+    bool swap = rand() % 2;
+    struct ServerMatch *match = &server->matches[index];
+    *match = (struct ServerMatch)
+    {
+        .state =
+        {
+            .turn = (enum Actor)((rand() % 2) + 1),
+            .recorder = server->recorder,
+        },
+        .players = { swap ? b : a, swap ? a : b },
+        .brain = create_ai_brain(NULL, server->ai_cortex),
+        .tag = (uint32_t)server->started + 1,
+        .next_free = -1,
+    };
+    // O mesmo pedido faz a IA parar de pensar.
+    match->brain.cancel = &server_stopping;
+    process_game_state(&match->state);
 
-    brain->goal = randomly_choosen_cell;
+    char starter = net_actor_char(match->state.turn);
+    for (int i = 0; i < 2; i++)
+    {
+        if (match->players[i] < 0)
+            continue;
+        struct ServerClient *client = server->clients[match->players[i]];
+        client->match = index;
+        server_send(server, client, "START %c %c\n", (i == 0) ? 'x' : 'o', starter);
+    }
+    server->started++;
+
+    if (match->players[match->state.turn - 1] < 0)
+        schedule_input(&server->scheduler, index, match->tag, monotonic_ns());
 }
 
 /**
- * Parte do cortex mediano/bom.
- *
- * Diz se a linha analisada é
- * potencialmente ruim de jogar.
+ * Libera uma partida, mandando `notice`
+ * para os jogadores que ainda estão nela.
  */
-bool avarage_ai_is_line_potentially_useless(MovePrint my_moves, MovePrint enemy_moves)
+void server_end_match(struct GameServer *server, int32_t index, const char *notice)
 {
-    return (!test_move_print_purity(enemy_moves, my_moves))
-        || move_print_count(enemy_moves) == 0;
+    struct ServerMatch *match = &server->matches[index];
+    for (int i = 0; i < 2; i++)
+    {
+        if (match->players[i] < 0)
+            continue;
+        struct ServerClient *client = server->clients[match->players[i]];
+        if (client == NULL || client->match != index)
+            continue;
+        client->match = -1;
+        server_send(server, client, "%s", notice);
+    }
+
+    match->tag = 0;
+    match->next_free = server->free_match;
+    server->free_match = index;
 }
 
 /**
- * Parte do cortex mediano/bom.
- *
- * Testa se alguém vai ganhar com
- * alguma jogada, o teste é feito
- * pela perspectiva do `testing`
+ * Fecha uma conexão, avisando o oponente.
  */
-bool avarage_ai_test_winner(MovePrint testing, MovePrint opponent)
+void server_drop_client(struct GameServer *server, int fd)
 {
-    return move_print_count(testing) == 2
-        && test_move_print_purity(testing, opponent);
+    struct ServerClient *client = server->clients[fd];
+    if (client->match >= 0)
+    {
+        int32_t match = client->match;
+        client->match = -1;
+        server_end_match(server, match, "LEFT\n");
+    }
+    if (server->waiting_fd == fd)
+        server->waiting_fd = -1;
+
+    net_poller_remove(&server->poller, fd);
+    close(fd);
+    free(client);
+    server->clients[fd] = NULL;
 }
 
 /**
- * Parte do cortex mediano/bom.
+ * Joga na célula `cell` pelo `actor` da partida
+ * `index`, avisa o oponente e termina a partida
+ * se for o caso.
  *
- * Enxerga quais jogadas faltam em uma linha.
+ * Retorna `false` se a jogada for inválida.
  */
-MovePrint avarage_ai_see_missing_moves(MovePrint my_moves, int match_print_i)
+bool server_play_move(struct GameServer *server, int32_t index, enum Actor actor, int cell)
 {
-    return my_moves ^ match_move_prints[match_print_i];
+    struct ServerMatch *match = &server->matches[index];
+    bool valid = cell >= 0 && cell < 9
+        && match->state.turn == actor
+        && play_game_move(&match->state, vec2(cell % 3, cell / 3));
+    if (!valid)
+        return false;
+    server->moves++;
+
+    process_game_state(&match->state);
+    int opponent = match->players[(actor == X_ACTOR) ? 1 : 0];
+    if (opponent >= 0)
+        server_send(server, server->clients[opponent], "MOVE %d\n", cell);
+    else if (match->state.endgame == RUNNING)
+        schedule_input(&server->scheduler, index, match->tag, monotonic_ns());
+
+    if (match->state.endgame != RUNNING)
+    {
+        const char *notice = "END draw\n";
+        if (match->state.endgame == X_VICTORY)
+            notice = "END x\n";
+        else if (match->state.endgame == O_VICTORY)
+            notice = "END o\n";
+
+        server->finished++;
+        server_end_match(server, index, notice);
+    }
+    return true;
 }
 
 /**
- * Parte do cortex mediano/bom.
+ * Dá um passo da IA de uma partida que
+ * acordou, agendando a próxima espera.
  *
- * Uma memória temporária para
- * armazenar possíveis jogadas.
+ * As esperas de partidas que já
+ * acabaram são só ignoradas.
  */
-struct AvarageAIMoveOptions
+void server_step_ai(struct GameServer *server, struct ScheduledInput due, uint64_t now)
 {
-    size_t len;
-    struct Vec2 moves[9];
-    MovePrint __stored_moves;
-};
+    struct ServerMatch *match = &server->matches[due.task];
+    if (match->tag != due.tag)
+        return;
+
+    // As partidas mudam de lugar quando
+    // a lista cresce, os "olhos" também.
+    match->brain.view = &match->state;
+    uint64_t wake_at = now;
+    enum GameInput input = ai_game_input_step(&match->brain, now, &wake_at);
+
+    if (input == WAIT_INPUT)
+        schedule_input(&server->scheduler, due.task, due.tag, wake_at);
+    else if (input == MOVE_INPUT)
+    {
+        struct Vec2 cell = match->state.selection;
+        // Uma célula ocupada faz a IA pensar de novo.
+        if (!server_play_move(server, due.task, match->state.turn, (cell.y * 3) + cell.x))
+            schedule_input(&server->scheduler, due.task, due.tag, now);
+    }
+    else
+    {
+        apply_game_input(&match->state, input);
+        schedule_input(&server->scheduler, due.task, due.tag, now);
+    }
+}
 
 /**
- * Parte do cortex mediano/bom.
- *
- * Adiciona mais uma jogada em um
- * `AvarageAIMoveOptions` se ainda
- * não houver a jogada `move`.
+ * Responde a uma linha recebida de uma conexão.
  */
-void avarage_ai_move_options_push(struct AvarageAIMoveOptions *opts, struct Vec2 move)
+void server_handle_line(struct GameServer *server, struct ServerClient *client, const char *line)
 {
-    if (!move_print_inspec(opts->__stored_moves, move))
+    int cell = -1;
+
+    if (!strcmp(line, "JOIN"))
     {
-        edit_move_print(&opts->__stored_moves, move, true);
-        opts->moves[opts->len] = move;
-        opts->len++;
+        if (client->match >= 0 || server->waiting_fd == client->fd)
+            server_send(server, client, "ERR\n");
+        else if (server->ai_cortex != NULL)
+            server_start_match(server, client->fd, -1);
+        else if (server->waiting_fd < 0)
+        {
+            server->waiting_fd = client->fd;
+            server_send(server, client, "WAIT\n");
+        }
+        else
+        {
+            int opponent = server->waiting_fd;
+            server->waiting_fd = -1;
+            server_start_match(server, opponent, client->fd);
+        }
     }
+    else if (!strcmp(line, "QUIT"))
+    {
+        if (server->waiting_fd == client->fd)
+            server->waiting_fd = -1;
+        if (client->match >= 0)
+        {
+            int32_t match = client->match;
+            client->match = -1;
+            server_end_match(server, match, "LEFT\n");
+        }
+    }
+    else if (sscanf(line, "MOVE %d", &cell) == 1 && client->match >= 0)
+    {
+        int32_t index = client->match;
+        enum Actor actor = (server->matches[index].players[0] == client->fd) ? X_ACTOR : O_ACTOR;
+        if (!server_play_move(server, index, actor, cell))
+            server_send(server, client, "ERR\n");
+    }
+    else
+        server_send(server, client, "ERR\n");
 }
 
 /**
- * Parte do cortex mediano/bom.
- *
- * Pega aleatoriamente uma
- * jogada de um `AvarageAIMoveOptions`
+ * Aceita todas as conexões que estão esperando.
  */
-struct Vec2 avarage_ai_move_options_pick(struct AvarageAIMoveOptions *opts)
+void server_accept(struct GameServer *server)
 {
-    if (opts->len == 0) return vec2(-1, -1);
+    while (true)
+    {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0)
+            return;
 
-    if (opts->len == 1) return opts->moves[0];
-    return opts->moves[rand() % opts->len];
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        close_on_exec(fd);
+
+        if ((size_t)fd >= server->clients_cap)
+        {
+            size_t cap = ((size_t)fd + 1) * 2;
+            struct ServerClient **clients = realloc(server->clients, cap * sizeof(struct ServerClient *));
+            if (clients == NULL)
+            {
+                close(fd);
+                continue;
+            }
+            memset(clients + server->clients_cap, 0, (cap - server->clients_cap) * sizeof(struct ServerClient *));
+            server->clients = clients;
+            server->clients_cap = cap;
+        }
+
+        struct ServerClient *client = malloc(sizeof(struct ServerClient));
+        if (client == NULL || !net_poller_add(&server->poller, fd))
+        {
+            free(client);
+            close(fd);
+            continue;
+        }
+
+        *client = (struct ServerClient){ .fd = fd, .match = -1 };
+        server->clients[fd] = client;
+        server->connections++;
+    }
 }
 
 /**
- * Cortex mediano/bom.
- *
- * Em resumo, o algoritmo consiste
- * em sempre tentar bloquear o oponente,
- * e ganhar assim que aparecer uma
- * oportunidade, mas não é
- * estratégico o suficiente
- * para ser impossível.
+ * Lê e responde tudo o que uma conexão mandou.
  */
-void avarage_ai_cortex(struct AIBrain *brain)
+void server_read_client(struct GameServer *server, struct ServerClient *client)
 {
-    bool should_i_start = brain->view->moves == 0;
-    if (should_i_start)
+    if (!net_receive(client->fd, client->input, &client->input_len, NET_LINE_MAX))
     {
-        brain->goal = vec2(rand() % 3, rand() % 3);
+        server_drop_client(server, client->fd);
         return;
     }
 
-    enum Actor me = brain->view->turn;
-    enum Actor enemy = opponent_actor(brain->view->turn);
-
-    struct MovePrintTriplet move_view = get_move_print_triplet(brain->view->board);
-    MovePrint all_my_moves = (me == X_ACTOR) ? move_view.x : move_view.o;
-    MovePrint all_enemy_moves = (enemy == X_ACTOR) ? move_view.x : move_view.o;
+    char line[NET_LINE_MAX];
+    while (net_take_line(client->input, &client->input_len, line))
+        server_handle_line(server, client, line);
+}
 
-    struct AvarageAIMoveOptions danger_cells = {0};
-    struct AvarageAIMoveOptions avarage_moves = {0};
-    struct AvarageAIMoveOptions potentially_useless = {0};
+/**
+ * Hospeda partidas entre jogadores conectados
+ * em `program_options.server_path`, até receber
+ * `SIGINT` (Ctrl+C) ou `SIGTERM`.
+ */
+int server_session()
+{
+    struct GameServer server =
+    {
+        .free_match = -1,
+        .waiting_fd = -1,
+    };
 
-    for (int i = 0; i < 8; i++)
+    raise_open_files_limit();
+    signal(SIGPIPE, SIG_IGN);
+
+    // Sem `SA_RESTART`, para a espera
+    // acordar quando o sinal chegar.
+    struct sigaction stop = { .sa_handler = on_server_stop };
+    sigemptyset(&stop.sa_mask);
+    sigaction(SIGINT, &stop, NULL);
+    sigaction(SIGTERM, &stop, NULL);
+
+    // A IA é dividida entre todas as partidas,
+    // então o cortex não pode guardar nada
+    // de uma partida (como um motor externo).
+    void *ai_data = NULL;
+    if (program_options.server_ai != NULL
+        && (!open_ai_cortex(program_options.server_ai, &server.ai_cortex, &ai_data) || ai_data != NULL))
     {
-        MovePrint my_moves = all_my_moves & match_move_prints[i];
-        MovePrint enemy_moves = all_enemy_moves & match_move_prints[i];
+        fprintf(stderr, "Cortex desconhecido ou que não dá para dividir: %s\n", program_options.server_ai);
+        if (server.ai_cortex != NULL)
+            close_ai_cortex(server.ai_cortex, ai_data);
+        return 1;
+    }
+    get_classic_mnk_geometry();
 
-        bool will_i_win = avarage_ai_test_winner(my_moves, enemy_moves);
-        if (will_i_win)
+    if (program_options.record_path != NULL)
+    {
+        server.recorder = malloc(sizeof(struct GameRecordWriter));
+        if (!open_game_record_writer(server.recorder, program_options.record_path, program_options.record_block_games))
         {
-            MovePrint missing_move = avarage_ai_see_missing_moves(my_moves, i);
-            move_print_coords(missing_move, &brain->goal);
-            return;
+            perror(program_options.record_path);
+            free(server.recorder);
+            return 1;
         }
+    }
 
-        if (avarage_ai_is_line_potentially_useless(my_moves, enemy_moves))
-        {
-            MovePrint moves = avarage_ai_see_missing_moves(my_moves, i);
-            uint8_t move_count = move_print_count(moves);
-            struct Vec2 move_coords[3] = {0};
-            move_print_coords(moves, move_coords);
-            for (int i = 0; i < move_count; i++)
-                avarage_ai_move_options_push(&potentially_useless, move_coords[i]);
-            continue;
-        }
+    server.listen_fd = listen_unix_socket(program_options.server_path);
+    if (server.listen_fd < 0 || !open_net_poller(&server.poller)
+        || !net_poller_add(&server.poller, server.listen_fd))
+    {
+        perror(program_options.server_path);
+        return 1;
+    }
 
-        bool will_enemy_win = avarage_ai_test_winner(enemy_moves, my_moves);
-        if (will_enemy_win)
+    printf("Servidor ouvindo em %s (Ctrl+C para parar)\n", program_options.server_path);
+
+    struct NetEvent events[NET_POLL_EVENTS];
+    while (!server_stopping)
+    {
+        // Dormimos até chegar algo ou até
+        // a próxima espera da IA terminar.
+        int timeout = input_scheduler_timeout(&server.scheduler, monotonic_ns());
+        int ready = net_poller_wait(&server.poller, events, timeout);
+        for (int i = 0; i < ready; i++)
         {
-            MovePrint missing_move = avarage_ai_see_missing_moves(enemy_moves, i);
-            struct Vec2 danger_cell = {0};
-            move_print_coords(missing_move, &danger_cell);
-            avarage_ai_move_options_push(&danger_cells, danger_cell);
-            continue;
-        }
+            struct NetEvent event = events[i];
+            if (event.fd == server.listen_fd)
+            {
+                server_accept(&server);
+                continue;
+            }
 
-        MovePrint available_moves = avarage_ai_see_missing_moves(enemy_moves, i);
-        struct Vec2 available_moves_coords[2] = {0};
-        move_print_coords(available_moves, available_moves_coords);
+            // A conexão pode ter sido fechada
+            // por um evento anterior da mesma leva.
+            struct ServerClient *client = server.clients[event.fd];
+            if (client == NULL)
+                continue;
+
+            if (event.writable && !client->broken)
+                server_flush(&server, client);
+            if (event.readable)
+                server_read_client(&server, client);
+        }
 
-        avarage_ai_move_options_push(&avarage_moves, available_moves_coords[0]);
-        avarage_ai_move_options_push(&avarage_moves, available_moves_coords[1]);
+        uint64_t now = monotonic_ns();
+        struct ScheduledInput due;
+        while (take_due_input(&server.scheduler, now, &due))
+            server_step_ai(&server, due, now);
     }
 
-    bool am_i_in_danger = danger_cells.len > 0;
-    bool do_i_have_good_moves = avarage_moves.len > 0;
+    for (size_t fd = 0; fd < server.clients_cap; fd++)
+        if (server.clients[fd] != NULL)
+            server_drop_client(&server, fd);
 
-    if (am_i_in_danger)
-        brain->goal = avarage_ai_move_options_pick(&danger_cells);
-    else if (do_i_have_good_moves)
-        brain->goal = avarage_ai_move_options_pick(&avarage_moves);
-    else
-        brain->goal = avarage_ai_move_options_pick(&potentially_useless);
+    close_net_poller(&server.poller);
+    close(server.listen_fd);
+    unlink(program_options.server_path);
+    free(server.clients);
+    free(server.matches);
+    close_input_scheduler(&server.scheduler);
+
+    if (server.recorder != NULL)
+    {
+        close_game_record_writer(server.recorder);
+        free(server.recorder);
+    }
+
+    printf("\nconexões: %llu, partidas: %llu começadas, %llu terminadas, jogadas: %llu\n",
+        (unsigned long long)server.connections,
+        (unsigned long long)server.started,
+        (unsigned long long)server.finished,
+        (unsigned long long)server.moves);
+    return 0;
 }
 
 /**
- * Estrutura que guarda
- * o tamanho em bytes (`blen`)
- * e o tamanho visual/utf-8 (`ulen`)
+ * Fonte de entrada de uma partida em rede
+ * no terminal, veja `network_local_game_input`
+ * e `network_remote_game_input`.
  */
-struct UStrLenRes
+struct NetworkInputSource
 {
-    size_t ulen;
-    size_t blen;
+    int fd;
+    struct GameState *view;
+    /**
+     * Com qual ator jogamos
+     * (`NULL_ACTOR` até a partida começar).
+     */
+    enum Actor local_actor;
+    /**
+     * A jogada do oponente até onde vamos
+     * "andar", ou `AI_THINKING_STATE` se
+     * ela ainda não chegou.
+     */
+    struct Vec2 goal;
+    char input[NET_LINE_MAX];
+    size_t input_len;
+    /**
+     * O oponente saiu (ou o servidor fechou).
+     */
+    bool opponent_left;
 };
 
 /**
- * Versão utf-8 do `strlen`, que conta
- * code points utf-8 além de contar os bytes.
+ * Manda uma linha para o servidor.
  */
-struct UStrLenRes ustrlen(const char *str)
+void network_send(struct NetworkInputSource *net, const char *line)
 {
-    struct UStrLenRes ln = {0, 0};
-    for (char c = *str; c != 0; str++, c = *str)
+    size_t len = strlen(line);
+    size_t sent = 0;
+    while (sent < len)
     {
-        // `(c & 0xC0) == 0x80` testa se
-        // o byte segue o padrão `10xxxxxx`,
-        // Se ele seguir, é só um byte de continuidade
-        // do utf-8 e não precisa ser contado.
-        ln.ulen += ((c & 0xC0) == 0x80) ? 0 : 1;
-        ln.blen++;
+        ssize_t n = write(net->fd, line + sent, len - sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            net->opponent_left = true;
+            return;
+        }
+        sent += n;
     }
-    return ln;
 }
 
 /**
- * Em vez de escrever texto
- * a partir do cursor, usa o
- * cursor como o centro do texto.
+ * Atualiza a fonte com uma linha do servidor.
+ *
+ * Retorna `true` se algo que interessa
+ * para quem espera mudou.
  */
-void write_center(const char *str)
+bool network_handle_line(struct NetworkInputSource *net, const char *line)
 {
-    struct UStrLenRes len = ustrlen(str);
-    size_t visual_half = len.ulen - (len.ulen / 2);
-    move_cursor(vec2(-visual_half, 0));
-    fwrite(str, 1, len.blen, stdout);
-}
+    char actor = 0, starter = 0;
+    int cell = -1;
 
-/// Flag para negrito.
-#define BOLD_FLAG ((uint8_t)(0x01))
-/// Flag para esvaecido.
-#define DIM_FLAG ((uint8_t)(0x02))
-/// Flag para itálico.
-#define ITALIC_FLAG ((uint8_t)(0x04))
-/// Flag para cor do texto.
-#define FOREGROUND_COLOR_FLAG ((uint8_t)0x08)
-/// Flag para cor do fundo.
-#define BACKGROUND_COLOR_FLAG ((uint8_t)0x10)
+    if (sscanf(line, "START %c %c", &actor, &starter) == 2)
+    {
+        *net->view = (struct GameState){ .turn = net_actor(starter) };
+        net->local_actor = net_actor(actor);
+        return true;
+    }
+    if (sscanf(line, "MOVE %d", &cell) == 1 && cell >= 0 && cell < 9)
+    {
+        net->goal = vec2(cell % 3, cell / 3);
+        return true;
+    }
+    if (!strcmp(line, "LEFT"))
+    {
+        net->opponent_left = true;
+        return true;
+    }
+    return false;
+}
 
 /**
- * Estrutura que guarda a
- * representação visual de um
- * texto para menus.
+ * Espera por uma tecla ou por uma novidade
+ * do servidor, o que vier primeiro.
  *
- * `fmt_flags` pode conter:
- * - `BOLD_FLAG`;
- * - `DIM_FLAG`;
- * - `ITALIC_FLAG`;
- * - `FOREGROUND_COLOR_FLAG` (depende do campo `foreground_color`);
- * - `BACKGROUND_COLOR_FLAG` (depende do campo `background_color`).
+ * Retorna `true` e preenche `key` quando for
+ * uma tecla, e `false` quando o estado
+ * da fonte mudou.
  */
-struct TextStyle
+bool network_wait_key(struct NetworkInputSource *net, enum KeyboardInput *key)
 {
-    struct Color foreground_color;
-    struct Color background_color;
-    uint8_t fmt_flags;
-};
+    char line[NET_LINE_MAX];
+    while (true)
+    {
+        bool changed = false;
+        while (net_take_line(net->input, &net->input_len, line))
+            changed |= network_handle_line(net, line);
+        if (changed || net->opponent_left)
+            return false;
+
+        // Teclas que já chegaram não
+        // acordariam o `poll` de novo.
+        if (input_decoder.len > 0)
+        {
+            *key = keyboard_input();
+            return true;
+        }
 
-/**
- * Um nó de texto que
- * guarda tanto um ponteiro
- * parao o texto em si, quanto
- * seu estilo atribuído.
- */
-struct TextNode
-{
-    struct TextStyle style;
-    const char *str;
-};
+        struct pollfd fds[] = {
+            { .fd = net->fd, .events = POLLIN },
+            { .fd = STDIN_FILENO, .events = POLLIN },
+            { .fd = display_resize_pipe[0], .events = POLLIN },
+        };
+        if (poll(fds, 3, -1) < 0)
+            continue;
+
+        if (fds[1].revents || fds[2].revents)
+        {
+            *key = keyboard_input();
+            return true;
+        }
+
+        if (fds[0].revents && !net_receive(net->fd, net->input, &net->input_len, NET_LINE_MAX))
+            net->opponent_left = true;
+    }
+}
 
 /**
- * Escreve um nó de texto
- * na tela, usando o cursor
- * como centro do texto, e
- * aplicando o estilo atribuído.
+ * A entrada do jogador local, que também
+ * manda as jogadas dele para o servidor.
+ *
+ * Compatível com o tipo `GameInputSourceExecutor`.
  */
-void write_text_node(struct TextNode node)
+enum GameInput network_local_game_input(GameInputSourceArgs a)
 {
-    if (node.style.fmt_flags & BOLD_FLAG)
-        set_bold();
-    else if (node.style.fmt_flags & DIM_FLAG)
-        set_dim();
+    struct NetworkInputSource *net = a;
 
-    if (node.style.fmt_flags & ITALIC_FLAG)
-        set_italic();
+    while (!net->opponent_left)
+    {
+        enum KeyboardInput key = KEY_UNSUPPORTED;
+        enum GameInput input = REDRAW_INPUT;
+        if (!network_wait_key(net, &key) || !player_key_input(key, &input))
+            continue;
+        // Não dá para desfazer uma jogada já enviada.
+        if (input == UNDO_INPUT || input == REDO_INPUT)
+            continue;
 
-    if (node.style.fmt_flags & FOREGROUND_COLOR_FLAG)
-        set_foreground_color(node.style.foreground_color);
-    if (node.style.fmt_flags & BACKGROUND_COLOR_FLAG)
-        set_background_color(node.style.foreground_color);
+        if (input == MOVE_INPUT)
+        {
+            struct Vec2 cell = net->view->selection;
+            if (game_board_cell(net->view->board, cell) != FREE_MOVE)
+                continue;
 
-    write_center(node.str);
+            char line[NET_LINE_MAX];
+            snprintf(line, sizeof(line), "MOVE %d\n", (cell.y * 3) + cell.x);
+            network_send(net, line);
+        }
+        else if (input == QUIT_INPUT)
+            network_send(net, "QUIT\n");
 
-    if (node.style.fmt_flags != 0)
-        reset_formatting();
+        return input;
+    }
+    return QUIT_INPUT;
 }
 
 /**
- * Escreve vários nós verticalmente, usando
- * o cursor como centro tanto horizontal
- * quanto vertical.
+ * A entrada do oponente remoto: espera a
+ * jogada dele chegar e "anda" até ela
+ * como a IA faz.
+ *
+ * Compatível com o tipo `GameInputSourceExecutor`.
  */
-void write_text_node_row(struct Vec2 offset, size_t n, struct TextNode nodes[n])
+enum GameInput network_remote_game_input(GameInputSourceArgs a)
 {
-    offset.y -= n - (n / 2);
-
-    set_cursor_position(offset);
+    struct NetworkInputSource *net = a;
 
-    for (size_t i = 0; i < n; i++)
+    while (is_ai_thinking(net->goal))
     {
-        write_text_node(nodes[i]);
-        offset.y += 1;
-        set_cursor_position(offset);
+        if (net->opponent_left)
+            return QUIT_INPUT;
+
+        enum KeyboardInput key = KEY_UNSUPPORTED;
+        enum GameInput input = REDRAW_INPUT;
+        if (!network_wait_key(net, &key) || !player_key_input(key, &input))
+            continue;
+
+        // Enquanto o oponente pensa, só
+        // dá para sair ou redesenhar.
+        if (input == QUIT_INPUT)
+        {
+            network_send(net, "QUIT\n");
+            return QUIT_INPUT;
+        }
+        if (input == REDRAW_INPUT)
+            return REDRAW_INPUT;
     }
-}
 
-/// Nenhum estilo (estilo plano).
-const struct TextStyle plain_style = {0};
-/// Estilo de título.
-const struct TextStyle title_style = { .fmt_flags = BOLD_FLAG, };
-/// Estilo de opção.
-const struct TextStyle option_style = { .fmt_flags = ITALIC_FLAG, };
-/// Estilo de informação/instrução.
-const struct TextStyle info_style = { .fmt_flags = DIM_FLAG | ITALIC_FLAG, };
+    bool am_i_where_i_want = (net->goal.x == net->view->selection.x)
+        && (net->goal.y == net->view->selection.y);
+    if (am_i_where_i_want)
+    {
+        block_delay(150);
+        net->goal = AI_THINKING_STATE;
+        return MOVE_INPUT;
+    }
 
-/**
- * Possíveis opções de jogo.
- */
-enum MainMenuOption
-{
-    QUIT_GAME,
-    PLAYER_VS_PLAYER,
-    PLAYER_VS_MACHINE,
-    MACHINE_VS_MACHINE,
-};
+    block_delay(75);
+    return walk_towards(net->view->selection, net->goal);
+}
 
 /**
- * Menu principal do jogo.
- * Mostra opções de jogo e
- * informa os controles.
+ * Tela de espera por um oponente.
+ *
+ * Retorna `false` se o jogador
+ * desistir ou o servidor fechar.
  */
-enum MainMenuOption main_menu()
+bool network_waiting_screen(struct NetworkInputSource *net)
 {
+    DRAW_POPUP:;
     new_screen_frame(true);
 
     struct Vec2 dsize = display_size();
     struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
 
-    struct TextNode menu[] = {
-        {title_style, "C Tic Tac Toe"},
-        {option_style, "1. Jogador vs. Jogador"},
-        {option_style, "2. Jogador vs. Máquina"},
-        {option_style, "3. Máquina vs. Máquina"},
-        {plain_style, ""},
-        {info_style, "Q Escape Backspace => Saír"},
+    struct TextNode info[] = {
+        {title_style, "Esperando um Oponente..."},
+        {plain_style, program_options.client_path},
         {plain_style, ""},
-        {title_style, "Controles"},
-        {info_style, "WASD ↑←↓→ => Mover"},
-        {info_style, "Espaço Enter => Marcar"},
+        {info_style, "Q Escape Backspace => Cancelar"},
     };
 
-    write_text_node_row(menu_offset, sizeof(menu)/sizeof(struct TextNode), menu);
+    write_text_node_row(menu_offset, sizeof(info)/sizeof(struct TextNode), info);
 
-    while (true)
+    while (net->local_actor == NULL_ACTOR)
     {
-        enum KeyboardInput key = keyboard_input();
+        enum KeyboardInput key = KEY_UNSUPPORTED;
+        if (!network_wait_key(net, &key))
+        {
+            if (net->opponent_left)
+                return false;
+            continue;
+        }
 
         switch (key)
         {
-        case KEY_1: return PLAYER_VS_PLAYER;
-        case KEY_2: return PLAYER_VS_MACHINE;
-        case KEY_3: return MACHINE_VS_MACHINE;
-        case KEY_ESCAPE: case KEY_Q: case KEY_BACKSPACE: return QUIT_GAME;
-        default: continue;
+        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE:
+            network_send(net, "QUIT\n");
+            return false;
+        case KEY_RESIZE:
+            goto DRAW_POPUP;
+        default:
+            continue;
         }
     }
+    return true;
 }
 
 /**
- * Um pequeno popup para
- * instruír os jogadores a
- * escolherem quem vai ser quem.
- *
- * Retorna `true` se os jogadores
- * decidirem procesguir, mas retorna
- * `false` se eles quiserem cancelar
- * a partida.
+ * Avisa que o oponente saiu da partida.
  */
-bool player_vs_player_popup()
+void network_left_popup()
 {
+    DRAW_POPUP:;
     new_screen_frame(true);
 
     struct Vec2 dsize = display_size();
     struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
 
     struct TextNode info[] = {
-        {title_style, "Decidam quem vai ser quem (X ou O)"},
-        {plain_style, "Quem começa (X ou O) é decidido aleatoriamente pelo jogo"},
+        {title_style, "O Oponente Saiu"},
         {plain_style, ""},
-        {info_style, "Espaço Enter => Confirmar"},
-        {info_style, "Q Escape Backspace => Cancelar"},
+        {info_style, "Espaço Enter => Continuar"},
     };
 
     write_text_node_row(menu_offset, sizeof(info)/sizeof(struct TextNode), info);
 
-    return blocking_confirm();
+    if (blocking_confirm() == NEEDS_REDRAW)
+        goto DRAW_POPUP;
 }
 
 /**
- * Um menu que deixa o jogador
- * decidir se ele quer usar X ou O.
- *
- * `NULL_ACTOR` significa cancelamento.
+ * Joga uma partida contra outra pessoa
+ * conectada ao servidor em
+ * `program_options.client_path`.
  */
-enum Actor player_actor_selection_menu()
+int client_session()
 {
-    new_screen_frame(true);
-
-    struct Vec2 dsize = display_size();
-    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+    int fd = connect_unix_socket(program_options.client_path);
+    if (fd < 0)
+    {
+        perror(program_options.client_path);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
 
-    struct TextStyle x_option =
+    struct GameState game = {0};
+    struct NetworkInputSource net =
     {
-        .fmt_flags = FOREGROUND_COLOR_FLAG | ITALIC_FLAG,
-        .foreground_color = actor_color(X_ACTOR),
+        .fd = fd,
+        .view = &game,
+        .goal = AI_THINKING_STATE,
     };
+    network_send(&net, "JOIN\n");
 
-    struct TextStyle o_option =
+    setup_terminal();
+
+    if (!network_waiting_screen(&net))
     {
-        .fmt_flags = FOREGROUND_COLOR_FLAG | ITALIC_FLAG,
-        .foreground_color = actor_color(O_ACTOR),
-    };
+        close(fd);
+        return 0;
+    }
 
-    struct TextNode menu[] = {
-        {title_style, "Escolha Sua Peça"},
-        {x_option, "1. Usar Peça X"},
-        {o_option, "2. Usar Peça O"},
-        {plain_style, ""},
-        {info_style, "Escolher X ou O não garante que você vai começar"},
-        {info_style, "Q Escape Backspace => Cancelar"},
+    struct GameInputSource local =
+    {
+        .executor = network_local_game_input,
+        .args = &net,
+    };
+    struct GameInputSource remote =
+    {
+        .executor = network_remote_game_input,
+        .args = &net,
     };
 
-    write_text_node_row(menu_offset, sizeof(menu)/sizeof(struct TextNode), menu);
+    actor_popup("Você Joga Com:", net.local_actor);
+    who_is_starting_popup(game.turn);
+    while (game_event_loop(&game, (game.turn == net.local_actor) ? local : remote));
 
-    while (true)
+    if (net.opponent_left && game.endgame == RUNNING)
+        network_left_popup();
+    after_game_screen(&game);
+
+    close(fd);
+    return 0;
+}
+
+/**
+ * Uma conexão do gerador de carga, que
+ * joga aleatoriamente o mais rápido possível.
+ */
+struct LoadClient
+{
+    int fd;
+    char input[NET_LINE_MAX];
+    size_t input_len;
+    char output[NET_OUTPUT_MAX];
+    size_t output_len;
+    bool watching_output;
+    struct GameState state;
+    enum Actor actor;
+    /**
+     * Quando a última jogada foi
+     * enviada (`0` para nenhuma).
+     */
+    uint64_t sent_at;
+};
+
+/**
+ * Guarda uma linha para enviar.
+ */
+void load_client_queue(struct LoadClient *client, const char *line)
+{
+    size_t len = strlen(line);
+    if (client->output_len + len <= NET_OUTPUT_MAX)
     {
-        enum KeyboardInput key = keyboard_input();
-        switch (key)
-        {
-        case KEY_1: return X_ACTOR;
-        case KEY_2: return O_ACTOR;
-        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE: return NULL_ACTOR;
-        default: continue;
-        }
+        memcpy(client->output + client->output_len, line, len);
+        client->output_len += len;
     }
 }
 
 /**
- * Menu para o jogador escolher
- * uma IA para jogar.
- *
- * `NULL` significa cancelamento.
+ * Joga numa célula livre aleatória.
  */
-AIBrainCortex ai_cortex_selection_menu(const char *ctitle, struct TextStyle *ctitle_style)
+void load_client_play(struct LoadClient *client, uint64_t *moves)
 {
-    new_screen_frame(true);
+    struct BoardSnapshot snapshot = client->state.snapshots[client->state.record.len];
+    MovePrint free_cells = ~(snapshot.x | snapshot.o) & 0x1ff;
 
-    struct Vec2 dsize = display_size();
-    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+    int choice = rand() % move_print_count(free_cells);
+    int cell = 0;
+    for (; cell < 9; cell++)
+        if (((free_cells >> cell) & 1) && choice-- == 0)
+            break;
 
-    struct TextNode menu[] = {
-        {
-            (ctitle_style == NULL) ? title_style : *ctitle_style,
-            (ctitle == NULL) ? "Escolha um Oponente" : ctitle,
-        },
-        {option_style, "1. Burrice Artificial (fácil)"},
-        {option_style, "2. Inteligência Bloqueante (médio)"},
-        {plain_style, ""},
-        {info_style, "Q Escape Backspace => Cancelar"},
-    };
+    play_game_move(&client->state, vec2(cell % 3, cell / 3));
+    process_game_state(&client->state);
 
-    write_text_node_row(menu_offset, sizeof(menu)/sizeof(struct TextNode), menu);
+    char line[NET_LINE_MAX];
+    snprintf(line, sizeof(line), "MOVE %d\n", cell);
+    load_client_queue(client, line);
+    client->sent_at = monotonic_ns();
+    (*moves)++;
+}
 
-    while (true)
+/**
+ * Abre `program_options.loadgen_connections`
+ * conexões com o servidor em
+ * `program_options.loadgen_path`, que jogam
+ * entre si até terminarem
+ * `program_options.loadgen_matches` partidas.
+ *
+ * Mostra a vazão e a latência das respostas
+ * (da nossa jogada até a jogada do oponente chegar).
+ */
+int loadgen_session()
+{
+    size_t count = (program_options.loadgen_connections > 0) ? program_options.loadgen_connections : 1000;
+    uint64_t target = (program_options.loadgen_matches > 0) ? program_options.loadgen_matches : 100000;
+
+    raise_open_files_limit();
+    signal(SIGPIPE, SIG_IGN);
+
+    struct NetPoller poller;
+    struct LoadClient *clients = calloc(count, sizeof(struct LoadClient));
+    if (clients == NULL || !open_net_poller(&poller))
     {
-        enum KeyboardInput key = keyboard_input();
-        switch (key)
+        free(clients);
+        return 1;
+    }
+
+    int max_fd = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        int fd = connect_unix_socket(program_options.loadgen_path);
+        if (fd < 0)
         {
-        case KEY_1: return dumb_ai_cortex;
-        case KEY_2: return avarage_ai_cortex;
-        case KEY_Q: case KEY_ESCAPE: case KEY_BACKSPACE: return NULL;
-        default: continue;
+            fprintf(stderr, "conexão %zu: ", i + 1);
+            perror(program_options.loadgen_path);
+            for (size_t j = 0; j < i; j++)
+                close(clients[j].fd);
+            free(clients);
+            close_net_poller(&poller);
+            return 1;
         }
+
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        net_poller_add(&poller, fd);
+        clients[i].fd = fd;
+        if (fd > max_fd)
+            max_fd = fd;
     }
-}
 
-/**
- * Mostra por mais ou menos 2 segundos um
- * popup mostrando quem vai começar
- * jogando (X ou O).
- */
-void who_is_starting_popup(enum Actor starter)
-{
-    new_screen_frame(true);
-    block_delay(200);
+    struct LoadClient **by_fd = calloc(max_fd + 1, sizeof(struct LoadClient *));
+    for (size_t i = 0; i < count; i++)
+        by_fd[clients[i].fd] = &clients[i];
 
-    struct Vec2 dsize = display_size();
-    struct Vec2 menu_offset = {dsize.x / 2, dsize.y / 2};
+    struct PhaseStats latency = {0};
+    uint64_t finished = 0;
+    uint64_t moves = 0;
+    uint64_t errors = 0;
+    uint64_t start = monotonic_ns();
 
-    struct TextStyle actor_titile_style =
+    for (size_t i = 0; i < count; i++)
     {
-        .fmt_flags = FOREGROUND_COLOR_FLAG | BOLD_FLAG,
-        .foreground_color = actor_color(starter),
-    };
+        load_client_queue(&clients[i], "JOIN\n");
+        net_flush(clients[i].fd, clients[i].output, &clients[i].output_len);
+    }
 
-    struct Vec2 title_offset = { menu_offset.x, menu_offset.y - 2 };
-    set_cursor_position(title_offset);
-    write_text_node((struct TextNode){actor_titile_style, "Quem Começa:"});
+    struct NetEvent events[NET_POLL_EVENTS];
+    bool broken = false;
+    while (finished < target && !broken)
+    {
+        int ready = net_poller_wait(&poller, events, -1);
+        for (int e = 0; e < ready; e++)
+        {
+            struct LoadClient *client = by_fd[events[e].fd];
 
-    struct Vec2 actor_box_offset = { menu_offset.x - 3, menu_offset.y - 1 };
-    set_cursor_position(actor_box_offset);
-    draw_game_cell(starter, actor_to_move(starter), true);
+            if (!net_receive(client->fd, client->input, &client->input_len, NET_LINE_MAX))
+            {
+                broken = true;
+                break;
+            }
 
-    block_delay(2E3 + 100);
-    new_screen_frame(true);
-    block_delay(200);
+            char line[NET_LINE_MAX];
+            while (net_take_line(client->input, &client->input_len, line))
+            {
+                char actor = 0, starter = 0;
+                int cell = -1;
+
+                if (sscanf(line, "START %c %c", &actor, &starter) == 2)
+                {
+                    client->state = (struct GameState){ .turn = net_actor(starter) };
+                    client->actor = net_actor(actor);
+                    client->sent_at = 0;
+                    process_game_state(&client->state);
+                    if (client->state.turn == client->actor)
+                        load_client_play(client, &moves);
+                }
+                else if (sscanf(line, "MOVE %d", &cell) == 1)
+                {
+                    if (client->sent_at != 0)
+                    {
+                        uint64_t ns = monotonic_ns() - client->sent_at;
+                        latency.count++;
+                        latency.total_ns += ns;
+                        latency.histogram[phase_histogram_bucket(ns)]++;
+                    }
+
+                    play_game_move(&client->state, vec2(cell % 3, cell / 3));
+                    process_game_state(&client->state);
+                    if (client->state.endgame == RUNNING)
+                        load_client_play(client, &moves);
+                }
+                else if (!strncmp(line, "END", 3))
+                {
+                    // Cada partida termina para os dois
+                    // lados, contamos só pelo lado do X.
+                    if (client->actor == X_ACTOR)
+                        finished++;
+                    load_client_queue(client, "JOIN\n");
+                }
+                else if (!strcmp(line, "LEFT") || !strcmp(line, "ERR"))
+                {
+                    errors++;
+                    load_client_queue(client, "JOIN\n");
+                }
+            }
+
+            if (!net_flush(client->fd, client->output, &client->output_len))
+                broken = true;
+
+            bool pending = client->output_len > 0;
+            if (pending != client->watching_output)
+            {
+                net_poller_watch_output(&poller, client->fd, pending);
+                client->watching_output = pending;
+            }
+        }
+    }
+
+    uint64_t elapsed = monotonic_ns() - start;
+    for (size_t i = 0; i < count; i++)
+        close(clients[i].fd);
+    free(by_fd);
+    free(clients);
+    close_net_poller(&poller);
+
+    if (broken)
+        fprintf(stderr, "O servidor fechou uma conexão\n");
+
+    double seconds = elapsed / 1e9;
+    char p50[16], p99[16], avarage[16];
+    format_duration(p50, sizeof(p50), phase_stats_percentile(&latency, 50));
+    format_duration(p99, sizeof(p99), phase_stats_percentile(&latency, 99));
+    format_duration(avarage, sizeof(avarage), (latency.count > 0) ? latency.total_ns / latency.count : 0);
+
+    printf("conexões:     %zu\n", count);
+    printf("partidas:     %llu (%.0f/s)\n", (unsigned long long)finished, finished / seconds);
+    printf("jogadas:      %llu (%.0f/s)\n", (unsigned long long)moves, moves / seconds);
+    printf("erros:        %llu\n", (unsigned long long)errors);
+    printf("tempo:        %.3f s\n", seconds);
+    printf("resposta:     média %s, p50 %s, p99 %s\n", avarage, p50, p99);
+    return broken ? 1 : 0;
+}
+
+#else
+
+int server_session()
+{
+    fprintf(stderr, "O modo em rede só existe em sistemas POSIX\n");
+    return 1;
+}
+
+int client_session()
+{
+    return server_session();
+}
+
+int loadgen_session()
+{
+    return server_session();
 }
 
+#endif
+
 /**
  * E finalmente, a função `main` !
  */
-int main()
+int main(int argc, char *argv[])
 {
-    setup_terminal();
+    if (!parse_program_options(argc, argv))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    srand(program_options.has_seed ? program_options.seed : time(NULL));
+    phase_stats_enabled = PHASE_STATS && program_options.stats;
+    if (program_options.trace_path != NULL)
+        start_tracing(program_options.trace_path);
+    if (program_options.nnue_path != NULL)
+    {
+        nnue_weights_ready = load_nnue_weights(&nnue_weights, program_options.nnue_path);
+        if (!nnue_weights_ready)
+        {
+            fprintf(stderr, "%s: não é um arquivo de pesos válido\n", program_options.nnue_path);
+            return 1;
+        }
+    }
+    if (program_options.rl_table_path != NULL)
+    {
+        rl_table = malloc(sizeof(struct RlTable));
+        if (rl_table == NULL || !load_rl_table(rl_table, program_options.rl_table_path))
+        {
+            fprintf(stderr, "%s: não é um arquivo de tabela válido\n", program_options.rl_table_path);
+            return 1;
+        }
+    }
+
+    if (program_options.engine_cortex != NULL)
+        return engine_session();
+    if (program_options.script_path != NULL)
+        return script_session();
+    if (program_options.selfplay_games > 0)
+        return selfplay_session();
+    if (program_options.read_records_path != NULL)
+        return read_records_session();
+    if (program_options.replay_path != NULL)
+        return replay_session();
+    if (program_options.perft_depth > 0)
+        return perft_session();
+    if (program_options.train_path != NULL)
+        return train_session();
+    if (program_options.rl_train_path != NULL)
+        return rl_train_session();
+    if (program_options.sprt_candidate != NULL)
+        return sprt_session();
+    if (program_options.tournament_games > 0)
+        return tournament_session();
+    if (program_options.ratings_path != NULL)
+        return ratings_session();
+    if (program_options.crowd_games > 0)
+        return crowd_session();
+    if (program_options.bench_render)
+        return render_bench_session();
+    if (program_options.bench || program_options.bench_json_path != NULL)
+        return bench_session();
+    if (program_options.server_path != NULL)
+        return server_session();
+    if (program_options.client_path != NULL)
+        return client_session();
+    if (program_options.loadgen_path != NULL)
+        return loadgen_session();
 
-    srand(time(NULL));
+    setup_terminal();
     
     struct GameInputSource player =
     {
@@ -1965,6 +14263,7 @@ int main()
             if (player_vs_player_popup() == false) break;
             who_is_starting_popup(game.turn);
             while (game_event_loop(&game, player));
+            after_game_screen(&game);
             break;
         }
         case PLAYER_VS_MACHINE:
@@ -1975,6 +14274,9 @@ int main()
             AIBrainCortex ai_cortex = ai_cortex_selection_menu(NULL, NULL);
             if (ai_cortex == NULL) goto CHOOSING_ACTOR_START;
 
+            // Desfazer volta até a vez do jogador.
+            game.undo_whole_turn = true;
+
             struct AIBrain ai_brain = create_ai_brain(&game, ai_cortex);
             struct GameInputSource ai =
             {
@@ -1998,6 +14300,35 @@ int main()
 
             who_is_starting_popup(game.turn);
             while (game_event_loop(&game, (game.turn == X_ACTOR) ? x_input : o_input));
+            after_game_screen(&game);
+            break;
+        }
+        case ULTIMATE_GAME:
+        {
+            enum MainMenuOption mode = game_mode_menu("Jogo da Velha Supremo",
+                "Sua jogada manda o oponente para o tabuleiro da mesma posição");
+            if (mode == PLAYER_VS_PLAYER && player_vs_player_popup())
+                ultimate_game(NULL_ACTOR);
+            else if (mode == PLAYER_VS_MACHINE)
+            {
+                enum Actor player_actor = player_actor_selection_menu();
+                if (player_actor != NULL_ACTOR)
+                    ultimate_game(opponent_actor(player_actor));
+            }
+            break;
+        }
+        case QUBIC_GAME:
+        {
+            enum MainMenuOption mode = game_mode_menu("Qubic (4x4x4)",
+                "4 em linha num cubo, inclusive atravessando as camadas");
+            if (mode == PLAYER_VS_PLAYER && player_vs_player_popup())
+                qubic_game(NULL_ACTOR);
+            else if (mode == PLAYER_VS_MACHINE)
+            {
+                enum Actor player_actor = player_actor_selection_menu();
+                if (player_actor != NULL_ACTOR)
+                    qubic_game(opponent_actor(player_actor));
+            }
             break;
         }
         case MACHINE_VS_MACHINE:
@@ -2036,6 +14367,7 @@ int main()
 
             who_is_starting_popup(game.turn);
             while (game_event_loop(&game, (game.turn == X_ACTOR) ? x_ai : o_ai));
+            after_game_screen(&game);
             break;
         }
         }